@@ -36,9 +36,9 @@ def deser_uint256(f):
     return r
 
 # allows simple http get calls
-def http_get_call(host, port, path, response_object = 0):
+def http_get_call(host, port, path, response_object = 0, headers = {}):
     conn = httplib.HTTPConnection(host, port)
-    conn.request('GET', path)
+    conn.request('GET', path, headers=headers)
 
     if response_object:
         return conn.getresponse()
@@ -81,7 +81,8 @@ class RESTTest (BitcoinTestFramework):
 
         assert_equal(self.nodes[0].getbalance(), 10)
 
-        txid = self.nodes[0].sendtoaddress(self.nodes[1].getnewaddress(), 0.1)
+        address = self.nodes[1].getnewaddress()
+        txid = self.nodes[0].sendtoaddress(address, 0.1)
         self.sync_all()
         self.nodes[2].generate(1)
         self.sync_all()
@@ -351,5 +352,119 @@ class RESTTest (BitcoinTestFramework):
         json_obj = json.loads(json_string)
         assert_equal(json_obj['bestblockhash'], bb_hash)
 
+        ##################
+        # /rest/address/ #
+        ##################
+
+        bb_height = self.nodes[0].getblockcount()
+
+        # balance in json, as getaddressbalance returns it, at the tip
+        response = http_get_call(url.hostname, url.port, '/rest/address/balance/'+address+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 200)
+        etag = response.getheader('etag')
+        assert(etag is not None)
+        json_obj = json.loads(response.read())
+        rpc_balance = self.nodes[0].getaddressbalance(address)
+        assert_equal(json_obj['balance'], rpc_balance['balance'])
+        assert_equal(json_obj['received'], rpc_balance['received'])
+        assert_equal(json_obj['height'], bb_height)
+        assert_equal(json_obj['hash'], bb_hash)
+
+        # the same tag gets 304 without a body until the tip changes, and a different format has its own tag
+        response = http_get_call(url.hostname, url.port, '/rest/address/balance/'+address+self.FORMAT_SEPARATOR+'json', True, {'If-None-Match': etag})
+        assert_equal(response.status, 304)
+        assert_equal(response.getheader('etag'), etag)
+        assert_equal(response.read(), '')
+        response = http_get_call(url.hostname, url.port, '/rest/address/balance/'+address+self.FORMAT_SEPARATOR+'hex', True, {'If-None-Match': etag})
+        assert_equal(response.status, 200)
+        assert(response.getheader('etag') != etag)
+
+        # binary utxos start with the height and hash of the block they are read at, and hex is the same bytes
+        response = http_get_call(url.hostname, url.port, '/rest/address/utxos/'+address+self.FORMAT_SEPARATOR+'bin', True)
+        assert_equal(response.status, 200)
+        utxos_bin = response.read()
+        output = StringIO.StringIO(utxos_bin)
+        assert_equal(struct.unpack("i", output.read(4))[0], bb_height)
+        assert_equal(hex(deser_uint256(output))[2:].zfill(65).rstrip("L"), bb_hash)
+        assert_equal(struct.unpack("i", output.read(4))[0], 0) # nothing left to continue from
+        utxos_hex = http_get_call(url.hostname, url.port, '/rest/address/utxos/'+address+self.FORMAT_SEPARATOR+'hex')
+        assert_equal(utxos_hex, binascii.hexlify(utxos_bin) + "\n")
+
+        json_string = http_get_call(url.hostname, url.port, '/rest/address/utxos/'+address+self.FORMAT_SEPARATOR+'json')
+        json_obj = json.loads(json_string)
+        rpc_utxos = self.nodes[0].getaddressutxos(address)
+        assert_equal(len(json_obj['utxos']), len(rpc_utxos))
+        assert_equal(json_obj['utxos'][0]['txid'], txid)
+        assert_equal(json_obj['utxos'][0]['satoshis'], 10000000)
+
+        json_string = http_get_call(url.hostname, url.port, '/rest/address/deltas/'+address+self.FORMAT_SEPARATOR+'json')
+        json_obj = json.loads(json_string)
+        assert_equal(len(json_obj['deltas']), len(self.nodes[0].getaddressdeltas(address)))
+        assert_equal(json_obj['next'], 0)
+
+        # a height range returns what getaddressdeltas returns for it
+        tx_height = json_obj['deltas'][0]['height']
+        range_path = '/rest/address/deltas/%d/%d/' % (tx_height, tx_height)
+        json_string = http_get_call(url.hostname, url.port, range_path+address+self.FORMAT_SEPARATOR+'json')
+        json_obj = json.loads(json_string)
+        rpc_deltas = self.nodes[0].getaddressdeltas({'addresses': [address], 'start': tx_height, 'end': tx_height})
+        assert_equal(len(json_obj['deltas']), len(rpc_deltas))
+        assert_equal(json_obj['next'], 0)
+        range_path = '/rest/address/utxos/%d/%d/' % (tx_height + 1, bb_height)
+        json_string = http_get_call(url.hostname, url.port, range_path+address+self.FORMAT_SEPARATOR+'json')
+        assert_equal(len(json.loads(json_string)['utxos']), 0)
+
+        # bad ranges, and ranges for the balance, are rejected
+        response = http_get_call(url.hostname, url.port, '/rest/address/deltas/2/1/'+address+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 400)
+        response = http_get_call(url.hostname, url.port, '/rest/address/balance/1/2/'+address+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 400)
+
+        # a new tip changes the tag
+        self.nodes[0].generate(1)
+        self.sync_all()
+        response = http_get_call(url.hostname, url.port, '/rest/address/balance/'+address+self.FORMAT_SEPARATOR+'json', True, {'If-None-Match': etag})
+        assert_equal(response.status, 200)
+        assert(response.getheader('etag') != etag)
+
+        #########################
+        # /rest/compactsapling/ #
+        #########################
+
+        # the same range as z_getcompactsaplingblocks returns, as json and as the concatenated serialized blocks
+        bb_height = self.nodes[0].getblockcount()
+        start_hash = self.nodes[0].getblockhash(bb_height - 4)
+        rpc_blocks = self.nodes[0].z_getcompactsaplingblocks(bb_height - 4, 5)
+        json_string = http_get_call(url.hostname, url.port, '/rest/compactsapling/5/'+start_hash+self.FORMAT_SEPARATOR+'json')
+        assert_equal(json.loads(json_string), rpc_blocks)
+        assert_equal(rpc_blocks[0]['hash'], start_hash)
+        rpc_hex = self.nodes[0].z_getcompactsaplingblocks(bb_height - 4, 5, False)
+        hex_string = http_get_call(url.hostname, url.port, '/rest/compactsapling/5/'+start_hash+self.FORMAT_SEPARATOR+'hex')
+        assert_equal(hex_string, ''.join(rpc_hex) + "\n")
+
+        # a range past the tip stops there
+        json_string = http_get_call(url.hostname, url.port, '/rest/compactsapling/10/'+start_hash+self.FORMAT_SEPARATOR+'json')
+        assert_equal(len(json.loads(json_string)), 5)
+        response = http_get_call(url.hostname, url.port, '/rest/compactsapling/0/'+start_hash+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 400)
+
+        ####################################
+        # /rest/identity/, /rest/currency/ #
+        ####################################
+
+        # names keep their dots, and only a known format after the last one is the extension
+        response = http_get_call(url.hostname, url.port, '/rest/currency/no.such.currency'+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 404)
+        assert_equal(response.read().strip(), 'no.such.currency not found')
+        assert(response.getheader('etag') is None)
+
+        response = http_get_call(url.hostname, url.port, '/rest/currency/no.such.currency', True)
+        assert_equal(response.status, 404)
+        assert(response.read().startswith('output format not found'))
+
+        response = http_get_call(url.hostname, url.port, '/rest/identity/no.such.name@'+self.FORMAT_SEPARATOR+'hex', True)
+        assert_equal(response.status, 404)
+        assert(response.getheader('etag') is None)
+
 if __name__ == '__main__':
     RESTTest().main()
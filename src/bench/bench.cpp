@@ -0,0 +1,163 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench/bench.h"
+
+#include "clientversion.h"
+#include "random.h"
+#include "tinyformat.h"
+
+#include <univalue.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <regex>
+
+static int64_t GetBenchTimeNanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+benchmark::State::State(const std::string &nameIn, int nEvalsIn, uint64_t nIterationsIn) :
+    name(nameIn), nEvals(nEvalsIn), nIterations(std::max(nIterationsIn, (uint64_t)1)), nCount(nIterations), nStart(0)
+{
+}
+
+// called when an evaluation has run all of its iterations, and before the first
+bool benchmark::State::NextEvaluation()
+{
+    int64_t nNow = GetBenchTimeNanos();
+    if (nStart)
+    {
+        vElapsed.push_back(nNow - nStart);
+    }
+    if (vElapsed.size() >= nEvals)
+    {
+        return false;
+    }
+    // this call is the first iteration of the next evaluation
+    nCount = 1;
+    nStart = GetBenchTimeNanos();
+    return true;
+}
+
+uint256 benchmark::RandomHash()
+{
+    uint256 hash;
+    for (auto it = hash.begin(); it != hash.end(); it++)
+    {
+        *it = insecure_rand();
+    }
+    return hash;
+}
+
+benchmark::BenchRunner::BenchmarkMap &benchmark::BenchRunner::benchmarks()
+{
+    static BenchmarkMap benchmarksMap;
+    return benchmarksMap;
+}
+
+benchmark::BenchRunner::BenchRunner(const std::string &name, BenchFunction func, uint64_t nIterations)
+{
+    benchmarks().insert(std::make_pair(name, Bench({func, nIterations})));
+}
+
+void benchmark::BenchRunner::List(const std::string &filter)
+{
+    std::regex reFilter(filter);
+    for (auto &oneBench : benchmarks())
+    {
+        if (std::regex_match(oneBench.first, reFilter))
+        {
+            std::cout << oneBench.first << std::endl;
+        }
+    }
+}
+
+bool benchmark::BenchRunner::RunAll(const std::string &filter, int nEvals, double scaling, const std::string &printer)
+{
+    std::regex reFilter(filter);
+    UniValue results(UniValue::VARR);
+
+    if (printer == "csv")
+    {
+        std::cout << "name,evals,iterations,total_s,min_ns,median_ns,max_ns" << std::endl;
+    }
+    else if (printer != "json")
+    {
+        std::cout << strprintf("%-36s %6s %10s %10s %14s %14s %14s", "Benchmark", "evals", "iterations", "total(s)", "min(ns)", "median(ns)", "max(ns)") << std::endl;
+    }
+
+    for (auto &oneBench : benchmarks())
+    {
+        if (!std::regex_match(oneBench.first, reFilter))
+        {
+            continue;
+        }
+
+        // every benchmark sees the same pseudo random data from one run to the next
+        seed_insecure_rand(true);
+
+        State state(oneBench.first, nEvals, (uint64_t)(oneBench.second.nIterations * scaling));
+        try
+        {
+            oneBench.second.func(state);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << oneBench.first << ": " << e.what() << std::endl;
+            return false;
+        }
+        if (state.vElapsed.size() != nEvals)
+        {
+            std::cerr << oneBench.first << ": did not run its evaluations" << std::endl;
+            return false;
+        }
+
+        std::vector<int64_t> vSorted(state.vElapsed);
+        std::sort(vSorted.begin(), vSorted.end());
+        int64_t nTotal = 0;
+        for (auto oneElapsed : vSorted)
+        {
+            nTotal += oneElapsed;
+        }
+        double totalSeconds = nTotal * 0.000000001;
+        double minNanos = (double)vSorted.front() / state.nIterations;
+        double medianNanos = (double)vSorted[vSorted.size() / 2] / state.nIterations;
+        double maxNanos = (double)vSorted.back() / state.nIterations;
+
+        if (printer == "json")
+        {
+            UniValue oneResult(UniValue::VOBJ);
+            oneResult.push_back(Pair("name", oneBench.first));
+            oneResult.push_back(Pair("evals", nEvals));
+            oneResult.push_back(Pair("iterations", (uint64_t)state.nIterations));
+            oneResult.push_back(Pair("total_s", totalSeconds));
+            oneResult.push_back(Pair("min_ns", minNanos));
+            oneResult.push_back(Pair("median_ns", medianNanos));
+            oneResult.push_back(Pair("max_ns", maxNanos));
+            results.push_back(oneResult);
+        }
+        else if (printer == "csv")
+        {
+            std::cout << strprintf("%s,%d,%u,%.6f,%.1f,%.1f,%.1f", oneBench.first, nEvals, state.nIterations, totalSeconds, minNanos, medianNanos, maxNanos) << std::endl;
+        }
+        else
+        {
+            std::cout << strprintf("%-36s %6d %10u %10.3f %14.1f %14.1f %14.1f", oneBench.first, nEvals, state.nIterations, totalSeconds, minNanos, medianNanos, maxNanos) << std::endl;
+        }
+    }
+
+    if (printer == "json")
+    {
+        UniValue ret(UniValue::VOBJ);
+        ret.push_back(Pair("version", FormatFullVersion()));
+        ret.push_back(Pair("evals", nEvals));
+        ret.push_back(Pair("scaling", scaling));
+        ret.push_back(Pair("benchmarks", results));
+        std::cout << ret.write(2) << std::endl;
+    }
+    return true;
+}
@@ -0,0 +1,100 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef VERUS_BENCH_BENCH_H
+#define VERUS_BENCH_BENCH_H
+
+#include "uint256.h"
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/preprocessor/cat.hpp>
+#include <boost/preprocessor/stringize.hpp>
+
+/*
+ * A benchmark runs a fixed number of iterations in each of a fixed number of evaluations, so that results are comparable
+ * between runs and releases on the same machine, and reports the time per iteration of the fastest, median and slowest
+ * evaluation. Anything done before the loop is setup and is not timed:
+ *
+ * static void VerusHashV2b(benchmark::State &state)
+ * {
+ *     ... setup ...
+ *     while (state.KeepRunning())
+ *     {
+ *         ... what is measured ...
+ *     }
+ * }
+ * BENCHMARK(VerusHashV2b, 100000);
+ *
+ * where 100000 is the number of iterations in one evaluation, chosen so that an evaluation takes a few tens of
+ * milliseconds on a typical machine.
+ */
+namespace benchmark {
+
+class State
+{
+public:
+    State(const std::string &nameIn, int nEvalsIn, uint64_t nIterationsIn);
+
+    inline bool KeepRunning()
+    {
+        if (nCount < nIterations)
+        {
+            nCount++;
+            return true;
+        }
+        return NextEvaluation();
+    }
+
+    const std::string name;
+    const int nEvals;
+    const uint64_t nIterations;
+
+    //! nanoseconds taken by each evaluation that has finished
+    std::vector<int64_t> vElapsed;
+
+private:
+    bool NextEvaluation();
+
+    uint64_t nCount;
+    int64_t nStart;
+};
+
+typedef boost::function<void(State &)> BenchFunction;
+
+class BenchRunner
+{
+    struct Bench
+    {
+        BenchFunction func;
+        uint64_t nIterations;
+    };
+    typedef std::map<std::string, Bench> BenchmarkMap;
+    static BenchmarkMap &benchmarks();
+
+public:
+    BenchRunner(const std::string &name, BenchFunction func, uint64_t nIterations);
+
+    //! Run the benchmarks whose names match filter, a regular expression, scaling their iterations by scaling, and print
+    //! the results as a table, as "csv" or as "json" according to printer
+    static bool RunAll(const std::string &filter, int nEvals, double scaling, const std::string &printer);
+
+    //! Print the names of the benchmarks whose names match filter, one to a line
+    static void List(const std::string &filter);
+};
+
+//! A hash from the deterministic pseudo random sequence each benchmark starts with, for repeatable data
+uint256 RandomHash();
+
+}
+
+// BENCHMARK(foo, 1000) registers foo to run with 1000 iterations in each evaluation
+#define BENCHMARK(n, iterations) \
+    benchmark::BenchRunner BOOST_PP_CAT(bench_, BOOST_PP_CAT(__LINE__, n))(BOOST_PP_STRINGIZE(n), n, iterations);
+
+#endif // VERUS_BENCH_BENCH_H
@@ -0,0 +1,105 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench/bench.h"
+
+#include "chainparams.h"
+#include "crypto/common.h"
+#include "crypto/verus_hash.h"
+#include "key.h"
+#include "primitives/block.h"
+#include "pubkey.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <stdio.h>
+
+static const int DEFAULT_BENCH_EVALUATIONS = 5;
+static const char *DEFAULT_BENCH_FILTER = ".*";
+static const char *DEFAULT_BENCH_PRINTER = "console";
+
+static std::string BenchHelpMessage()
+{
+    std::string strUsage = "Usage:\n  bench_verus [options]\n\nOptions:\n";
+    strUsage += "  -?                    This help message\n";
+    strUsage += strprintf("  -filter=<regex>       Regular expression filter to select the benchmarks to run (default: %s)\n", DEFAULT_BENCH_FILTER);
+    strUsage += strprintf("  -evals=<n>            Number of times each benchmark is evaluated (default: %d)\n", DEFAULT_BENCH_EVALUATIONS);
+    strUsage += "  -scaling=<factor>     Multiply the iterations of each evaluation by factor (default: 1.0)\n";
+    strUsage += strprintf("  -printer=<format>     Output format, one of console, csv or json (default: %s)\n", DEFAULT_BENCH_PRINTER);
+    strUsage += "  -chain=<name>         Chain whose parameters the benchmarks run under (default: VRSCTEST)\n";
+    strUsage += "  -list                 List the benchmarks selected by -filter and exit\n";
+    return strUsage;
+}
+
+int main(int argc, char *argv[])
+{
+    ParseParameters(argc, argv);
+    if (mapArgs.count("-?") || mapArgs.count("-h") || mapArgs.count("-help"))
+    {
+        fprintf(stdout, "%s", BenchHelpMessage().c_str());
+        return EXIT_SUCCESS;
+    }
+
+    std::string printer = GetArg("-printer", DEFAULT_BENCH_PRINTER);
+    int nEvals = GetArg("-evals", DEFAULT_BENCH_EVALUATIONS);
+    double scaling = atof(GetArg("-scaling", "1.0").c_str());
+    if (nEvals < 1 || scaling <= 0 || (printer != "console" && printer != "csv" && printer != "json"))
+    {
+        fprintf(stderr, "Error: invalid -evals, -scaling or -printer\n%s", BenchHelpMessage().c_str());
+        return EXIT_FAILURE;
+    }
+
+    SetupEnvironment();
+    fPrintToDebugLog = false;
+    if (init_and_check_sodium() == -1)
+    {
+        fprintf(stderr, "Error: failed to initialize libsodium\n");
+        return EXIT_FAILURE;
+    }
+    ECC_Start();
+    boost::scoped_ptr<ECCVerifyHandle> globalVerifyHandle(new ECCVerifyHandle());
+
+    // chain parameters are set up as the daemon does, in a data directory of our own so nothing of a real node is touched
+    boost::filesystem::path pathTemp = GetTempPath() / strprintf("bench_verus_%lu_%i", (unsigned long)GetTime(), (int)GetRand(100000));
+    boost::filesystem::create_directories(pathTemp);
+    mapArgs["-datadir"] = pathTemp.string();
+    SoftSetArg("-chain", "VRSCTEST");
+
+    void komodo_args(char *argv0);
+    komodo_args(argv[0]);
+    bool fRet = SelectParamsFromCommandLine();
+    if (!fRet)
+    {
+        fprintf(stderr, "Error: invalid combination of -regtest and -testnet\n");
+    }
+    else
+    {
+        // every solution version is active from block 1, as on a new PBaaS chain
+        CVerusHash::init();
+        CVerusHashV2::init();
+        CBlockHeader::SetVerusV2Hash();
+        for (int32_t version = CActivationHeight::SOLUTION_VERUSV2; version < CActivationHeight::NUM_VERSIONS; version++)
+        {
+            CConstVerusSolutionVector::activationHeight.SetActivationHeight(version, 1);
+        }
+
+        if (mapArgs.count("-list"))
+        {
+            benchmark::BenchRunner::List(GetArg("-filter", DEFAULT_BENCH_FILTER));
+        }
+        else
+        {
+            fRet = benchmark::BenchRunner::RunAll(GetArg("-filter", DEFAULT_BENCH_FILTER), nEvals, scaling, printer);
+        }
+    }
+
+    globalVerifyHandle.reset();
+    ECC_Stop();
+    boost::system::error_code ec;
+    boost::filesystem::remove_all(pathTemp, ec);
+    return fRet ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,55 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef VERUS_BENCH_CHAIN_H
+#define VERUS_BENCH_CHAIN_H
+
+#include "bench/bench.h"
+
+#include "chain.h"
+#include "main.h"
+#include "utiltime.h"
+
+/**
+ * A chain of block index entries with no blocks behind them, which is the active chain while it exists, for benchmarks
+ * of code that needs a tip or a height but never reads a block from disk. The caller must hold cs_main.
+ */
+class CBenchChain
+{
+public:
+    std::vector<CBlockIndex *> vIndex;
+
+    CBenchChain(int32_t nTipHeight)
+    {
+        int64_t nStartTime = GetTime() - (nTipHeight + 1) * 60;
+        for (int32_t i = 0; i <= nTipHeight; i++)
+        {
+            CBlockIndex *pindex = new CBlockIndex();
+            pindex->SetHeight(i);
+            pindex->nTime = nStartTime + i * 60;
+            pindex->pprev = vIndex.size() ? vIndex.back() : NULL;
+            pindex->phashBlock = &(mapBlockIndex.insert(std::make_pair(benchmark::RandomHash(), pindex)).first->first);
+            pindex->BuildSkip();
+            vIndex.push_back(pindex);
+        }
+        chainActive.SetTip(vIndex.back());
+    }
+
+    ~CBenchChain()
+    {
+        chainActive.SetTip(NULL);
+        for (auto pindex : vIndex)
+        {
+            mapBlockIndex.erase(pindex->GetBlockHash());
+            delete pindex;
+        }
+    }
+
+    CBlockIndex *Tip()
+    {
+        return vIndex.back();
+    }
+};
+
+#endif // VERUS_BENCH_CHAIN_H
@@ -0,0 +1,165 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench/bench.h"
+#include "bench/coinsview.h"
+
+#include "amount.h"
+#include "random.h"
+#include "script/standard.h"
+
+#include <deque>
+
+// unspent transactions in the base view
+static const uint32_t BASE_COINS = 100000;
+// transactions spent and created in each iteration of the block benchmarks
+static const uint32_t BLOCK_TRANSACTIONS = 200;
+
+static CCoins RandomCoins(int nHeight)
+{
+    CCoins coins;
+    coins.nVersion = 1;
+    coins.nHeight = nHeight;
+    coins.fCoinBase = false;
+    coins.vout.resize(2);
+    for (auto &oneOut : coins.vout)
+    {
+        uint256 keyHash = benchmark::RandomHash();
+        oneOut.nValue = 1 + insecure_rand() % COIN;
+        oneOut.scriptPubKey = GetScriptForDestination(CKeyID(uint160(std::vector<unsigned char>(keyHash.begin(), keyHash.begin() + 20))));
+    }
+    return coins;
+}
+
+static void FillBaseView(CBenchCoinsView &base, std::vector<uint256> &txids)
+{
+    for (uint32_t i = 0; i < BASE_COINS; i++)
+    {
+        txids.push_back(benchmark::RandomHash());
+        base.mapCoins[txids.back()] = RandomCoins(1 + i / 1000);
+    }
+    base.hashBestBlock = benchmark::RandomHash();
+}
+
+// coins looked up through a cache that already holds them
+static void CoinsCacheAccessHit(benchmark::State &state)
+{
+    CBenchCoinsView base;
+    std::vector<uint256> txids;
+    FillBaseView(base, txids);
+    CCoinsViewCache cache(&base);
+    for (auto &txid : txids)
+    {
+        cache.AccessCoins(txid);
+    }
+    while (state.KeepRunning())
+    {
+        if (!cache.AccessCoins(txids[insecure_rand() % txids.size()]))
+        {
+            throw std::runtime_error("missing coins");
+        }
+    }
+}
+
+// coins looked up through a new cache, which copies them from the view under it
+static void CoinsCacheAccessMiss(benchmark::State &state)
+{
+    CBenchCoinsView base;
+    std::vector<uint256> txids;
+    FillBaseView(base, txids);
+    CCoinsViewCache tip(&base);
+    for (auto &txid : txids)
+    {
+        tip.AccessCoins(txid);
+    }
+    while (state.KeepRunning())
+    {
+        CCoinsViewCache cache(&tip);
+        for (int i = 0; i < 16; i++)
+        {
+            if (!cache.AccessCoins(txids[insecure_rand() % txids.size()]))
+            {
+                throw std::runtime_error("missing coins");
+            }
+        }
+    }
+}
+
+// what connecting a block does to the coins of its transparent transactions: a cache over the tip cache spends an
+// output of each of a block of earlier transactions, adds the new transactions, and is flushed to the tip
+static void CoinsCacheConnectFlush(benchmark::State &state)
+{
+    CBenchCoinsView base;
+    std::vector<uint256> txids;
+    FillBaseView(base, txids);
+    CCoinsViewCache tip(&base);
+    std::deque<uint256> live(txids.begin(), txids.end());
+    int nHeight = 1000;
+
+    while (state.KeepRunning())
+    {
+        CCoinsViewCache view(&tip);
+        for (uint32_t i = 0; i < BLOCK_TRANSACTIONS; i++)
+        {
+            {
+                CCoinsModifier spent = view.ModifyCoins(live.front());
+                uint32_t n = 0;
+                while (n < spent->vout.size() && spent->vout[n].IsNull())
+                {
+                    n++;
+                }
+                if (!spent->Spend(n))
+                {
+                    throw std::runtime_error("failed to spend coins");
+                }
+                // each output is spent in turn, coming back around for the next one
+                if (!spent->IsPruned())
+                {
+                    live.push_back(live.front());
+                }
+            }
+            live.pop_front();
+
+            uint256 newTxid = benchmark::RandomHash();
+            {
+                CCoinsModifier created = view.ModifyNewCoins(newTxid);
+                *created = RandomCoins(nHeight);
+            }
+            live.push_back(newTxid);
+        }
+        view.SetBestBlock(benchmark::RandomHash());
+        if (!view.Flush())
+        {
+            throw std::runtime_error("failed to flush coins");
+        }
+        nHeight++;
+    }
+}
+
+// writing the tip cache of one block's changes to the view under it, as a chainstate flush does
+static void CoinsCacheBatchWrite(benchmark::State &state)
+{
+    CBenchCoinsView base;
+    std::vector<uint256> txids;
+    FillBaseView(base, txids);
+    while (state.KeepRunning())
+    {
+        CCoinsViewCache tip(&base);
+        for (uint32_t i = 0; i < BLOCK_TRANSACTIONS; i++)
+        {
+            CCoinsModifier created = tip.ModifyNewCoins(benchmark::RandomHash());
+            *created = RandomCoins(1000);
+        }
+        tip.SetBestBlock(benchmark::RandomHash());
+        if (!tip.Flush())
+        {
+            throw std::runtime_error("failed to flush coins");
+        }
+    }
+}
+
+BENCHMARK(CoinsCacheAccessHit, 500000);
+BENCHMARK(CoinsCacheAccessMiss, 20000);
+BENCHMARK(CoinsCacheConnectFlush, 200);
+BENCHMARK(CoinsCacheBatchWrite, 200);
@@ -0,0 +1,115 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef VERUS_BENCH_COINSVIEW_H
+#define VERUS_BENCH_COINSVIEW_H
+
+#include "coins.h"
+
+#include <map>
+
+/**
+ * An in memory coins view to put caches on in benchmarks, which holds empty shielded trees as its best anchors, so that
+ * nothing a benchmark does reads from or writes to a database.
+ */
+class CBenchCoinsView : public CCoinsView
+{
+public:
+    std::map<uint256, CCoins> mapCoins;
+    uint256 hashBestBlock;
+    SproutMerkleTree sproutTree;
+    SaplingMerkleTree saplingTree;
+
+    bool GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const
+    {
+        if (rt == sproutTree.root())
+        {
+            tree = sproutTree;
+            return true;
+        }
+        return false;
+    }
+
+    bool GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const
+    {
+        if (rt == saplingTree.root())
+        {
+            tree = saplingTree;
+            return true;
+        }
+        return false;
+    }
+
+    bool GetNullifier(const uint256 &nullifier, ShieldedType type) const
+    {
+        return false;
+    }
+
+    bool GetCoins(const uint256 &txid, CCoins &coins) const
+    {
+        auto it = mapCoins.find(txid);
+        if (it == mapCoins.end())
+        {
+            return false;
+        }
+        coins = it->second;
+        return true;
+    }
+
+    bool HaveCoins(const uint256 &txid) const
+    {
+        return mapCoins.count(txid) != 0;
+    }
+
+    uint256 GetBestBlock() const
+    {
+        return hashBestBlock;
+    }
+
+    uint256 GetBestAnchor(ShieldedType type) const
+    {
+        if (type == SPROUT)
+        {
+            return sproutTree.root();
+        }
+        return saplingTree.root();
+    }
+
+    bool BatchWrite(CCoinsMap &mapCoinsIn,
+                    const uint256 &hashBlock,
+                    const uint256 &hashSproutAnchor,
+                    const uint256 &hashSaplingAnchor,
+                    CAnchorsSproutMap &mapSproutAnchors,
+                    CAnchorsSaplingMap &mapSaplingAnchors,
+                    CNullifiersMap &mapSproutNullifiers,
+                    CNullifiersMap &mapSaplingNullifiers)
+    {
+        for (auto &entry : mapCoinsIn)
+        {
+            if (entry.second.flags & CCoinsCacheEntry::DIRTY)
+            {
+                if (entry.second.coins.IsPruned())
+                {
+                    mapCoins.erase(entry.first);
+                }
+                else
+                {
+                    mapCoins[entry.first] = entry.second.coins;
+                }
+            }
+        }
+        mapCoinsIn.clear();
+        mapSproutAnchors.clear();
+        mapSaplingAnchors.clear();
+        mapSproutNullifiers.clear();
+        mapSaplingNullifiers.clear();
+        if (!hashBlock.IsNull())
+        {
+            hashBestBlock = hashBlock;
+        }
+        return true;
+    }
+};
+
+#endif // VERUS_BENCH_COINSVIEW_H
@@ -0,0 +1,176 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench/bench.h"
+#include "bench/chain.h"
+#include "bench/coinsview.h"
+
+#include "cc/CCinclude.h"
+#include "consensus/upgrades.h"
+#include "consensus/validation.h"
+#include "keystore.h"
+#include "main.h"
+#include "pbaas/identity.h"
+#include "pbaas/reserves.h"
+#include "random.h"
+#include "script/sign.h"
+#include "txmempool.h"
+#include "utilstrencodings.h"
+
+// spending transactions in the synthetic block, each with identity payments and a reserve transfer
+static const int PBAAS_BLOCK_TRANSACTIONS = 200;
+static const CAmount PBAAS_BLOCK_TX_FEE = 10000;
+
+static CKey DeterministicKey()
+{
+    CKey key;
+    while (!key.IsValid())
+    {
+        uint256 secret = benchmark::RandomHash();
+        key.Set(secret.begin(), secret.end(), true);
+    }
+    return key;
+}
+
+static uint160 RandomID()
+{
+    uint256 hash = benchmark::RandomHash();
+    return uint160(std::vector<unsigned char>(hash.begin(), hash.begin() + 20));
+}
+
+/*
+ * Validates, without writing anything, a block at the first PBaaS height whose transactions each spend a signed
+ * transparent output to two identities, a reserve transfer into a basket currency and change, with a coinbase that
+ * puts the block's fees in the fee pool. The block and all it spends live in memory over a chain of index entries, so
+ * this measures the checks of ConnectBlock and the CheckBlock it calls rather than disk access. With CCs enabled,
+ * CheckBlock adds the block's transactions to the mempool, so as on a node that relayed them, they are in the mempool
+ * and their signatures are in the signature cache after an untimed first connection. That connection also makes sure
+ * the block is valid, so that an invalid block is not timed as a fast failure.
+ */
+static void ConnectBlockPBaaS(benchmark::State &state)
+{
+    LOCK(cs_main);
+    const CChainParams &chainparams = Params();
+    const Consensus::Params &consensus = chainparams.GetConsensus();
+
+    CBenchChain chain(1);
+    int32_t nHeight = chain.Tip()->GetHeight() + 1;
+    uint32_t consensusBranchId = CurrentEpochBranchId(nHeight, consensus);
+
+    // PBaaS activates at this block, so there is no fee pool of an earlier block to read from disk
+    int32_t nOldPBaaSHeight = CConstVerusSolutionVector::activationHeight.heights[CActivationHeight::ACTIVATE_PBAAS];
+    CConstVerusSolutionVector::activationHeight.SetActivationHeight(CActivationHeight::ACTIVATE_PBAAS, nHeight);
+
+    CBenchCoinsView base;
+    base.hashBestBlock = chain.Tip()->GetBlockHash();
+    CCoinsViewCache tip(&base);
+    CCoinsViewCache *pcoinsTipOld = pcoinsTip;
+    pcoinsTip = &tip;
+
+    CBasicKeyStore keystore;
+    CBlock block;
+    block.vtx.resize(1);
+
+    uint160 basketID = RandomID();
+    CAmount nFees = 0;
+    for (int i = 0; i < PBAAS_BLOCK_TRANSACTIONS; i++)
+    {
+        CKey key = DeterministicKey();
+        keystore.AddKey(key);
+        CScript fromScript = GetScriptForDestination(key.GetPubKey().GetID());
+
+        uint256 prevTxid = benchmark::RandomHash();
+        CAmount nValueIn = 10 * COIN;
+        {
+            CCoinsModifier coins = tip.ModifyNewCoins(prevTxid);
+            coins->nVersion = 1;
+            coins->nHeight = nHeight - 1;
+            coins->vout.push_back(CTxOut(nValueIn, fromScript));
+        }
+
+        CMutableTransaction mtx = CreateNewContextualCMutableTransaction(consensus, nHeight);
+        mtx.vin.push_back(CTxIn(prevTxid, 0));
+        mtx.vout.push_back(CTxOut(COIN, CIdentity::TransparentOutput(CIdentityID(RandomID()))));
+        mtx.vout.push_back(CTxOut(COIN, CIdentity::TransparentOutput(CIdentityID(RandomID()))));
+
+        std::vector<CTxDestination> dests({CTxDestination(key.GetPubKey().GetID())});
+        CReserveTransfer rt(CReserveTransfer::VALID + CReserveTransfer::CONVERT,
+                            ASSETCHAINS_CHAINID,
+                            2 * COIN,
+                            ASSETCHAINS_CHAINID,
+                            0,
+                            basketID,
+                            DestinationToTransferDestination(dests[0]));
+        rt.nFees = rt.CalculateTransferFee();
+        CAmount transferValue = rt.TotalCurrencyOut().valueMap[ASSETCHAINS_CHAINID];
+        mtx.vout.push_back(CTxOut(transferValue, MakeMofNCCScript(CConditionObj<CReserveTransfer>(EVAL_RESERVE_TRANSFER, dests, 1, &rt))));
+        mtx.vout.push_back(CTxOut(nValueIn - (2 * COIN + transferValue + PBAAS_BLOCK_TX_FEE), fromScript));
+
+        if (!SignSignature(keystore, fromScript, mtx, 0, nValueIn, SIGHASH_ALL, consensusBranchId))
+        {
+            throw std::runtime_error("failed to sign transaction");
+        }
+        block.vtx.push_back(CTransaction(mtx));
+        nFees += PBAAS_BLOCK_TX_FEE;
+    }
+
+    // the coinbase takes the block subsidy and leaves all fees in the fee pool, as the miner does at PBaaS heights
+    CMutableTransaction coinbaseTx = CreateNewContextualCMutableTransaction(consensus, nHeight);
+    coinbaseTx.vin.push_back(CTxIn());
+    coinbaseTx.vin[0].scriptSig = CScript() << nHeight << OP_0;
+    coinbaseTx.vout.push_back(CTxOut(GetBlockSubsidy(nHeight, consensus), GetScriptForDestination(DeterministicKey().GetPubKey().GetID())));
+
+    CFeePool feePool(CCurrencyValueMap(std::vector<uint160>({ASSETCHAINS_CHAINID}), std::vector<int64_t>({nFees})));
+    CCcontract_info CC;
+    CCinit(&CC, EVAL_FEE_POOL);
+    CPubKey pkCC = CPubKey(ParseHex(CC.CChexstr));
+    coinbaseTx.vout.push_back(CTxOut(0, MakeMofNCCScript(CConditionObj<CFeePool>(EVAL_FEE_POOL, {pkCC.GetID()}, 1, &feePool))));
+    block.vtx[0] = coinbaseTx;
+
+    block.nVersion = CBlockHeader::CURRENT_VERSION;
+    block.hashPrevBlock = chain.Tip()->GetBlockHash();
+    block.hashMerkleRoot = block.BuildMerkleTree();
+    block.hashFinalSaplingRoot = base.saplingTree.root();
+    block.nTime = chain.Tip()->nTime + 60;
+    block.nBits = chain.Tip()->nBits;
+
+    uint256 blockHash = block.GetHash();
+    CBlockIndex index(block);
+    index.SetHeight(nHeight);
+    index.pprev = chain.Tip();
+    index.phashBlock = &blockHash;
+
+    bool fConnected = true;
+    std::string strError;
+    {
+        CValidationState validationState;
+        CCoinsViewCache view(&tip);
+        if (!ConnectBlock(block, validationState, &index, view, chainparams, true, false))
+        {
+            fConnected = false;
+            strError = "block did not connect: " + validationState.GetRejectReason();
+        }
+    }
+    while (fConnected && state.KeepRunning())
+    {
+        CValidationState validationState;
+        CCoinsViewCache view(&tip);
+        if (!ConnectBlock(block, validationState, &index, view, chainparams, true, false))
+        {
+            fConnected = false;
+            strError = "block did not connect: " + validationState.GetRejectReason();
+        }
+    }
+
+    // the mempool entries spend coins of the in-memory view, which is about to go
+    mempool.clear();
+    pcoinsTip = pcoinsTipOld;
+    CConstVerusSolutionVector::activationHeight.SetActivationHeight(CActivationHeight::ACTIVATE_PBAAS, nOldPBaaSHeight);
+    if (!fConnected)
+    {
+        throw std::runtime_error(strError);
+    }
+}
+
+BENCHMARK(ConnectBlockPBaaS, 10);
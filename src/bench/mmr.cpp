@@ -0,0 +1,141 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench/bench.h"
+
+#include "mmr.h"
+#include "random.h"
+
+#include <set>
+
+typedef CMerkleMountainRange<CDefaultMMRNode> BenchMMRange;
+typedef CMerkleMountainView<CDefaultMMRNode> BenchMMView;
+
+// about the number of blocks a chain MMR proves into over a couple of weeks
+static const uint32_t MMR_LEAVES = 20000;
+// elements in each multi-element proof, as in a batch of exports proven together
+static const uint32_t MULTIPROOF_ELEMENTS = 64;
+
+static void AddLeaves(BenchMMRange &mmr, std::vector<uint256> &leaves, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        leaves.push_back(benchmark::RandomHash());
+        mmr.Add(CDefaultMMRNode(leaves.back()));
+    }
+}
+
+static std::vector<uint64_t> RandomPositions(uint32_t count, uint64_t size)
+{
+    std::set<uint64_t> positionSet;
+    while (positionSet.size() < count)
+    {
+        positionSet.insert(insecure_rand() % size);
+    }
+    return std::vector<uint64_t>(positionSet.begin(), positionSet.end());
+}
+
+static void MMRAdd1024(benchmark::State &state)
+{
+    std::vector<uint256> leaves;
+    while (state.KeepRunning())
+    {
+        BenchMMRange mmr;
+        leaves.clear();
+        AddLeaves(mmr, leaves, 1024);
+    }
+}
+
+static void MMRGetProof(benchmark::State &state)
+{
+    BenchMMRange mmr;
+    std::vector<uint256> leaves;
+    AddLeaves(mmr, leaves, MMR_LEAVES);
+    BenchMMView view(mmr);
+    view.GetRoot();
+    while (state.KeepRunning())
+    {
+        CMMRProof proof;
+        if (!view.GetProof(proof, insecure_rand() % MMR_LEAVES))
+        {
+            throw std::runtime_error("failed to build proof");
+        }
+    }
+}
+
+static void MMRCheckProof(benchmark::State &state)
+{
+    BenchMMRange mmr;
+    std::vector<uint256> leaves;
+    AddLeaves(mmr, leaves, MMR_LEAVES);
+    BenchMMView view(mmr);
+    uint256 root = view.GetRoot();
+
+    std::vector<uint64_t> positions = RandomPositions(256, MMR_LEAVES);
+    std::vector<CMMRProof> proofs;
+    if (!view.GetProofs(proofs, positions))
+    {
+        throw std::runtime_error("failed to build proofs");
+    }
+    int i = 0;
+    while (state.KeepRunning())
+    {
+        if (proofs[i].CheckProof(leaves[positions[i]]) != root)
+        {
+            throw std::runtime_error("proof did not check");
+        }
+        i = (i + 1) % proofs.size();
+    }
+}
+
+static void MMRGetMultiProof(benchmark::State &state)
+{
+    BenchMMRange mmr;
+    std::vector<uint256> leaves;
+    AddLeaves(mmr, leaves, MMR_LEAVES);
+    BenchMMView view(mmr);
+    view.GetRoot();
+    std::vector<uint64_t> positions = RandomPositions(MULTIPROOF_ELEMENTS, MMR_LEAVES);
+    while (state.KeepRunning())
+    {
+        CMMRProof proof;
+        if (!view.GetMultiProof(proof, positions))
+        {
+            throw std::runtime_error("failed to build multi-element proof");
+        }
+    }
+}
+
+static void MMRCheckMultiProof(benchmark::State &state)
+{
+    BenchMMRange mmr;
+    std::vector<uint256> leaves;
+    AddLeaves(mmr, leaves, MMR_LEAVES);
+    BenchMMView view(mmr);
+    uint256 root = view.GetRoot();
+    std::vector<uint64_t> positions = RandomPositions(MULTIPROOF_ELEMENTS, MMR_LEAVES);
+    CMMRProof proof;
+    if (!view.GetMultiProof(proof, positions))
+    {
+        throw std::runtime_error("failed to build multi-element proof");
+    }
+    std::vector<uint256> hashes;
+    for (auto pos : positions)
+    {
+        hashes.push_back(leaves[pos]);
+    }
+    while (state.KeepRunning())
+    {
+        if (proof.CheckProof(hashes) != root)
+        {
+            throw std::runtime_error("multi-element proof did not check");
+        }
+    }
+}
+
+BENCHMARK(MMRAdd1024, 50);
+BENCHMARK(MMRGetProof, 20000);
+BENCHMARK(MMRCheckProof, 20000);
+BENCHMARK(MMRGetMultiProof, 100);
+BENCHMARK(MMRCheckMultiProof, 100);
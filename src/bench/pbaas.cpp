@@ -0,0 +1,174 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench/bench.h"
+#include "bench/chain.h"
+#include "bench/coinsview.h"
+
+#include "cc/CCinclude.h"
+#include "main.h"
+#include "pbaas/identity.h"
+#include "pbaas/reserves.h"
+#include "random.h"
+
+// reserve currencies of the fractional basket the conversion benchmarks use
+static const int BASKET_RESERVES = 4;
+// currency outputs spent and created by the reserve transaction descriptor benchmark
+static const int RESERVE_TX_OUTPUTS = 8;
+
+static uint160 RandomID()
+{
+    uint256 hash = benchmark::RandomHash();
+    return uint160(std::vector<unsigned char>(hash.begin(), hash.begin() + 20));
+}
+
+static CCurrencyState FractionalBasket(int numReserves)
+{
+    std::vector<uint160> currencies;
+    std::vector<int32_t> weights;
+    std::vector<int64_t> reserves;
+    for (int i = 0; i < numReserves; i++)
+    {
+        currencies.push_back(RandomID());
+        weights.push_back((int32_t)(SATOSHIDEN / numReserves));
+        reserves.push_back((1000000 + insecure_rand() % 1000000) * SATOSHIDEN);
+    }
+    CAmount supply = 10000000 * SATOSHIDEN;
+    return CCurrencyState(RandomID(), currencies, weights, reserves, supply, 0, supply, CCurrencyState::FLAG_FRACTIONAL);
+}
+
+static void ConvertAmountsSingle(benchmark::State &state)
+{
+    CCurrencyState basket = FractionalBasket(1);
+    while (state.KeepRunning())
+    {
+        CCurrencyState newState;
+        basket.ConvertAmounts(1000 * SATOSHIDEN, 500 * SATOSHIDEN, newState);
+        if (!newState.IsValid())
+        {
+            throw std::runtime_error("conversion failed");
+        }
+    }
+}
+
+// one block's conversions through a multi-reserve basket, both into and out of each reserve
+static void ConvertAmountsMulti(benchmark::State &state)
+{
+    CCurrencyState basket = FractionalBasket(BASKET_RESERVES);
+    std::vector<CAmount> reserveIn, fractionalIn;
+    for (int i = 0; i < BASKET_RESERVES; i++)
+    {
+        reserveIn.push_back((100 + insecure_rand() % 1000) * SATOSHIDEN);
+        fractionalIn.push_back((100 + insecure_rand() % 1000) * SATOSHIDEN);
+    }
+    while (state.KeepRunning())
+    {
+        CCurrencyState newState;
+        std::vector<CAmount> prices = basket.ConvertAmounts(reserveIn, fractionalIn, newState);
+        if (prices.size() != BASKET_RESERVES)
+        {
+            throw std::runtime_error("conversion failed");
+        }
+    }
+}
+
+static CIdentity BenchIdentity()
+{
+    std::vector<CTxDestination> primary;
+    for (int i = 0; i < 3; i++)
+    {
+        primary.push_back(CKeyID(RandomID()));
+    }
+    std::vector<std::pair<uint160, uint256>> contentMap;
+    for (int i = 0; i < 8; i++)
+    {
+        contentMap.push_back(std::make_pair(RandomID(), benchmark::RandomHash()));
+    }
+    uint160 parent = RandomID();
+    CIdentity identity(CIdentity::VERSION_PBAAS, 0, primary, 2, parent, "benchmarkidentity", contentMap, RandomID(), RandomID());
+    identity.systemID = parent;
+    return identity;
+}
+
+static void IdentitySerialize(benchmark::State &state)
+{
+    CIdentity identity = BenchIdentity();
+    while (state.KeepRunning())
+    {
+        if (::AsVector(identity).empty())
+        {
+            throw std::runtime_error("empty identity");
+        }
+    }
+}
+
+static void IdentityDeserialize(benchmark::State &state)
+{
+    std::vector<unsigned char> serialized = ::AsVector(BenchIdentity());
+    while (state.KeepRunning())
+    {
+        if (!CIdentity(serialized).IsValid())
+        {
+            throw std::runtime_error("invalid identity");
+        }
+    }
+}
+
+// a transaction that spends currency outputs into reserve transfers and new currency outputs, as a wallet sending
+// tokens and converting through a basket makes them
+static void ReserveTransactionDescriptor(benchmark::State &state)
+{
+    LOCK(cs_main);
+    CBenchChain chain(1);
+    int32_t nHeight = chain.Tip()->GetHeight() + 1;
+
+    CBenchCoinsView base;
+    CCoinsViewCache view(&base);
+    CMutableTransaction mtx = CreateNewContextualCMutableTransaction(Params().GetConsensus(), nHeight);
+
+    std::vector<CTxDestination> dests({CKeyID(RandomID())});
+    uint160 basketID = RandomID();
+    for (int i = 0; i < RESERVE_TX_OUTPUTS; i++)
+    {
+        uint160 currencyID = RandomID();
+        CTokenOutput tokenIn(currencyID, 1000 * SATOSHIDEN);
+        uint256 txid = benchmark::RandomHash();
+        {
+            CCoinsModifier coins = view.ModifyNewCoins(txid);
+            coins->nVersion = 1;
+            coins->nHeight = nHeight - 1;
+            coins->vout.push_back(CTxOut(0, MakeMofNCCScript(CConditionObj<CTokenOutput>(EVAL_RESERVE_OUTPUT, dests, 1, &tokenIn))));
+        }
+        mtx.vin.push_back(CTxIn(txid, 0));
+
+        CReserveTransfer rt(CReserveTransfer::VALID + CReserveTransfer::CONVERT,
+                            currencyID,
+                            500 * SATOSHIDEN,
+                            ASSETCHAINS_CHAINID,
+                            0,
+                            basketID,
+                            DestinationToTransferDestination(dests[0]));
+        rt.nFees = rt.CalculateTransferFee();
+        mtx.vout.push_back(CTxOut(rt.nFees, MakeMofNCCScript(CConditionObj<CReserveTransfer>(EVAL_RESERVE_TRANSFER, dests, 1, &rt))));
+
+        CTokenOutput tokenOut(currencyID, 500 * SATOSHIDEN);
+        mtx.vout.push_back(CTxOut(0, MakeMofNCCScript(CConditionObj<CTokenOutput>(EVAL_RESERVE_OUTPUT, dests, 1, &tokenOut))));
+    }
+    CTransaction tx(mtx);
+
+    while (state.KeepRunning())
+    {
+        CReserveTransactionDescriptor rtxd(tx, view, nHeight);
+        if (!rtxd.IsValid() || rtxd.IsReject())
+        {
+            throw std::runtime_error("invalid reserve transaction");
+        }
+    }
+}
+
+BENCHMARK(ConvertAmountsSingle, 20000);
+BENCHMARK(ConvertAmountsMulti, 2000);
+BENCHMARK(IdentitySerialize, 100000);
+BENCHMARK(IdentityDeserialize, 100000);
+BENCHMARK(ReserveTransactionDescriptor, 5000);
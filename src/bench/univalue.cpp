@@ -0,0 +1,184 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench/bench.h"
+
+#include "cc/CCinclude.h"
+#include "core_io.h"
+#include "main.h"
+#include "pbaas/identity.h"
+#include "pbaas/reserves.h"
+#include "random.h"
+#include "univalue.h"
+
+#include <sstream>
+
+// transactions in the block the JSON benchmarks decode, as getblock with verbosity 2 returns it
+static const int JSON_BLOCK_TRANSACTIONS = 200;
+// identities in the array the JSON benchmarks build, as listidentities returns it
+static const int JSON_IDENTITIES = 200;
+
+static uint160 RandomID()
+{
+    uint256 hash = benchmark::RandomHash();
+    return uint160(std::vector<unsigned char>(hash.begin(), hash.begin() + 20));
+}
+
+// a block of transactions that each spend a transparent output to two identities, a reserve transfer and change
+static CBlock JSONBenchBlock()
+{
+    CBlock block;
+    uint160 basketID = RandomID();
+    for (int i = 0; i < JSON_BLOCK_TRANSACTIONS; i++)
+    {
+        CMutableTransaction mtx;
+        uint256 sigHash = benchmark::RandomHash();
+        mtx.vin.push_back(CTxIn(benchmark::RandomHash(), 0, CScript() << std::vector<unsigned char>(sigHash.begin(), sigHash.end())));
+
+        std::vector<CTxDestination> dests({CTxDestination(CKeyID(RandomID()))});
+        mtx.vout.push_back(CTxOut(COIN, CIdentity::TransparentOutput(CIdentityID(RandomID()))));
+        mtx.vout.push_back(CTxOut(COIN, CIdentity::TransparentOutput(CIdentityID(RandomID()))));
+
+        CReserveTransfer rt(CReserveTransfer::VALID + CReserveTransfer::CONVERT,
+                            ASSETCHAINS_CHAINID,
+                            2 * COIN,
+                            ASSETCHAINS_CHAINID,
+                            0,
+                            basketID,
+                            DestinationToTransferDestination(dests[0]));
+        rt.nFees = rt.CalculateTransferFee();
+        mtx.vout.push_back(CTxOut(rt.TotalCurrencyOut().valueMap[ASSETCHAINS_CHAINID], MakeMofNCCScript(CConditionObj<CReserveTransfer>(EVAL_RESERVE_TRANSFER, dests, 1, &rt))));
+        mtx.vout.push_back(CTxOut(5 * COIN, GetScriptForDestination(dests[0])));
+        block.vtx.push_back(CTransaction(mtx));
+    }
+    return block;
+}
+
+static UniValue BlockToUniv(const CBlock &block)
+{
+    uint256 blockHash = block.GetHash();
+    UniValue txs(UniValue::VARR);
+    txs.reserve(block.vtx.size());
+    for (const CTransaction &tx : block.vtx)
+    {
+        UniValue objTx(UniValue::VOBJ);
+        TxToUniv(tx, blockHash, objTx);
+        txs.push_back(std::move(objTx));
+    }
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("hash", blockHash.GetHex()));
+    result.push_back(Pair("tx", std::move(txs)));
+    return result;
+}
+
+static UniValue IdentitiesToUniv()
+{
+    UniValue result(UniValue::VARR);
+    result.reserve(JSON_IDENTITIES);
+    for (int i = 0; i < JSON_IDENTITIES; i++)
+    {
+        std::vector<CTxDestination> primary({CTxDestination(CKeyID(RandomID())), CTxDestination(CKeyID(RandomID()))});
+        std::vector<std::pair<uint160, uint256>> contentMap({std::make_pair(RandomID(), benchmark::RandomHash())});
+        CIdentity identity(CIdentity::VERSION_PBAAS, 0, primary, 1, RandomID(), strprintf("identity%d", i), contentMap, RandomID(), RandomID());
+
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("identity", identity.ToUniValue()));
+        entry.push_back(Pair("status", "active"));
+        entry.push_back(Pair("canspendfor", true));
+        entry.push_back(Pair("cansignfor", true));
+        result.push_back(std::move(entry));
+    }
+    return result;
+}
+
+static void UniValueBuildBlock(benchmark::State &state)
+{
+    CBlock block = JSONBenchBlock();
+    while (state.KeepRunning())
+    {
+        if (BlockToUniv(block)["tx"].size() != block.vtx.size())
+        {
+            throw std::runtime_error("missing transactions");
+        }
+    }
+}
+
+// writing a new string for each reply, as the RPC server did before writing into its reply buffer
+static void UniValueWriteBlock(benchmark::State &state)
+{
+    UniValue result = BlockToUniv(JSONBenchBlock());
+    while (state.KeepRunning())
+    {
+        if (result.write().empty())
+        {
+            throw std::runtime_error("empty JSON");
+        }
+    }
+}
+
+// appending to a buffer that keeps its capacity from one reply to the next
+static void UniValueWriteBlockBuffer(benchmark::State &state)
+{
+    UniValue result = BlockToUniv(JSONBenchBlock());
+    std::string buffer;
+    while (state.KeepRunning())
+    {
+        buffer.clear();
+        result.write(buffer);
+        if (buffer.empty())
+        {
+            throw std::runtime_error("empty JSON");
+        }
+    }
+}
+
+static void UniValueWriteBlockStream(benchmark::State &state)
+{
+    UniValue result = BlockToUniv(JSONBenchBlock());
+    std::ostringstream os;
+    while (state.KeepRunning())
+    {
+        os.str(std::string());
+        result.write(os);
+        if (!os.good())
+        {
+            throw std::runtime_error("stream failed");
+        }
+    }
+}
+
+static void UniValueReadBlock(benchmark::State &state)
+{
+    std::string json = BlockToUniv(JSONBenchBlock()).write();
+    while (state.KeepRunning())
+    {
+        UniValue result;
+        if (!result.read(json))
+        {
+            throw std::runtime_error("invalid JSON");
+        }
+    }
+}
+
+static void UniValueWriteIdentities(benchmark::State &state)
+{
+    UniValue result = IdentitiesToUniv();
+    std::string buffer;
+    while (state.KeepRunning())
+    {
+        buffer.clear();
+        result.write(buffer, 1);
+        if (buffer.empty())
+        {
+            throw std::runtime_error("empty JSON");
+        }
+    }
+}
+
+BENCHMARK(UniValueBuildBlock, 20);
+BENCHMARK(UniValueWriteBlock, 50);
+BENCHMARK(UniValueWriteBlockBuffer, 50);
+BENCHMARK(UniValueWriteBlockStream, 50);
+BENCHMARK(UniValueReadBlock, 20);
+BENCHMARK(UniValueWriteIdentities, 200);
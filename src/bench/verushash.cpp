@@ -0,0 +1,116 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "bench/bench.h"
+
+#include "crypto/verus_hash.h"
+#include "hash.h"
+#include "random.h"
+#include "version.h"
+
+// the size of a serialized block header with its 1344 byte solution
+static const size_t HEADER_BYTES = 1487;
+
+static std::vector<unsigned char> RandomHeaderBytes()
+{
+    std::vector<unsigned char> vch(HEADER_BYTES);
+    for (auto &oneByte : vch)
+    {
+        oneByte = insecure_rand();
+    }
+    return vch;
+}
+
+static void VerusHashHeader(benchmark::State &state)
+{
+    std::vector<unsigned char> vch = RandomHeaderBytes();
+    uint256 hash;
+    while (state.KeepRunning())
+    {
+        verus_hash(hash.begin(), vch.data(), vch.size());
+        vch[0] = *hash.begin();
+    }
+}
+
+static void VerusHashV2Header(benchmark::State &state)
+{
+    std::vector<unsigned char> vch = RandomHeaderBytes();
+    CVerusHashV2Writer hw(SER_GETHASH, PROTOCOL_VERSION);
+    uint256 hash;
+    while (state.KeepRunning())
+    {
+        hw.Reset();
+        hw.write((const char *)vch.data(), vch.size());
+        hash = hw.GetHash();
+        vch[0] = *hash.begin();
+    }
+}
+
+// the hash used for blocks from VerusHash 2.0b onwards, which adds the CLHash of the final state with a key made from it
+static void VerusHashV2bVersion(benchmark::State &state, int solutionVersion)
+{
+    std::vector<unsigned char> vch = RandomHeaderBytes();
+    CVerusHashV2bWriter hw(SER_GETHASH, PROTOCOL_VERSION, solutionVersion);
+    uint256 hash;
+    while (state.KeepRunning())
+    {
+        hw.Reset();
+        hw.write((const char *)vch.data(), vch.size());
+        hash = hw.GetHash();
+        vch[0] = *hash.begin();
+    }
+}
+
+static void VerusHashV2bHeader(benchmark::State &state)
+{
+    VerusHashV2bVersion(state, SOLUTION_VERUSHHASH_V2);
+}
+
+static void VerusHashV2_1Header(benchmark::State &state)
+{
+    VerusHashV2bVersion(state, SOLUTION_VERUSHHASH_V2_1);
+}
+
+static void VerusHashV2_2Header(benchmark::State &state)
+{
+    VerusHashV2bVersion(state, SOLUTION_VERUSHHASH_V2_2);
+}
+
+// CLHash of one 64 byte buffer, with the key refreshed from the last one as it is for each hash
+static void CLHashV2_2(benchmark::State &state)
+{
+    CVerusHashV2 vh(SOLUTION_VERUSHHASH_V2_2);
+    alignas(32) unsigned char buf[64];
+    for (auto &oneByte : buf)
+    {
+        oneByte = insecure_rand();
+    }
+    while (state.KeepRunning())
+    {
+        u128 *key = CVerusHashV2::GenNewCLKey(buf);
+        uint64_t intermediate = vh.vclh(buf, key);
+        memcpy(buf + 32, &intermediate, sizeof(intermediate));
+    }
+}
+
+// VerusHash 2.0 of the 64 byte nodes that merkle trees and MMRs of blocks and transactions hash
+static void VerusHashV2Node(benchmark::State &state)
+{
+    uint256 left = benchmark::RandomHash(), right = benchmark::RandomHash();
+    while (state.KeepRunning())
+    {
+        CVerusHashV2Writer hw(SER_GETHASH, PROTOCOL_VERSION);
+        hw << left;
+        hw << right;
+        left = hw.GetHash();
+    }
+}
+
+BENCHMARK(VerusHashHeader, 20000);
+BENCHMARK(VerusHashV2Header, 20000);
+BENCHMARK(VerusHashV2bHeader, 20000);
+BENCHMARK(VerusHashV2_1Header, 20000);
+BENCHMARK(VerusHashV2_2Header, 20000);
+BENCHMARK(CLHashV2_2, 200000);
+BENCHMARK(VerusHashV2Node, 200000);
@@ -0,0 +1,214 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "blockmmrcache.h"
+
+#include "chainparams.h"
+#include "main.h"
+#include "util.h"
+
+#include <list>
+#include <map>
+
+static const char DB_BLOCK_TX_ROOTS = 'm';
+static const char DB_BLOCK_SEQ = 's';
+static const char DB_BLOCK_SEQ_RANGE = 'R';
+
+CBlockMMRDB *pblockmmrdb = NULL;
+
+CBlockMMRDB::CBlockMMRDB(size_t nCacheSize, int64_t nMaxBlocksIn, bool fMemory, bool fWipe) :
+    CDBWrapper(GetDataDir() / "blocks" / "mmrcache", nCacheSize, DefaultOptions(), fMemory, fWipe),
+    nMaxBlocks(std::max(nMaxBlocksIn, (int64_t)1)), nFirstSeq(0), nNextSeq(0)
+{
+    std::pair<uint64_t, uint64_t> seqRange;
+    if (Read(DB_BLOCK_SEQ_RANGE, seqRange))
+    {
+        nFirstSeq = seqRange.first;
+        nNextSeq = seqRange.second;
+    }
+}
+
+CDBOptions CBlockMMRDB::DefaultOptions()
+{
+    CDBOptions dbOptions;
+    dbOptions.nBloomBits = 10;
+    dbOptions.nBlockCachePercent = 75;
+    dbOptions.nWriteBufferPercent = 10;
+    return dbOptions;
+}
+
+bool CBlockMMRDB::ReadTxRoots(const uint256 &hash, std::vector<uint256> &vTxRoots) const
+{
+    return Read(std::make_pair(DB_BLOCK_TX_ROOTS, hash), vTxRoots);
+}
+
+bool CBlockMMRDB::WriteTxRoots(const uint256 &hash, const std::vector<uint256> &vTxRoots)
+{
+    LOCK(cs);
+    if (Exists(std::make_pair(DB_BLOCK_TX_ROOTS, hash)))
+        return true;
+
+    CDBBatch batch(*this);
+    batch.Write(std::make_pair(DB_BLOCK_TX_ROOTS, hash), vTxRoots);
+    batch.Write(std::make_pair(DB_BLOCK_SEQ, nNextSeq), hash);
+    uint64_t nNewFirst = nFirstSeq, nNewNext = nNextSeq + 1;
+
+    // drop the oldest entries, also catching up if -blockmmrcache was lowered since the last run
+    for (; nNewNext - nNewFirst > (uint64_t)nMaxBlocks; nNewFirst++)
+    {
+        uint256 oldHash;
+        if (Read(std::make_pair(DB_BLOCK_SEQ, nNewFirst), oldHash))
+            batch.Erase(std::make_pair(DB_BLOCK_TX_ROOTS, oldHash));
+        batch.Erase(std::make_pair(DB_BLOCK_SEQ, nNewFirst));
+    }
+    batch.Write(DB_BLOCK_SEQ_RANGE, std::make_pair(nNewFirst, nNewNext));
+
+    if (!WriteBatch(batch))
+        return false;
+    nFirstSeq = nNewFirst;
+    nNextSeq = nNewNext;
+    return true;
+}
+
+namespace {
+
+/** Least recently used block MMRs, bounded by the approximate memory of their layers */
+class CBlockMMRMemoryCache
+{
+public:
+    CBlockMMRMemoryCache() : nUsage(0) {}
+
+    BlockTxRootMMRangeRef Get(const uint256 &hash)
+    {
+        LOCK(cs);
+        std::map<uint256, Entry>::iterator it = mapEntries.find(hash);
+        if (it == mapEntries.end())
+            return BlockTxRootMMRangeRef();
+        lruHashes.splice(lruHashes.begin(), lruHashes, it->second.lruPos);
+        return it->second.mmRange;
+    }
+
+    void Put(const uint256 &hash, const BlockTxRootMMRangeRef &mmRange)
+    {
+        LOCK(cs);
+        if (mapEntries.count(hash))
+            return;
+        Entry &entry = mapEntries[hash];
+        entry.mmRange = mmRange;
+        entry.nUsage = Usage(*mmRange);
+        entry.lruPos = lruHashes.insert(lruHashes.begin(), hash);
+        nUsage += entry.nUsage;
+
+        // always keep the newest, even if it alone is over the limit
+        while (nUsage > MAX_BLOCK_MMR_MEMORY && lruHashes.size() > 1)
+        {
+            std::map<uint256, Entry>::iterator oldest = mapEntries.find(lruHashes.back());
+            nUsage -= oldest->second.nUsage;
+            mapEntries.erase(oldest);
+            lruHashes.pop_back();
+        }
+    }
+
+private:
+    struct Entry
+    {
+        BlockTxRootMMRangeRef mmRange;
+        size_t nUsage;
+        std::list<uint256>::iterator lruPos;
+    };
+
+    CCriticalSection cs;
+    std::map<uint256, Entry> mapEntries;
+    std::list<uint256> lruHashes;
+    size_t nUsage;
+
+    static size_t Usage(const BlockTxRootMMRange &mmRange)
+    {
+        // the upper layers together hold at most as many nodes as the leaves
+        return 2 * mmRange.size() * sizeof(CDefaultMMRNode) + sizeof(Entry) + 3 * sizeof(void *);
+    }
+};
+
+CBlockMMRMemoryCache blockMMRMemoryCache;
+
+BlockTxRootMMRangeRef MakeBlockTxRootMMR(const std::vector<uint256> &vTxRoots)
+{
+    std::shared_ptr<BlockTxRootMMRange> mmRange(new BlockTxRootMMRange());
+    for (const uint256 &txRoot : vTxRoots)
+    {
+        mmRange->Add(CDefaultMMRNode(txRoot));
+    }
+    return mmRange;
+}
+
+}
+
+bool GetBlockTxRootMMR(const CBlockIndex *pindex, BlockTxRootMMRangeRef &mmRange, const CBlock *pblock)
+{
+    if (pindex == NULL)
+        return false;
+
+    const uint256 hash = pindex->GetBlockHash();
+    mmRange = blockMMRMemoryCache.Get(hash);
+    if (mmRange)
+        return true;
+
+    // entries are keyed by block hash, so ones left behind by a reorg are never returned for the new chain
+    std::vector<uint256> vTxRoots;
+    bool fFromDisk = pblockmmrdb && pblockmmrdb->ReadTxRoots(hash, vTxRoots);
+    if (!fFromDisk)
+    {
+        CBlock block;
+        if (pblock == NULL)
+        {
+            LOCK(cs_main);
+            if (!(pindex->nStatus & BLOCK_HAVE_DATA))
+                return false;
+            if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus(), false))
+                return false;
+            pblock = &block;
+        }
+        // the roots may already be memoized on the block by an earlier tree
+        vTxRoots.reserve(pblock->vtx.size());
+        for (size_t i = 0; i < pblock->vtx.size(); i++)
+        {
+            vTxRoots.push_back(pblock->GetMMRNode(i).hash);
+        }
+    }
+
+    mmRange = MakeBlockTxRootMMR(vTxRoots);
+    blockMMRMemoryCache.Put(hash, mmRange);
+
+    if (!fFromDisk && pblockmmrdb)
+    {
+        try {
+            pblockmmrdb->WriteTxRoots(hash, vTxRoots);
+        } catch (const dbwrapper_error &e) {
+            LogPrintf("%s: failed to cache transaction MMR roots of block %s: %s\n", __func__, hash.GetHex(), e.what());
+        }
+    }
+    return true;
+}
+
+bool GetBlockTxRootProof(const CBlockIndex *pindex, const uint256 &txRoot, CMMRProof &proof, int &txIndex, const CBlock *pblock)
+{
+    BlockTxRootMMRangeRef mmRange;
+    if (!GetBlockTxRootMMR(pindex, mmRange, pblock))
+        return false;
+
+    size_t pos;
+    for (pos = 0; pos < mmRange->size(); pos++)
+    {
+        if (mmRange->layer0[pos].hash == txRoot)
+        {
+            break;
+        }
+    }
+    if (pos == mmRange->size())
+        return false;
+
+    txIndex = pos;
+    BlockTxRootMMView blockView(*mmRange);
+    return blockView.GetProof(proof, pos);
+}
@@ -0,0 +1,65 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef VERUS_BLOCKMMRCACHE_H
+#define VERUS_BLOCKMMRCACHE_H
+
+#include "dbwrapper.h"
+#include "primitives/block.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <memory>
+#include <vector>
+
+class CBlockIndex;
+
+//! -blockmmrcache default, number of blocks whose transaction MMR roots are kept on disk
+static const int64_t DEFAULT_BLOCK_MMR_CACHE = 20000;
+//! Bytes of block MMR layers kept in memory for the most recently proven blocks
+static const size_t MAX_BLOCK_MMR_MEMORY = 16 * 1024 * 1024;
+
+typedef std::shared_ptr<const BlockTxRootMMRange> BlockTxRootMMRangeRef;
+
+/**
+ * On disk cache of the transaction MMR roots of blocks, the leaves of each block MMR, keyed by
+ * block hash. Entries are added as blocks are proven and the oldest are dropped once more than
+ * nMaxBlocks are held.
+ */
+class CBlockMMRDB : public CDBWrapper
+{
+public:
+    CBlockMMRDB(size_t nCacheSize, int64_t nMaxBlocksIn, bool fMemory = false, bool fWipe = false);
+
+    bool ReadTxRoots(const uint256 &hash, std::vector<uint256> &vTxRoots) const;
+    bool WriteTxRoots(const uint256 &hash, const std::vector<uint256> &vTxRoots);
+
+    //! small random reads of recent blocks, so favour the block cache
+    static CDBOptions DefaultOptions();
+
+private:
+    CCriticalSection cs;
+    int64_t nMaxBlocks;
+    //! entries are numbered in the order they were added, the oldest still held is nFirstSeq
+    uint64_t nFirstSeq;
+    uint64_t nNextSeq;
+};
+
+extern CBlockMMRDB *pblockmmrdb;
+
+/**
+ * Get the block MMR of a block from its transaction MMR roots, from memory, else from the on disk
+ * cache, else from the block itself, which is then added to both. pblock may be given when the
+ * caller already has the block, otherwise it is only read from disk on a miss. Takes cs_main
+ * while reading the block.
+ */
+bool GetBlockTxRootMMR(const CBlockIndex *pindex, BlockTxRootMMRangeRef &mmRange, const CBlock *pblock = NULL);
+
+/**
+ * Prove the transaction whose MMR root is txRoot up to the block MMR root of pindex, returning its
+ * position in the block in txIndex.
+ */
+bool GetBlockTxRootProof(const CBlockIndex *pindex, const uint256 &txRoot, CMMRProof &proof, int &txIndex, const CBlock *pblock = NULL);
+
+#endif // VERUS_BLOCKMMRCACHE_H
@@ -5,6 +5,8 @@
 
 #include "chain.h"
 
+#include "util.h"
+
 using namespace std;
 
 /**
@@ -14,6 +16,7 @@ void CChain::SetTip(CBlockIndex *pindex) {
     lastTip = pindex;
     if (pindex == NULL) {
         vChain.clear();
+        // the store keeps its saved nodes, which are matched against the chain when it is set again
         mmr.Truncate(0);
         return;
     }
@@ -24,14 +27,58 @@ void CChain::SetTip(CBlockIndex *pindex) {
         vChain[pindex->GetHeight()] = pindex;
         pindex = pindex->pprev;
     }
-    mmr.Truncate(vChain.size() - modCount);
-    for (int i = (vChain.size() - modCount); i < vChain.size(); i++)
+    uint64_t unchanged = vChain.size() - modCount;
+    if (unchanged == 0 && mmr.size() == 0)
+    {
+        unchanged = RestoreMMR();
+    }
+    mmr.Truncate(unchanged);
+    mmrStore.Truncate(unchanged);
+    for (int i = unchanged; i < vChain.size(); i++)
     {
         // add this block to the Merkle Mountain Range
         mmr.Add(vChain[i]->GetBlockMMRNode());
     }
 }
 
+uint64_t CChain::RestoreMMR()
+{
+    // saved leaves commit to their block hashes, so once one matches, everything below it does as well
+    uint64_t nLeaves = std::min(mmrStore.SavedLeaves(), (uint64_t)vChain.size());
+    CMMRStoreLayer<ChainMMRNode> savedLeaves(&mmrStore, 0);
+    savedLeaves.resize(nLeaves);
+    for (; nLeaves > 0; nLeaves--)
+    {
+        if (savedLeaves[nLeaves - 1].hash == vChain[nLeaves - 1]->GetBlockMMRNode().hash)
+        {
+            break;
+        }
+    }
+    mmr.layer0.resize(nLeaves);
+    mmr.upperNodes.clear();
+    for (uint64_t layerSize = nLeaves >> 1, height = 1; layerSize; layerSize >>= 1, height++)
+    {
+        mmr.upperNodes.push_back(CMMRStoreLayer<ChainMMRNode>(&mmrStore, height));
+        mmr.upperNodes.back().resize(layerSize);
+    }
+    if (nLeaves)
+    {
+        LogPrintf("%s: restored chain MMR of %lu blocks from %lu saved\n", __func__, nLeaves, mmrStore.SavedLeaves());
+    }
+    return nLeaves;
+}
+
+bool CChain::OpenMMRStore(const boost::filesystem::path &path)
+{
+    assert(mmr.size() == 0);
+    return mmrStore.Open(path);
+}
+
+bool CChain::FlushMMR()
+{
+    return mmrStore.Flush(mmr.size());
+}
+
 // returns false if unable to fast calculate the VerusPOSHash from the header. 
 // if it returns false, value is set to 0, but it can still be calculated from the full block
 // in that case. the only difference between this and the POS hash for the contest is that it is not divided by the value out
@@ -229,6 +276,56 @@ bool CChain::GetMerkleProof(ChainMerkleMountainView &view, CMMRProof &retProof,
     }
 }
 
+bool CChain::GetBlockProofs(ChainMerkleMountainView &view, std::vector<CMMRProof> &retProofs, const std::vector<int> &indexes) const
+{
+    std::vector<uint64_t> positions;
+    retProofs.clear();
+    retProofs.resize(indexes.size());
+    for (int i = 0; i < indexes.size(); i++)
+    {
+        CBlockIndex *pindex = (indexes[i] < 0 || indexes[i] >= (int)vChain.size()) ? NULL : vChain[indexes[i]];
+        if (!pindex)
+        {
+            return false;
+        }
+        retProofs[i] << pindex->BlockProofBridge();
+        positions.push_back(indexes[i]);
+    }
+    return view.GetProofs(retProofs, positions);
+}
+
+bool CChain::GetMerkleProofs(ChainMerkleMountainView &view, std::vector<CMMRProof> &retProofs, const std::vector<int> &indexes) const
+{
+    std::vector<uint64_t> positions;
+    retProofs.clear();
+    retProofs.resize(indexes.size());
+    for (int i = 0; i < indexes.size(); i++)
+    {
+        CBlockIndex *pindex = (indexes[i] < 0 || indexes[i] >= (int)vChain.size()) ? NULL : vChain[indexes[i]];
+        if (!pindex)
+        {
+            return false;
+        }
+        retProofs[i] << pindex->MMRProofBridge();
+        positions.push_back(indexes[i]);
+    }
+    return view.GetProofs(retProofs, positions);
+}
+
+bool CChain::GetMultiProof(ChainMerkleMountainView &view, CMMRProof &retProof, const std::vector<int> &indexes) const
+{
+    std::vector<uint64_t> positions;
+    for (auto index : indexes)
+    {
+        if (index < 0 || index >= (int)vChain.size())
+        {
+            return false;
+        }
+        positions.push_back(index);
+    }
+    return view.GetMultiProof(retProof, positions);
+}
+
 uint256 CChainPower::CompactChainPower() const
 {
     arith_uint256 compactPower = (chainStake << 128) + chainWork;
@@ -14,6 +14,7 @@ class CChainPower;
 #include "tinyformat.h"
 #include "uint256.h"
 #include "mmr.h"
+#include "mmrstore.h"
 
 #include <vector>
 
@@ -681,8 +682,8 @@ public:
 };
 
 class CChain;
-typedef CMerkleMountainRange<ChainMMRNode, CChunkedLayer<ChainMMRNode, 9>, COverlayNodeLayer<ChainMMRNode, CChain>> ChainMerkleMountainRange;
-typedef CMerkleMountainView<ChainMMRNode, CChunkedLayer<ChainMMRNode, 9>, COverlayNodeLayer<ChainMMRNode, CChain>> ChainMerkleMountainView;
+typedef CMerkleMountainRange<ChainMMRNode, CMMRStoreLayer<ChainMMRNode>, CMMRStoreLayer<ChainMMRNode>> ChainMerkleMountainRange;
+typedef CMerkleMountainView<ChainMMRNode, CMMRStoreLayer<ChainMMRNode>, CMMRStoreLayer<ChainMMRNode>> ChainMerkleMountainView;
 
 /** An in-memory indexed chain of blocks. 
  * With Verus and PBaaS chains, this also provides a complete Merkle Mountain Range (MMR) for the chain at all times,
@@ -691,11 +692,16 @@ typedef CMerkleMountainView<ChainMMRNode, CChunkedLayer<ChainMMRNode, 9>, COverl
 class CChain {
 private:
     std::vector<CBlockIndex*> vChain;
+    // holds the nodes of mmr, in memory or in a memory mapped file once OpenMMRStore is called
+    CMMRNodeStore mmrStore;
     ChainMerkleMountainRange mmr;
     CBlockIndex *lastTip;
 
+    // restores mmr from the nodes saved in mmrStore that still match this chain, returning its new size
+    uint64_t RestoreMMR();
+
 public:
-    CChain() : vChain(), mmr(COverlayNodeLayer<ChainMMRNode, CChain>(*this)) {}
+    CChain() : vChain(), mmrStore(sizeof(ChainMMRNode)), mmr(CMMRStoreLayer<ChainMMRNode>(&mmrStore, 0)), lastTip(NULL) {}
 
     /** Returns the index entry for the genesis block of this chain, or NULL if none. */
     CBlockIndex *Genesis() const {
@@ -740,6 +746,19 @@ public:
 
     bool GetBlockProof(ChainMerkleMountainView &view, CMMRProof &retProof, int index) const;
     bool GetMerkleProof(ChainMerkleMountainView &view, CMMRProof &retProof, int index) const;
+    /** Proofs of many blocks against one view, as GetBlockProof and GetMerkleProof return them, reading shared MMR nodes once. */
+    bool GetBlockProofs(ChainMerkleMountainView &view, std::vector<CMMRProof> &retProofs, const std::vector<int> &indexes) const;
+    bool GetMerkleProofs(ChainMerkleMountainView &view, std::vector<CMMRProof> &retProofs, const std::vector<int> &indexes) const;
+    /**
+     * One compact proof of many blocks in the view, checked by CMMRProof::CheckProof with the blocks'
+     * ChainMMRNode::HashObj(BlockMMRRoot(), GetBlockHash()) hashes in ascending order of height.
+     */
+    bool GetMultiProof(ChainMerkleMountainView &view, CMMRProof &retProof, const std::vector<int> &indexes) const;
+
+    /** Keep the MMR in a memory mapped file, so the next start only adds blocks changed since the last flush. Call while the chain is empty. */
+    bool OpenMMRStore(const boost::filesystem::path &path);
+    /** Make the MMR nodes of the current chain durable in the file. */
+    bool FlushMMR();
 
     /** Compare two chains efficiently. */
     friend bool operator==(const CChain &a, const CChain &b) {
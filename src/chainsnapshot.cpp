@@ -0,0 +1,495 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "chainsnapshot.h"
+
+#include "chain.h"
+#include "chainparams.h"
+#include "clientversion.h"
+#include "hash.h"
+#include "main.h"
+#include "pbaas/notarizedsync.h"
+#include "pbaas/pbaas.h"
+#include "streams.h"
+#include "txdb.h"
+#include "util.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+static const unsigned char CHAINSTATE_SNAPSHOT_MAGIC[8] = {'V', 'R', 'S', 'C', 'S', 'N', 'A', 'P'};
+
+// the database each record belongs to, with a zero after the last record
+static const uint8_t SNAPSHOT_RECORDS_END = 0;
+static const uint8_t SNAPSHOT_CHAINSTATE = 1;
+static const uint8_t SNAPSHOT_BLOCK_TREE = 2;
+
+// block tree key prefixes, as in txdb.cpp
+static const char DB_BLOCK_FILES = 'f';
+static const char DB_TXINDEX = 't';
+static const char DB_BLOCK_INDEX = 'b';
+static const char DB_FLAG = 'F';
+static const char DB_REINDEX_FLAG = 'R';
+static const char DB_LAST_BLOCK = 'l';
+
+static const std::string SNAPSHOT_LOADING_FLAG = "snapshotloading";
+
+// the flags of the indexes in the block tree that are copied with it, other flags are those of the node that writes them
+static bool IsSnapshotIndexFlag(const std::string &name)
+{
+    return name == "addressindex" || name == "spentindex" || name == "timestampindex" || name == "insightexplorer";
+}
+
+namespace {
+
+/** Writes to a file while hashing everything written for the checksum */
+class CSnapshotWriter
+{
+public:
+    CAutoFile fileout;
+    CHashWriter hasher;
+
+    CSnapshotWriter(FILE *file) : fileout(file, SER_DISK, CLIENT_VERSION), hasher(SER_DISK, CLIENT_VERSION) {}
+
+    template <typename T>
+    CSnapshotWriter &operator<<(const T &obj)
+    {
+        fileout << obj;
+        hasher << obj;
+        return *this;
+    }
+};
+
+/** Reads from a file while hashing everything read for the checksum */
+class CSnapshotReader
+{
+public:
+    CAutoFile filein;
+    CHashWriter hasher;
+
+    CSnapshotReader(FILE *file) : filein(file, SER_DISK, CLIENT_VERSION), hasher(SER_DISK, CLIENT_VERSION) {}
+
+    template <typename T>
+    CSnapshotReader &operator>>(T &obj)
+    {
+        filein >> obj;
+        hasher << obj;
+        return *this;
+    }
+};
+
+}
+
+bool DumpChainstateSnapshot(const boost::filesystem::path &path, CChainstateSnapshotInfo &info, std::string &strError)
+{
+    if (boost::filesystem::exists(path))
+    {
+        strError = path.string() + " already exists";
+        return false;
+    }
+
+    // the records are read from database snapshots, so nothing else waits on the lock while they are written out
+    boost::scoped_ptr<CDBSnapshot> coinsSnapshot, blockTreeSnapshot;
+    std::vector<uint256> activeHashes;
+    {
+        LOCK(cs_main);
+        if (!pcoinsdbview || !pblocktree || !chainActive.Tip())
+        {
+            strError = "no chainstate to dump";
+            return false;
+        }
+        FlushStateToDisk();
+        if (pcoinsdbview->GetBestBlock() != chainActive.Tip()->GetBlockHash())
+        {
+            strError = "chainstate database is not at the tip after flushing";
+            return false;
+        }
+        coinsSnapshot.reset(new CDBSnapshot(pcoinsdbview->GetDB()));
+        blockTreeSnapshot.reset(new CDBSnapshot(*pblocktree));
+
+        activeHashes.resize(chainActive.Height() + 1);
+        for (int i = 0; i <= chainActive.Height(); i++)
+        {
+            activeHashes[i] = chainActive[i]->GetBlockHash();
+        }
+        info.hashGenesisBlock = Params().GetConsensus().hashGenesisBlock;
+        info.hashBlock = chainActive.Tip()->GetBlockHash();
+        info.nHeight = chainActive.Height();
+        info.nRecords = 0;
+    }
+
+    boost::filesystem::path tmpPath = path.string() + ".incomplete";
+    FILE *file = fopen(tmpPath.string().c_str(), "wb");
+    if (!file)
+    {
+        strError = "cannot open " + tmpPath.string() + " for writing";
+        return false;
+    }
+    setvbuf(file, NULL, _IOFBF, 1 << 20);
+
+    {
+        CSnapshotWriter writer(file);
+        try
+        {
+            writer << FLATDATA(CHAINSTATE_SNAPSHOT_MAGIC) << CHAINSTATE_SNAPSHOT_VERSION;
+            writer << info.hashGenesisBlock << info.hashBlock << info.nHeight;
+
+            boost::scoped_ptr<CDBIterator> pcursor(pcoinsdbview->GetDB().NewIterator(coinsSnapshot.get()));
+            for (pcursor->SeekToFirst(); pcursor->Valid(); pcursor->Next())
+            {
+                boost::this_thread::interruption_point();
+                writer << SNAPSHOT_CHAINSTATE << pcursor->GetRawKey() << pcursor->GetRawValue();
+                info.nRecords++;
+            }
+
+            pcursor.reset(pblocktree->NewIterator(blockTreeSnapshot.get()));
+            for (pcursor->SeekToFirst(); pcursor->Valid(); pcursor->Next())
+            {
+                boost::this_thread::interruption_point();
+                std::vector<unsigned char> key = pcursor->GetRawKey();
+                if (key.empty())
+                {
+                    continue;
+                }
+                switch (key[0])
+                {
+                    case DB_BLOCK_INDEX:
+                    {
+                        std::pair<char, uint256> indexKey;
+                        CDiskBlockIndex diskindex;
+                        if (!pcursor->GetKey(indexKey) || !pcursor->GetValue(diskindex))
+                        {
+                            throw std::runtime_error("cannot read block index entry");
+                        }
+                        // only the active chain, as the loading node will have no blocks to reorganize with
+                        if (diskindex.GetHeight() < 0 || diskindex.GetHeight() >= (int)activeHashes.size() ||
+                            activeHashes[diskindex.GetHeight()] != indexKey.second)
+                        {
+                            continue;
+                        }
+                        diskindex.nStatus &= ~(BLOCK_HAVE_DATA | BLOCK_HAVE_UNDO);
+                        diskindex.nFile = 0;
+                        diskindex.nDataPos = 0;
+                        diskindex.nUndoPos = 0;
+                        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+                        ssValue << diskindex;
+                        writer << SNAPSHOT_BLOCK_TREE << key << std::vector<unsigned char>(ssValue.begin(), ssValue.end());
+                        break;
+                    }
+
+                    case DB_FLAG:
+                    {
+                        std::pair<char, std::string> flagKey;
+                        if (!pcursor->GetKey(flagKey) || !IsSnapshotIndexFlag(flagKey.second))
+                        {
+                            continue;
+                        }
+                        writer << SNAPSHOT_BLOCK_TREE << key << pcursor->GetRawValue();
+                        break;
+                    }
+
+                    // these refer to block files, which the loading node does not have
+                    case DB_BLOCK_FILES:
+                    case DB_LAST_BLOCK:
+                    case DB_TXINDEX:
+                    case DB_REINDEX_FLAG:
+                        continue;
+
+                    default:
+                        writer << SNAPSHOT_BLOCK_TREE << key << pcursor->GetRawValue();
+                }
+                info.nRecords++;
+            }
+
+            writer << SNAPSHOT_RECORDS_END << info.nRecords;
+            info.hashChecksum = writer.hasher.GetHash();
+            writer.fileout << info.hashChecksum;
+            FileCommit(writer.fileout.Get());
+        }
+        catch (const std::exception &e)
+        {
+            strError = std::string("error writing snapshot: ") + e.what();
+            writer.fileout.fclose();
+            boost::filesystem::remove(tmpPath);
+            return false;
+        }
+    }
+
+    if (!RenameOver(tmpPath, path))
+    {
+        strError = "cannot rename " + tmpPath.string() + " to " + path.string();
+        return false;
+    }
+    LogPrintf("%s: wrote %lu records at height %d, block %s, to %s\n", __func__,
+              info.nRecords, info.nHeight, info.hashBlock.GetHex(), path.string());
+    return true;
+}
+
+// reads the snapshot at path, writing its records to pcoinsdb and pblocktreedb unless they are NULL
+static bool ReadChainstateSnapshot(const boost::filesystem::path &path, CDBWrapper *pcoinsdb, CDBWrapper *pblocktreedb,
+                                   CChainstateSnapshotInfo &info, std::string &strError)
+{
+    FILE *file = fopen(path.string().c_str(), "rb");
+    if (!file)
+    {
+        strError = "cannot open " + path.string();
+        return false;
+    }
+    setvbuf(file, NULL, _IOFBF, 1 << 20);
+
+    CSnapshotReader reader(file);
+    info.mapFlags.clear();
+    try
+    {
+        unsigned char magic[sizeof(CHAINSTATE_SNAPSHOT_MAGIC)];
+        uint32_t nVersion;
+        reader >> FLATDATA(magic) >> nVersion;
+        if (memcmp(magic, CHAINSTATE_SNAPSHOT_MAGIC, sizeof(magic)))
+        {
+            strError = path.string() + " is not a chainstate snapshot";
+            return false;
+        }
+        if (nVersion != CHAINSTATE_SNAPSHOT_VERSION)
+        {
+            strError = strprintf("unsupported chainstate snapshot version %u", nVersion);
+            return false;
+        }
+        reader >> info.hashGenesisBlock >> info.hashBlock >> info.nHeight;
+        if (info.hashGenesisBlock != Params().GetConsensus().hashGenesisBlock)
+        {
+            strError = "chainstate snapshot is of a different chain";
+            return false;
+        }
+
+        // records of each database are together and in key order, so batches are written as sorted runs
+        CDBWrapper *pbatchdb = NULL;
+        boost::scoped_ptr<CDBBatch> batch;
+        size_t nBatchBytes = 0;
+        uint64_t nRecords = 0;
+        while (true)
+        {
+            boost::this_thread::interruption_point();
+            uint8_t nDatabase;
+            reader >> nDatabase;
+            if (nDatabase == SNAPSHOT_RECORDS_END)
+            {
+                break;
+            }
+            if (nDatabase != SNAPSHOT_CHAINSTATE && nDatabase != SNAPSHOT_BLOCK_TREE)
+            {
+                strError = strprintf("corrupt chainstate snapshot record %lu", nRecords);
+                return false;
+            }
+            std::vector<unsigned char> key, value;
+            reader >> key >> value;
+            nRecords++;
+
+            // snapshots of older versions have every flag, of which only those of the copied indexes are kept
+            if (nDatabase == SNAPSHOT_BLOCK_TREE && key.size() && key[0] == DB_FLAG)
+            {
+                CDataStream ssKey(key, SER_DISK, CLIENT_VERSION), ssValue(value, SER_DISK, CLIENT_VERSION);
+                std::pair<char, std::string> flagKey;
+                char ch;
+                ssKey >> flagKey;
+                ssValue >> ch;
+                if (!IsSnapshotIndexFlag(flagKey.second))
+                {
+                    continue;
+                }
+                info.mapFlags[flagKey.second] = ch == '1';
+            }
+
+            CDBWrapper *pdb = nDatabase == SNAPSHOT_CHAINSTATE ? pcoinsdb : pblocktreedb;
+            if (!pdb)
+            {
+                continue;
+            }
+            if (batch && (pdb != pbatchdb || nBatchBytes >= CHAINSTATE_SNAPSHOT_BATCH_SIZE))
+            {
+                pbatchdb->WriteBatch(*batch);
+                batch.reset();
+                nBatchBytes = 0;
+            }
+            if (!batch)
+            {
+                pbatchdb = pdb;
+                batch.reset(new CDBBatch(*pdb));
+            }
+            batch->WriteRaw(key, value);
+            nBatchBytes += key.size() + value.size();
+
+            if (nRecords % 1000000 == 0)
+            {
+                LogPrintf("%s: loaded %lu chainstate snapshot records\n", __func__, nRecords);
+            }
+        }
+        if (batch)
+        {
+            pbatchdb->WriteBatch(*batch);
+        }
+
+        uint64_t nRecordsWritten;
+        reader >> nRecordsWritten;
+        uint256 hashChecksum = reader.hasher.GetHash();
+        reader.filein >> info.hashChecksum;
+        if (nRecordsWritten != nRecords || hashChecksum != info.hashChecksum)
+        {
+            strError = "chainstate snapshot checksum does not match";
+            return false;
+        }
+        info.nRecords = nRecords;
+    }
+    catch (const std::exception &e)
+    {
+        strError = std::string("error reading chainstate snapshot: ") + e.what();
+        return false;
+    }
+    return true;
+}
+
+// erases every entry of db but keepKey, in batches
+static bool EraseDatabase(CDBWrapper &db, const std::vector<unsigned char> &keepKey)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(db.NewIterator());
+    boost::scoped_ptr<CDBBatch> batch(new CDBBatch(db));
+    size_t nBatchBytes = 0;
+    for (pcursor->SeekToFirst(); pcursor->Valid(); pcursor->Next())
+    {
+        std::vector<unsigned char> key = pcursor->GetRawKey();
+        if (key == keepKey)
+        {
+            continue;
+        }
+        batch->EraseRaw(key);
+        nBatchBytes += key.size();
+        if (nBatchBytes >= CHAINSTATE_SNAPSHOT_BATCH_SIZE)
+        {
+            if (!db.WriteBatch(*batch))
+            {
+                return false;
+            }
+            batch.reset(new CDBBatch(db));
+            nBatchBytes = 0;
+        }
+    }
+    return db.WriteBatch(*batch, true);
+}
+
+bool LoadChainstateSnapshot(const boost::filesystem::path &path, CCoinsViewDB &coinsdb, CBlockTreeDB &blocktree,
+                            CChainstateSnapshotInfo &info, std::string &strError)
+{
+    LogPrintf("%s: checking %s\n", __func__, path.string());
+    if (!ReadChainstateSnapshot(path, NULL, NULL, info, strError))
+    {
+        return false;
+    }
+
+    // index entries are copied as they are, so they must be of the indexes this node keeps
+    const std::pair<std::string, bool> indexSettings[] = {
+        {"insightexplorer", GetBoolArg("-insightexplorer", DEFAULT_INSIGHTEXPLORER)},
+        {"timestampindex", GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX)}};
+    for (auto &setting : indexSettings)
+    {
+        auto flagIt = info.mapFlags.find(setting.first);
+        if (flagIt != info.mapFlags.end() && flagIt->second != setting.second)
+        {
+            strError = strprintf("the snapshot was written by a node with -%s=%d", setting.first, flagIt->second);
+            return false;
+        }
+    }
+
+    if (IsChainstateSnapshotLoadInterrupted(blocktree))
+    {
+        // the flag is erased last, so records left by an interrupted erase are never taken for a finished load
+        LogPrintf("%s: erasing the records of an interrupted load\n", __func__);
+        CDataStream ssFlagKey(SER_DISK, CLIENT_VERSION);
+        ssFlagKey << std::make_pair(DB_FLAG, SNAPSHOT_LOADING_FLAG);
+        if (!EraseDatabase(coinsdb.GetDB(), std::vector<unsigned char>()) ||
+            !EraseDatabase(blocktree, std::vector<unsigned char>(ssFlagKey.begin(), ssFlagKey.end())))
+        {
+            strError = "cannot erase the records of an interrupted load";
+            return false;
+        }
+    }
+
+    // the flag is only cleared once every record is written and checked, so a partly loaded database is never used
+    if (!blocktree.WriteFlag(SNAPSHOT_LOADING_FLAG, true))
+    {
+        strError = "cannot write to the block index database";
+        return false;
+    }
+    LogPrintf("%s: loading %lu records at height %d, block %s\n", __func__, info.nRecords, info.nHeight, info.hashBlock.GetHex());
+    if (!ReadChainstateSnapshot(path, &coinsdb.GetDB(), &blocktree, info, strError))
+    {
+        return false;
+    }
+
+    // pruning requires the transaction index to be off, and the snapshot has none
+    if (!blocktree.WriteFlag("prunedblockfiles", true) || !blocktree.WriteFlag("txindex", false) || !blocktree.Sync())
+    {
+        strError = "cannot write to the block index database";
+        return false;
+    }
+    LogPrintf("%s: chainstate loaded at height %d\n", __func__, info.nHeight);
+    return true;
+}
+
+bool CheckChainstateSnapshot(const CChainstateSnapshotInfo &info, std::string &strError)
+{
+    if (IsVerusActive())
+    {
+        LogPrintf("%s: there is no notary chain to check the snapshot against\n", __func__);
+        return true;
+    }
+
+    CProofRoot proofRoot;
+    if (!GetConfirmedNotarizedProofRoot(proofRoot))
+    {
+        strError = "cannot read the last confirmed notarization of this chain from the notary chain";
+        return false;
+    }
+
+    CBlockIndex *pindexSnapshot = NULL;
+    {
+        LOCK(cs_main);
+        BlockMap::iterator it = mapBlockIndex.find(info.hashBlock);
+        if (it != mapBlockIndex.end())
+        {
+            pindexSnapshot = it->second;
+        }
+    }
+    if (!pindexSnapshot)
+    {
+        strError = "the snapshot block is not in the block index";
+        return false;
+    }
+    if (pindexSnapshot->GetHeight() < (int)proofRoot.rootHeight)
+    {
+        strError = strprintf("the snapshot at height %d is older than the last confirmed notarization at height %u",
+                             pindexSnapshot->GetHeight(), proofRoot.rootHeight);
+        return false;
+    }
+
+    CBlockIndex *pindexRoot = NULL;
+    if (!CheckNotarizedProofRoot(proofRoot, pindexRoot) || pindexSnapshot->GetAncestor(proofRoot.rootHeight) != pindexRoot)
+    {
+        strError = strprintf("the snapshot headers do not match the notarized proof root at height %u", proofRoot.rootHeight);
+        return false;
+    }
+    LogPrintf("%s: snapshot block %s is on the chain notarized at height %u, block %s\n", __func__,
+              info.hashBlock.GetHex(), proofRoot.rootHeight, proofRoot.blockHash.GetHex());
+    return true;
+}
+
+bool FinishChainstateSnapshotLoad(CBlockTreeDB &blocktree)
+{
+    return blocktree.WriteFlag(SNAPSHOT_LOADING_FLAG, false) && blocktree.Sync();
+}
+
+bool IsChainstateSnapshotLoadInterrupted(CBlockTreeDB &blocktree)
+{
+    bool fLoading = false;
+    return blocktree.ReadFlag(SNAPSHOT_LOADING_FLAG, fLoading) && fLoading;
+}
@@ -0,0 +1,76 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef VERUS_CHAINSNAPSHOT_H
+#define VERUS_CHAINSNAPSHOT_H
+
+#include "serialize.h"
+#include "uint256.h"
+
+#include <map>
+#include <string>
+
+#include <boost/filesystem/path.hpp>
+
+class CBlockTreeDB;
+class CCoinsViewDB;
+
+//! Version of the snapshot file format
+static const uint32_t CHAINSTATE_SNAPSHOT_VERSION = 1;
+//! Bytes of records written to the databases in each batch while loading a snapshot
+static const size_t CHAINSTATE_SNAPSHOT_BATCH_SIZE = 16 * 1024 * 1024;
+
+/** What a chainstate snapshot was taken at, from its header and trailer */
+class CChainstateSnapshotInfo
+{
+public:
+    uint256 hashGenesisBlock;   // identifies the chain the snapshot belongs to
+    uint256 hashBlock;          // the chainstate is as of the end of this block
+    int32_t nHeight;
+    uint64_t nRecords;          // database entries in the snapshot
+    uint256 hashChecksum;       // double SHA256 of everything before it in the file
+    std::map<std::string, bool> mapFlags;   // index flags of the node that wrote it, which its index entries follow
+
+    CChainstateSnapshotInfo() : nHeight(0), nRecords(0) {}
+};
+
+/**
+ * Write the chainstate at the current tip to path as a chainstate snapshot. The snapshot holds every
+ * entry of the chainstate database, which are the coins, the Sprout and Sapling anchors and nullifiers
+ * and the best block and anchors, followed by the block index entries of the active chain, with their
+ * block and undo data marked as missing. Everything after the fixed header is covered by a checksum
+ * at the end of the file.
+ *
+ * Takes cs_main only to flush the state and take database snapshots, then streams without it.
+ */
+bool DumpChainstateSnapshot(const boost::filesystem::path &path, CChainstateSnapshotInfo &info, std::string &strError);
+
+/**
+ * Load a snapshot written by DumpChainstateSnapshot into empty chainstate and block index databases,
+ * before the block index is loaded. The whole file is checked before anything is written, and entries
+ * are then written in the sorted order they were dumped in, in large batches. The node starts at the
+ * snapshot block as a pruned node would, without the data of the blocks before it.
+ *
+ * If an earlier load into these databases was interrupted, what it wrote is erased first. The load is
+ * only finished by FinishChainstateSnapshotLoad, once CheckChainstateSnapshot has checked it.
+ */
+bool LoadChainstateSnapshot(const boost::filesystem::path &path, CCoinsViewDB &coinsdb, CBlockTreeDB &blocktree,
+                            CChainstateSnapshotInfo &info, std::string &strError);
+
+/**
+ * Check a loaded snapshot against the proof root of the last notarization of this chain confirmed on the
+ * notary chain, once the block index is loaded. The notarized block must be an ancestor of the snapshot
+ * block, and the MMR of the headers up to it must match the root. The proof root commits to headers only,
+ * so the coins are trusted as those of a copied data directory would be. On the Verus chain, which has no
+ * notary chain, the snapshot is not checked.
+ */
+bool CheckChainstateSnapshot(const CChainstateSnapshotInfo &info, std::string &strError);
+
+/** Mark a load into blocktree as finished, once it is checked */
+bool FinishChainstateSnapshotLoad(CBlockTreeDB &blocktree);
+
+/** True if an earlier LoadChainstateSnapshot into blocktree was not finished */
+bool IsChainstateSnapshotLoadInterrupted(CBlockTreeDB &blocktree);
+
+#endif // VERUS_CHAINSNAPSHOT_H
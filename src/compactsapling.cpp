@@ -0,0 +1,181 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "compactsapling.h"
+
+#include "chainparams.h"
+#include "main.h"
+#include "primitives/block.h"
+#include "primitives/transaction.h"
+#include "sync.h"
+#include "util.h"
+#include "utilstrencodings.h"
+
+static const char DB_COMPACT_SAPLING_BLOCK = 'c';
+static const char DB_COMPACT_SAPLING_QUEUE = 'q';
+static const char DB_COMPACT_SAPLING_FIRST = 'F';
+static const char DB_COMPACT_SAPLING_NEXT = 'N';
+
+CCompactSaplingDB *pcompactsapling = NULL;
+
+UniValue CCompactSaplingOutput::ToUniValue() const
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("cmu", cmu.GetHex()));
+    ret.push_back(Pair("epk", epk.GetHex()));
+    ret.push_back(Pair("ciphertext", HexStr(ciphertext.begin(), ciphertext.end())));
+    return ret;
+}
+
+CCompactSaplingTx::CCompactSaplingTx(const CTransaction &tx, uint32_t nIndexIn) : nIndex(nIndexIn), txid(tx.GetHash())
+{
+    vNullifiers.reserve(tx.vShieldedSpend.size());
+    for (const SpendDescription &spend : tx.vShieldedSpend)
+    {
+        vNullifiers.push_back(spend.nullifier);
+    }
+    vOutputs.resize(tx.vShieldedOutput.size());
+    for (size_t i = 0; i < tx.vShieldedOutput.size(); i++)
+    {
+        const OutputDescription &output = tx.vShieldedOutput[i];
+        vOutputs[i].cmu = output.cm;
+        vOutputs[i].epk = output.ephemeralKey;
+        std::copy(output.encCiphertext.begin(), output.encCiphertext.begin() + COMPACT_SAPLING_CIPHERTEXT_SIZE, vOutputs[i].ciphertext.begin());
+    }
+}
+
+UniValue CCompactSaplingTx::ToUniValue() const
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("index", (int64_t)nIndex));
+    ret.push_back(Pair("txid", txid.GetHex()));
+    UniValue nullifiers(UniValue::VARR);
+    for (const uint256 &nullifier : vNullifiers)
+    {
+        nullifiers.push_back(nullifier.GetHex());
+    }
+    ret.push_back(Pair("nullifiers", nullifiers));
+    UniValue outputs(UniValue::VARR);
+    for (const CCompactSaplingOutput &output : vOutputs)
+    {
+        outputs.push_back(output.ToUniValue());
+    }
+    ret.push_back(Pair("outputs", outputs));
+    return ret;
+}
+
+CCompactSaplingBlock::CCompactSaplingBlock(const CBlock &block, int32_t nHeightIn) :
+    nHeight(nHeightIn), hash(block.GetHash()), hashPrevBlock(block.hashPrevBlock), nTime(block.nTime)
+{
+    for (uint32_t i = 0; i < block.vtx.size(); i++)
+    {
+        const CTransaction &tx = block.vtx[i];
+        if (tx.vShieldedSpend.size() || tx.vShieldedOutput.size())
+        {
+            vtx.push_back(CCompactSaplingTx(tx, i));
+        }
+    }
+}
+
+UniValue CCompactSaplingBlock::ToUniValue() const
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("height", nHeight));
+    ret.push_back(Pair("hash", hash.GetHex()));
+    ret.push_back(Pair("previousblockhash", hashPrevBlock.GetHex()));
+    ret.push_back(Pair("time", (int64_t)nTime));
+    UniValue txs(UniValue::VARR);
+    for (const CCompactSaplingTx &tx : vtx)
+    {
+        txs.push_back(tx.ToUniValue());
+    }
+    ret.push_back(Pair("tx", txs));
+    return ret;
+}
+
+CCompactSaplingDB::CCompactSaplingDB(size_t nCacheSize, bool fMemory, bool fWipe, uint64_t nMaxBlocksIn) :
+    CDBWrapper(GetDataDir() / "blocks" / "compactsapling", nCacheSize, DefaultOptions(), fMemory, fWipe),
+    nMaxBlocks(std::max(nMaxBlocksIn, (uint64_t)1)), nFirstSeq(0), nNextSeq(0)
+{
+    if (!Read(DB_COMPACT_SAPLING_FIRST, nFirstSeq) || !Read(DB_COMPACT_SAPLING_NEXT, nNextSeq) || nFirstSeq > nNextSeq)
+        nFirstSeq = nNextSeq = 0;
+}
+
+CDBOptions CCompactSaplingDB::DefaultOptions()
+{
+    CDBOptions dbOptions;
+    dbOptions.nBlockSize = 16384;
+    dbOptions.nBlockCachePercent = 75;
+    dbOptions.nWriteBufferPercent = 10;
+    dbOptions.fCompression = true;
+    return dbOptions;
+}
+
+bool CCompactSaplingDB::ReadBlock(const uint256 &hash, CCompactSaplingBlock &block) const
+{
+    return Read(std::make_pair(DB_COMPACT_SAPLING_BLOCK, hash), block);
+}
+
+bool CCompactSaplingDB::WriteBlock(const CCompactSaplingBlock &block)
+{
+    LOCK(cs);
+    // another request may have cached it since this one missed
+    if (Exists(std::make_pair(DB_COMPACT_SAPLING_BLOCK, block.hash)))
+        return true;
+
+    CDBBatch batch(*this);
+    batch.Write(std::make_pair(DB_COMPACT_SAPLING_BLOCK, block.hash), block);
+    batch.Write(std::make_pair(DB_COMPACT_SAPLING_QUEUE, nNextSeq), block.hash);
+    uint64_t nFirst = nFirstSeq, nNext = nNextSeq + 1;
+    for (; nNext - nFirst > nMaxBlocks; nFirst++)
+    {
+        uint256 hash;
+        if (Read(std::make_pair(DB_COMPACT_SAPLING_QUEUE, nFirst), hash))
+            batch.Erase(std::make_pair(DB_COMPACT_SAPLING_BLOCK, hash));
+        batch.Erase(std::make_pair(DB_COMPACT_SAPLING_QUEUE, nFirst));
+    }
+    batch.Write(DB_COMPACT_SAPLING_FIRST, nFirst);
+    batch.Write(DB_COMPACT_SAPLING_NEXT, nNext);
+    if (!WriteBatch(batch))
+        return false;
+    nFirstSeq = nFirst;
+    nNextSeq = nNext;
+    return true;
+}
+
+uint64_t CCompactSaplingDB::GetBlockCount()
+{
+    LOCK(cs);
+    return nNextSeq - nFirstSeq;
+}
+
+bool GetCompactSaplingBlock(const CBlockIndex *pindex, CCompactSaplingBlock &block)
+{
+    if (pindex == NULL)
+        return false;
+
+    // entries are keyed by block hash, so ones left behind by a reorg are never returned for the new chain
+    if (pcompactsapling && pcompactsapling->ReadBlock(pindex->GetBlockHash(), block))
+        return true;
+
+    CBlock fullBlock;
+    {
+        LOCK(cs_main);
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA))
+            return false;
+        if (!ReadBlockFromDisk(fullBlock, pindex, Params().GetConsensus(), false))
+            return false;
+    }
+    block = CCompactSaplingBlock(fullBlock, pindex->GetHeight());
+
+    if (pcompactsapling)
+    {
+        try {
+            pcompactsapling->WriteBlock(block);
+        } catch (const dbwrapper_error &e) {
+            LogPrintf("%s: failed to cache compact Sapling block %s: %s\n", __func__, block.hash.GetHex(), e.what());
+        }
+    }
+    return true;
+}
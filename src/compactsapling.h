@@ -0,0 +1,143 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef VERUS_COMPACTSAPLING_H
+#define VERUS_COMPACTSAPLING_H
+
+#include "dbwrapper.h"
+#include "serialize.h"
+#include "sync.h"
+#include "uint256.h"
+#include "zcash/Zcash.h"
+
+#include <array>
+#include <vector>
+
+#include <univalue.h>
+
+class CBlock;
+class CBlockIndex;
+class CTransaction;
+
+//! The part of a Sapling note ciphertext needed to trial decrypt it and check its commitment (ZIP 307)
+#define COMPACT_SAPLING_CIPHERTEXT_SIZE (ZC_NOTEPLAINTEXT_LEADING + ZC_DIVERSIFIER_SIZE + ZC_V_SIZE + ZC_R_SIZE)
+
+//! -compactsaplingcache default
+static const bool DEFAULT_COMPACT_SAPLING_CACHE = false;
+//! Maximum number of blocks returned by one compact Sapling request
+static const int MAX_COMPACT_SAPLING_BLOCKS = 1000;
+//! Number of blocks kept in the compact Sapling cache before the oldest written are evicted
+static const uint64_t DEFAULT_COMPACT_SAPLING_CACHE_BLOCKS = 100000;
+
+/** A Sapling output stripped down to what a scanner needs to find notes sent to it */
+class CCompactSaplingOutput
+{
+public:
+    uint256 cmu;
+    uint256 epk;
+    std::array<unsigned char, COMPACT_SAPLING_CIPHERTEXT_SIZE> ciphertext;
+
+    CCompactSaplingOutput() { ciphertext.fill(0); }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(cmu);
+        READWRITE(epk);
+        READWRITE(ciphertext);
+    }
+
+    UniValue ToUniValue() const;
+};
+
+/** The Sapling nullifiers and outputs of one transaction, nIndex is its position in the block */
+class CCompactSaplingTx
+{
+public:
+    uint32_t nIndex;
+    uint256 txid;
+    std::vector<uint256> vNullifiers;
+    std::vector<CCompactSaplingOutput> vOutputs;
+
+    CCompactSaplingTx() : nIndex(0) {}
+    CCompactSaplingTx(const CTransaction &tx, uint32_t nIndexIn);
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nIndex);
+        READWRITE(txid);
+        READWRITE(vNullifiers);
+        READWRITE(vOutputs);
+    }
+
+    UniValue ToUniValue() const;
+};
+
+/**
+ * The Sapling data of a block in the compact form light clients and wallet scanners use, only
+ * transactions with Sapling spends or outputs are included.
+ */
+class CCompactSaplingBlock
+{
+public:
+    int32_t nHeight;
+    uint256 hash;
+    uint256 hashPrevBlock;
+    uint32_t nTime;
+    std::vector<CCompactSaplingTx> vtx;
+
+    CCompactSaplingBlock() : nHeight(0), nTime(0) {}
+    CCompactSaplingBlock(const CBlock &block, int32_t nHeightIn);
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nHeight);
+        READWRITE(hash);
+        READWRITE(hashPrevBlock);
+        READWRITE(nTime);
+        READWRITE(vtx);
+    }
+
+    UniValue ToUniValue() const;
+};
+
+/**
+ * On disk cache of compact Sapling blocks keyed by block hash, filled as blocks are requested. Each
+ * write is also queued by sequence number, and once more than nMaxBlocks are cached the oldest
+ * written are erased, which also drops the entries of blocks a reorg left behind.
+ */
+class CCompactSaplingDB : public CDBWrapper
+{
+private:
+    CCriticalSection cs;
+    uint64_t nMaxBlocks;
+    uint64_t nFirstSeq; //!< sequence number of the oldest cached block
+    uint64_t nNextSeq;  //!< sequence number of the next block written
+
+public:
+    CCompactSaplingDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, uint64_t nMaxBlocksIn = DEFAULT_COMPACT_SAPLING_CACHE_BLOCKS);
+
+    bool ReadBlock(const uint256 &hash, CCompactSaplingBlock &block) const;
+    bool WriteBlock(const CCompactSaplingBlock &block);
+
+    uint64_t GetBlockCount();
+
+    //! read mostly and scanned in height order, so favour the block cache over write buffers
+    static CDBOptions DefaultOptions();
+};
+
+extern CCompactSaplingDB *pcompactsapling;
+
+/**
+ * Get the compact Sapling data of a block in the active chain, from the cache when enabled or
+ * else from the block on disk, which is then added to the cache. Takes cs_main while reading the block.
+ */
+bool GetCompactSaplingBlock(const CBlockIndex *pindex, CCompactSaplingBlock &block);
+
+#endif // VERUS_COMPACTSAPLING_H
@@ -1151,6 +1151,29 @@ UniValue CIdentity::ToUniValue() const
     return obj;
 }
 
+template <typename MULTIBRANCH>
+static void MultiBranchToUniValue(const MULTIBRANCH &branch, UniValue &retObj)
+{
+    UniValue indexArray(UniValue::VARR), extraArray(UniValue::VARR), nodeArray(UniValue::VARR);
+    retObj.push_back(Pair("branchtype", (int)branch.branchType));
+    for (auto index : branch.indexes)
+    {
+        indexArray.push_back((int64_t)index);
+    }
+    retObj.push_back(Pair("indexes", indexArray));
+    retObj.push_back(Pair("mmvsize", (int64_t)(branch.nSize)));
+    for (auto &oneHash : branch.leafExtras)
+    {
+        extraArray.push_back(oneHash.GetHex());
+    }
+    retObj.push_back(Pair("leafextras", extraArray));
+    for (auto &oneHash : branch.nodes)
+    {
+        nodeArray.push_back(oneHash.GetHex());
+    }
+    retObj.push_back(Pair("hashes", nodeArray));
+}
+
 UniValue CMMRProof::ToUniValue() const
 {
     UniValue retObj(UniValue::VOBJ);
@@ -1197,6 +1220,16 @@ UniValue CMMRProof::ToUniValue() const
                 retObj.push_back(Pair("hashes", branchArray));
                 break;
             }
+            case CMerkleBranchBase::BRANCH_MMRBLAKE_MULTINODE:
+            {
+                MultiBranchToUniValue(*(CMMRNodeMultiBranch *)(proof), retObj);
+                break;
+            }
+            case CMerkleBranchBase::BRANCH_MMRBLAKE_MULTIPOWERNODE:
+            {
+                MultiBranchToUniValue(*(CMMRPowerNodeMultiBranch *)(proof), retObj);
+                break;
+            }
         };
     }
     return retObj;
@@ -14,14 +14,15 @@
 #include <memenv.h>
 #include <stdint.h>
 
-static leveldb::Options GetOptions(size_t nCacheSize, bool compression, int maxOpenFiles)
+static leveldb::Options GetOptions(size_t nCacheSize, const CDBOptions& dbOptions)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = compression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
-    options.max_open_files = maxOpenFiles;
+    options.block_cache = leveldb::NewLRUCache(nCacheSize / 100 * dbOptions.nBlockCachePercent);
+    options.write_buffer_size = nCacheSize / 100 * dbOptions.nWriteBufferPercent; // up to two write buffers may be held in memory simultaneously
+    options.block_size = dbOptions.nBlockSize;
+    options.filter_policy = dbOptions.nBloomBits > 0 ? leveldb::NewBloomFilterPolicy(dbOptions.nBloomBits) : NULL;
+    options.compression = dbOptions.fCompression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
+    options.max_open_files = dbOptions.nMaxOpenFiles;
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
         // on corruption in later versions.
@@ -30,14 +31,43 @@ static leveldb::Options GetOptions(size_t nCacheSize, bool compression, int maxO
     return options;
 }
 
-CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles)
+CDBOptions &CDBOptions::ApplyArgs(const std::string &strName)
+{
+    nBloomBits = std::max(0, std::min(64, (int)GetArg("-" + strName + "bloombits", nBloomBits)));
+    nBlockSize = std::max((int64_t)1024, std::min((int64_t)(4 << 20), GetArg("-" + strName + "blocksize", nBlockSize)));
+    nBlockCachePercent = std::max(1, std::min(90, (int)GetArg("-" + strName + "cacheshare", nBlockCachePercent)));
+    // two write buffers may be live at once, so they share whatever the block cache leaves over
+    nWriteBufferPercent = std::max(1, std::min((100 - nBlockCachePercent) / 2, (int)GetArg("-" + strName + "writebuffer", nWriteBufferPercent)));
+    return *this;
+}
+
+std::string CDBOptions::ToString() const
+{
+    return strprintf("bloombits=%d, blocksize=%u, cacheshare=%d%%, writebuffer=%d%%, compression=%s, maxopenfiles=%d",
+                     nBloomBits, nBlockSize, nBlockCachePercent, nWriteBufferPercent, fCompression ? "on" : "off", nMaxOpenFiles);
+}
+
+static CDBOptions MakeDBOptions(bool compression, int maxOpenFiles)
+{
+    CDBOptions dbOptions;
+    dbOptions.fCompression = compression;
+    dbOptions.nMaxOpenFiles = maxOpenFiles;
+    return dbOptions;
+}
+
+CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles) :
+    CDBWrapper(path, nCacheSize, MakeDBOptions(compression, maxOpenFiles), fMemory, fWipe)
+{
+}
+
+CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, const CDBOptions& dbOptions, bool fMemory, bool fWipe)
 {
     penv = NULL;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize, compression, maxOpenFiles);
+    options = GetOptions(nCacheSize, dbOptions);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -49,7 +79,7 @@ CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, b
             dbwrapper_private::HandleError(result);
         }
         TryCreateDirectory(path);
-        LogPrintf("Opening LevelDB in %s\n", path.string());
+        LogPrintf("Opening LevelDB in %s (%s)\n", path.string(), dbOptions.ToString());
     }
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     dbwrapper_private::HandleError(status);
@@ -70,6 +100,7 @@ CDBWrapper::~CDBWrapper()
 
 bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
 {
+    CPerfTimer timer(PERF_DB_WRITE);
     leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
     dbwrapper_private::HandleError(status);
     return true;
@@ -82,6 +113,17 @@ bool CDBWrapper::IsEmpty()
     return !(it->Valid());
 }
 
+CDBSnapshot::CDBSnapshot(const CDBWrapper &_parent) : pdb(_parent.pdb)
+{
+    psnapshot = pdb->GetSnapshot();
+}
+
+CDBSnapshot::~CDBSnapshot()
+{
+    pdb->ReleaseSnapshot(psnapshot);
+    psnapshot = NULL;
+}
+
 CDBIterator::~CDBIterator() { delete piter; }
 bool CDBIterator::Valid() { return piter->Valid(); }
 void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
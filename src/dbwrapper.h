@@ -6,6 +6,7 @@
 #define BITCOIN_DBWRAPPER_H
 
 #include "clientversion.h"
+#include "perfstats.h"
 #include "serialize.h"
 #include "streams.h"
 #include "util.h"
@@ -27,6 +28,37 @@ public:
 
 class CDBWrapper;
 
+/**
+ * Per-database LevelDB tuning. The cache size passed to CDBWrapper is split
+ * between the LRU block cache and the write buffers according to the
+ * percentages below, so each database can be tuned for its access pattern.
+ */
+/** Settings of a LevelDB database, whose defaults are those of the databases that set nothing else */
+struct CDBOptions
+{
+    //! bits per key used by the bloom filter, 0 disables the filter
+    int nBloomBits;
+    //! approximate size of user data packed per block, in bytes
+    size_t nBlockSize;
+    //! percentage of the cache size used for the LRU block cache
+    int nBlockCachePercent;
+    //! percentage of the cache size used for each of the (up to two) write buffers
+    int nWriteBufferPercent;
+    bool fCompression;
+    int nMaxOpenFiles;
+
+    CDBOptions() : nBloomBits(10), nBlockSize(4096), nBlockCachePercent(50), nWriteBufferPercent(25),
+                   fCompression(false), nMaxOpenFiles(64) {}
+
+    /**
+     * Override settings from -<name>bloombits, -<name>blocksize, -<name>cacheshare
+     * and -<name>writebuffer, clamping them to sane ranges.
+     */
+    CDBOptions &ApplyArgs(const std::string &strName);
+
+    std::string ToString() const;
+};
+
 /** These should be considered an implementation detail of the specific database.
  */
 namespace dbwrapper_private {
@@ -68,6 +100,20 @@ public:
         batch.Put(slKey, slValue);
     }
 
+    //! write a key and value that are already serialized, such as ones copied from another database
+    void WriteRaw(const std::vector<unsigned char>& key, const std::vector<unsigned char>& value)
+    {
+        leveldb::Slice slKey((const char *)key.data(), key.size());
+        leveldb::Slice slValue((const char *)value.data(), value.size());
+        batch.Put(slKey, slValue);
+    }
+
+    void EraseRaw(const std::vector<unsigned char>& key)
+    {
+        leveldb::Slice slKey((const char *)key.data(), key.size());
+        batch.Delete(slKey);
+    }
+
     template <typename K>
     void Erase(const K& key)
     {
@@ -80,6 +126,26 @@ public:
     }
 };
 
+/** Point-in-time, read-only view of a CDBWrapper. The snapshot is released on destruction. */
+class CDBSnapshot
+{
+private:
+    leveldb::DB *pdb;
+    const leveldb::Snapshot *psnapshot;
+
+    CDBSnapshot(const CDBSnapshot&);
+    void operator=(const CDBSnapshot&);
+
+public:
+    /**
+     * @param[in] _parent   CDBWrapper to take the snapshot of, must outlive the snapshot
+     */
+    CDBSnapshot(const CDBWrapper &_parent);
+    ~CDBSnapshot();
+
+    const leveldb::Snapshot *GetSnapshot() const { return psnapshot; }
+};
+
 class CDBIterator
 {
 private:
@@ -142,10 +208,22 @@ public:
         return piter->value().size();
     }
 
+    //! the key and value as stored, for copying entries without knowing their types
+    std::vector<unsigned char> GetRawKey() {
+        leveldb::Slice slKey = piter->key();
+        return std::vector<unsigned char>(slKey.data(), slKey.data() + slKey.size());
+    }
+
+    std::vector<unsigned char> GetRawValue() {
+        leveldb::Slice slValue = piter->value();
+        return std::vector<unsigned char>(slValue.data(), slValue.data() + slValue.size());
+    }
+
 };
 
 class CDBWrapper
 {
+    friend class CDBSnapshot;
 private:
     //! custom environment this database is using (may be NULL in case of default environment)
     leveldb::Env* penv;
@@ -176,18 +254,36 @@ public:
      * @param[in] fWipe       If true, remove all existing data.
      */
     CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool compression = false, int maxOpenFiles = 64);
+
+    /**
+     * @param[in] path        Location in the filesystem where leveldb data will be stored.
+     * @param[in] nCacheSize  Total memory to split between block cache and write buffers.
+     * @param[in] dbOptions   Per-database tuning of bloom filter, block size and cache shares.
+     * @param[in] fMemory     If true, use leveldb's memory environment.
+     * @param[in] fWipe       If true, remove all existing data.
+     */
+    CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, const CDBOptions& dbOptions, bool fMemory = false, bool fWipe = false);
     ~CDBWrapper();
 
+    /**
+     * Read a value, optionally from a snapshot taken earlier with CDBSnapshot
+     * instead of the current state of the database.
+     */
     template <typename K, typename V>
-    bool Read(const K& key, V& value) const
+    bool Read(const K& key, V& value, const CDBSnapshot *psnapshot = NULL) const
     {
+        CPerfTimer timer(PERF_DB_READ);
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
         ssKey << key;
         leveldb::Slice slKey(&ssKey[0], ssKey.size());
 
+        leveldb::ReadOptions snapshotoptions = readoptions;
+        if (psnapshot)
+            snapshotoptions.snapshot = psnapshot->GetSnapshot();
+
         std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        leveldb::Status status = pdb->Get(snapshotoptions, slKey, &strValue);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -252,9 +348,12 @@ public:
         return WriteBatch(batch, true);
     }
 
-    CDBIterator *NewIterator()
+    CDBIterator *NewIterator(const CDBSnapshot *psnapshot = NULL)
     {
-        return new CDBIterator(*this, pdb->NewIterator(iteroptions));
+        leveldb::ReadOptions snapshotoptions = iteroptions;
+        if (psnapshot)
+            snapshotoptions.snapshot = psnapshot->GetSnapshot();
+        return new CDBIterator(*this, pdb->NewIterator(snapshotoptions));
     }
 
     /**
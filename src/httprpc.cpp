@@ -3,6 +3,7 @@
 #include "chainparams.h"
 #include "httpserver.h"
 #include "key_io.h"
+#include "rpc/jsonstream.h"
 #include "rpc/protocol.h"
 #include "rpc/server.h"
 #include "random.h"
@@ -75,6 +76,29 @@ static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const Uni
     req->WriteReply(nStatus, strReply);
 }
 
+/** Sink for the reply to a single JSON-RPC request, which becomes a chunked reply on its first flush */
+class HTTPRPCReplyStream
+{
+public:
+    HTTPRPCReplyStream(HTTPRequest* req) : req(req), fStarted(false) {}
+
+    bool operator()(const std::string& strChunk)
+    {
+        if (!fStarted) {
+            req->WriteHeader("Content-Type", "application/json");
+            req->StartChunkedReply(HTTP_OK);
+            fStarted = true;
+        }
+        return req->WriteReplyChunk(strChunk);
+    }
+
+    bool Started() const { return fStarted; }
+
+private:
+    HTTPRequest* req;
+    bool fStarted;
+};
+
 static bool RPCAuthorized(const std::string& strAuth)
 {
     if (strRPCUserColonPass.empty()) // Belt-and-suspenders measure if InitRPCAuthentication was not called
@@ -142,10 +166,38 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
                 printf("%s %s\n", jreq.strMethod.c_str(), jreq.params.write().c_str());
             }
 
-            UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
-
-            // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            // Send reply. It is written out as it is produced and replies too large for one
+            // flush go out chunked, rather than as one string built from the whole result.
+            HTTPRPCReplyStream stream(req);
+            CJSONStreamWriter writer(boost::ref(stream));
+            writer.BeginObject();
+            writer.Key("result");
+            try {
+                UniValue result;
+                {
+                    CRPCResultStreamScope streamScope(jreq.strMethod, &writer);
+                    result = tableRPC.execute(jreq.strMethod, jreq.params);
+                }
+                if (writer.AwaitingValue())
+                    writer.Value(result);
+            } catch (...) {
+                if (!stream.Started())
+                    throw;
+                // the status line is already out, all that is left is to drop the connection
+                LogPrintf("%s: %s failed after part of its reply was sent\n", __func__, jreq.strMethod);
+                req->AbortChunkedReply();
+                return false;
+            }
+            writer.Pair("error", NullUniValue);
+            writer.Pair("id", jreq.id);
+            writer.EndObject();
+            if (stream.Started()) {
+                if (writer.Flush())
+                    req->WriteReplyChunk("\n");
+                req->EndChunkedReply();
+                return true;
+            }
+            strReply = writer.TakeBuffer() + "\n";
 
         // array of requests
         } else if (valRequest.isArray())
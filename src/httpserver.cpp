@@ -25,6 +25,7 @@
 #include <event2/http.h>
 #include <event2/thread.h>
 #include <event2/buffer.h>
+#include <event2/bufferevent.h>
 #include <event2/util.h>
 #include <event2/keyvalq_struct.h>
 
@@ -38,6 +39,10 @@
 #include <boost/algorithm/string/case_conv.hpp> // for to_lower()
 #include <boost/foreach.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+/** Most bytes of a chunked reply that may wait to be sent before its worker is held back */
+static const size_t MAX_HTTP_CHUNK_BACKLOG = 4 * 1024 * 1024;
 
 /** HTTP request work item */
 class HTTPWorkItem : public HTTPClosure
@@ -540,6 +545,125 @@ void HTTPEvent::trigger(struct timeval* tv)
     else
         evtimer_add(ev, tv); // trigger after timeval passed
 }
+/** A chunked reply, shared between the worker producing it and the http thread sending it.
+ * req and self are only touched by the http thread.
+ */
+struct HTTPChunkedReply
+{
+    boost::mutex cs;
+    boost::condition_variable condDrained;
+    struct evhttp_request* req;
+    //! bytes handed to the http thread that have not been written to the socket yet
+    size_t nQueued;
+    //! the part of nQueued already in libevent's output buffer
+    size_t nBuffered;
+    //! the connection closed before the reply was finished
+    bool fClosed;
+    //! keeps the reply alive while libevent holds callbacks pointing to it
+    boost::shared_ptr<HTTPChunkedReply> self;
+
+    HTTPChunkedReply(struct evhttp_request* reqIn) : req(reqIn), nQueued(0), nBuffered(0), fClosed(false) {}
+};
+
+static void http_chunked_close_cb(struct evhttp_connection*, void* arg)
+{
+    HTTPChunkedReply* reply = (HTTPChunkedReply*)arg;
+    boost::shared_ptr<HTTPChunkedReply> keepAlive;
+    {
+        boost::unique_lock<boost::mutex> lock(reply->cs);
+        // When the client goes away mid-reply libevent detaches the unfinished request from the
+        // connection and leaves it to us, http_chunked_end or http_chunked_abort frees it. A request
+        // still attached here is freed together with its connection, as on shutdown.
+        if (evhttp_request_get_connection(reply->req))
+        {
+            reply->req = NULL;
+            keepAlive.swap(reply->self);
+        }
+        reply->fClosed = true;
+    }
+    reply->condDrained.notify_all();
+}
+
+static void http_chunked_written_cb(struct evhttp_connection*, void* arg)
+{
+    // called once libevent's output buffer is empty again
+    HTTPChunkedReply* reply = (HTTPChunkedReply*)arg;
+    {
+        boost::unique_lock<boost::mutex> lock(reply->cs);
+        reply->nQueued -= reply->nBuffered;
+        reply->nBuffered = 0;
+    }
+    reply->condDrained.notify_all();
+}
+
+static void http_chunked_start(boost::shared_ptr<HTTPChunkedReply> reply, int nStatus)
+{
+    reply->self = reply;
+    struct evhttp_connection* evcon = evhttp_request_get_connection(reply->req);
+    if (!evcon)
+    {
+        // the client left before the reply started, the request waits for http_chunked_end or abort to free it
+        {
+            boost::unique_lock<boost::mutex> lock(reply->cs);
+            reply->fClosed = true;
+        }
+        reply->condDrained.notify_all();
+        return;
+    }
+    evhttp_connection_set_closecb(evcon, http_chunked_close_cb, reply.get());
+    evhttp_send_reply_start(reply->req, nStatus, NULL);
+}
+
+static void http_chunked_send(boost::shared_ptr<HTTPChunkedReply> reply, const std::string& strChunk)
+{
+    if (!reply->req || reply->fClosed)
+        return;
+    {
+        boost::unique_lock<boost::mutex> lock(reply->cs);
+        reply->nBuffered += strChunk.size();
+    }
+    struct evbuffer* evb = evbuffer_new();
+    evbuffer_add(evb, strChunk.data(), strChunk.size());
+    evhttp_send_reply_chunk_with_cb(reply->req, evb, http_chunked_written_cb, reply.get());
+    evbuffer_free(evb);
+}
+
+static void http_chunked_end(boost::shared_ptr<HTTPChunkedReply> reply)
+{
+    if (!reply->req)
+        return;
+    // a request detached from its closed connection has no close callback left to clear, and
+    // evhttp_send_reply_end frees it
+    if (!reply->fClosed)
+        evhttp_connection_set_closecb(evhttp_request_get_connection(reply->req), NULL, NULL);
+    evhttp_send_reply_end(reply->req);
+    reply->req = NULL;
+    reply->self.reset();
+}
+
+static void http_chunked_abort(boost::shared_ptr<HTTPChunkedReply> reply)
+{
+    if (!reply->req)
+        return;
+    if (reply->fClosed)
+    {
+        // the client has already gone, so there is nothing to truncate, only the detached request to free
+        http_chunked_end(reply);
+        return;
+    }
+    // drop the connection, so the client sees a truncated body instead of a complete one
+    struct evhttp_connection* evcon = evhttp_request_get_connection(reply->req);
+    evhttp_connection_set_closecb(evcon, NULL, NULL);
+    evhttp_connection_free(evcon);
+    {
+        boost::unique_lock<boost::mutex> lock(reply->cs);
+        reply->req = NULL;
+        reply->fClosed = true;
+    }
+    reply->condDrained.notify_all();
+    reply->self.reset();
+}
+
 HTTPRequest::HTTPRequest(struct evhttp_request* req) : req(req),
                                                        replySent(false)
 {
@@ -549,7 +673,10 @@ HTTPRequest::~HTTPRequest()
     if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
-        WriteReply(HTTP_INTERNAL, "Unhandled request");
+        if (chunked)
+            AbortChunkedReply();
+        else
+            WriteReply(HTTP_INTERNAL, "Unhandled request");
     }
     // evhttpd cleans up the request, as long as a reply was sent.
 }
@@ -611,6 +738,54 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     req = 0; // transferred back to main thread
 }
 
+void HTTPRequest::StartChunkedReply(int nStatus)
+{
+    assert(!replySent && req && !chunked);
+    chunked.reset(new HTTPChunkedReply(req));
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, boost::bind(http_chunked_start, chunked, nStatus));
+    ev->trigger(0);
+}
+
+bool HTTPRequest::WriteReplyChunk(const std::string& strChunk)
+{
+    assert(!replySent && chunked);
+    {
+        boost::unique_lock<boost::mutex> lock(chunked->cs);
+        // Stay no more than a few chunks ahead of the client. A client that stops reading
+        // runs into the server timeout, which closes the connection and wakes us.
+        while (!chunked->fClosed && chunked->nQueued > 0 && chunked->nQueued + strChunk.size() > MAX_HTTP_CHUNK_BACKLOG)
+            chunked->condDrained.wait(lock);
+        if (chunked->fClosed)
+            return false;
+        if (strChunk.empty())
+            return true;
+        chunked->nQueued += strChunk.size();
+    }
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, boost::bind(http_chunked_send, chunked, strChunk));
+    ev->trigger(0);
+    return true;
+}
+
+void HTTPRequest::EndChunkedReply()
+{
+    assert(!replySent && chunked);
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, boost::bind(http_chunked_end, chunked));
+    ev->trigger(0);
+    chunked.reset();
+    replySent = true;
+    req = 0; // transferred back to main thread
+}
+
+void HTTPRequest::AbortChunkedReply()
+{
+    assert(!replySent && chunked);
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, boost::bind(http_chunked_abort, chunked));
+    ev->trigger(0);
+    chunked.reset();
+    replySent = true;
+    req = 0; // transferred back to main thread
+}
+
 CService HTTPRequest::GetPeer()
 {
     evhttp_connection* con = evhttp_request_get_connection(req);
@@ -12,6 +12,7 @@
 #endif
 #include <boost/thread.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/function.hpp>
 
 static const int DEFAULT_HTTP_THREADS=4;
@@ -22,6 +23,7 @@ struct evhttp_request;
 struct event_base;
 class CService;
 class HTTPRequest;
+struct HTTPChunkedReply;
 
 /** Initialize HTTP server.
  * Call this before RegisterHTTPHandler or EventBase().
@@ -59,6 +61,7 @@ class HTTPRequest
 {
 private:
     struct evhttp_request* req;
+    boost::shared_ptr<HTTPChunkedReply> chunked;
 
     // For test access
 protected:
@@ -118,6 +121,36 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     virtual void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Start a chunked HTTP reply, for bodies too large to build in one piece.
+     * nStatus and the headers are sent right away, the body follows in any number of
+     * WriteReplyChunk calls and is finished by EndChunkedReply.
+     *
+     * @note call this instead of WriteReply, after the headers are written.
+     */
+    virtual void StartChunkedReply(int nStatus);
+
+    /**
+     * Send the next part of a chunked reply. Blocks while the client is slow to read what was
+     * sent before. Returns false once the connection is gone, the rest of the body can be dropped.
+     */
+    virtual bool WriteReplyChunk(const std::string& strChunk);
+
+    /**
+     * Finish a chunked reply.
+     *
+     * @note As with WriteReply, do not call any other HTTPRequest methods after this.
+     */
+    virtual void EndChunkedReply();
+
+    /**
+     * Close the connection in the middle of a chunked reply, without the final empty chunk,
+     * so the client cannot take what was sent for the whole body.
+     *
+     * @note As with WriteReply, do not call any other HTTPRequest methods after this.
+     */
+    virtual void AbortChunkedReply();
 };
 
 /** Event handler closure.
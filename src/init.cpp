@@ -12,8 +12,11 @@
 #include "primitives/block.h"
 #include "addrman.h"
 #include "amount.h"
+#include "chainsnapshot.h"
 #include "checkpoints.h"
 #include "compat/sanity.h"
+#include "blockmmrcache.h"
+#include "compactsapling.h"
 #include "consensus/upgrades.h"
 #include "consensus/validation.h"
 #include "httpserver.h"
@@ -25,6 +28,7 @@
 #include "metrics.h"
 #include "miner.h"
 #include "net.h"
+#include "pbaas/notarizedsync.h"
 #include "rpc/server.h"
 #include "rpc/pbaasrpc.h"
 #include "rpc/register.h"
@@ -33,12 +37,14 @@
 #include "scheduler.h"
 #include "txdb.h"
 #include "torcontrol.h"
+#include "transaction_builder.h"
 #include "ui_interface.h"
 #include "util.h"
 #include "utilmoneystr.h"
 #include "validationinterface.h"
 #ifdef ENABLE_WALLET
 #include "key_io.h"
+#include "wallet/saplingdecrypt.h"
 #include "wallet/wallet.h"
 #include "wallet/walletdb.h"
 #endif
@@ -171,7 +177,7 @@ public:
     // Writes do not need similar protection, as failure to write is handled by the caller.
 };
 
-static CCoinsViewDB *pcoinsdbview = NULL;
+CCoinsViewDB *pcoinsdbview = NULL;
 static CCoinsViewErrorCatcher *pcoinscatcher = NULL;
 static boost::scoped_ptr<ECCVerifyHandle> globalVerifyHandle;
 
@@ -220,6 +226,7 @@ void Shutdown()
     StopNode();
     StopTorControl();
     UnregisterNodeSignals(GetNodeSignals());
+    UnregisterBackgroundSignalScheduler();
 
     if (fFeeEstimatesInitialized)
     {
@@ -243,8 +250,13 @@ void Shutdown()
         pcoinscatcher = NULL;
         delete pcoinsdbview;
         pcoinsdbview = NULL;
+        UpdateBlockTreeSnapshot(NULL);
         delete pblocktree;
         pblocktree = NULL;
+        delete pcompactsapling;
+        pcompactsapling = NULL;
+        delete pblockmmrdb;
+        pblockmmrdb = NULL;
     }
 #ifdef ENABLE_WALLET
     if (pwalletMain)
@@ -350,8 +362,10 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-alerts", strprintf(_("Receive and display P2P network alerts (default: %u)"), DEFAULT_ALERTS));
     strUsage += HelpMessageOpt("-alertnotify=<cmd>", _("Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)"));
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", _("Execute command when the best block changes (%s in cmd is replaced by block hash)"));
+    strUsage += HelpMessageOpt("-blockmmrcache=<n>", strprintf(_("Keep the transaction MMR roots of up to <n> recently proven blocks on disk for partial transaction proofs, 0 to disable (default: %u)"), DEFAULT_BLOCK_MMR_CACHE));
     strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(_("How many blocks to check at startup (default: %u, 0 = all)"), 288));
     strUsage += HelpMessageOpt("-checklevel=<n>", strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"), 3));
+    strUsage += HelpMessageOpt("-compactsaplingcache", strprintf(_("Keep an on-disk cache of the last %u compact Sapling blocks served by z_getcompactsaplingblocks and /rest/compactsapling (default: %u)"), DEFAULT_COMPACT_SAPLING_CACHE_BLOCKS, DEFAULT_COMPACT_SAPLING_CACHE));
     strUsage += HelpMessageOpt("-conf=<file>", strprintf(_("Specify configuration file (default: %s)"), "komodo.conf"));
     if (mode == HMM_BITCOIND)
     {
@@ -362,9 +376,15 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-datadir=<dir>", _("Specify data directory"));
     strUsage += HelpMessageOpt("-exportdir=<dir>", _("Specify directory to be used when exporting data"));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    strUsage += HelpMessageOpt("-<db>bloombits=<n>", _("Set bloom filter bits per key for database <db> (blockindex, chainstate or notarisations), 0 to disable"));
+    strUsage += HelpMessageOpt("-<db>blocksize=<n>", _("Set LevelDB block size in bytes for database <db>"));
+    strUsage += HelpMessageOpt("-<db>cacheshare=<n>", _("Set percentage of the cache of database <db> used for the block cache"));
+    strUsage += HelpMessageOpt("-<db>writebuffer=<n>", _("Set percentage of the cache of database <db> used for each write buffer"));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file") + " " + _("on startup"));
+    strUsage += HelpMessageOpt("-loadsnapshot=<file>", _("Start from a chainstate snapshot written by dumpchainstate instead of the blocks before it, when the block index and chainstate databases are empty (requires -prune). On a PBaaS chain, it must be on the chain notarized by the last notarization confirmed on the notary chain"));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
     strUsage += HelpMessageOpt("-mempooltxinputlimit=<n>", _("[DEPRECATED FROM OVERWINTER] Set the maximum number of transparent inputs in a transaction that the mempool will accept (default: 0 = no limit applied)"));
+    strUsage += HelpMessageOpt("-notarizedsync", strprintf(_("On a PBaaS chain, skip script and proof checks of blocks under the last notarization of this chain confirmed on the notary chain, once the headers are checked against it (default: %u)"), DEFAULT_NOTARIZED_SYNC));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -(int)boost::thread::hardware_concurrency(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
 #ifndef _WIN32
@@ -395,6 +415,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-listen", _("Accept connections from outside (default: 1 if no -proxy or -connect)"));
     strUsage += HelpMessageOpt("-listenonion", strprintf(_("Automatically create Tor hidden service (default: %d)"), DEFAULT_LISTEN_ONION));
     strUsage += HelpMessageOpt("-maxconnections=<n>", strprintf(_("Maintain at most <n> connections to peers (default: %u)"), DEFAULT_MAX_PEER_CONNECTIONS));
+    strUsage += HelpMessageOpt("-msghandlerthreads=<n>", strprintf(_("Number of threads handling peer messages, 1 handles all peers on a single thread (default: %u, max: %u)"), DEFAULT_MESSAGE_HANDLER_THREADS, MAX_MESSAGE_HANDLER_THREADS));
+    strUsage += HelpMessageOpt("-socketevents=<mode>", strprintf(_("Socket events mode, which must be one of 'select' or 'epoll' where supported (default: %s)"), DefaultSocketEventsMode()));
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf(_("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)"), 5000));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf(_("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), 1000));
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf(_("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy"));
@@ -425,7 +447,12 @@ std::string HelpMessage(HelpMessageMode mode)
             CURRENCY_UNIT, FormatMoney(CWallet::minTxFee.GetFeePerK())));
     strUsage += HelpMessageOpt("-paytxfee=<amt>", strprintf(_("Fee (in %s/kB) to add to transactions you send (default: %s)"),
         CURRENCY_UNIT, FormatMoney(payTxFee.GetFeePerK())));
+    strUsage += HelpMessageOpt("-provingtxs=<n>", strprintf(_("Number of transactions whose Sapling proofs are generated at once, each proof already uses all cores (default: %d)"), DEFAULT_PROVING_TXS));
     strUsage += HelpMessageOpt("-rescan", _("Rescan the block chain for missing wallet transactions") + " " + _("on startup"));
+    strUsage += HelpMessageOpt("-saplingdecryptthreads=<n>", strprintf(_("Number of threads trial decrypting Sapling outputs for the wallet (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
+        1, MAX_SAPLING_DECRYPT_THREADS, DEFAULT_SAPLING_DECRYPT_THREADS));
+    strUsage += HelpMessageOpt("-rescanthreads=<n>", strprintf(_("Number of threads reading and decrypting blocks during a wallet rescan (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
+        1, MAX_RESCAN_THREADS, DEFAULT_RESCAN_THREADS));
     strUsage += HelpMessageOpt("-salvagewallet", _("Attempt to recover private keys from a corrupt wallet.dat") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-sendfreetransactions", strprintf(_("Send transactions as zero-fee transactions if possible (default: %u)"), 0));
     strUsage += HelpMessageOpt("-spendzeroconfchange", strprintf(_("Spend unconfirmed change when sending transactions (default: %u)"), 1));
@@ -436,6 +463,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-upgradewallet", _("Upgrade wallet to latest format") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-wallet=<file>", _("Specify wallet file (within data directory)") + " " + strprintf(_("(default: %s)"), "wallet.dat"));
     strUsage += HelpMessageOpt("-walletbroadcast", _("Make the wallet broadcast transactions") + " " + strprintf(_("(default: %u)"), true));
+    strUsage += HelpMessageOpt("-walletstore=<store>", strprintf(_("Keep the wallet in Berkeley DB (bdb) or in an append-only log next to it (log), the wallet is copied over on the first start with a new store (default: %s)"), DEFAULT_WALLET_STORE));
     strUsage += HelpMessageOpt("-walletnotify=<cmd>", _("Execute command when a wallet transaction changes (%s in cmd is replaced by TxID)"));
     strUsage += HelpMessageOpt("-zapwallettxes=<mode>", _("Delete all wallet transactions and only recover those parts of the blockchain through -rescan on startup") +
         " " + _("(1 = keep tx meta data e.g. account owner and payment request information, 2 = drop tx meta data)"));
@@ -534,6 +562,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-rpcpassword=<pw>", _("Password for JSON-RPC connections"));
     strUsage += HelpMessageOpt("-rpcport=<port>", strprintf(_("Listen for JSON-RPC connections on <port> (default: %u or testnet: %u)"), 7771, 17771));
     strUsage += HelpMessageOpt("-rpcallowip=<ip>", _("Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times"));
+    strUsage += HelpMessageOpt("-rpcbatchthreads=<n>", strprintf(_("Number of threads running the read-only calls of a JSON-RPC batch at once (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
+        1, MAX_RPC_BATCH_THREADS, DEFAULT_RPC_BATCH_THREADS));
     strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(_("Set the number of threads to service RPC calls (default: %d)"), DEFAULT_HTTP_THREADS));
     if (showDebug) {
         strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
@@ -954,7 +984,16 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     // Make sure enough file descriptors are available
     int nBind = std::max((int)mapArgs.count("-bind") + (int)mapArgs.count("-whitebind"), 1);
     nMaxConnections = GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
-    nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
+    std::string strSocketEvents = GetArg("-socketevents", DefaultSocketEventsMode());
+    if (!SetSocketEventsMode(strSocketEvents))
+        return InitError(strprintf(_("Invalid -socketevents ('%s') specified. Only these modes are supported: %s"), strSocketEvents, DefaultSocketEventsMode() == "epoll" ? "select, epoll" : "select"));
+    if (!InitSocketEvents())
+        return InitError(strprintf(_("Unable to use -socketevents=%s: %s"), strSocketEvents, NetworkErrorString(errno)));
+    // select() cannot watch sockets past FD_SETSIZE, epoll is only limited by the descriptor limit
+    if (nSocketEventsMode == SOCKETEVENTS_SELECT)
+        nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
+    else
+        nMaxConnections = std::max(nMaxConnections, 0);
     int nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
@@ -1023,6 +1062,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    nMessageHandlerThreads = std::max(1, std::min((int)GetArg("-msghandlerthreads", DEFAULT_MESSAGE_HANDLER_THREADS), MAX_MESSAGE_HANDLER_THREADS));
+
     fServer = GetBoolArg("-server", false);
 
     // block pruning; get the amount of disk space (in MB) to allot for block & undo files
@@ -1115,6 +1156,9 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     fSendFreeTransactions = GetBoolArg("-sendfreetransactions", false);
 
     std::string strWalletFile = GetArg("-wallet", "wallet.dat");
+    std::string strWalletStore = GetArg("-walletstore", DEFAULT_WALLET_STORE);
+    if (strWalletStore != "bdb" && strWalletStore != "log")
+        return InitError(strprintf(_("Unknown -walletstore: '%s'"), strWalletStore));
     // Check Sapling migration address if set and is a valid Sapling address
     if (mapArgs.count("-migrationdestaddress")) {
         std::string migrationDestAddress = mapArgs["-migrationdestaddress"];
@@ -1318,9 +1362,22 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             threadGroup.create_thread(&ThreadScriptCheck);
     }
 
+#ifdef ENABLE_WALLET
+    if (!fDisableWallet) {
+        nSaplingDecryptThreads = GetArg("-saplingdecryptthreads", DEFAULT_SAPLING_DECRYPT_THREADS);
+        if (nSaplingDecryptThreads <= 0)
+            nSaplingDecryptThreads += GetNumCores();
+        nSaplingDecryptThreads = std::max(1, std::min(nSaplingDecryptThreads, MAX_SAPLING_DECRYPT_THREADS));
+        LogPrintf("Using %u threads for Sapling trial decryption\n", nSaplingDecryptThreads);
+        for (int i=0; i<nSaplingDecryptThreads-1; i++)
+            threadGroup.create_thread(&ThreadSaplingTrialDecrypt);
+    }
+#endif
+
     // Start the lightweight task scheduler thread
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
     threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+    RegisterBackgroundSignalScheduler(scheduler);
 
     // Count uptime
     MarkStartTime();
@@ -1378,7 +1435,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         if (!warningString.empty())
             InitWarning(warningString);
         if (!errorString.empty())
-            return InitError(warningString);
+            return InitError(errorString);
 
     } // (!fDisableWallet)
 #endif // ENABLE_WALLET
@@ -1562,6 +1619,11 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     int dbMaxOpenFiles = GetArg("-dbmaxopenfiles", DEFAULT_DB_MAX_OPEN_FILES);
     bool dbCompression = GetBoolArg("-dbcompression", DEFAULT_DB_COMPRESSION);
 
+    bool fPointLookupIndexes = GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) || GetBoolArg("-spentindex", DEFAULT_SPENTINDEX) || GetBoolArg("-txindex", false);
+    CDBOptions blockTreeDBOptions = CBlockTreeDB::DefaultOptions(fPointLookupIndexes, dbCompression, dbMaxOpenFiles).ApplyArgs("blockindex");
+    CDBOptions coinsDBOptions = CCoinsViewDB::DefaultOptions().ApplyArgs("chainstate");
+    CDBOptions notarisationsDBOptions = NotarisationDB::DefaultOptions().ApplyArgs("notarisations");
+
     LogPrintf("Block index database configuration:\n");
     LogPrintf("* Using %d max open files\n", dbMaxOpenFiles);
     LogPrintf("* Compression is %s\n", dbCompression ? "enabled" : "disabled");
@@ -1583,17 +1645,31 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     nTotalCache -= nBlockTreeDBCache;
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nTotalCache -= nCoinDBCache;
+    int64_t nCompactSaplingCache = 0;
+    if (GetBoolArg("-compactsaplingcache", DEFAULT_COMPACT_SAPLING_CACHE)) {
+        nCompactSaplingCache = std::min(nTotalCache / 8, (int64_t)1 << 26); // at most 64 MiB, entries are read once per scanner pass
+        nTotalCache -= nCompactSaplingCache;
+    }
+    int64_t nBlockMMRCache = 0;
+    if (GetArg("-blockmmrcache", DEFAULT_BLOCK_MMR_CACHE) > 0) {
+        nBlockMMRCache = std::min(nTotalCache / 16, (int64_t)1 << 23); // at most 8 MiB, entries are small and mostly for recent blocks
+        nTotalCache -= nBlockMMRCache;
+    }
     nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Max cache setting possible %.1fMiB\n", nMaxDbCache);
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
+    if (nCompactSaplingCache)
+        LogPrintf("* Using %.1fMiB for compact Sapling block cache\n", nCompactSaplingCache * (1.0 / 1024 / 1024));
+    if (nBlockMMRCache)
+        LogPrintf("* Using %.1fMiB for block MMR cache\n", nBlockMMRCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set\n", nCoinCacheUsage * (1.0 / 1024 / 1024));
 
     if ( fReindex == 0 )
     {
         bool checkval,fAddressIndex,fSpentIndex,fTimeStampIndex;
-        pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex, dbCompression, dbMaxOpenFiles);
+        pblocktree = new CBlockTreeDB(nBlockTreeDBCache, blockTreeDBOptions, false, fReindex);
 
         fAddressIndex = true;
         pblocktree->ReadFlag("addressindex", checkval);
@@ -1650,14 +1726,42 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                 delete pcoinscatcher;
                 delete pblocktree;
                 delete pnotarisations;
+                delete pcompactsapling;
+                delete pblockmmrdb;
 
-                pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex, dbCompression, dbMaxOpenFiles);
-                pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex);
+                pblocktree = new CBlockTreeDB(nBlockTreeDBCache, blockTreeDBOptions, false, fReindex);
+                pcoinsdbview = new CCoinsViewDB(nCoinDBCache, coinsDBOptions, false, fReindex);
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
-                pnotarisations = new NotarisationDB(100*1024*1024, false, fReindex);
+                pnotarisations = new NotarisationDB(100*1024*1024, notarisationsDBOptions, false, fReindex);
+                pcompactsapling = nCompactSaplingCache ? new CCompactSaplingDB(nCompactSaplingCache, false, fReindex) : NULL;
+                pblockmmrdb = nBlockMMRCache ? new CBlockMMRDB(nBlockMMRCache, GetArg("-blockmmrcache", DEFAULT_BLOCK_MMR_CACHE), false, fReindex) : NULL;
+                if (!chainActive.OpenMMRStore(GetDataDir() / "blocks" / "chainmmr.dat"))
+                    LogPrintf("Cannot open the chain MMR file, it will be rebuilt in memory\n");
 
 
+                bool fSnapshotInterrupted = IsChainstateSnapshotLoadInterrupted(*pblocktree);
+                if (fSnapshotInterrupted && !mapArgs.count("-loadsnapshot")) {
+                    return InitError(_("Loading a chainstate snapshot did not finish. Restart with -loadsnapshot to load it again"));
+                }
+
+                // a new data directory is wiped for its index flags, so fReindex is set without -reindex
+                bool fLoadedSnapshot = false;
+                CChainstateSnapshotInfo snapshotInfo;
+                if (mapArgs.count("-loadsnapshot") && (fSnapshotInterrupted || (pblocktree->IsEmpty() && pcoinsdbview->GetDB().IsEmpty()))) {
+                    if (GetBoolArg("-reindex", false))
+                        return InitError(_("-loadsnapshot cannot be used with -reindex"));
+                    if (!fPruneMode)
+                        return InitError(_("-loadsnapshot requires -prune, as the blocks before the snapshot are never downloaded"));
+                    uiInterface.InitMessage(_("Loading chainstate snapshot..."));
+                    std::string strSnapshotError;
+                    if (!LoadChainstateSnapshot(GetArg("-loadsnapshot", ""), *pcoinsdbview, *pblocktree, snapshotInfo, strSnapshotError))
+                        return InitError(strprintf(_("Cannot load chainstate snapshot: %s"), strSnapshotError));
+                    // there are no block files to reindex
+                    fReindex = false;
+                    fLoadedSnapshot = true;
+                }
+
                 if (fReindex) {
                     pblocktree->WriteReindexing(true);
                     //If we're reindexing in prune mode, wipe away unusable block files and all undo data files
@@ -1701,6 +1805,15 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                     break;
                 }
 
+                if (fLoadedSnapshot) {
+                    uiInterface.InitMessage(_("Checking chainstate snapshot..."));
+                    std::string strSnapshotError;
+                    if (!CheckChainstateSnapshot(snapshotInfo, strSnapshotError))
+                        return InitError(strprintf(_("Cannot use chainstate snapshot: %s"), strSnapshotError));
+                    if (!FinishChainstateSnapshotLoad(*pblocktree))
+                        return InitError(_("Cannot write to the block index database"));
+                }
+
                 if (!fReindex) {
                     uiInterface.InitMessage(_("Rewinding blocks if needed..."));
                     if (!RewindBlockIndex(chainparams, clearWitnessCaches)) {
@@ -1888,7 +2001,10 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             uiInterface.InitMessage(_("Rescanning..."));
             LogPrintf("Rescanning last %i blocks (from block %i)...\n", chainActive.Height() - pindexRescan->GetHeight(), pindexRescan->GetHeight());
             nStart = GetTimeMillis();
-            pwalletMain->ScanForWalletTransactions(pindexRescan, true);
+            CWalletRescanReserver reserver(pwalletMain);
+            if (!reserver.Reserve())
+                return InitError(_("Failed to rescan the wallet during initialization"));
+            pwalletMain->ScanForWalletTransactions(pindexRescan, reserver, true);
             LogPrintf(" rescan      %15dms\n", GetTimeMillis() - nStart);
             pwalletMain->SetBestChain(chainActive.GetLocator());
             nWalletDBUpdated++;
@@ -2063,6 +2179,11 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                                          boost::ref(cs_main), boost::cref(pindexBestHeader));
     scheduler.scheduleEvery(f, 60);
 
+    if (GetBoolArg("-notarizedsync", DEFAULT_NOTARIZED_SYNC))
+    {
+        StartNotarizedSync(scheduler);
+    }
+
     // ********************************************************* Step 11: finished
 
     SetRPCWarmupFinished();
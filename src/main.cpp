@@ -29,7 +29,9 @@
 #include "net.h"
 #include "pbaas/pbaas.h"
 #include "pbaas/notarization.h"
+#include "pbaas/notarizedsync.h"
 #include "pbaas/identity.h"
+#include "perfstats.h"
 #include "pow.h"
 #include "script/interpreter.h"
 #include "txdb.h"
@@ -1724,6 +1726,7 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
 bool AcceptToMemoryPoolInt(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,bool* pfMissingInputs, bool fRejectAbsurdFee, int dosLevel, int32_t simHeight)
 {
     AssertLockHeld(cs_main);
+    CPerfTimer timer(PERF_ACCEPTTOMEMPOOL);
     if (pfMissingInputs)
         *pfMissingInputs = false;
 
@@ -2121,27 +2124,28 @@ bool AcceptToMemoryPoolInt(CTxMemPool& pool, CValidationState &state, const CTra
 }
 
 bool GetTimestampIndex(const unsigned int &high,const unsigned int &low, bool fActiveOnly,
-    std::vector<std::pair<uint256, unsigned int> > &hashes)
+    std::vector<std::pair<uint256, unsigned int> > &hashes, const CDBSnapshot *psnapshot)
 {
     if (!fTimestampIndex)
         return error("Timestamp index not enabled");
 
-    if (!pblocktree->ReadTimestampIndex(high, low, fActiveOnly, hashes))
+    if (!pblocktree->ReadTimestampIndex(high, low, fActiveOnly, hashes, psnapshot))
         return error("Unable to get hashes for timestamps");
 
     return true;
 }
 
-bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
+bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value, const CDBSnapshot *psnapshot)
 {
-    AssertLockHeld(cs_main);
+    if (!psnapshot)
+        AssertLockHeld(cs_main);
     if (!fSpentIndex)
         return error("Spent index not enabled");
 
     if (mempool.getSpentIndex(key, value))
         return true;
 
-    if (!pblocktree->ReadSpentIndex(key, value))
+    if (!pblocktree->ReadSpentIndex(key, value, psnapshot))
         //return error("Unable to get spent index information");
         return false;
 
@@ -2150,29 +2154,58 @@ bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
 
 bool GetAddressIndex(const uint160& addressHash, int type,
                      std::vector<CAddressIndexDbEntry>& addressIndex,
-                     int start, int end)
+                     int start, int end, const CDBSnapshot *psnapshot, size_t nMaxEntries)
 {
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressIndex(addressHash, type, addressIndex, start, end))
+    if (!pblocktree->ReadAddressIndex(addressHash, type, addressIndex, start, end, psnapshot, nMaxEntries))
         return error("unable to get txids for address");
 
     return true;
 }
 
 bool GetAddressUnspent(const uint160& addressHash, int type,
-                       std::vector<CAddressUnspentDbEntry>& unspentOutputs)
+                       std::vector<CAddressUnspentDbEntry>& unspentOutputs, const CDBSnapshot *psnapshot)
 {
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, unspentOutputs))
+    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, unspentOutputs, psnapshot))
         return error("unable to get txids for address");
 
     return true;
 }
 
+// guards pblockTreeSnapshot, always taken after cs_main when both are held
+static CCriticalSection cs_blockTreeSnapshot;
+static std::shared_ptr<const CBlockTreeSnapshot> pblockTreeSnapshot;
+
+void UpdateBlockTreeSnapshot(const CBlockIndex *pindex)
+{
+    std::shared_ptr<const CBlockTreeSnapshot> pnewSnapshot;
+    if (pblocktree && pindex)
+        pnewSnapshot = std::make_shared<const CBlockTreeSnapshot>(*pblocktree, pindex->GetBlockHash(), pindex->GetHeight());
+
+    // readers still holding the previous snapshot keep it alive until they are done
+    LOCK(cs_blockTreeSnapshot);
+    pblockTreeSnapshot = pnewSnapshot;
+}
+
+std::shared_ptr<const CBlockTreeSnapshot> GetBlockTreeSnapshot()
+{
+    {
+        LOCK(cs_blockTreeSnapshot);
+        if (pblockTreeSnapshot)
+            return pblockTreeSnapshot;
+    }
+
+    // no block has been connected since startup yet
+    LOCK2(cs_main, cs_blockTreeSnapshot);
+    UpdateBlockTreeSnapshot(chainActive.Tip());
+    return pblockTreeSnapshot;
+}
+
 /*uint64_t myGettxout(uint256 hash,int32_t n)
 {
     CCoins coins;
@@ -2411,6 +2444,51 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
     return ReadBlockFromDisk(block, pindex, consensusParams, 0);
 }
 
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& messageStart)
+{
+    block.clear();
+    if ( pindex == 0 )
+        return false;
+
+    // Step back over the index header written by WriteBlockToDisk
+    CDiskBlockPos pos = pindex->GetBlockPos();
+    if (pos.nPos < MESSAGE_START_SIZE + sizeof(unsigned int))
+        return error("%s: invalid block position %s", __func__, pos.ToString());
+    pos.nPos -= MESSAGE_START_SIZE + sizeof(unsigned int);
+
+    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+
+    try {
+        CMessageHeader::MessageStartChars blockStart;
+        unsigned int nSize;
+        filein >> FLATDATA(blockStart) >> nSize;
+        if (memcmp(blockStart, messageStart, MESSAGE_START_SIZE))
+            return error("%s: block start mismatch at %s", __func__, pos.ToString());
+        if (nSize == 0 || nSize > MAX_BLOCK_SIZE)
+            return error("%s: invalid block size %u at %s", __func__, nSize, pos.ToString());
+
+        // The raw bytes are sent as is, so make sure they are the block the index points to
+        long nBlockPos = ftell(filein.Get());
+        CBlockHeader header;
+        filein >> header;
+        if (header.GetHash() != pindex->GetBlockHash())
+            return error("%s: GetHash() doesn't match index for %s at %s", __func__,
+                         pindex->ToString(), pindex->GetBlockPos().ToString());
+        if (nBlockPos < 0 || fseek(filein.Get(), nBlockPos, SEEK_SET))
+            return error("%s: seek failed at %s", __func__, pos.ToString());
+
+        block.resize(nSize);
+        filein.read((char*)&block[0], nSize);
+    }
+    catch (const std::exception& e) {
+        block.clear();
+        return error("%s: I/O error - %s at %s", __func__, e.what(), pos.ToString());
+    }
+    return true;
+}
+
 //uint64_t komodo_moneysupply(int32_t height);
 extern char ASSETCHAINS_SYMBOL[KOMODO_ASSETCHAIN_MAXLEN];
 extern uint64_t ASSETCHAINS_ENDSUBSIDY[ASSETCHAINS_MAX_ERAS], ASSETCHAINS_REWARD[ASSETCHAINS_MAX_ERAS], ASSETCHAINS_HALVING[ASSETCHAINS_MAX_ERAS];
@@ -2627,12 +2705,13 @@ void CheckForkWarningConditionsOnNewFork(CBlockIndex* pindexNewForkTip, const CC
     CheckForkWarningConditions(chainParams);
 }
 
-// Requires cs_main.
+// Takes cs_main for the node state, as messages handled in parallel call this without it
 void Misbehaving(NodeId pnode, int howmuch)
 {
     if (howmuch == 0)
         return;
     
+    LOCK(cs_main);
     CNodeState *state = State(pnode);
     if (state == NULL)
         return;
@@ -3566,6 +3645,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         return(false);
     //fprintf(stderr,"connectblock ht.%d\n",(int32_t)pindex->GetHeight());
     AssertLockHeld(cs_main);
+    CPerfTimer timer(PERF_CONNECTBLOCK);
 
     // either set at activate best chain or when we connect block 1
     if (pindex->GetHeight() == 1)
@@ -3581,11 +3661,22 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             fExpensiveChecks = false;
         }
     }
+    // with -notarizedsync, the ancestors of a header matching a confirmed notarization of this chain are treated the same way
+    bool fNotarized = IsNotarizedAncestor(pindex);
+    if (fNotarized)
+    {
+        fExpensiveChecks = false;
+    }
     auto verifier = libzcash::ProofVerifier::Strict();
     auto disabledVerifier = libzcash::ProofVerifier::Disabled();
     int32_t futureblock;
     // Check it again to verify JoinSplit proofs, and in case a previous version let a bad block in
-    if (!CheckBlock(&futureblock,pindex->GetHeight(), pindex, block, state, chainparams, fExpensiveChecks ? verifier : disabledVerifier, fCheckPOW, !fJustCheck) || futureblock != 0 )
+    bool fCheckedBlock;
+    {
+        CPerfTimer proofsTimer(PERF_CONNECTBLOCK_PROOFS);
+        fCheckedBlock = CheckBlock(&futureblock,pindex->GetHeight(), pindex, block, state, chainparams, fExpensiveChecks ? verifier : disabledVerifier, fCheckPOW, !fJustCheck);
+    }
+    if (!fCheckedBlock || futureblock != 0 )
     {
         //fprintf(stderr,"checkblock failure in connectblock futureblock.%d\n",futureblock);
         return state.DoS(100, error("%s: checkblock failure in connectblock futureblock.%d\n", __func__,futureblock),
@@ -3643,7 +3734,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         return true;
     }
     
-    bool fScriptChecks = (!fCheckpointsEnabled || pindex->GetHeight() >= Checkpoints::GetTotalBlocksEstimate(chainparams.Checkpoints()));
+    bool fScriptChecks = (!fCheckpointsEnabled || pindex->GetHeight() >= Checkpoints::GetTotalBlocksEstimate(chainparams.Checkpoints())) && !fNotarized;
     //if ( KOMODO_TESTNET_EXPIRATION != 0 && pindex->GetHeight() > KOMODO_TESTNET_EXPIRATION ) // "testnet"
     //    return(false);
 
@@ -3704,6 +3795,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     CCheckQueueControl<CScriptCheck> control(fExpensiveChecks && nScriptCheckThreads ? &scriptcheckqueue : NULL);
     
     int64_t nTimeStart = GetTimeMicros();
+    int64_t nInputsMicros = 0, nScriptsMicros = 0;
     CAmount nFees = 0;
     int nInputs = 0;
     unsigned int nSigOps = 0;
@@ -3786,6 +3878,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         // coinbase transaction output is dependent on all other transactions in the block, figure those out first 
         if (!tx.IsCoinBase())
         {
+            int64_t nInputsStart = GetPerfTimeMicros();
             if (!view.HaveInputs(tx))
             {
                 return state.DoS(100, error("ConnectBlock(): inputs missing/spent"),
@@ -3795,6 +3888,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             if (!view.HaveShieldedRequirements(tx))
                 return state.DoS(100, error("ConnectBlock(): JoinSplit requirements not met"),
                                  REJECT_INVALID, "bad-txns-joinsplit-requirements-not-met");
+            nInputsMicros += GetPerfTimeMicros() - nInputsStart;
 
             for (size_t j = 0; j < tx.vin.size(); j++) {
 
@@ -3925,8 +4019,10 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
             std::vector<CScriptCheck> vChecks;
             bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
+            int64_t nScriptsStart = GetPerfTimeMicros();
             if (!ContextualCheckInputs(tx, state, view, nHeight, fExpensiveChecks, flags, fCacheResults, txdata[i], chainparams.GetConsensus(), consensusBranchId, nScriptCheckThreads ? &vChecks : NULL))
                 return false;
+            nScriptsMicros += GetPerfTimeMicros() - nScriptsStart;
             control.Add(vChecks);
         }
         else if (nHeight == 1 && !isVerusActive)
@@ -4404,8 +4500,12 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                             REJECT_INVALID, "bad-cb-amount");
     }
 
+    int64_t nScriptsStart = GetPerfTimeMicros();
     if (!control.Wait())
         return state.DoS(100, false);
+    nScriptsMicros += GetPerfTimeMicros() - nScriptsStart;
+    GetPerfHistogram(PERF_CONNECTBLOCK_INPUTS).Add(nInputsMicros);
+    GetPerfHistogram(PERF_CONNECTBLOCK_SCRIPTS).Add(nScriptsMicros);
     int64_t nTime2 = GetTimeMicros(); nTimeVerify += nTime2 - nTimeStart;
     LogPrint("bench", "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs]\n", nInputs - 1, 0.001 * (nTime2 - nTimeStart), nInputs <= 1 ? 0 : 0.001 * (nTime2 - nTimeStart) / (nInputs-1), nTimeVerify * 0.000001);
     
@@ -4419,6 +4519,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             CDiskBlockPos pos;
             if (!FindUndoPos(state, pindex->nFile, pos, ::GetSerializeSize(blockundo, SER_DISK, CLIENT_VERSION) + 40))
                 return error("ConnectBlock(): FindUndoPos failed");
+            CPerfTimer undoTimer(PERF_CONNECTBLOCK_UNDO);
             if (!UndoWriteToDisk(blockundo, pos, pindex->pprev->GetBlockHash(), chainparams.MessageStart()))
                 return AbortNode(state, "Failed to write undo data");
             
@@ -4531,7 +4632,8 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     
     // Watch for changes to the previous coinbase transaction.
     static uint256 hashPrevBestCoinBase;
-    GetMainSignals().UpdatedTransaction(hashPrevBestCoinBase);
+    uint256 hashUpdatedCoinBase = hashPrevBestCoinBase;
+    CallFunctionInValidationInterfaceQueue([hashUpdatedCoinBase]() { GetMainSignals().UpdatedTransaction(hashUpdatedCoinBase); });
     hashPrevBestCoinBase = block.vtx[0].GetHash();
     
     int64_t nTime4 = GetTimeMicros(); nTimeCallbacks += nTime4 - nTime3;
@@ -4622,6 +4724,9 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
                     return AbortNode(state, "Failed to write to block index database");
                 }
             }
+            // The chain MMR file is only read back up to the blocks the index now holds, so it is
+            // synced after it. A failure only means more of the MMR is rebuilt on the next start.
+            chainActive.FlushMMR();
             // Finally remove any pruned files
             if (fFlushForPrune)
                 UnlinkPrunedFiles(setFilesToPrune);
@@ -4642,8 +4747,10 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
             nLastFlush = nNow;
         }
         if ((mode == FLUSH_STATE_ALWAYS || mode == FLUSH_STATE_PERIODIC) && nNow > nLastSetChain + (int64_t)DATABASE_WRITE_INTERVAL * 1000000) {
-            // Update best block in wallet (so we can detect restored wallets).
-            GetMainSignals().SetBestChain(chainActive.GetLocator());
+            // Update best block in wallet (so we can detect restored wallets),
+            // after the wallet has been told about the blocks before it.
+            CBlockLocator locator = chainActive.GetLocator();
+            CallFunctionInValidationInterfaceQueue([locator]() { GetMainSignals().SetBestChain(locator); });
             nLastSetChain = nNow;
         }
     } catch (const std::runtime_error& e) {
@@ -4666,6 +4773,7 @@ void PruneAndFlush() {
 /** Update chainActive and related internal data structures. */
 void static UpdateTip(CBlockIndex *pindexNew, const CChainParams& chainParams) {
     chainActive.SetTip(pindexNew);
+    UpdateBlockTreeSnapshot(pindexNew);
     
     // New best block
     nTimeBestReceived = GetTime();
@@ -4807,23 +4915,28 @@ bool static DisconnectTip(CValidationState &state, const CChainParams& chainpara
     SaplingMerkleTree newSaplingTree;
     assert(pcoinsTip->GetSproutAnchorAt(pcoinsTip->GetBestAnchor(SPROUT), newSproutTree));
     assert(pcoinsTip->GetSaplingAnchorAt(pcoinsTip->GetBestAnchor(SAPLING), newSaplingTree));
-    // Let wallets know transactions went from 1-confirmed to
-    // 0-confirmed or conflicted:
-    for (int i = 0; i < block.vtx.size(); i++)
-    {
-        CTransaction &tx = block.vtx[i];
-        //if ((i == (block.vtx.size() - 1)) && ((ASSETCHAINS_LWMAPOS && block.IsVerusPOSBlock()) || (ASSETCHAINS_STAKED != 0 && (komodo_isPoS((CBlock *)&block) != 0))))
-        if ((i == (block.vtx.size() - 1)) && (ASSETCHAINS_STAKED != 0 && (komodo_isPoS((CBlock *)&block) != 0)))
-        {
-            EraseFromWallets(tx.GetHash());
-        }
-        else
-        {
-            SyncWithWallets(tx, NULL);
+    //bool fErasePoS = (ASSETCHAINS_LWMAPOS && block.IsVerusPOSBlock()) || (ASSETCHAINS_STAKED != 0 && (komodo_isPoS((CBlock *)&block) != 0));
+    bool fErasePoS = ASSETCHAINS_STAKED != 0 && (komodo_isPoS((CBlock *)&block) != 0);
+    // Listeners are told in the background, after the notifications queued before, with their own copy of the block
+    std::shared_ptr<const CBlock> pblockNotify = std::make_shared<const CBlock>(block);
+    CallFunctionInValidationInterfaceQueue([pindexDelete, pblockNotify, fErasePoS, newSproutTree, newSaplingTree]() {
+        // Let wallets know transactions went from 1-confirmed to
+        // 0-confirmed or conflicted:
+        for (int i = 0; i < pblockNotify->vtx.size(); i++)
+        {
+            const CTransaction &tx = pblockNotify->vtx[i];
+            if ((i == (pblockNotify->vtx.size() - 1)) && fErasePoS)
+            {
+                GetMainSignals().EraseTransaction(tx.GetHash());
+            }
+            else
+            {
+                GetMainSignals().SyncTransaction(tx, NULL);
+            }
         }
-    }
-    // Update cached incremental witnesses
-    GetMainSignals().ChainTip(pindexDelete, &block, newSproutTree, newSaplingTree, false);
+        // Update cached incremental witnesses
+        GetMainSignals().ChainTip(pindexDelete, pblockNotify.get(), newSproutTree, newSaplingTree, false);
+    });
     return true;
 }
 
@@ -4889,6 +5002,7 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     if (!FlushStateToDisk(state, FLUSH_STATE_IF_NEEDED))
         return false;
     int64_t nTime5 = GetTimeMicros(); nTimeChainState += nTime5 - nTime4;
+    GetPerfHistogram(PERF_CONNECTTIP_FLUSH).Add(nTime5 - nTime3);
     LogPrint("bench", "  - Writing chainstate: %.2fms [%.2fs]\n", (nTime5 - nTime4) * 0.001, nTimeChainState * 0.000001);
     // Remove conflicting transactions from the mempool.
     list<CTransaction> txConflicted;
@@ -4900,17 +5014,21 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     // Update chainActive & related variables.
     UpdateTip(pindexNew, chainparams);
 
-    // Tell wallet about transactions that went from mempool
-    // to conflicted:
-    BOOST_FOREACH(const CTransaction &tx, txConflicted) {
-        SyncWithWallets(tx, NULL);
-    }
-    // ... and about transactions that got confirmed:
-    BOOST_FOREACH(const CTransaction &tx, pblock->vtx) {
-        SyncWithWallets(tx, pblock);
-    }
-    // Update cached incremental witnesses
-    GetMainSignals().ChainTip(pindexNew, pblock, oldSproutTree, oldSaplingTree, true);
+    // Listeners are told in the background, after the notifications queued before, with their own copy of the block
+    std::shared_ptr<const CBlock> pblockNotify = std::make_shared<const CBlock>(*pblock);
+    CallFunctionInValidationInterfaceQueue([pindexNew, pblockNotify, txConflicted, oldSproutTree, oldSaplingTree]() {
+        // Tell wallet about transactions that went from mempool
+        // to conflicted:
+        BOOST_FOREACH(const CTransaction &tx, txConflicted) {
+            GetMainSignals().SyncTransaction(tx, NULL);
+        }
+        // ... and about transactions that got confirmed:
+        BOOST_FOREACH(const CTransaction &tx, pblockNotify->vtx) {
+            GetMainSignals().SyncTransaction(tx, pblockNotify.get());
+        }
+        // Update cached incremental witnesses
+        GetMainSignals().ChainTip(pindexNew, pblockNotify.get(), oldSproutTree, oldSaplingTree, true);
+    });
 
     EnforceNodeDeprecation(pindexNew->GetHeight());
     
@@ -5173,7 +5291,10 @@ bool ActivateBestChain(CValidationState& state, const CChainParams& chainparams,
     CBlockIndex *pindexMostWork = NULL;
     do {
         boost::this_thread::interruption_point();
-        
+
+        // Let the validation interface queue catch up before connecting more, so it cannot grow without bound
+        LimitValidationInterfaceQueue();
+
         bool fInitialDownload;
         {
             LOCK(cs_main);
@@ -5205,7 +5326,7 @@ bool ActivateBestChain(CValidationState& state, const CChainParams& chainparams,
                     pnode->PushInventory(CInv(MSG_BLOCK, hashNewTip));
             }
             // Notify external listeners about the new tip.
-            GetMainSignals().UpdatedBlockTip(pindexNewTip);
+            CallFunctionInValidationInterfaceQueue([pindexNewTip]() { GetMainSignals().UpdatedBlockTip(pindexNewTip); });
             uiInterface.NotifyBlockTip(hashNewTip);
         } //else fprintf(stderr,"initial download skips propagation\n");
     } while(pindexMostWork != chainActive.Tip());
@@ -6831,6 +6952,11 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
         uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, (int)(((double)(chainActive.Height() - pindex->GetHeight())) / (double)nCheckDepth * (nCheckLevel >= 4 ? 50 : 100)))));
         if (pindex->GetHeight() < chainActive.Height()-nCheckDepth)
             break;
+        if (fPruneMode && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
+            // If pruning, only go back as far as we have data.
+            LogPrintf("VerifyDB(): block verification stopping at height %d (pruning, no data)\n", pindex->GetHeight());
+            break;
+        }
         CBlock block;
         // check level 0: read from disk
         if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus(), 0))
@@ -7083,6 +7209,7 @@ void UnloadBlockIndex()
     LOCK(cs_main);
     setBlockIndexCandidates.clear();
     chainActive.SetTip(NULL);
+    UpdateBlockTreeSnapshot(NULL);
     pindexBestInvalid = NULL;
     pindexBestHeader = NULL;
     mempool.clear();
@@ -7124,39 +7251,41 @@ bool LoadBlockIndex()
 
 bool InitBlockIndex(const CChainParams& chainparams) 
 {
-    LOCK(cs_main);
-    
-    // Initialize global variables that cannot be constructed at startup.
-    recentRejects.reset(new CRollingBloomFilter(120000, 0.000001));
-    // Check whether we're already initialized
-    if (chainActive.Genesis() != NULL)
+    CBlock &block = const_cast<CBlock&>(chainparams.GenesisBlock());
+    CValidationState state;
     {
-        return true;
-    }
-    // Use the provided setting for -txindex in the new database
-    fTxIndex = GetBoolArg("-txindex", true);
-    pblocktree->WriteFlag("txindex", fTxIndex);
-    // Use the provided setting for -addressindex in the new database
-    fAddressIndex = true;
-    pblocktree->WriteFlag("addressindex", fAddressIndex);
+        LOCK(cs_main);
 
-    // Use the provided setting for -timestampindex in the new database
-    fTimestampIndex = GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
-    pblocktree->WriteFlag("timestampindex", fTimestampIndex);
-    
-    fSpentIndex = true;
-    pblocktree->WriteFlag("spentindex", fSpentIndex);
-    fprintf(stderr,"fAddressIndex.%d/%d fSpentIndex.%d/%d\n",fAddressIndex,DEFAULT_ADDRESSINDEX,fSpentIndex,DEFAULT_SPENTINDEX);
-    LogPrintf("Initializing databases...\n");
-    
-    // Only add the genesis block if not reindexing (in which case we reuse the one already on disk)
-    if (!fReindex) {
+        // Initialize global variables that cannot be constructed at startup.
+        recentRejects.reset(new CRollingBloomFilter(120000, 0.000001));
+        // Check whether we're already initialized
+        if (chainActive.Genesis() != NULL)
+        {
+            return true;
+        }
+        // Use the provided setting for -txindex in the new database
+        fTxIndex = GetBoolArg("-txindex", true);
+        pblocktree->WriteFlag("txindex", fTxIndex);
+        // Use the provided setting for -addressindex in the new database
+        fAddressIndex = true;
+        pblocktree->WriteFlag("addressindex", fAddressIndex);
+
+        // Use the provided setting for -timestampindex in the new database
+        fTimestampIndex = GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
+        pblocktree->WriteFlag("timestampindex", fTimestampIndex);
+
+        fSpentIndex = true;
+        pblocktree->WriteFlag("spentindex", fSpentIndex);
+        fprintf(stderr,"fAddressIndex.%d/%d fSpentIndex.%d/%d\n",fAddressIndex,DEFAULT_ADDRESSINDEX,fSpentIndex,DEFAULT_SPENTINDEX);
+        LogPrintf("Initializing databases...\n");
+
+        // Only add the genesis block if not reindexing (in which case we reuse the one already on disk)
+        if (fReindex)
+            return true;
         try {
-            CBlock &block = const_cast<CBlock&>(chainparams.GenesisBlock());
             // Start new block file
             unsigned int nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
             CDiskBlockPos blockPos;
-            CValidationState state;
             if (!FindBlockPos(state, blockPos, nBlockSize+8, 0, block.GetBlockTime()))
                 return error("LoadBlockIndex(): FindBlockPos failed");
             if (!WriteBlockToDisk(block, blockPos, chainparams.MessageStart()))
@@ -7166,16 +7295,20 @@ bool InitBlockIndex(const CChainParams& chainparams)
                 return error("LoadBlockIndex(): couldnt add to block index");
             if (!ReceivedBlockTransactions(block, state, chainparams, pindex, blockPos))
                 return error("LoadBlockIndex(): genesis block not accepted");
-            if (!ActivateBestChain(state, chainparams, &block))
-                return error("LoadBlockIndex(): genesis block cannot be activated");
-            // Force a chainstate write so that when we VerifyDB in a moment, it doesn't check stale data
-            return FlushStateToDisk(state, FLUSH_STATE_ALWAYS);
         } catch (const std::runtime_error& e) {
             return error("LoadBlockIndex(): failed to initialize block database: %s", e.what());
         }
     }
-    
-    return true;
+
+    // ActivateBestChain waits for the validation interface queue, which cannot be done holding cs_main
+    try {
+        if (!ActivateBestChain(state, chainparams, &block))
+            return error("LoadBlockIndex(): genesis block cannot be activated");
+        // Force a chainstate write so that when we VerifyDB in a moment, it doesn't check stale data
+        return FlushStateToDisk(state, FLUSH_STATE_ALWAYS);
+    } catch (const std::runtime_error& e) {
+        return error("LoadBlockIndex(): failed to initialize block database: %s", e.what());
+    }
 }
 
 bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp)
@@ -7576,8 +7709,8 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
     
     vector<CInv> vNotFound;
     
-    LOCK(cs_main);
-
+    // cs_main is only taken to look up requested blocks, not while they are read from disk and
+    // sent, as getdata is handled for several peers at once
     LogPrint("getdata", "%s\n", __func__);
 
     while (it != pfrom->vRecvGetData.end()) {
@@ -7600,49 +7733,73 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
             {
                 LogPrint("getdata", "%s: inv %s\n", __func__, inv.type == MSG_BLOCK ? "MSG_BLOCK" : "MSG_FILTERED_BLOCK");
 
-                bool send = false;
-                BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
-                if (mi != mapBlockIndex.end())
+                // block index entries are never freed, so the one found here can be read after cs_main is released
+                CBlockIndex *pindexSend = NULL;
+                uint256 hashTip;
                 {
-                    if (chainActive.Contains(mi->second)) {
-                        send = true;
-                    } else {
-                        static const int nOneMonth = 30 * 24 * 60 * 60;
-                        // To prevent fingerprinting attacks, only send blocks outside of the active
-                        // chain if they are valid, and no more than a month older (both in time, and in
-                        // best equivalent proof of work) than the best header chain we know about.
-                        send = mi->second->IsValid(BLOCK_VALID_SCRIPTS) && (pindexBestHeader != NULL) &&
-                            (pindexBestHeader->GetBlockTime() - mi->second->GetBlockTime() < nOneMonth) &&
-                            (GetBlockProofEquivalentTime(*pindexBestHeader, *mi->second, *pindexBestHeader, consensusParams) < nOneMonth);
-                        if (!send) {
-                            LogPrintf("%s: ignoring request from peer=%i for old block that isn't in the main chain\n", __func__, pfrom->GetId());
+                    LOCK(cs_main);
+                    bool send = false;
+                    BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
+                    if (mi != mapBlockIndex.end())
+                    {
+                        if (chainActive.Contains(mi->second)) {
+                            send = true;
+                        } else {
+                            static const int nOneMonth = 30 * 24 * 60 * 60;
+                            // To prevent fingerprinting attacks, only send blocks outside of the active
+                            // chain if they are valid, and no more than a month older (both in time, and in
+                            // best equivalent proof of work) than the best header chain we know about.
+                            send = mi->second->IsValid(BLOCK_VALID_SCRIPTS) && (pindexBestHeader != NULL) &&
+                                (pindexBestHeader->GetBlockTime() - mi->second->GetBlockTime() < nOneMonth) &&
+                                (GetBlockProofEquivalentTime(*pindexBestHeader, *mi->second, *pindexBestHeader, consensusParams) < nOneMonth);
+                            if (!send) {
+                                LogPrintf("%s: ignoring request from peer=%i for old block that isn't in the main chain\n", __func__, pfrom->GetId());
+                            }
                         }
                     }
+                    // Pruned nodes may have deleted the block, so check whether
+                    // it's available before trying to send.
+                    if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
+                    {
+                        pindexSend = mi->second;
+                        hashTip = chainActive.Tip()->GetBlockHash();
+                    }
                 }
-                // Pruned nodes may have deleted the block, so check whether
-                // it's available before trying to send.
-                if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
+                if (pindexSend)
                 {
                     LogPrint("getdata", "%s: is send\n", __func__);
 
                     // Send block from disk
                     CBlock block;
-                    if (!ReadBlockFromDisk(block, (*mi).second, consensusParams, 1))
+                    bool fRead;
+                    std::vector<unsigned char> vchBlock;
+                    if (inv.type == MSG_BLOCK)
                     {
-                        assert(!"cannot load block from disk");
+                        // Blocks are stored in their network serialization, so send the bytes
+                        // as they are on disk rather than deserializing and reserializing them
+                        fRead = ReadRawBlockFromDisk(vchBlock, pindexSend, Params().MessageStart());
                     }
                     else
                     {
-                        if (inv.type == MSG_BLOCK)
+                        fRead = ReadBlockFromDisk(block, pindexSend, consensusParams, 1);
+                    }
+                    if (!fRead)
+                    {
+                        // the block may have been pruned since it was looked up, otherwise the data is gone
+                        LOCK(cs_main);
+                        if (pindexSend->nStatus & BLOCK_HAVE_DATA)
                         {
-                            //uint256 hash; int32_t z;
-                            //hash = block.GetHash();
-                            //for (z=31; z>=0; z--)
-                            //    fprintf(stderr,"%02x",((uint8_t *)&hash)[z]);
-                            //fprintf(stderr," send block %d\n",komodo_block2height(&block));
-                            pfrom->PushMessage("block", block);
+                            assert(!"cannot load block from disk");
                         }
-                        else // MSG_FILTERED_BLOCK)
+                        vNotFound.push_back(inv);
+                    }
+                    else if (inv.type == MSG_BLOCK)
+                    {
+                        pfrom->PushMessage("block", CFlatData(vchBlock));
+                    }
+                    else
+                    {
+                        // MSG_FILTERED_BLOCK
                         {
                             LOCK(pfrom->cs_filter);
                             if (pfrom->pfilter)
@@ -7665,13 +7822,13 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                         }
                     }
                     // Trigger the peer node to send a getblocks request for the next batch of inventory
-                    if (inv.hash == pfrom->hashContinue)
+                    if (fRead && inv.hash == pfrom->hashContinue)
                     {
                         // Bypass PushInventory, this must send even if redundant,
                         // and we want it right after the last block so they don't
                         // wait for other stuff first.
                         vector<CInv> vInv;
-                        vInv.push_back(CInv(MSG_BLOCK, chainActive.Tip()->GetBlockHash()));
+                        vInv.push_back(CInv(MSG_BLOCK, hashTip));
                         pfrom->PushMessage("inv", vInv);
                         pfrom->hashContinue.SetNull();
                     }
@@ -7847,7 +8004,10 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         pfrom->fClient = !(pfrom->nServices & NODE_NETWORK);
         
         // Potentially mark this peer as a preferred download peer.
-        UpdatePreferredDownload(pfrom, State(pfrom->GetId()));
+        {
+            LOCK(cs_main);
+            UpdatePreferredDownload(pfrom, State(pfrom->GetId()));
+        }
         
         // Change version
         pfrom->PushMessage("verack");
@@ -8519,7 +8679,10 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         }
         pfrom->fSentAddr = true;
         
-        pfrom->vAddrToSend.clear();
+        {
+            LOCK(pfrom->cs_addrRelay);
+            pfrom->vAddrToSend.clear();
+        }
         vector<CAddress> vAddr = addrman.GetAddr();
         BOOST_FOREACH(const CAddress &addr, vAddr)
         pfrom->PushAddress(addr);
@@ -8747,6 +8910,19 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     return true;
 }
 
+// Messages which are safe to handle for several peers at once when -msghandlerthreads is
+// above 1, they either only touch the sending peer or take cs_main for what they share.
+// Everything else, including blocks, headers and the version handshake, is handled one at a time.
+static CCriticalSection cs_serialMessages;
+
+static bool IsParallelMessage(const std::string &strCommand)
+{
+    return strCommand == "ping" || strCommand == "pong" ||
+           strCommand == "addr" || strCommand == "getaddr" ||
+           strCommand == "inv" || strCommand == "getdata" || strCommand == "notfound" ||
+           strCommand == "getheaders" || strCommand == "tx" || strCommand == "mempool";
+}
+
 // requires LOCK(cs_vRecvMsg)
 bool ProcessMessages(CNode* pfrom)
 {
@@ -8829,7 +9005,17 @@ bool ProcessMessages(CNode* pfrom)
         {
             //printf("processing message: %s, from %s\n", strCommand.c_str(), pfrom->addr.ToString().c_str());
             std::vector<unsigned char> storedMessage(vRecv.begin(), vRecv.end());
-            fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime);
+            if (nMessageHandlerThreads > 1 && !IsParallelMessage(strCommand))
+            {
+                LOCK(cs_serialMessages);
+                CPerfTimer messageTimer(GetMessagePerfHistogram(strCommand));
+                fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime);
+            }
+            else
+            {
+                CPerfTimer messageTimer(GetMessagePerfHistogram(strCommand));
+                fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime);
+            }
             //if (!fRet)
             //{
             //    printf("message error: %s, from %s\n---------------------\n%s\n", 
@@ -8931,7 +9117,10 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
             {
                 // Periodically clear addrKnown to allow refresh broadcasts
                 if (nLastRebroadcast)
+                {
+                    LOCK(pnode->cs_addrRelay);
                     pnode->addrKnown.reset();
+                }
                 
                 // Rebroadcast our address
                 AdvertizeLocal(pnode);
@@ -8945,6 +9134,7 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
         //
         if (fSendTrickle)
         {
+            LOCK(pto->cs_addrRelay);
             vector<CAddress> vAddr;
             vAddr.reserve(pto->vAddrToSend.size());
             BOOST_FOREACH(const CAddress& addr, pto->vAddrToSend)
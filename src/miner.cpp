@@ -24,6 +24,7 @@
 #include "main.h"
 #include "metrics.h"
 #include "net.h"
+#include "perfstats.h"
 #include "pow.h"
 #include "primitives/transaction.h"
 #include "random.h"
@@ -229,6 +230,7 @@ void IncrementExtraNonce(CBlock* pblock, CBlockIndex* pindexPrev, unsigned int &
         txcb.vin[0].scriptSig = (CScript() << nHeight << CScriptNum(nExtraNonce)) + COINBASE_FLAGS;
         assert(txcb.vin[0].scriptSig.size() <= 100);
         pblock->vtx[0] = txcb;
+        pblock->vMMRNodes.clear();
         if (buildMerkle)
         {
             pblock->hashMerkleRoot = pblock->BuildMerkleTree();
@@ -1316,6 +1318,8 @@ bool MakeBlockOneCoinbaseOutputs(std::vector<CTxOut> &outputs,
 
 CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const std::vector<CTxOut> &minerOutputs, bool isStake)
 {
+    CPerfTimer timer(PERF_CREATENEWBLOCK);
+
     // instead of one scriptPubKeyIn, we take a vector of them along with relative weight. each is assigned a percentage of the block subsidy and
     // mining reward based on its weight relative to the total
     if (!(minerOutputs.size() && ConnectedChains.SetLatestMiningOutputs(minerOutputs) || isStake))
@@ -2196,6 +2200,7 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const std::vecto
 
             // Added
             pblock->vtx.push_back(tx);
+            pblock->vMMRNodes.clear();
             pblocktemplate->vTxFees.push_back(nTxFees);
             pblocktemplate->vTxSigOps.push_back(nTxSigOps);
             nBlockSize += nTxSize;
@@ -2339,6 +2344,7 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const std::vecto
 
         // coinbase is done
         pblock->vtx[0] = coinbaseTx;
+        pblock->vMMRNodes.clear();
         uint256 cbHash = coinbaseTx.GetHash();
 
         // display it at block 1 for PBaaS debugging
@@ -2354,6 +2360,7 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const std::vecto
         {
             UpdateCoins(txStaked, view, nHeight);
             pblock->vtx.push_back(txStaked);
+            pblock->vMMRNodes.clear();
             pblocktemplate->vTxFees.push_back(0);
             int txSigOps = GetLegacySigOpCount(txStaked);
             pblocktemplate->vTxSigOps.push_back(txSigOps);
@@ -2365,6 +2372,7 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const std::vecto
         extern CWallet *pwalletMain;
 
         pblock->vtx[0] = coinbaseTx;
+        pblock->vMMRNodes.clear();
         pblocktemplate->vTxFees[0] = -nFees;
         pblocktemplate->vTxSigOps[0] = GetLegacySigOpCount(pblock->vtx[0]);
 
@@ -2402,6 +2410,7 @@ CBlockTemplate* CreateNewBlock(const CChainParams& chainparams, const std::vecto
             {
                 CAmount txfees = 5000;
                 pblock->vtx.push_back(txNotary);
+                pblock->vMMRNodes.clear();
                 pblocktemplate->vTxFees.push_back(txfees);
                 pblocktemplate->vTxSigOps.push_back(GetLegacySigOpCount(txNotary));
                 nFees += txfees;
@@ -2732,7 +2741,12 @@ void static VerusStaker(CWallet *pwallet)
             int32_t newHeight = Mining_height;
 
             if (newHeight > VERUS_MIN_STAKEAGE)
+            {
+                // stake selection reads the wallet, which must have seen every block and
+                // transaction so far so as not to stake a spent output
+                SyncWithValidationInterfaceQueue();
                 ptr = CreateNewBlockWithKey(reservekey, newHeight, true);
+            }
 
             // TODO - putting this output here tends to help mitigate announcing a staking height earlier than
             // announcing the last block win when we start staking before a block's acceptance has been
@@ -2960,6 +2974,8 @@ void static BitcoinMiner_noeq()
             miningTimer.start();
 
 #ifdef ENABLE_WALLET
+            // let the wallet catch up with the chain before it is used for the new block
+            SyncWithValidationInterfaceQueue();
             CBlockTemplate *ptr = CreateNewBlockWithKey(reservekey, Mining_height);
 #else
             CBlockTemplate *ptr = CreateNewBlockWithKey();
@@ -39,6 +39,16 @@ void CMMRProof::DeleteProofSequence()
                 delete (CMMRPowerNodeBranch *)pProof;
                 break;
             }
+            case CMerkleBranchBase::BRANCH_MMRBLAKE_MULTINODE:
+            {
+                delete (CMMRNodeMultiBranch *)pProof;
+                break;
+            }
+            case CMerkleBranchBase::BRANCH_MMRBLAKE_MULTIPOWERNODE:
+            {
+                delete (CMMRPowerNodeMultiBranch *)pProof;
+                break;
+            }
             default:
             {
                 ErrorAndBP("ERROR: likely double-free or memory corruption, unrecognized object in proof sequence");
@@ -74,10 +84,102 @@ const CMMRProof &CMMRProof::operator<<(const CMMRPowerNodeBranch &append)
     return *this;
 }
 
+const CMMRProof &CMMRProof::operator<<(const CMMRNodeMultiBranch &append)
+{
+    CMerkleBranchBase *pNewProof = new CMMRNodeMultiBranch(append);
+    pNewProof->branchType = CMerkleBranchBase::BRANCH_MMRBLAKE_MULTINODE;
+    proofSequence.push_back(pNewProof);
+    return *this;
+}
+
+const CMMRProof &CMMRProof::operator<<(const CMMRPowerNodeMultiBranch &append)
+{
+    CMerkleBranchBase *pNewProof = new CMMRPowerNodeMultiBranch(append);
+    pNewProof->branchType = CMerkleBranchBase::BRANCH_MMRBLAKE_MULTIPOWERNODE;
+    proofSequence.push_back(pNewProof);
+    return *this;
+}
+
+const CMMRProof &CMMRProof::operator<<(const CMMRProof &append)
+{
+    for (auto pProof : append.proofSequence)
+    {
+        switch(pProof->branchType)
+        {
+            case CMerkleBranchBase::BRANCH_BTC:
+            {
+                *this << *(CBTCMerkleBranch *)pProof;
+                break;
+            }
+            case CMerkleBranchBase::BRANCH_MMRBLAKE_NODE:
+            {
+                *this << *(CMMRNodeBranch *)pProof;
+                break;
+            }
+            case CMerkleBranchBase::BRANCH_MMRBLAKE_POWERNODE:
+            {
+                *this << *(CMMRPowerNodeBranch *)pProof;
+                break;
+            }
+            case CMerkleBranchBase::BRANCH_MMRBLAKE_MULTINODE:
+            {
+                *this << *(CMMRNodeMultiBranch *)pProof;
+                break;
+            }
+            case CMerkleBranchBase::BRANCH_MMRBLAKE_MULTIPOWERNODE:
+            {
+                *this << *(CMMRPowerNodeMultiBranch *)pProof;
+                break;
+            }
+            default:
+            {
+                ErrorAndBP("ERROR: unrecognized object in proof sequence");
+            }
+        }
+    }
+    return *this;
+}
+
 uint256 CMMRProof::CheckProof(uint256 hash) const
 {
-    for (auto &pProof : proofSequence)
+    return CheckProofFrom(hash, 0);
+}
+
+uint256 CMMRProof::CheckProof(const std::vector<uint256> &hashes) const
+{
+    if (!proofSequence.size())
+    {
+        return uint256();
+    }
+
+    uint256 hash;
+    switch(proofSequence[0]->branchType)
     {
+        case CMerkleBranchBase::BRANCH_MMRBLAKE_MULTINODE:
+        {
+            hash = ((CMMRNodeMultiBranch *)proofSequence[0])->SafeCheck(hashes);
+            break;
+        }
+        case CMerkleBranchBase::BRANCH_MMRBLAKE_MULTIPOWERNODE:
+        {
+            hash = ((CMMRPowerNodeMultiBranch *)proofSequence[0])->SafeCheck(hashes);
+            break;
+        }
+        default:
+        {
+            return hashes.size() == 1 ? CheckProofFrom(hashes[0], 0) : uint256();
+        }
+    }
+
+    // the root of the multi branch is then proven by the rest of the sequence, as with any other hash
+    return hash.IsNull() ? hash : CheckProofFrom(hash, 1);
+}
+
+uint256 CMMRProof::CheckProofFrom(uint256 hash, int start) const
+{
+    for (int i = start; i < proofSequence.size(); i++)
+    {
+        CMerkleBranchBase *pProof = proofSequence[i];
         switch(pProof->branchType)
         {
             case CMerkleBranchBase::BRANCH_BTC:
@@ -97,11 +199,31 @@ uint256 CMMRProof::CheckProof(uint256 hash) const
                 //printf("Result from CMMRPowerNodeBranch check: %s\n", hash.GetHex().c_str());
                 break;
             }
+            case CMerkleBranchBase::BRANCH_MMRBLAKE_MULTINODE:
+            case CMerkleBranchBase::BRANCH_MMRBLAKE_MULTIPOWERNODE:
+            {
+                // nodes without multi branches cannot even read them, so a proof checked from a
+                // single hash, as every consensus check is, must never accept one
+                return uint256();
+            }
         }
     }
     return hash;
 }
 
+bool CMMRProof::HasMultiBranch() const
+{
+    for (auto pProof : proofSequence)
+    {
+        if (pProof->branchType == CMerkleBranchBase::BRANCH_MMRBLAKE_MULTINODE ||
+            pProof->branchType == CMerkleBranchBase::BRANCH_MMRBLAKE_MULTIPOWERNODE)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 // return the index that would be generated for an mmv of the indicated size at the specified position
 uint64_t CMerkleBranchBase::GetMMRProofIndex(uint64_t pos, uint64_t mmvSize, int extrahashes)
 {
@@ -19,6 +19,7 @@
 #ifndef MMR_H
 #define MMR_H
 
+#include <map>
 #include <vector>
 #include <univalue.h>
 
@@ -87,6 +88,13 @@ public:
         // how many extra proof hashes per layer are added with this node
         return 0;
     }
+
+    // the values a multiproof carries for this node, which are its hash followed by any extra hashes
+    std::vector<uint256> GetNodeValues() const { return {hash}; }
+    static CMMRNode FromNodeValues(const uint256 *values) { return CMMRNode(values[0]); }
+
+    // whether CreateParentNode can combine this with a right node that came from an untrusted source
+    bool CanCombine(const CMMRNode &nRight) const { return true; }
 };
 typedef CMMRNode<CBLAKE2bWriter> CDefaultMMRNode;
 
@@ -167,6 +175,17 @@ public:
         // how many extra proof hashes per layer are added with this node
         return 1;
     }
+
+    std::vector<uint256> GetNodeValues() const { return {hash, power}; }
+    static CMMRPowerNode FromNodeValues(const uint256 *values) { return CMMRPowerNode(values[0], values[1]); }
+
+    // power from a proof may be anything, so check the sums CreateParentNode asserts on
+    bool CanCombine(const CMMRPowerNode &nRight) const
+    {
+        arith_uint256 work = Work() + nRight.Work();
+        arith_uint256 stake = Stake() + nRight.Stake();
+        return work << 128 >> 128 == work && stake << 128 >> 128 == stake;
+    }
 };
 typedef CMMRPowerNode<CBLAKE2bWriter> CDefaultMMRPowerNode;
 
@@ -308,7 +327,9 @@ public:
         BRANCH_INVALID = 0,
         BRANCH_BTC = 1,
         BRANCH_MMRBLAKE_NODE = 2,
-        BRANCH_MMRBLAKE_POWERNODE = 3
+        BRANCH_MMRBLAKE_POWERNODE = 3,
+        BRANCH_MMRBLAKE_MULTINODE = 4,
+        BRANCH_MMRBLAKE_MULTIPOWERNODE = 5
     };
 
     uint8_t branchType;
@@ -412,6 +433,196 @@ public:
 typedef CMMRBranch<CBLAKE2bWriter> CMMRNodeBranch;
 typedef CMMRBranch<CBLAKE2bWriter, CMMRPowerNode<CBLAKE2bWriter>> CMMRPowerNodeBranch;
 
+// proves several elements of one merkle mountain view at once. each node their paths to the root have in common
+// is carried only once, and nodes that can be computed from the proven elements are not carried at all
+template <typename HASHALGOWRITER=CBLAKE2bWriter, typename NODETYPE=CDefaultMMRNode>
+class CMMRMultiBranch : public CMerkleBranchBase
+{
+public:
+    uint32_t nSize;                     // size of the view the elements are proven in
+    std::vector<uint32_t> indexes;      // indexes of the proven elements, in ascending order
+    std::vector<uint256> leafExtras;    // GetExtraHashCount() leaf hashes, such as power, for each proven element
+    std::vector<uint256> nodes;         // values of all other nodes needed, in the order Walk() asks for them
+
+    CMMRMultiBranch() : nSize(0) {}
+    CMMRMultiBranch(BRANCH_TYPE type) : CMerkleBranchBase(type), nSize(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(*(CMerkleBranchBase *)this);
+        READWRITE(VARINT(nSize));
+        READWRITE(indexes);
+        READWRITE(leafExtras);
+        READWRITE(nodes);
+    }
+
+    // the leaf node of an element from the hash a single proof of it would be checked with, and its extra leaf hashes
+    static NODETYPE LeafNode(const uint256 &hash, const uint256 *extras)
+    {
+        uint32_t extraCount = NODETYPE::GetExtraHashCount();
+        std::vector<uint256> values(1, hash);
+        if (extraCount)
+        {
+            HASHALGOWRITER hw(SER_GETHASH, 0);
+            hw << hash;
+            for (uint32_t i = 0; i < extraCount; i++)
+            {
+                hw << extras[i];
+            }
+            values[0] = hw.GetHash();
+            values.insert(values.end(), extras, extras + extraCount);
+        }
+        return NODETYPE::FromNodeValues(&values[0]);
+    }
+
+    // combines the known nodes of a view of mmvSize elements up to its root. getNode(bagging, level, index, node) is
+    // called for each other node needed, first going up the mountains to their peaks, then up the merkle tree of peaks.
+    // the order of those calls depends only on the size and the known positions, so the prover and verifier agree on it.
+    template <typename GETNODE>
+    static bool Walk(uint64_t mmvSize, std::map<uint64_t, NODETYPE> known, GETNODE &getNode, NODETYPE &root)
+    {
+        if (!mmvSize || known.empty() || known.rbegin()->first >= mmvSize)
+        {
+            return false;
+        }
+
+        std::map<uint64_t, NODETYPE> knownPeaks;
+        uint64_t levelSize = mmvSize;
+        for (uint32_t level = 0; !known.empty(); level++, levelSize >>= 1)
+        {
+            if (!WalkLevel(known, levelSize, false, level, getNode, &knownPeaks, mmvSize))
+            {
+                return false;
+            }
+        }
+
+        // peaks are the set bits of the size, highest first, and the last of an odd count passes through to the next level
+        known.swap(knownPeaks);
+        levelSize = 0;
+        for (uint64_t bits = mmvSize; bits; bits &= bits - 1)
+        {
+            levelSize++;
+        }
+        for (uint32_t level = 0; levelSize > 1; level++, levelSize = (levelSize >> 1) + (levelSize & 1))
+        {
+            if (!WalkLevel(known, levelSize, true, level, getNode, NULL, mmvSize))
+            {
+                return false;
+            }
+        }
+        if (known.size() != 1 || known.begin()->first != 0)
+        {
+            return false;
+        }
+        root = known.begin()->second;
+        return true;
+    }
+
+    // elements are hashed as leaves given in the same order as indexes
+    uint256 SafeCheck(const std::vector<uint256> &hashes) const
+    {
+        uint32_t extraCount = NODETYPE::GetExtraHashCount();
+        uint32_t valueCount = extraCount + 1;
+        if (hashes.size() != indexes.size() || leafExtras.size() != indexes.size() * extraCount || nodes.size() % valueCount)
+        {
+            return uint256();
+        }
+
+        std::map<uint64_t, NODETYPE> known;
+        for (int i = 0; i < indexes.size(); i++)
+        {
+            if (i && indexes[i] <= indexes[i - 1])
+            {
+                return uint256();
+            }
+            known[indexes[i]] = LeafNode(hashes[i], extraCount ? &leafExtras[i * extraCount] : NULL);
+        }
+
+        size_t next = 0;
+        auto getNode = [this, &next, valueCount](bool bagging, uint32_t level, uint64_t index, NODETYPE &node) -> bool
+        {
+            if (next + valueCount > nodes.size())
+            {
+                return false;
+            }
+            node = NODETYPE::FromNodeValues(&nodes[next]);
+            next += valueCount;
+            return true;
+        };
+
+        NODETYPE root;
+        if (!Walk(nSize, known, getNode, root) || next != nodes.size())
+        {
+            return uint256();
+        }
+        return root.hash;
+    }
+
+private:
+    // replaces the known nodes of one level with the ones they make on the level above. in the mountains, an unpaired
+    // last node is a peak and is moved to peaks, while in the merkle tree of peaks, it passes through
+    template <typename GETNODE>
+    static bool WalkLevel(std::map<uint64_t, NODETYPE> &known, uint64_t levelSize, bool bagging, uint32_t level, GETNODE &getNode,
+                          std::map<uint64_t, NODETYPE> *peaks, uint64_t mmvSize)
+    {
+        std::map<uint64_t, NODETYPE> above;
+        for (auto it = known.begin(); it != known.end(); it++)
+        {
+            uint64_t p = it->first;
+            NODETYPE left, right;
+            if (p & 1)
+            {
+                if (!getNode(bagging, level, p - 1, left))
+                {
+                    return false;
+                }
+                right = it->second;
+            }
+            else if (p + 1 < levelSize)
+            {
+                left = it->second;
+                auto nextIt = it;
+                if (++nextIt != known.end() && nextIt->first == p + 1)
+                {
+                    right = nextIt->second;
+                    it = nextIt;
+                }
+                else if (!getNode(bagging, level, p + 1, right))
+                {
+                    return false;
+                }
+            }
+            else if (bagging)
+            {
+                above[p >> 1] = it->second;
+                continue;
+            }
+            else
+            {
+                // the peak of this mountain, after the peaks of the higher ones
+                uint64_t peakIndex = 0;
+                for (uint64_t bits = mmvSize >> (level + 1); bits; bits &= bits - 1)
+                {
+                    peakIndex++;
+                }
+                (*peaks)[peakIndex] = it->second;
+                continue;
+            }
+            if (!left.CanCombine(right))
+            {
+                return false;
+            }
+            above[p >> 1] = left.CreateParentNode(right);
+        }
+        known.swap(above);
+        return true;
+    }
+};
+typedef CMMRMultiBranch<CBLAKE2bWriter> CMMRNodeMultiBranch;
+typedef CMMRMultiBranch<CBLAKE2bWriter, CMMRPowerNode<CBLAKE2bWriter>> CMMRPowerNodeMultiBranch;
+
 // by default, this is compatible with normal merkle proofs with the existing
 // block merkle roots. different hash algorithms may be selected for performance,
 // security, or other purposes
@@ -539,6 +750,8 @@ public:
                         CBTCMerkleBranch *pBranch;
                         CMMRNodeBranch *pNodeBranch;
                         CMMRPowerNodeBranch *pPowerNodeBranch;
+                        CMMRNodeMultiBranch *pNodeMultiBranch;
+                        CMMRPowerNodeMultiBranch *pPowerNodeMultiBranch;
                         CMerkleBranchBase *pobj;
                     };
 
@@ -576,6 +789,26 @@ public:
                             error = false;
                             break;
                         }
+                        case CMerkleBranchBase::BRANCH_MMRBLAKE_MULTINODE:
+                        {
+                            pNodeMultiBranch = new CMMRNodeMultiBranch();
+                            if (pNodeMultiBranch)
+                            {
+                                READWRITE(*pNodeMultiBranch);
+                            }
+                            error = false;
+                            break;
+                        }
+                        case CMerkleBranchBase::BRANCH_MMRBLAKE_MULTIPOWERNODE:
+                        {
+                            pPowerNodeMultiBranch = new CMMRPowerNodeMultiBranch();
+                            if (pPowerNodeMultiBranch)
+                            {
+                                READWRITE(*pPowerNodeMultiBranch);
+                            }
+                            error = false;
+                            break;
+                        }
                         default:
                         {
                             printf("%s: ERROR: default case - proof sequence is likely corrupt, code %d\n", __func__, branchType);
@@ -629,6 +862,16 @@ public:
                         READWRITE(*(CMMRPowerNodeBranch *)pProof);
                         break;
                     }
+                    case CMerkleBranchBase::BRANCH_MMRBLAKE_MULTINODE:
+                    {
+                        READWRITE(*(CMMRNodeMultiBranch *)pProof);
+                        break;
+                    }
+                    case CMerkleBranchBase::BRANCH_MMRBLAKE_MULTIPOWERNODE:
+                    {
+                        READWRITE(*(CMMRPowerNodeMultiBranch *)pProof);
+                        break;
+                    }
                     default:
                     {
                         error = true;
@@ -644,8 +887,31 @@ public:
     const CMMRProof &operator<<(const CBTCMerkleBranch &append);
     const CMMRProof &operator<<(const CMMRNodeBranch &append);
     const CMMRProof &operator<<(const CMMRPowerNodeBranch &append);
+    const CMMRProof &operator<<(const CMMRNodeMultiBranch &append);
+    const CMMRProof &operator<<(const CMMRPowerNodeMultiBranch &append);
+    // appends a copy of each branch of another proof, such as one continuing from this proof's root
+    const CMMRProof &operator<<(const CMMRProof &append);
+    // checks a proof of one element, a proof with any multi branch is never valid here
     uint256 CheckProof(uint256 checkHash) const;
+    // checks a proof that starts with a multi branch, hashes being the elements it proves in the order of its indexes.
+    // multi branches are for proofs between nodes that both support them, no consensus check accepts them yet.
+    uint256 CheckProof(const std::vector<uint256> &checkHashes) const;
+    bool HasMultiBranch() const;
     UniValue ToUniValue() const;
+
+private:
+    uint256 CheckProofFrom(uint256 hash, int start) const;
+};
+
+// creates the upper layers of a mountain range, layer types that need more than a default constructor,
+// such as ones sharing storage with layer 0, specialize this
+template <typename LAYER_TYPE, typename LAYER0_TYPE>
+struct CMMRUpperLayer
+{
+    static LAYER_TYPE New(const LAYER0_TYPE &layer0, uint32_t height)
+    {
+        return LAYER_TYPE();
+    }
 };
 
 // an in memory MMR is represented by a vector of vectors of hashes, each being a layer of nodes of the binary tree, with the lowest layer
@@ -676,7 +942,7 @@ public:
             // expand vector of vectors if we are adding a new layer
             if (height == upperNodes.size())
             {
-                upperNodes.resize(upperNodes.size() + 1);
+                upperNodes.push_back(CMMRUpperLayer<LAYER_TYPE, LAYER0_TYPE>::New(layer0, height + 1));
                 // printf("adding2: upperNodes.size(): %lu, upperNodes[%d].size(): %lu\n", upperNodes.size(), height, height && upperNodes.size() ? upperNodes[height-1].size() : 0);
             }
 
@@ -1002,8 +1268,98 @@ public:
         return CMerkleBranchBase::BRANCH_MMRBLAKE_POWERNODE;
     }
 
+    uint8_t GetMultiBranchType(const CDefaultMMRNode &overload)
+    {
+        return CMerkleBranchBase::BRANCH_MMRBLAKE_MULTINODE;
+    }
+
+    uint8_t GetMultiBranchType(const CDefaultMMRPowerNode &overload)
+    {
+        return CMerkleBranchBase::BRANCH_MMRBLAKE_MULTIPOWERNODE;
+    }
+
     // return a proof of the element at "pos"
     bool GetProof(CMMRProof &retProof, uint64_t pos)
+    {
+        auto getNode = [this](uint32_t height, uint64_t index) -> NODE_TYPE { return mmr.GetNode(height, index); };
+        return GetProofWith(retProof, pos, getNode);
+    }
+
+    // return proofs of the elements at "positions", the same as GetProof would return them one by one, reading each
+    // node of the range that more than one of them need only once
+    bool GetProofs(std::vector<CMMRProof> &retProofs, const std::vector<uint64_t> &positions)
+    {
+        std::map<std::pair<uint32_t, uint64_t>, NODE_TYPE> nodeCache;
+        auto getNode = [this, &nodeCache](uint32_t height, uint64_t index) -> NODE_TYPE
+        {
+            auto key = std::make_pair(height, index);
+            auto it = nodeCache.find(key);
+            if (it == nodeCache.end())
+            {
+                it = nodeCache.insert(std::make_pair(key, mmr.GetNode(height, index))).first;
+            }
+            return it->second;
+        };
+
+        retProofs.resize(positions.size());
+        for (int i = 0; i < positions.size(); i++)
+        {
+            if (!GetProofWith(retProofs[i], positions[i], getNode))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // return one proof of all elements at "positions", which CMMRProof::CheckProof checks given the hashes a proof of
+    // each one from GetProof would be checked with, in ascending order of position. nodes shared by their paths are
+    // included once, and nodes the paths compute are not included at all.
+    bool GetMultiProof(CMMRProof &retProof, const std::vector<uint64_t> &positions)
+    {
+        typedef CMMRMultiBranch<HASHALGOWRITER, NODE_TYPE> MultiBranch;
+        MultiBranch retBranch((CMerkleBranchBase::BRANCH_TYPE)GetMultiBranchType(NODE_TYPE()));
+
+        std::map<uint64_t, NODE_TYPE> known;
+        for (auto pos : positions)
+        {
+            if (pos >= size())
+            {
+                return false;
+            }
+            known[pos] = mmr.GetNode(0, pos);
+        }
+        uint256 rootHash = GetRoot();
+
+        for (auto &oneLeaf : known)
+        {
+            retBranch.indexes.push_back(oneLeaf.first);
+            std::vector<uint256> toAdd = oneLeaf.second.GetLeafHash();
+            retBranch.leafExtras.insert(retBranch.leafExtras.end(), toAdd.begin(), toAdd.end());
+        }
+        retBranch.nSize = size();
+
+        // the verifier takes the same path, reading these nodes from the branch instead of the range
+        auto getNode = [this, &retBranch](bool bagging, uint32_t level, uint64_t index, NODE_TYPE &node) -> bool
+        {
+            node = !bagging ? mmr.GetNode(level, index) : (level ? peakMerkle[level - 1][index] : peaks[index]);
+            std::vector<uint256> toAdd = node.GetNodeValues();
+            retBranch.nodes.insert(retBranch.nodes.end(), toAdd.begin(), toAdd.end());
+            return true;
+        };
+
+        NODE_TYPE root;
+        if (!MultiBranch::Walk(size(), known, getNode, root) || root.hash != rootHash)
+        {
+            return false;
+        }
+        retProof << retBranch;
+        return true;
+    }
+
+private:
+    template <typename GETNODE>
+    bool GetProofWith(CMMRProof &retProof, uint64_t pos, GETNODE &getNode)
     {
         // find a path from the indicated position to the root in the current view
         CMMRBranch<HASHALGOWRITER, NODE_TYPE> retBranch;
@@ -1014,7 +1370,7 @@ public:
             GetRoot();
 
             // if we have leaf information, add it
-            std::vector<uint256> toAdd = mmr.layer0[pos].GetLeafHash();
+            std::vector<uint256> toAdd = getNode(0, pos).GetLeafHash();
             if (toAdd.size())
             {
                 retBranch.branch.insert(retBranch.branch.end(), toAdd.begin(), toAdd.end());
@@ -1025,7 +1381,7 @@ public:
             {
                 if (p & 1)
                 {
-                    std::vector<uint256> proofHashes = mmr.GetNode(l, p - 1).GetProofHash(mmr.GetNode(l, p));
+                    std::vector<uint256> proofHashes = getNode(l, p - 1).GetProofHash(getNode(l, p));
                     retBranch.branch.insert(retBranch.branch.end(), proofHashes.begin(), proofHashes.end());
                     p >>= 1;
                 }
@@ -1034,7 +1390,7 @@ public:
                     // make sure there is one after us to hash with or we are a peak and should be hashed with the rest of the peaks
                     if (sizes[l] > (p + 1))
                     {
-                        std::vector<uint256> proofHashes = mmr.GetNode(l, p + 1).GetProofHash(mmr.GetNode(l, p));
+                        std::vector<uint256> proofHashes = getNode(l, p + 1).GetProofHash(getNode(l, p));
                         retBranch.branch.insert(retBranch.branch.end(), proofHashes.begin(), proofHashes.end());
                         p >>= 1;
                     }
@@ -1051,7 +1407,7 @@ public:
                         } */
 
                         // we are at a peak, the alternate peak to us, or the next thing we should be hashed with, if there is one, is next on our path
-                        uint256 peakHash = mmr.GetNode(l, p).hash;
+                        uint256 peakHash = getNode(l, p).hash;
 
                         // linear search to find out which peak we are in the base of the peakMerkle
                         for (p = 0; p < peaks.size(); p++)
@@ -1120,6 +1476,7 @@ public:
         return false;
     }
 
+public:
     // return a vector of the bits, either 1 or 0 in each byte, to represent both the size
     // of the proof by the size of the vector, and the expected bit in each position for the given
     // position in a Merkle Mountain View of the specified size
@@ -0,0 +1,236 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "mmrstore.h"
+
+#include "crypto/common.h"
+#include "util.h"
+
+#include <algorithm>
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+static const unsigned char MMR_STORE_MAGIC[8] = {'M', 'M', 'R', 'N', 'O', 'D', 'E', 'S'};
+static const uint32_t MMR_STORE_VERSION = 1;
+//! magic, version, node size and saved leaf count, padded
+static const size_t MMR_STORE_HEADER_SIZE = 64;
+//! nodes per chunk while kept in memory
+static const uint64_t MMR_STORE_CHUNK_NODES = 4096;
+//! the file grows by at least this many nodes, or an eighth of its size
+static const uint64_t MMR_STORE_MIN_GROWTH = 1 << 16;
+
+static uint64_t CountBits(uint64_t x)
+{
+    uint64_t nBits = 0;
+    for (; x; x &= x - 1)
+    {
+        nBits++;
+    }
+    return nBits;
+}
+
+CMMRNodeStore::CMMRNodeStore(size_t nNodeSizeIn) : nNodeSize(nNodeSizeIn), nCapacity(0), nSavedLeaves(0), pBase(NULL)
+{
+}
+
+CMMRNodeStore::~CMMRNodeStore()
+{
+    Close();
+}
+
+uint64_t CMMRNodeStore::NodePos(uint32_t height, uint64_t index)
+{
+    // everything under the first index << height leaves, then the node's own subtree below it
+    return (index << (height + 1)) - CountBits(index) + (((uint64_t)2 << height) - 2);
+}
+
+uint64_t CMMRNodeStore::NodeCount(uint64_t nLeaves)
+{
+    return (nLeaves << 1) - CountBits(nLeaves);
+}
+
+bool CMMRNodeStore::Open(const boost::filesystem::path &pathIn)
+{
+    Close();
+    vChunks.clear();
+    path = pathIn;
+
+    bool fNew = !boost::filesystem::exists(path);
+    if (fNew)
+    {
+        FILE *file = fopen(path.string().c_str(), "wb");
+        if (!file)
+        {
+            LogPrintf("%s: cannot create %s\n", __func__, path.string());
+            return false;
+        }
+        fclose(file);
+    }
+    if (!Map(fNew ? MMR_STORE_MIN_GROWTH : 0))
+    {
+        return false;
+    }
+
+    uint64_t nLeaves = ReadLE64(pBase + 16);
+    if (fNew ||
+        memcmp(pBase, MMR_STORE_MAGIC, sizeof(MMR_STORE_MAGIC)) ||
+        ReadLE32(pBase + 8) != MMR_STORE_VERSION ||
+        ReadLE32(pBase + 12) != nNodeSize ||
+        NodeCount(nLeaves) > nCapacity)
+    {
+        if (!fNew)
+        {
+            LogPrintf("%s: %s is not a valid node store, starting over\n", __func__, path.string());
+        }
+        nLeaves = 0;
+        if (!WriteHeader(0))
+        {
+            Unmap();
+            return false;
+        }
+    }
+    nSavedLeaves = nLeaves;
+    return true;
+}
+
+void CMMRNodeStore::Close()
+{
+    Unmap();
+    nCapacity = 0;
+    nSavedLeaves = 0;
+}
+
+bool CMMRNodeStore::Map(uint64_t nNewCapacity)
+{
+    Unmap();
+    try
+    {
+        uintmax_t nSize = MMR_STORE_HEADER_SIZE + nNewCapacity * nNodeSize;
+        if (boost::filesystem::file_size(path) < nSize)
+        {
+            boost::filesystem::resize_file(path, nSize);
+        }
+        mapping.reset(new boost::interprocess::file_mapping(path.string().c_str(), boost::interprocess::read_write));
+        region.reset(new boost::interprocess::mapped_region(*mapping, boost::interprocess::read_write));
+    }
+    catch (const std::exception &e)
+    {
+        LogPrintf("%s: cannot map %s: %s\n", __func__, path.string(), e.what());
+        Unmap();
+        return false;
+    }
+    pBase = (unsigned char *)region->get_address();
+    nCapacity = (region->get_size() - MMR_STORE_HEADER_SIZE) / nNodeSize;
+    return true;
+}
+
+void CMMRNodeStore::Unmap()
+{
+    region.reset();
+    mapping.reset();
+    pBase = NULL;
+    nCapacity = 0;
+}
+
+void CMMRNodeStore::MoveToMemory()
+{
+    uint64_t nNodes = nCapacity;
+    vChunks.resize((nNodes + MMR_STORE_CHUNK_NODES - 1) / MMR_STORE_CHUNK_NODES);
+    for (uint64_t i = 0; i < vChunks.size(); i++)
+    {
+        vChunks[i].assign(MMR_STORE_CHUNK_NODES * nNodeSize, 0);
+        uint64_t nCopy = std::min(MMR_STORE_CHUNK_NODES, nNodes - i * MMR_STORE_CHUNK_NODES);
+        memcpy(vChunks[i].data(), pBase + MMR_STORE_HEADER_SIZE + i * MMR_STORE_CHUNK_NODES * nNodeSize, nCopy * nNodeSize);
+    }
+    // nodes below the saved leaf count are left untouched in the file, which stays valid for the next start
+    Unmap();
+}
+
+const unsigned char *CMMRNodeStore::GetNode(uint32_t height, uint64_t index) const
+{
+    uint64_t pos = NodePos(height, index);
+    if (pBase)
+    {
+        return pos < nCapacity ? pBase + MMR_STORE_HEADER_SIZE + pos * nNodeSize : NULL;
+    }
+    uint64_t chunk = pos / MMR_STORE_CHUNK_NODES;
+    return chunk < vChunks.size() ? vChunks[chunk].data() + (pos % MMR_STORE_CHUNK_NODES) * nNodeSize : NULL;
+}
+
+bool CMMRNodeStore::SetNode(uint32_t height, uint64_t index, const unsigned char *pnode)
+{
+    uint64_t pos = NodePos(height, index);
+    if (pBase && pos >= nCapacity)
+    {
+        uint64_t nOldCapacity = nCapacity;
+        if (!Map(std::max(pos + 1, nOldCapacity + std::max(nOldCapacity / 8, MMR_STORE_MIN_GROWTH))))
+        {
+            // keep the range in memory for the rest of this run
+            if (!Map(nOldCapacity))
+            {
+                return false;
+            }
+            MoveToMemory();
+        }
+    }
+    if (pBase)
+    {
+        memcpy(pBase + MMR_STORE_HEADER_SIZE + pos * nNodeSize, pnode, nNodeSize);
+        return true;
+    }
+
+    uint64_t chunk = pos / MMR_STORE_CHUNK_NODES;
+    if (chunk >= vChunks.size())
+    {
+        vChunks.resize(chunk + 1);
+    }
+    if (vChunks[chunk].empty())
+    {
+        vChunks[chunk].assign(MMR_STORE_CHUNK_NODES * nNodeSize, 0);
+    }
+    memcpy(vChunks[chunk].data() + (pos % MMR_STORE_CHUNK_NODES) * nNodeSize, pnode, nNodeSize);
+    return true;
+}
+
+bool CMMRNodeStore::WriteHeader(uint64_t nLeaves)
+{
+    memcpy(pBase, MMR_STORE_MAGIC, sizeof(MMR_STORE_MAGIC));
+    WriteLE32(pBase + 8, MMR_STORE_VERSION);
+    WriteLE32(pBase + 12, nNodeSize);
+    WriteLE64(pBase + 16, nLeaves);
+    if (!region->flush(0, MMR_STORE_HEADER_SIZE, false))
+    {
+        LogPrintf("%s: cannot sync %s\n", __func__, path.string());
+        return false;
+    }
+    nSavedLeaves = nLeaves;
+    return true;
+}
+
+bool CMMRNodeStore::Truncate(uint64_t nLeaves)
+{
+    // lower the saved count before any of the dropped nodes can be overwritten
+    if (pBase && nLeaves < nSavedLeaves)
+    {
+        return WriteHeader(nLeaves);
+    }
+    return true;
+}
+
+bool CMMRNodeStore::Flush(uint64_t nLeaves)
+{
+    if (!pBase || nLeaves == nSavedLeaves)
+    {
+        return true;
+    }
+    uint64_t nNodes = std::min(NodeCount(nLeaves), nCapacity);
+    if (!region->flush(0, MMR_STORE_HEADER_SIZE + nNodes * nNodeSize, false))
+    {
+        LogPrintf("%s: cannot sync %s\n", __func__, path.string());
+        return false;
+    }
+    return WriteHeader(nLeaves);
+}
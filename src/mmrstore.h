@@ -0,0 +1,159 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef VERUS_MMRSTORE_H
+#define VERUS_MMRSTORE_H
+
+#include "mmr.h"
+
+#include <assert.h>
+#include <stdexcept>
+#include <stdint.h>
+#include <string.h>
+
+#include <memory>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+namespace boost { namespace interprocess {
+class file_mapping;
+class mapped_region;
+} }
+
+/**
+ * The nodes of every layer of a merkle mountain range, stored together in post order, which is the
+ * order an append only range completes them in. The nodes of the first n leaves are then always the
+ * first 2n - popcount(n) positions, so adding leaves only appends and truncating only shortens.
+ *
+ * Nodes are kept in memory until Open() maps a file. Nodes in the file are durable up to the leaf
+ * count last given to Flush() or Truncate(), and are never overwritten below it, so a crash leaves a
+ * valid range of that many leaves. As with the in-memory layers, changes must be synchronized with
+ * readers of the range.
+ */
+class CMMRNodeStore
+{
+public:
+    explicit CMMRNodeStore(size_t nNodeSizeIn);
+    ~CMMRNodeStore();
+
+    //! position of a node in post order
+    static uint64_t NodePos(uint32_t height, uint64_t index);
+    //! positions used by a range of nLeaves leaves
+    static uint64_t NodeCount(uint64_t nLeaves);
+
+    size_t NodeSize() const { return nNodeSize; }
+
+    //! maps path, creating it if needed, must be called while the store is empty
+    bool Open(const boost::filesystem::path &path);
+    void Close();
+    bool IsMapped() const { return (bool)region; }
+    //! number of leaves whose nodes were durable in the file when it was opened
+    uint64_t SavedLeaves() const { return nSavedLeaves; }
+
+    //! NULL if nothing has been stored at that position
+    const unsigned char *GetNode(uint32_t height, uint64_t index) const;
+    bool SetNode(uint32_t height, uint64_t index, const unsigned char *pnode);
+
+    //! called when the range is truncated to nLeaves, durably dropping saved leaves beyond it
+    bool Truncate(uint64_t nLeaves);
+    //! makes the nodes of the first nLeaves leaves durable
+    bool Flush(uint64_t nLeaves);
+
+private:
+    size_t nNodeSize;
+    uint64_t nCapacity;
+    uint64_t nSavedLeaves;
+    std::vector<std::vector<unsigned char>> vChunks;
+
+    boost::filesystem::path path;
+    std::unique_ptr<boost::interprocess::file_mapping> mapping;
+    std::unique_ptr<boost::interprocess::mapped_region> region;
+    unsigned char *pBase;
+
+    CMMRNodeStore(const CMMRNodeStore&);
+    void operator=(const CMMRNodeStore&);
+
+    bool Map(uint64_t nNewCapacity);
+    void Unmap();
+    //! copies the mapped nodes into memory when the file cannot grow
+    void MoveToMemory();
+    bool WriteHeader(uint64_t nLeaves);
+};
+
+/**
+ * A mountain range layer kept in a CMMRNodeStore. All layers of a range must share one store, which
+ * layer 0 is given and the upper layers inherit.
+ */
+template <typename NODE_TYPE>
+class CMMRStoreLayer
+{
+private:
+    CMMRNodeStore *store;
+    uint32_t height;
+    uint64_t vSize;
+
+public:
+    CMMRStoreLayer() : store(NULL), height(0), vSize(0) {}
+    CMMRStoreLayer(CMMRNodeStore *Store, uint32_t Height) : store(Store), height(Height), vSize(0)
+    {
+        assert(!store || store->NodeSize() == sizeof(NODE_TYPE));
+    }
+
+    CMMRNodeStore *GetStore() const
+    {
+        return store;
+    }
+
+    uint64_t size() const
+    {
+        return vSize;
+    }
+
+    NODE_TYPE operator[](uint64_t idx) const
+    {
+        const unsigned char *pnode = (idx < vSize && store) ? store->GetNode(height, idx) : NULL;
+        if (!pnode)
+        {
+            std::__throw_length_error("CMMRStoreLayer [] index out of range");
+            return NODE_TYPE();
+        }
+        // nodes are stored as their in-memory bytes, which for these node types are only byte arrays
+        NODE_TYPE node;
+        memcpy(&node, pnode, sizeof(NODE_TYPE));
+        return node;
+    }
+
+    void push_back(NODE_TYPE node)
+    {
+        if (!store || !store->SetNode(height, vSize, (const unsigned char *)&node))
+        {
+            throw std::runtime_error("CMMRStoreLayer: cannot store node");
+        }
+        vSize++;
+    }
+
+    void clear()
+    {
+        vSize = 0;
+    }
+
+    // the store keeps nodes beyond the size until they are overwritten, which lets a range be restored
+    // to any size the store holds
+    void resize(uint64_t newSize)
+    {
+        vSize = newSize;
+    }
+};
+
+template <typename NODE_TYPE>
+struct CMMRUpperLayer<CMMRStoreLayer<NODE_TYPE>, CMMRStoreLayer<NODE_TYPE>>
+{
+    static CMMRStoreLayer<NODE_TYPE> New(const CMMRStoreLayer<NODE_TYPE> &layer0, uint32_t height)
+    {
+        return CMMRStoreLayer<NODE_TYPE>(layer0.GetStore(), height);
+    }
+};
+
+#endif // VERUS_MMRSTORE_H
@@ -24,6 +24,10 @@
 #include <fcntl.h>
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
 #include <boost/filesystem.hpp>
 #include <boost/thread.hpp>
 
@@ -57,6 +61,12 @@ namespace {
 
         ListenSocket(SOCKET socket, bool whitelisted) : socket(socket), whitelisted(whitelisted) {}
     };
+
+#ifdef HAVE_SYS_EPOLL_H
+    /** Maximum number of events collected by one epoll_wait() call */
+    const int MAX_EPOLL_EVENTS = 256;
+    int epollfd = -1;
+#endif
 }
 
 //
@@ -75,6 +85,7 @@ static bool vfLimited[NET_MAX] = {};
 static CNode* pnodeLocalHost = NULL;
 uint64_t nLocalHostNonce = 0;
 static std::vector<ListenSocket> vhListenSocket;
+SocketEventsMode nSocketEventsMode = SOCKETEVENTS_SELECT;
 CAddrMan addrman;
 int nMaxConnections = DEFAULT_MAX_PEER_CONNECTIONS;
 bool fAddressesInitialized = false;
@@ -102,10 +113,99 @@ CCriticalSection cs_nLastNodeId;
 static CSemaphore *semOutbound = NULL;
 static boost::condition_variable messageHandlerCondition;
 
+int nMessageHandlerThreads = DEFAULT_MESSAGE_HANDLER_THREADS;
+
+// Peers queued for the message handler workers. A peer is queued at most once
+// (CNode::fMessageHandlerQueued), so its messages are always handled in order.
+static boost::mutex csMessageWork;
+static boost::condition_variable condMessageWork;
+static std::deque<std::pair<CNode*, bool> > vMessageWork;
+
 // Signals for message handling
 static CNodeSignals g_signals;
 CNodeSignals& GetNodeSignals() { return g_signals; }
 
+std::string DefaultSocketEventsMode()
+{
+#ifdef HAVE_SYS_EPOLL_H
+    return "epoll";
+#else
+    return "select";
+#endif
+}
+
+bool SetSocketEventsMode(const std::string& strMode)
+{
+    if (strMode == "select") {
+        nSocketEventsMode = SOCKETEVENTS_SELECT;
+        return true;
+    }
+#ifdef HAVE_SYS_EPOLL_H
+    if (strMode == "epoll") {
+        nSocketEventsMode = SOCKETEVENTS_EPOLL;
+        return true;
+    }
+#endif
+    return false;
+}
+
+bool InitSocketEvents()
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (nSocketEventsMode == SOCKETEVENTS_EPOLL && epollfd == -1)
+    {
+        epollfd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollfd == -1)
+            return false;
+    }
+#endif
+    return true;
+}
+
+/** select() can only watch sockets below FD_SETSIZE, epoll has no such limit */
+static bool IsServiceableSocket(SOCKET hSocket)
+{
+    return nSocketEventsMode != SOCKETEVENTS_SELECT || IsSelectableSocket(hSocket);
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+/**
+ * Peer sockets are registered edge-triggered: an event is only reported when a socket
+ * becomes readable or writable, and ThreadSocketHandler keeps that state in
+ * fHasRecvData/fCanSendData until a recv or send would block.
+ */
+static void RegisterSocketEvents(CNode *pnode)
+{
+    if (nSocketEventsMode != SOCKETEVENTS_EPOLL || pnode->hSocket == INVALID_SOCKET)
+        return;
+
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = pnode;
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, pnode->hSocket, &event) != 0)
+    {
+        LogPrintf("epoll_ctl failed to add peer=%d: %s\n", pnode->id, NetworkErrorString(errno));
+        pnode->fDisconnect = true;
+    }
+}
+
+/**
+ * Closing a socket only drops it from the epoll set once no other process holds a copy of
+ * the descriptor (e.g. a child forked for -blocknotify), so remove it explicitly.
+ */
+static void UnregisterSocketEvents(SOCKET hSocket)
+{
+    if (nSocketEventsMode != SOCKETEVENTS_EPOLL || hSocket == INVALID_SOCKET)
+        return;
+
+    struct epoll_event event;
+    epoll_ctl(epollfd, EPOLL_CTL_DEL, hSocket, &event);
+}
+#else
+static void RegisterSocketEvents(CNode *pnode) {}
+static void UnregisterSocketEvents(SOCKET hSocket) {}
+#endif
+
 void AddOneShot(const std::string& strDest)
 {
     LOCK(cs_vOneShots);
@@ -385,7 +485,7 @@ CNode* ConnectNode(CAddress addrConnect, const char *pszDest)
     if (pszDest ? ConnectSocketByName(addrConnect, hSocket, pszDest, Params().GetDefaultPort(), nConnectTimeout, &proxyConnectionFailed) :
                   ConnectSocket(addrConnect, hSocket, nConnectTimeout, &proxyConnectionFailed))
     {
-        if (!IsSelectableSocket(hSocket)) {
+        if (!IsServiceableSocket(hSocket)) {
             LogPrintf("Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE ?)\n");
             CloseSocket(hSocket);
             return NULL;
@@ -400,6 +500,7 @@ CNode* ConnectNode(CAddress addrConnect, const char *pszDest)
         {
             LOCK(cs_vNodes);
             vNodes.push_back(pnode);
+            RegisterSocketEvents(pnode);
         }
 
         pnode->nTimeConnected = GetTime();
@@ -420,6 +521,7 @@ void CNode::CloseSocketDisconnect()
     if (hSocket != INVALID_SOCKET)
     {
         LogPrint("net", "disconnecting peer=%d\n", id);
+        UnregisterSocketEvents(hSocket);
         CloseSocket(hSocket);
     }
 
@@ -727,6 +829,28 @@ void SocketSendData(CNode *pnode)
 
 static list<CNode*> vNodesDisconnected;
 
+// Peers for ThreadSocketHandler to disconnect with -socketevents=epoll, guarded by cs_vNodes.
+// Peers stay in vNodes until they are handled, and CNode::fDisconnectQueued keeps a peer from
+// being queued twice.
+static std::vector<CNode*> vNodesDisconnectQueued;
+
+/** Whether ThreadSocketHandler should disconnect a peer, either asked to or no longer used */
+static bool IsNodeToDisconnect(CNode *pnode)
+{
+    return pnode->fDisconnect ||
+        (pnode->GetRefCount() <= 0 && pnode->vRecvMsg.empty() && pnode->nSendSize == 0 && pnode->ssSend.empty());
+}
+
+/** Queue a peer for disconnection, so the epoll loop does not look through every peer for it */
+static void QueueNodeDisconnect(CNode *pnode)
+{
+    AssertLockHeld(cs_vNodes);
+    if (nSocketEventsMode != SOCKETEVENTS_EPOLL || pnode->fDisconnectQueued)
+        return;
+    pnode->fDisconnectQueued = true;
+    vNodesDisconnectQueued.push_back(pnode);
+}
+
 class CNodeRef {
 public:
     CNodeRef(CNode *pnode) : _pnode(pnode) {
@@ -951,7 +1075,7 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
         return;
     }
 
-    if (!IsSelectableSocket(hSocket))
+    if (!IsServiceableSocket(hSocket))
     {
         LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
         CloseSocket(hSocket);
@@ -1001,12 +1125,227 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
+        RegisterSocketEvents(pnode);
+    }
+}
+
+// requires LOCK(cs_vRecvMsg), returns true if the socket may have more data to read
+static bool SocketRecvData(CNode *pnode)
+{
+    // typical socket buffer is 8K-64K
+    char pchBuf[0x10000];
+    int nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+    if (nBytes > 0)
+    {
+        if (!pnode->ReceiveMsgBytes(pchBuf, nBytes))
+            pnode->CloseSocketDisconnect();
+        pnode->nLastRecv = GetTime();
+        pnode->nRecvBytes += nBytes;
+        pnode->RecordBytesRecv(nBytes);
+        // a short read drained the socket buffer, anything arriving later raises a new event
+        return nBytes == sizeof(pchBuf);
+    }
+    else if (nBytes == 0)
+    {
+        // socket closed gracefully
+        if (!pnode->fDisconnect)
+            LogPrint("net", "socket closed\n");
+        pnode->CloseSocketDisconnect();
+    }
+    else if (nBytes < 0)
+    {
+        // error
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
+        {
+            if (!pnode->fDisconnect)
+                LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
+            pnode->CloseSocketDisconnect();
+        }
+    }
+    return false;
+}
+
+static void InactivityCheck(CNode *pnode)
+{
+    int64_t nTime = GetTime();
+    if (nTime - pnode->nTimeConnected > 60)
+    {
+        if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
+        {
+            LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
+            pnode->fDisconnect = true;
+        }
+        else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
+        {
+            LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
+            pnode->fDisconnect = true;
+        }
+        else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
+        {
+            LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
+            pnode->fDisconnect = true;
+        }
+        else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
+        {
+            LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
+            pnode->fDisconnect = true;
+        }
     }
 }
 
+#ifdef HAVE_SYS_EPOLL_H
+// Peers with socket work left for the epoll loop, each holding a reference while listed. Only
+// ThreadSocketHandler touches it, and CNode::fSocketListed keeps a peer from being listed twice.
+static std::vector<CNode*> vNodesSocketReady;
+
+/**
+ * Wait for socket events with epoll and service the peers that are ready. Unlike select(),
+ * only peers with an event or work left over from an earlier event are visited, so the cost
+ * of a wakeup does not grow with the number of peers, and sockets are not limited to
+ * FD_SETSIZE. Returns true if some socket may still have data to read right away.
+ */
+static bool ServiceSocketsEpoll(bool fMoreWork)
+{
+    static int64_t nLastInactivityCheck = 0;
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+
+    int nEvents = epoll_wait(epollfd, events, MAX_EPOLL_EVENTS, fMoreWork ? 0 : 50);
+    boost::this_thread::interruption_point();
+
+    if (nEvents < 0)
+    {
+        if (errno != EINTR)
+        {
+            LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(errno));
+            MilliSleep(50);
+        }
+        nEvents = 0;
+    }
+
+    for (int i = 0; i < nEvents; i++)
+    {
+        // listen sockets are registered level-triggered with a pointer to their ListenSocket
+        const ListenSocket *pListenSocket = NULL;
+        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
+            if (events[i].data.ptr == &hListenSocket)
+                pListenSocket = &hListenSocket;
+        if (pListenSocket)
+        {
+            AcceptConnection(*pListenSocket);
+            continue;
+        }
+
+        // nodes are only deleted by this thread after their socket was unregistered
+        CNode *pnode = (CNode *)events[i].data.ptr;
+        if (events[i].events & (EPOLLHUP | EPOLLERR))
+        {
+            // nothing more can be sent to the peer
+            LOCK(cs_vNodes);
+            pnode->fDisconnect = true;
+            QueueNodeDisconnect(pnode);
+            continue;
+        }
+        if (events[i].events & (EPOLLIN | EPOLLRDHUP))
+            pnode->fHasRecvData = true;
+        if (events[i].events & EPOLLOUT)
+            pnode->fCanSendData = true;
+        if (!pnode->fSocketListed)
+        {
+            LOCK(cs_vNodes);
+            pnode->fSocketListed = true;
+            vNodesSocketReady.push_back(pnode->AddRef());
+        }
+    }
+
+    fMoreWork = false;
+    std::vector<CNode*> vNodesDone;
+    std::vector<CNode*> vNodesReady;
+    vNodesReady.swap(vNodesSocketReady);
+
+    BOOST_FOREACH(CNode* pnode, vNodesReady)
+    {
+        boost::this_thread::interruption_point();
+
+        if (pnode->hSocket == INVALID_SOCKET)
+        {
+            vNodesDone.push_back(pnode);
+            continue;
+        }
+
+        // drain the send buffer before receiving more, as with select() below. Data queued
+        // while the socket was writable went out with the optimistic write in EndMessage,
+        // so a peer only needs another visit for sending after a new EPOLLOUT event.
+        bool fSendPending = false, fSendBusy = false;
+        {
+            TRY_LOCK(pnode->cs_vSend, lockSend);
+            if (!lockSend)
+                fSendBusy = pnode->fCanSendData;
+            else if (!pnode->vSendMsg.empty())
+            {
+                if (pnode->fCanSendData)
+                {
+                    SocketSendData(pnode);
+                    // anything left over did not fit, wait for the socket to become writable again
+                    if (!pnode->vSendMsg.empty())
+                        pnode->fCanSendData = false;
+                }
+                fSendPending = !pnode->vSendMsg.empty();
+            }
+        }
+
+        if (!fSendPending && pnode->fHasRecvData && pnode->hSocket != INVALID_SOCKET)
+        {
+            TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
+            if (lockRecv && (
+                pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
+                pnode->GetTotalRecvSize() <= ReceiveFloodSize()))
+            {
+                pnode->fHasRecvData = SocketRecvData(pnode);
+                fMoreWork |= pnode->fHasRecvData;
+            }
+        }
+
+        // peers that still have unread data, whether throttled or not, stay listed
+        if (pnode->hSocket != INVALID_SOCKET && (pnode->fHasRecvData || fSendBusy))
+            vNodesSocketReady.push_back(pnode);
+        else
+            vNodesDone.push_back(pnode);
+    }
+
+    // the inactivity check reads a few fields of every peer, so it runs once a second rather
+    // than on every wakeup
+    bool fCheckInactivity = GetTime() != nLastInactivityCheck;
+    nLastInactivityCheck = GetTime();
+    {
+        LOCK(cs_vNodes);
+        BOOST_FOREACH(CNode* pnode, vNodesDone)
+        {
+            // peers whose socket was closed while receiving
+            if (pnode->fDisconnect)
+                QueueNodeDisconnect(pnode);
+            pnode->fSocketListed = false;
+            pnode->Release();
+        }
+        if (fCheckInactivity)
+            BOOST_FOREACH(CNode* pnode, vNodes)
+            {
+                if (pnode->hSocket != INVALID_SOCKET)
+                    InactivityCheck(pnode);
+                // also picks up peers disconnected by other threads, such as from RPC, and
+                // peers no longer used
+                if (IsNodeToDisconnect(pnode))
+                    QueueNodeDisconnect(pnode);
+            }
+    }
+    return fMoreWork;
+}
+#endif
+
 void ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
+    bool fMoreWork = false;
     while (true)
     {
         //
@@ -1015,11 +1354,19 @@ void ThreadSocketHandler()
         {
             LOCK(cs_vNodes);
             // Disconnect unused nodes
-            vector<CNode*> vNodesCopy = vNodes;
+            vector<CNode*> vNodesCopy;
+            if (nSocketEventsMode == SOCKETEVENTS_EPOLL)
+            {
+                // only the queued peers, so a wakeup does not cost a pass over every peer. A
+                // disconnected peer stays marked as queued, so it cannot be queued again while
+                // other threads still hold it.
+                vNodesCopy.swap(vNodesDisconnectQueued);
+            }
+            else
+                vNodesCopy = vNodes;
             BOOST_FOREACH(CNode* pnode, vNodesCopy)
             {
-                if (pnode->fDisconnect ||
-                    (pnode->GetRefCount() <= 0 && pnode->vRecvMsg.empty() && pnode->nSendSize == 0 && pnode->ssSend.empty()))
+                if (IsNodeToDisconnect(pnode))
                 {
                     // remove from vNodes
                     vNodes.erase(remove(vNodes.begin(), vNodes.end(), pnode), vNodes.end());
@@ -1035,6 +1382,8 @@ void ThreadSocketHandler()
                         pnode->Release();
                     vNodesDisconnected.push_back(pnode);
                 }
+                else
+                    pnode->fDisconnectQueued = false;
             }
         }
         {
@@ -1072,6 +1421,14 @@ void ThreadSocketHandler()
             uiInterface.NotifyNumConnectionsChanged(nPrevNodeCount);
         }
 
+#ifdef HAVE_SYS_EPOLL_H
+        if (nSocketEventsMode == SOCKETEVENTS_EPOLL)
+        {
+            fMoreWork = ServiceSocketsEpoll(fMoreWork);
+            continue;
+        }
+#endif
+
         //
         // Find which sockets have data to receive
         //
@@ -1188,39 +1545,7 @@ void ThreadSocketHandler()
             {
                 TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
                 if (lockRecv)
-                {
-                    {
-                        // typical socket buffer is 8K-64K
-                        char pchBuf[0x10000];
-                        int nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
-                        if (nBytes > 0)
-                        {
-                            if (!pnode->ReceiveMsgBytes(pchBuf, nBytes))
-                                pnode->CloseSocketDisconnect();
-                            pnode->nLastRecv = GetTime();
-                            pnode->nRecvBytes += nBytes;
-                            pnode->RecordBytesRecv(nBytes);
-                        }
-                        else if (nBytes == 0)
-                        {
-                            // socket closed gracefully
-                            if (!pnode->fDisconnect)
-                                LogPrint("net", "socket closed\n");
-                            pnode->CloseSocketDisconnect();
-                        }
-                        else if (nBytes < 0)
-                        {
-                            // error
-                            int nErr = WSAGetLastError();
-                            if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
-                            {
-                                if (!pnode->fDisconnect)
-                                    LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
-                                pnode->CloseSocketDisconnect();
-                            }
-                        }
-                    }
-                }
+                    SocketRecvData(pnode);
             }
 
             //
@@ -1238,30 +1563,7 @@ void ThreadSocketHandler()
             //
             // Inactivity checking
             //
-            int64_t nTime = GetTime();
-            if (nTime - pnode->nTimeConnected > 60)
-            {
-                if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
-                {
-                    LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
-                {
-                    LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
-                {
-                    LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
-                    pnode->fDisconnect = true;
-                }
-                else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
-                {
-                    LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
-                    pnode->fDisconnect = true;
-                }
-            }
+            InactivityCheck(pnode);
         }
         {
             LOCK(cs_vNodes);
@@ -1556,6 +1858,89 @@ bool OpenNetworkConnection(const CAddress& addrConnect, CSemaphoreGrant *grantOu
 }
 
 
+/** Handle received messages and send queued ones for one peer, returns true if it has more to process */
+static bool ProcessNodeMessages(CNode *pnode, bool fSendTrickle)
+{
+    if (pnode->fDisconnect)
+        return false;
+
+    bool fMoreWork = false;
+
+    // Receive messages
+    {
+        TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
+        if (lockRecv)
+        {
+            if (!g_signals.ProcessMessages(pnode))
+                pnode->CloseSocketDisconnect();
+
+            if (pnode->nSendSize < SendBufferSize())
+            {
+                if (!pnode->vRecvGetData.empty() || (!pnode->vRecvMsg.empty() && pnode->vRecvMsg[0].complete()))
+                {
+                    fMoreWork = true;
+                }
+            }
+        }
+    }
+    boost::this_thread::interruption_point();
+
+    // Send messages
+    {
+        TRY_LOCK(pnode->cs_vSend, lockSend);
+        if (lockSend)
+            g_signals.SendMessages(pnode, fSendTrickle);
+    }
+    boost::this_thread::interruption_point();
+
+    // most disconnects are decided while handling messages
+    if (pnode->fDisconnect)
+    {
+        LOCK(cs_vNodes);
+        QueueNodeDisconnect(pnode);
+    }
+
+    return fMoreWork;
+}
+
+static void ThreadMessageHandlerWorker()
+{
+    SetThreadPriority(THREAD_PRIORITY_BELOW_NORMAL);
+    while (true)
+    {
+        std::pair<CNode*, bool> work;
+        {
+            boost::unique_lock<boost::mutex> lock(csMessageWork);
+            while (vMessageWork.empty())
+                condMessageWork.wait(lock);
+            work = vMessageWork.front();
+            vMessageWork.pop_front();
+        }
+
+        CNode *pnode = work.first;
+        bool fMoreWork = false;
+        try
+        {
+            fMoreWork = ProcessNodeMessages(pnode, work.second);
+        }
+        catch (const boost::thread_interrupted&)
+        {
+            LOCK(cs_vNodes);
+            pnode->fMessageHandlerQueued = false;
+            pnode->Release();
+            throw;
+        }
+
+        {
+            LOCK(cs_vNodes);
+            pnode->fMessageHandlerQueued = false;
+            pnode->Release();
+        }
+        if (fMoreWork)
+            messageHandlerCondition.notify_one();
+    }
+}
+
 void ThreadMessageHandler()
 {
     boost::mutex condition_mutex;
@@ -1580,42 +1965,43 @@ void ThreadMessageHandler()
 
         bool fSleep = true;
 
-        BOOST_FOREACH(CNode* pnode, vNodesCopy)
+        if (nMessageHandlerThreads > 1)
         {
-            if (!pnode)
+            // Hand each idle peer to the worker pool, peers still being handled are picked
+            // up again on the next pass so a slow peer only holds up its own worker.
+            std::vector<std::pair<CNode*, bool> > vWork;
             {
-                LogPrintf("%s: unexpected NULL node\n", __func__);
+                LOCK(cs_vNodes);
+                BOOST_FOREACH(CNode* pnode, vNodesCopy)
+                {
+                    if (pnode->fDisconnect || pnode->fMessageHandlerQueued)
+                        continue;
+                    pnode->fMessageHandlerQueued = true;
+                    pnode->AddRef();
+                    vWork.push_back(std::make_pair(pnode, pnode == pnodeTrickle || pnode->fWhitelisted));
+                }
             }
-
-            if (pnode->fDisconnect)
-                continue;
-
-            // Receive messages
+            if (!vWork.empty())
             {
-                TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
-                if (lockRecv)
                 {
-                    if (!g_signals.ProcessMessages(pnode))
-                        pnode->CloseSocketDisconnect();
-
-                    if (pnode->nSendSize < SendBufferSize())
-                    {
-                        if (!pnode->vRecvGetData.empty() || (!pnode->vRecvMsg.empty() && pnode->vRecvMsg[0].complete()))
-                        {
-                            fSleep = false;
-                        }
-                    }
+                    boost::unique_lock<boost::mutex> lockWork(csMessageWork);
+                    vMessageWork.insert(vMessageWork.end(), vWork.begin(), vWork.end());
                 }
+                condMessageWork.notify_all();
             }
-            boost::this_thread::interruption_point();
-
-            // Send messages
+        }
+        else
+        {
+            BOOST_FOREACH(CNode* pnode, vNodesCopy)
             {
-                TRY_LOCK(pnode->cs_vSend, lockSend);
-                if (lockSend)
-                    g_signals.SendMessages(pnode, pnode == pnodeTrickle || pnode->fWhitelisted);
+                if (!pnode)
+                {
+                    LogPrintf("%s: unexpected NULL node\n", __func__);
+                }
+
+                if (ProcessNodeMessages(pnode, pnode == pnodeTrickle || pnode->fWhitelisted))
+                    fSleep = false;
             }
-            boost::this_thread::interruption_point();
         }
 
         {
@@ -1658,7 +2044,7 @@ bool BindListenPort(const CService &addrBind, string& strError, bool fWhiteliste
         LogPrintf("%s\n", strError);
         return false;
     }
-    if (!IsSelectableSocket(hListenSocket))
+    if (!IsServiceableSocket(hListenSocket))
     {
         strError = "Error: Couldn't create a listenable socket for incoming connections";
         LogPrintf("%s\n", strError);
@@ -1819,6 +2205,22 @@ void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler)
     else
         threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "dnsseed", &ThreadDNSAddressSeed));
 
+#ifdef HAVE_SYS_EPOLL_H
+    if (nSocketEventsMode == SOCKETEVENTS_EPOLL)
+    {
+        // InitSocketEvents created the epoll instance before any socket was opened
+        BOOST_FOREACH(ListenSocket& hListenSocket, vhListenSocket)
+        {
+            struct epoll_event event;
+            event.events = EPOLLIN;
+            event.data.ptr = &hListenSocket;
+            if (epoll_ctl(epollfd, EPOLL_CTL_ADD, hListenSocket.socket, &event) != 0)
+                LogPrintf("epoll_ctl failed to add listen socket: %s\n", NetworkErrorString(errno));
+        }
+    }
+#endif
+    LogPrintf("Using %s for socket events\n", nSocketEventsMode == SOCKETEVENTS_EPOLL ? "epoll" : "select");
+
     // Send and receive from sockets, accept connections
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "net", &ThreadSocketHandler));
 
@@ -1830,6 +2232,12 @@ void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     // Process messages
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "msghand", &ThreadMessageHandler));
+    if (nMessageHandlerThreads > 1)
+    {
+        LogPrintf("Using %d threads for message handling\n", nMessageHandlerThreads);
+        for (int i = 0; i < nMessageHandlerThreads; i++)
+            threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "msgwork", &ThreadMessageHandlerWorker));
+    }
 
     // Dump network addresses
     scheduler.scheduleEvery(&DumpAddresses, DUMP_ADDRESSES_INTERVAL);
@@ -1874,7 +2282,13 @@ public:
             delete pnode;
         vNodes.clear();
         vNodesDisconnected.clear();
+        vNodesDisconnectQueued.clear();
         vhListenSocket.clear();
+#ifdef HAVE_SYS_EPOLL_H
+        if (epollfd != -1)
+            close(epollfd);
+        epollfd = -1;
+#endif
         delete semOutbound;
         semOutbound = NULL;
         delete pnodeLocalHost;
@@ -2115,6 +2529,11 @@ CNode::CNode(SOCKET hSocketIn, const CAddress& addrIn, const std::string& addrNa
     fNetworkNode = false;
     fSuccessfullyConnected = false;
     fDisconnect = false;
+    fHasRecvData = false;
+    fCanSendData = false;
+    fSocketListed = false;
+    fDisconnectQueued = false;
+    fMessageHandlerQueued = false;
     nRefCount = 0;
     nSendSize = 0;
     nSendOffset = 0;
@@ -2149,6 +2568,7 @@ CNode::CNode(SOCKET hSocketIn, const CAddress& addrIn, const std::string& addrNa
 
 CNode::~CNode()
 {
+    UnregisterSocketEvents(hSocket);
     CloseSocket(hSocket);
 
     if (pfilter)
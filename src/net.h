@@ -60,9 +60,28 @@ static const size_t MAPASKFOR_MAX_SZ = MAX_INV_SZ;
 static const size_t SETASKFOR_MAX_SZ = 2 * MAX_INV_SZ;
 /** The maximum number of peer connections to maintain. */
 static const unsigned int DEFAULT_MAX_PEER_CONNECTIONS = 384;
+/** -msghandlerthreads default, peers are handled in parallel when above 1 */
+static const int DEFAULT_MESSAGE_HANDLER_THREADS = 4;
+/** Maximum number of message handler worker threads */
+static const int MAX_MESSAGE_HANDLER_THREADS = 16;
 /** The period before a network upgrade activates, where connections to upgrading peers are preferred (in blocks). */
 static const int NETWORK_UPGRADE_PEER_PREFERENCE_BLOCK_PERIOD = 24 * 24 * 3;
 
+/** How ThreadSocketHandler waits for sockets to become ready */
+enum SocketEventsMode {
+    SOCKETEVENTS_SELECT = 0,
+    SOCKETEVENTS_EPOLL = 1,
+};
+
+extern SocketEventsMode nSocketEventsMode;
+extern int nMessageHandlerThreads;
+/** Best -socketevents mode available on this platform */
+std::string DefaultSocketEventsMode();
+/** Set the -socketevents mode, returns false if it is unknown or not supported here */
+bool SetSocketEventsMode(const std::string& strMode);
+/** Create what the -socketevents mode needs, returns false with errno set if that fails */
+bool InitSocketEvents();
+
 unsigned int ReceiveFloodSize();
 unsigned int SendBufferSize();
 
@@ -278,6 +297,15 @@ public:
     bool fNetworkNode;
     bool fSuccessfullyConnected;
     bool fDisconnect;
+    // Edge-triggered socket readiness, only used by ThreadSocketHandler with -socketevents=epoll
+    bool fHasRecvData;
+    bool fCanSendData;
+    // Listed for another visit by the epoll loop, only used by ThreadSocketHandler
+    bool fSocketListed;
+    // Queued for ThreadSocketHandler to disconnect with -socketevents=epoll, guarded by cs_vNodes
+    bool fDisconnectQueued;
+    // Queued for or being handled by a message handler worker, guarded by cs_vNodes
+    bool fMessageHandlerQueued;
     // We use fRelayTxes for two purposes -
     // a) it allows us to not relay tx invs before receiving the peer's version message
     // b) the peer may tell us in its version message that we should not relay tx invs
@@ -313,9 +341,10 @@ public:
     uint256 hashContinue;
     int nStartingHeight;
 
-    // flood relay
-    std::vector<CAddress> vAddrToSend;
-    CRollingBloomFilter addrKnown;
+    // flood relay, other peers' message handlers push addresses here
+    CCriticalSection cs_addrRelay;
+    std::vector<CAddress> vAddrToSend; // GUARDED_BY(cs_addrRelay)
+    CRollingBloomFilter addrKnown; // GUARDED_BY(cs_addrRelay)
     bool fGetAddr;
     std::set<uint256> setKnown;
 
@@ -398,11 +427,13 @@ public:
 
     void AddAddressKnown(const CAddress& addr)
     {
+        LOCK(cs_addrRelay);
         addrKnown.insert(addr.GetKey());
     }
 
     void PushAddress(const CAddress& addr)
     {
+        LOCK(cs_addrRelay);
         // Known checking here is only to save space from duplicates.
         // SendMessages will filter it again for knowns that were added
         // after addresses were pushed.
@@ -10,7 +10,16 @@
 NotarisationDB *pnotarisations;
 
 
-NotarisationDB::NotarisationDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "notarisations", nCacheSize, fMemory, fWipe, false, 64) { }
+NotarisationDB::NotarisationDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "notarisations", nCacheSize, DefaultOptions(), fMemory, fWipe) { }
+
+NotarisationDB::NotarisationDB(size_t nCacheSize, const CDBOptions &dbOptions, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "notarisations", nCacheSize, dbOptions, fMemory, fWipe) { }
+
+CDBOptions NotarisationDB::DefaultOptions()
+{
+    CDBOptions dbOptions;
+    dbOptions.nWriteBufferPercent = 10;
+    return dbOptions;
+}
 
 
 NotarisationsInBlock ScanBlockNotarisations(const CBlock &block, int nHeight)
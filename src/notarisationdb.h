@@ -10,6 +10,10 @@ class NotarisationDB : public CDBWrapper
 {
 public:
     NotarisationDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    NotarisationDB(size_t nCacheSize, const CDBOptions &dbOptions, bool fMemory = false, bool fWipe = false);
+
+    //! small, write mostly database keyed by hash, so keep write buffers modest
+    static CDBOptions DefaultOptions();
 };
 
 
@@ -15,6 +15,7 @@
  */
 #include "main.h"
 #include "pbaas/pbaas.h"
+#include "perfstats.h"
 #include "identity.h"
 
 extern CTxMemPool mempool;
@@ -178,6 +179,7 @@ bool CIdentity::IsInvalidMutation(const CIdentity &newIdentity, uint32_t height,
 
 CIdentity CIdentity::LookupIdentity(const CIdentityID &nameID, uint32_t height, uint32_t *pHeightOut, CTxIn *pIdTxIn)
 {
+    CPerfTimer timer(PERF_LOOKUPIDENTITY);
     LOCK(mempool.cs);
 
     CIdentity ret;
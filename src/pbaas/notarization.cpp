@@ -1309,7 +1309,9 @@ bool CPBaaSNotarization::CreateEarnedNotarization(const CRPCChainData &externalS
         notarization.currencyStates[systemDef.GatewayConverterID()] = ConnectedChains.GetCurrencyState(systemDef.GatewayConverterID(), height);
     }
 
-    // add this blockchain's info, based on the requested height
+    // add this blockchain's info, based on the requested height. an earned notarization carries only
+    // proof roots, the proofs checked against them later are single element proofs, since multi
+    // element MMR proofs are not accepted by consensus on either chain
     CBlockIndex &curBlkIndex = *chainActive[height];
     uint160 thisChainID = ConnectedChains.ThisChain().GetID();
     notarization.proofRoots[thisChainID] = CProofRoot::GetProofRoot(height);
@@ -0,0 +1,207 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "pbaas/notarizedsync.h"
+
+#include "chain.h"
+#include "chainparams.h"
+#include "key_io.h"
+#include "main.h"
+#include "pbaas/notarization.h"
+#include "pbaas/pbaas.h"
+#include "scheduler.h"
+#include "util.h"
+
+#include <boost/bind.hpp>
+
+static CBlockIndex *pindexNotarizedSync = NULL;    // protected by cs_main
+
+static CCriticalSection cs_headerMMR;
+static CHeaderMMRPeaks headerMMR;                   // protected by cs_headerMMR
+static const CBlockIndex *pindexHeaderMMR = NULL;   // the last header in headerMMR, protected by cs_headerMMR
+
+void CHeaderMMRPeaks::Add(const ChainMMRNode &leaf)
+{
+    std::pair<uint32_t, ChainMMRNode> node(0, leaf);
+    while (peaks.size() && peaks.back().first == node.first)
+    {
+        node = std::make_pair(node.first + 1, peaks.back().second.CreateParentNode(node.second));
+        peaks.pop_back();
+    }
+    peaks.push_back(node);
+    nLeaves++;
+}
+
+uint256 CHeaderMMRPeaks::GetRoot() const
+{
+    if (!peaks.size())
+    {
+        return uint256();
+    }
+
+    // the peaks are bagged in pairs from the highest, with an odd one at the end passing through
+    std::vector<ChainMMRNode> layer;
+    for (auto &onePeak : peaks)
+    {
+        layer.push_back(onePeak.second);
+    }
+    while (layer.size() > 1)
+    {
+        std::vector<ChainMMRNode> nextLayer;
+        for (int i = 0; i + 1 < layer.size(); i += 2)
+        {
+            nextLayer.push_back(layer[i].CreateParentNode(layer[i + 1]));
+        }
+        if (layer.size() & 1)
+        {
+            nextLayer.push_back(layer.back());
+        }
+        layer.swap(nextLayer);
+    }
+    return layer[0].hash;
+}
+
+bool CheckNotarizedProofRoot(const CProofRoot &proofRoot, CBlockIndex *&pindexRoot)
+{
+    if (!proofRoot.IsValid() || proofRoot.type != CProofRoot::TYPE_PBAAS || proofRoot.systemID != ASSETCHAINS_CHAINID)
+    {
+        return false;
+    }
+
+    LOCK(cs_headerMMR);
+
+    // block index entries are never freed and their headers do not change, so they can be hashed after the lock is released
+    std::vector<const CBlockIndex *> headers;
+    {
+        LOCK(cs_main);
+        pindexRoot = pindexBestHeader ? pindexBestHeader->GetAncestor(proofRoot.rootHeight) : NULL;
+        if (!pindexRoot ||
+            pindexRoot->GetBlockHash() != proofRoot.blockHash ||
+            pindexRoot->chainPower.CompactChainPower() != proofRoot.compactPower)
+        {
+            return false;
+        }
+
+        // start over only if the headers hashed last time are not all under this root
+        if (pindexHeaderMMR && pindexRoot->GetAncestor(pindexHeaderMMR->GetHeight()) != pindexHeaderMMR)
+        {
+            headerMMR = CHeaderMMRPeaks();
+            pindexHeaderMMR = NULL;
+        }
+        for (const CBlockIndex *pindex = pindexRoot; pindex != pindexHeaderMMR; pindex = pindex->pprev)
+        {
+            headers.push_back(pindex);
+        }
+    }
+    for (auto it = headers.rbegin(); it != headers.rend(); it++)
+    {
+        headerMMR.Add((*it)->GetBlockMMRNode());
+    }
+    pindexHeaderMMR = pindexRoot;
+    return headerMMR.GetRoot() == proofRoot.stateRoot;
+}
+
+CBlockIndex *GetNotarizedSyncAnchor()
+{
+    AssertLockHeld(cs_main);
+    return pindexNotarizedSync;
+}
+
+bool IsNotarizedAncestor(const CBlockIndex *pindex)
+{
+    AssertLockHeld(cs_main);
+    return pindexNotarizedSync && pindex && pindexNotarizedSync->GetAncestor(pindex->GetHeight()) == pindex;
+}
+
+bool GetConfirmedNotarizedProofRoot(CProofRoot &proofRoot)
+{
+    if (!ConnectedChains.IsNotaryAvailable(true))
+    {
+        return false;
+    }
+
+    UniValue params(UniValue::VARR);
+    params.push_back(EncodeDestination(CIdentityID(ASSETCHAINS_CHAINID)));
+
+    UniValue result;
+    try
+    {
+        result = find_value(RPCCallRoot("getnotarizationdata", params), "result");
+    } catch (const std::exception &e)
+    {
+        result = NullUniValue;
+    }
+    if (result.isNull())
+    {
+        LogPrint("notarizedsync", "%s: no notarization data from the notary chain\n", __func__);
+        return false;
+    }
+
+    CChainNotarizationData cnd(result);
+    if (!cnd.IsValid() || !cnd.IsConfirmed())
+    {
+        return false;
+    }
+    auto rootIt = cnd.vtx[cnd.lastConfirmed].second.proofRoots.find(ASSETCHAINS_CHAINID);
+    if (rootIt == cnd.vtx[cnd.lastConfirmed].second.proofRoots.end())
+    {
+        return false;
+    }
+    proofRoot = rootIt->second;
+    return true;
+}
+
+// reads the proof root of the last confirmed notarization of this chain from the notary chain and, once our
+// headers reach it, makes it the anchor
+static void UpdateNotarizedSyncAnchor()
+{
+    CProofRoot proofRoot;
+    if (!GetConfirmedNotarizedProofRoot(proofRoot))
+    {
+        return;
+    }
+
+    {
+        LOCK(cs_main);
+        // nothing to gain from a root we have already anchored at or validated past
+        if ((pindexNotarizedSync && pindexNotarizedSync->GetHeight() >= proofRoot.rootHeight) ||
+            chainActive.Height() >= (int)proofRoot.rootHeight)
+        {
+            return;
+        }
+    }
+
+    CBlockIndex *pindexRoot = NULL;
+    if (!CheckNotarizedProofRoot(proofRoot, pindexRoot))
+    {
+        LogPrint("notarizedsync", "%s: headers do not yet match the notarized proof root at height %u\n", __func__, proofRoot.rootHeight);
+        return;
+    }
+
+    LOCK(cs_main);
+    pindexNotarizedSync = pindexRoot;
+    LogPrintf("%s: blocks up to %s at height %u are notarized, their script and proof checks will be skipped\n", __func__,
+              pindexRoot->GetBlockHash().GetHex(), proofRoot.rootHeight);
+}
+
+static void NotarizedSyncTask(CScheduler &scheduler)
+{
+    UpdateNotarizedSyncAnchor();
+
+    // a newer root is only useful until we catch up
+    if (IsInitialBlockDownload(Params()))
+    {
+        scheduler.scheduleFromNow(boost::bind(&NotarizedSyncTask, boost::ref(scheduler)), NOTARIZED_SYNC_INTERVAL);
+    }
+}
+
+void StartNotarizedSync(CScheduler &scheduler)
+{
+    if (IsVerusActive())
+    {
+        LogPrintf("%s: -notarizedsync only applies to PBaaS chains with a notary chain\n", __func__);
+        return;
+    }
+    scheduler.scheduleFromNow(boost::bind(&NotarizedSyncTask, boost::ref(scheduler)), 0);
+}
@@ -0,0 +1,64 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef VERUS_NOTARIZEDSYNC_H
+#define VERUS_NOTARIZEDSYNC_H
+
+#include "pbaas/crosschainrpc.h"
+#include "primitives/block.h"
+
+class CBlockIndex;
+class CScheduler;
+
+//! -notarizedsync default
+static const bool DEFAULT_NOTARIZED_SYNC = false;
+//! Seconds between checks of the notary chain while this chain is in initial block download
+static const int64_t NOTARIZED_SYNC_INTERVAL = 60;
+
+/**
+ * The root of a chain MMR of block headers, as CChain::GetMMV returns it, built from the peaks of its
+ * mountains. Headers can be added after the root is read, so a longer range is hashed from where the
+ * last one ended.
+ */
+class CHeaderMMRPeaks
+{
+public:
+    CHeaderMMRPeaks() : nLeaves(0) {}
+
+    void Add(const ChainMMRNode &leaf);
+    uint64_t size() const { return nLeaves; }
+    //! null if nothing was added
+    uint256 GetRoot() const;
+
+private:
+    std::vector<std::pair<uint32_t, ChainMMRNode>> peaks;   // height and node of each mountain, highest first
+    uint64_t nLeaves;
+};
+
+/**
+ * Notarized sync lets a PBaaS chain node skip the script and proof checks of blocks that the notary
+ * chain has already confirmed, as it does for blocks under a checkpoint. The proof root of the last
+ * confirmed notarization of this chain is read from the notary chain and checked against the headers
+ * we have. The header at its height must have its block hash and chain power, and the MMR of all
+ * headers up to and including it must have its state root. Only then is that header used as the anchor.
+ */
+void StartNotarizedSync(CScheduler &scheduler);
+
+/**
+ * Check a proof root of this chain against the best header chain, returning the header it notarizes
+ * in pindexRoot. Takes cs_main only to read the headers, so the MMR is built without it. The MMR of the
+ * last check is kept, so only the headers after it are hashed while it is still on the way to the root.
+ */
+bool CheckNotarizedProofRoot(const CProofRoot &proofRoot, CBlockIndex *&pindexRoot);
+
+/** Read the proof root of the last notarization of this chain confirmed on the notary chain */
+bool GetConfirmedNotarizedProofRoot(CProofRoot &proofRoot);
+
+/** The last header checked against a notarized proof root, or NULL. Requires cs_main. */
+CBlockIndex *GetNotarizedSyncAnchor();
+
+/** True if pindex is the notarized sync anchor or one of its ancestors. Requires cs_main. */
+bool IsNotarizedAncestor(const CBlockIndex *pindex);
+
+#endif // VERUS_NOTARIZEDSYNC_H
@@ -11,6 +11,7 @@
  */
 
 #include "base58.h"
+#include "blockmmrcache.h"
 #include "main.h"
 #include "rpc/pbaasrpc.h"
 #include "timedata.h"
@@ -1590,7 +1591,8 @@ bool CConnectedChains::GetPendingCurrencyExports(const uint160 currencyID,
     }
 }
 
-CPartialTransactionProof::CPartialTransactionProof(const CTransaction tx, const std::vector<int32_t> &inputNums, const std::vector<int32_t> &outputNums, const CBlockIndex *pIndex, uint32_t proofAtHeight)
+CPartialTransactionProof::CPartialTransactionProof(const CTransaction tx, const std::vector<int32_t> &inputNums, const std::vector<int32_t> &outputNums, const CBlockIndex *pIndex, uint32_t proofAtHeight,
+                                                   const CMMRProof *pBlockProof)
 {
     // get map and MMR for transaction
     CTransactionMap txMap(tx);
@@ -1610,49 +1612,27 @@ CPartialTransactionProof::CPartialTransactionProof(const CTransaction tx, const
     }
 
     // now, both the header and stake output are dependent on the transaction MMR root being provable up
-    // through the block MMR, and since we don't cache the new MMR proof for transactions yet, we need the block to create the proof.
-    // when we switch to the new MMR in place of a merkle tree, we can keep that in the wallet as well
-    CBlock block;
-    if (!ReadBlockFromDisk(block, pIndex, Params().GetConsensus(), false))
+    // through the block MMR, which comes from the block MMR cache and only needs the block on a miss
+    CMMRProof txRootProof;
+    int txIndexPos;
+    if (!GetBlockTxRootProof(pIndex, txRoot, txRootProof, txIndexPos))
     {
-        LogPrintf("%s: ERROR: could not read block number %u from disk\n", __func__, pIndex->GetHeight());
+        LogPrintf("%s: ERROR: could not create proof of source transaction in block %u\n", __func__, pIndex->GetHeight());
         version = VERSION_INVALID;
         return;
     }
 
-    BlockMMRange blockMMR(block.GetBlockMMRTree());
-    BlockMMView blockView(blockMMR);
-
-    int txIndexPos;
-    for (txIndexPos = 0; txIndexPos < blockMMR.size(); txIndexPos++)
+    // callers proving many blocks at one height may have made the proof of the block already
+    if (pBlockProof)
     {
-        uint256 txRootHashFromMMR = blockMMR[txIndexPos].hash;
-        if (txRootHashFromMMR == txRoot)
-        {
-            //printf("tx with root %s found in block\n", txRootHashFromMMR.GetHex().c_str());
-            break;
-        }
+        txRootProof << *pBlockProof;
     }
-
-    if (txIndexPos == blockMMR.size())
-    {
-        LogPrintf("%s: ERROR: could not find transaction root in block %u\n", __func__, pIndex->GetHeight());
-        version = VERSION_INVALID;
-        return;
-    }
-
-    // prove the tx up to the MMR root, which also contains the block hash
-    CMMRProof txRootProof;
-    if (!blockView.GetProof(txRootProof, txIndexPos))
+    else
     {
-        LogPrintf("%s: ERROR: could not create proof of source transaction in block %u\n", __func__, pIndex->GetHeight());
-        version = VERSION_INVALID;
-        return;
+        ChainMerkleMountainView mmv = chainActive.GetMMV();
+        mmv.resize(proofAtHeight + 1);
+        chainActive.GetMerkleProof(mmv, txRootProof, pIndex->GetHeight());
     }
-
-    ChainMerkleMountainView mmv = chainActive.GetMMV();
-    mmv.resize(proofAtHeight + 1);
-    chainActive.GetMerkleProof(mmv, txRootProof, pIndex->GetHeight());
     *this = CPartialTransactionProof(txRootProof, txProofVec);
 
     /*printf("%s: MMR root at height %u: %s\n", __func__, proofAtHeight, mmv.GetRoot().GetHex().c_str());
@@ -1674,12 +1654,15 @@ bool CConnectedChains::GetExportProofs(uint32_t height,
                                        std::vector<std::pair<std::pair<CInputDescriptor,CPartialTransactionProof>,std::vector<CReserveTransfer>>> &exports)
 {
     // fill in proofs of the export outputs for each export at the specified height
-    CBlock proofBlock;
+    std::vector<CTransaction> exportTxes(exports.size());
+    std::vector<CBlockIndex *> exportBlocks(exports.size());
+    std::vector<int> exportHeights(exports.size());
 
-    for (auto &oneExport : exports)
+    for (int i = 0; i < exports.size(); i++)
     {
+        auto &oneExport = exports[i];
         uint256 blockHash;
-        CTransaction exportTx;
+        CTransaction &exportTx = exportTxes[i];
         if (!myGetTransaction(oneExport.first.first.txIn.prevout.hash, exportTx, blockHash))
         {
             LogPrintf("%s: unable to retrieve export %s\n", __func__, oneExport.first.first.txIn.prevout.hash.GetHex().c_str());
@@ -1702,12 +1685,30 @@ bool CConnectedChains::GetExportProofs(uint32_t height,
             LogPrintf("%s: cannot validate block of export tx %s\n", __func__, oneExport.first.first.txIn.prevout.hash.GetHex().c_str());
             return false;
         }
+        exportBlocks[i] = blockIt->second;
+        exportHeights[i] = blockIt->second->GetHeight();
+    }
+
+    // prove all of the export blocks against one view of the chain MMR
+    std::vector<CMMRProof> blockProofs;
+    ChainMerkleMountainView mmv = chainActive.GetMMV();
+    mmv.resize(height + 1);
+    if (!chainActive.GetMerkleProofs(mmv, blockProofs, exportHeights))
+    {
+        LogPrintf("%s: cannot prove export blocks at height %u\n", __func__, height);
+        return false;
+    }
+
+    for (int i = 0; i < exports.size(); i++)
+    {
+        auto &oneExport = exports[i];
         std::vector<int32_t> inputsToProve;
-        oneExport.first.second = CPartialTransactionProof(exportTx,
+        oneExport.first.second = CPartialTransactionProof(exportTxes[i],
                                                           inputsToProve,
                                                           std::vector<int32_t>({(int32_t)oneExport.first.first.txIn.prevout.n}), 
-                                                          blockIt->second, 
-                                                          height);
+                                                          exportBlocks[i], 
+                                                          height,
+                                                          &blockProofs[i]);
     }
     return true;
 }
@@ -0,0 +1,146 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "perfstats.h"
+
+#include "tinyformat.h"
+
+#include <algorithm>
+#include <cmath>
+
+const int CLatencyHistogram::BUCKETS;
+
+CLatencyHistogram::CLatencyHistogram() : nCount(0), nTotalMicros(0)
+{
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        buckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void CLatencyHistogram::Add(int64_t nMicros)
+{
+    int bucket = 0;
+    if (nMicros > 0)
+    {
+        bucket = std::min(64 - __builtin_clzll((uint64_t)nMicros), BUCKETS - 1);
+    }
+    else
+    {
+        nMicros = 0;
+    }
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    nCount.fetch_add(1, std::memory_order_relaxed);
+    nTotalMicros.fetch_add(nMicros, std::memory_order_relaxed);
+}
+
+std::vector<uint64_t> CLatencyHistogram::GetBuckets() const
+{
+    std::vector<uint64_t> ret(BUCKETS);
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        ret[i] = buckets[i].load(std::memory_order_relaxed);
+    }
+    return ret;
+}
+
+int64_t CLatencyHistogram::Percentile(const std::vector<uint64_t> &buckets, uint64_t count, double fraction)
+{
+    uint64_t nTarget = std::max((uint64_t)1, (uint64_t)std::ceil(count * fraction));
+    uint64_t nSeen = 0;
+    for (int i = 0; i < buckets.size(); i++)
+    {
+        nSeen += buckets[i];
+        if (nSeen >= nTarget)
+        {
+            return BucketLimit(i);
+        }
+    }
+    return buckets.size() ? BucketLimit(buckets.size() - 1) : 0;
+}
+
+static const char *perfStatNames[PERF_STAT_COUNT] = {
+    "connectblock",
+    "connectblock_proofs",
+    "connectblock_inputs",
+    "connectblock_scripts",
+    "connectblock_undo",
+    "connecttip_flush",
+    "accepttomemorypool",
+    "createnewblock",
+    "lookupidentity",
+    "leveldb_read",
+    "leveldb_write",
+};
+
+static CLatencyHistogram perfHistograms[PERF_STAT_COUNT];
+
+CLatencyHistogram &GetPerfHistogram(PerfStat stat)
+{
+    return perfHistograms[stat];
+}
+
+const char *GetPerfStatName(PerfStat stat)
+{
+    return perfStatNames[stat];
+}
+
+// message types handled by ProcessMessage, so that peers cannot make up new ones to track
+static const std::vector<std::string> perfMessageTypes = {
+    "addr", "alert", "block", "filteradd", "filterclear", "filterload", "getaddr", "getblocks", "getdata", "getheaders",
+    "headers", "inv", "mempool", "notfound", "ping", "pong", "reject", "tx", "verack", "version", "other"
+};
+
+static std::vector<CLatencyHistogram> messagePerfHistograms(perfMessageTypes.size());
+
+CLatencyHistogram &GetMessagePerfHistogram(const std::string &strCommand)
+{
+    for (int i = 0; i < perfMessageTypes.size() - 1; i++)
+    {
+        if (perfMessageTypes[i] == strCommand)
+        {
+            return messagePerfHistograms[i];
+        }
+    }
+    return messagePerfHistograms[perfMessageTypes.size() - 1];
+}
+
+const std::vector<std::string> &GetPerfMessageTypes()
+{
+    return perfMessageTypes;
+}
+
+static void HistogramToPrometheus(std::string &out, const std::string &name, const std::string &labels, const CLatencyHistogram &histogram)
+{
+    std::vector<uint64_t> buckets = histogram.GetBuckets();
+    uint64_t nCumulative = 0;
+    for (int i = 0; i < CLatencyHistogram::BUCKETS - 1; i++)
+    {
+        nCumulative += buckets[i];
+        out += strprintf("%s_bucket{%s,le=\"%.6f\"} %u\n", name, labels, CLatencyHistogram::BucketLimit(i) * 0.000001, nCumulative);
+    }
+    // the count is read last, so it may include latencies added after the buckets were read
+    uint64_t nCount = std::max(nCumulative + buckets.back(), histogram.Count());
+    out += strprintf("%s_bucket{%s,le=\"+Inf\"} %u\n", name, labels, nCount);
+    out += strprintf("%s_sum{%s} %.6f\n", name, labels, histogram.TotalMicros() * 0.000001);
+    out += strprintf("%s_count{%s} %u\n", name, labels, nCount);
+}
+
+std::string GetPerfStatsPrometheus()
+{
+    std::string out;
+    out += "# HELP verus_latency_seconds Time taken by node operations.\n";
+    out += "# TYPE verus_latency_seconds histogram\n";
+    for (int i = 0; i < PERF_STAT_COUNT; i++)
+    {
+        HistogramToPrometheus(out, "verus_latency_seconds", strprintf("operation=\"%s\"", perfStatNames[i]), perfHistograms[i]);
+    }
+    out += "# HELP verus_message_latency_seconds Time taken to process P2P messages by command.\n";
+    out += "# TYPE verus_message_latency_seconds histogram\n";
+    for (int i = 0; i < perfMessageTypes.size(); i++)
+    {
+        HistogramToPrometheus(out, "verus_message_latency_seconds", strprintf("command=\"%s\"", perfMessageTypes[i]), messagePerfHistograms[i]);
+    }
+    return out;
+}
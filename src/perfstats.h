@@ -0,0 +1,87 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef VERUS_PERFSTATS_H
+#define VERUS_PERFSTATS_H
+
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/** Latency histogram of one operation, which any number of threads can add to without locking */
+class CLatencyHistogram
+{
+public:
+    //! bucket 0 holds latencies under 1 microsecond and bucket i those under 2^i microseconds, the last everything longer
+    static const int BUCKETS = 32;
+
+    CLatencyHistogram();
+
+    void Add(int64_t nMicros);
+
+    uint64_t Count() const { return nCount.load(std::memory_order_relaxed); }
+    uint64_t TotalMicros() const { return nTotalMicros.load(std::memory_order_relaxed); }
+    std::vector<uint64_t> GetBuckets() const;
+
+    //! Upper bound of bucket i in microseconds, the last bucket having none
+    static int64_t BucketLimit(int i) { return (int64_t)1 << i; }
+
+    //! Upper bound in microseconds of the bucket holding the nth of count latencies in order
+    static int64_t Percentile(const std::vector<uint64_t> &buckets, uint64_t count, double fraction);
+
+private:
+    std::atomic<uint64_t> buckets[BUCKETS];
+    std::atomic<uint64_t> nCount;
+    std::atomic<uint64_t> nTotalMicros;
+};
+
+enum PerfStat
+{
+    PERF_CONNECTBLOCK,              // all of ConnectBlock
+    PERF_CONNECTBLOCK_PROOFS,       // the CheckBlock that verifies JoinSplit and Sapling proofs
+    PERF_CONNECTBLOCK_INPUTS,       // fetching the coins and shielded anchors and nullifiers spent
+    PERF_CONNECTBLOCK_SCRIPTS,      // input checks and waiting for the script check threads
+    PERF_CONNECTBLOCK_UNDO,         // writing undo data
+    PERF_CONNECTTIP_FLUSH,          // flushing the block's coins to the tip cache and the chainstate if needed
+    PERF_ACCEPTTOMEMPOOL,
+    PERF_CREATENEWBLOCK,
+    PERF_LOOKUPIDENTITY,
+    PERF_DB_READ,
+    PERF_DB_WRITE,
+    PERF_STAT_COUNT
+};
+
+CLatencyHistogram &GetPerfHistogram(PerfStat stat);
+const char *GetPerfStatName(PerfStat stat);
+
+/** Histogram of the time taken to process one P2P message type, with all unknown types sharing one */
+CLatencyHistogram &GetMessagePerfHistogram(const std::string &strCommand);
+/** The message types with their own histograms, followed by the shared one for all others */
+const std::vector<std::string> &GetPerfMessageTypes();
+
+/** Monotonic time for measuring latency, which unlike GetTimeMicros does not jump with the clock */
+inline int64_t GetPerfTimeMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/** Adds the time from its construction to its destruction to a histogram */
+class CPerfTimer
+{
+public:
+    CPerfTimer(CLatencyHistogram &histogramIn) : histogram(histogramIn), nStart(GetPerfTimeMicros()) {}
+    CPerfTimer(PerfStat stat) : histogram(GetPerfHistogram(stat)), nStart(GetPerfTimeMicros()) {}
+    ~CPerfTimer() { histogram.Add(GetPerfTimeMicros() - nStart); }
+
+private:
+    CLatencyHistogram &histogram;
+    int64_t nStart;
+};
+
+/** All histograms in the Prometheus text exposition format */
+std::string GetPerfStatsPrometheus();
+
+#endif // VERUS_PERFSTATS_H
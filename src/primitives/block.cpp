@@ -484,6 +484,10 @@ CDefaultMMRNode CBlock::GetMMRNode(int index) const
     {
         return CDefaultMMRNode(uint256());
     }
+    if (vMMRNodes.size() == vtx.size())
+    {
+        return vMMRNodes[index];
+    }
     return vtx[index].GetDefaultMMRNode();
 }
 
@@ -499,18 +503,35 @@ BlockMMRange CBlock::BuildBlockMMRTree() const
     // for now, we will duplicate the merkle tree and enable proof of an element within a transaction using the MMR.
     // at some point, we should replace the txid with a fully hashed transaction tree and deprecate standard
     // txids altogether.
-    BlockMMRange mmRange(BlockMMRNodeLayer(*this));
+    // each transaction's MMR root is only computed here, the overlay layer and later trees read it from vMMRNodes
+    vMMRNodes.clear();
+    vMMRNodes.reserve(vtx.size());
     for (auto &tx : vtx)
     {
-        mmRange.Add(tx.GetDefaultMMRNode());
+        vMMRNodes.push_back(tx.GetDefaultMMRNode());
+    }
+    BlockMMRange mmRange(BlockMMRNodeLayer(*this));
+    for (auto &node : vMMRNodes)
+    {
+        mmRange.Add(node);
     }
     return mmRange;
 }
 
 BlockMMRange CBlock::GetBlockMMRTree() const
 {
-    // no caching yet, the anticipation of which is why this is separate from build
-    return BuildBlockMMRTree();
+    // after the first build, only the upper layers are hashed again. trees that must outlive the block
+    // or avoid reading it at all come from the block MMR cache in blockmmrcache.h
+    if (vMMRNodes.size() != vtx.size())
+    {
+        return BuildBlockMMRTree();
+    }
+    BlockMMRange mmRange(BlockMMRNodeLayer(*this));
+    for (auto &node : vMMRNodes)
+    {
+        mmRange.Add(node);
+    }
+    return mmRange;
 }
 
 CPartialTransactionProof CBlock::GetPartialTransactionProof(const CTransaction &tx, int txIndex, const std::vector<std::pair<int16_t, int16_t>> &partIndexes) const
@@ -403,6 +403,10 @@ typedef COverlayNodeLayer<CDefaultMMRNode, CBlock> BlockMMRNodeLayer;
 typedef CMerkleMountainRange<CDefaultMMRNode, CChunkedLayer<CDefaultMMRNode, 2>, BlockMMRNodeLayer> BlockMMRange;
 typedef CMerkleMountainView<CDefaultMMRNode, CChunkedLayer<CDefaultMMRNode, 2>, BlockMMRNodeLayer> BlockMMView;
 
+// the same block MMR holding copies of its transaction MMR roots, so it can outlive the block
+typedef CMerkleMountainRange<CDefaultMMRNode, CChunkedLayer<CDefaultMMRNode, 2>> BlockTxRootMMRange;
+typedef CMerkleMountainView<CDefaultMMRNode, CChunkedLayer<CDefaultMMRNode, 2>> BlockTxRootMMView;
+
 class CBlock : public CBlockHeader
 {
 public:
@@ -411,6 +415,8 @@ public:
 
     // memory only
     mutable std::vector<uint256> vMerkleTree;
+    // transaction MMR roots, only valid for the transactions they were built from, so cleared wherever vtx changes
+    mutable std::vector<CDefaultMMRNode> vMMRNodes;
 
     CBlock()
     {
@@ -429,6 +435,10 @@ public:
     inline void SerializationOp(Stream& s, Operation ser_action) {
         READWRITE(*(CBlockHeader*)this);
         READWRITE(vtx);
+        if (ser_action.ForRead())
+        {
+            vMMRNodes.clear();
+        }
     }
 
     void SetNull()
@@ -436,6 +446,7 @@ public:
         CBlockHeader::SetNull();
         vtx.clear();
         vMerkleTree.clear();
+        vMMRNodes.clear();
     }
 
     CBlockHeader GetBlockHeader() const
@@ -1259,7 +1259,8 @@ public:
                              const std::vector<int32_t> &inputNums,
                              const std::vector<int32_t> &outputNums,
                              const CBlockIndex *pIndex,
-                             uint32_t proofAtHeight);
+                             uint32_t proofAtHeight,
+                             const CMMRProof *pBlockProof=NULL);
 
     // This creates a proof for older blocks and full transactions, typically where the root proof is a standard
     // merkle proof
@@ -1326,6 +1327,18 @@ public:
 
     bool IsValid() const
     {
+        // multi branches are not part of consensus, nodes that predate them cannot read such a proof at all
+        if (txProof.HasMultiBranch())
+        {
+            return false;
+        }
+        for (auto &oneComponent : components)
+        {
+            if (oneComponent.elProof.HasMultiBranch())
+            {
+                return false;
+            }
+        }
         return version >= VERSION_FIRST && version <= VERSION_LAST && type != TYPE_INVALID && type <= TYPE_LAST;
     }
 
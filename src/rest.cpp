@@ -3,14 +3,23 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or https://www.opensource.org/licenses/mit-license.php .
 
+#include "base58.h"
 #include "chainparams.h"
+#include "compactsapling.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "main.h"
+#include "hash.h"
 #include "httpserver.h"
+#include "key_io.h"
+#include "pbaas/identity.h"
+#include "pbaas/pbaas.h"
+#include "perfstats.h"
+#include "rpc/pbaasrpc.h"
 #include "rpc/server.h"
 #include "streams.h"
 #include "sync.h"
+#include "txdb.h"
 #include "txmempool.h"
 #include "utilstrencodings.h"
 #include "version.h"
@@ -23,6 +32,7 @@
 using namespace std;
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+static const size_t MAX_REST_ADDRESS_ENTRIES = 10000; //entries in one address utxos or deltas reply
 
 enum RetFormat {
     RF_UNDEF,
@@ -591,6 +601,485 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
     return true; // continue to process further HTTP reqs on this cxn
 }
 
+static bool rest_compactsapling(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    vector<string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+    vector<string> path;
+    boost::split(path, params[0], boost::is_any_of("/"));
+
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "No block count specified. Use /rest/compactsapling/<count>/<hash>.<ext>.");
+
+    long count = strtol(path[0].c_str(), NULL, 10);
+    if (count < 1 || count > MAX_COMPACT_SAPLING_BLOCKS)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Block count out of range: " + path[0]);
+
+    string hashStr = path[1];
+    uint256 hash;
+    if (!ParseHashStr(hashStr, hash))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
+
+    std::vector<const CBlockIndex *> vIndex;
+    vIndex.reserve(count);
+    {
+        LOCK(cs_main);
+        BlockMap::const_iterator it = mapBlockIndex.find(hash);
+        const CBlockIndex *pindex = (it != mapBlockIndex.end()) ? it->second : NULL;
+        if (pindex == NULL || !chainActive.Contains(pindex))
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        while (pindex != NULL) {
+            vIndex.push_back(pindex);
+            if (vIndex.size() == (unsigned long)count)
+                break;
+            pindex = chainActive.Next(pindex);
+        }
+    }
+
+    // blocks are written back to back so scanners can read them as one sequential stream
+    CDataStream ssBlocks(SER_NETWORK, PROTOCOL_VERSION);
+    UniValue jsonBlocks(UniValue::VARR);
+    BOOST_FOREACH(const CBlockIndex *pindex, vIndex) {
+        CCompactSaplingBlock block;
+        if (!GetCompactSaplingBlock(pindex, block))
+            return RESTERR(req, HTTP_NOT_FOUND, pindex->GetBlockHash().GetHex() + " not available (pruned data)");
+        if (rf == RF_JSON)
+            jsonBlocks.push_back(block.ToUniValue());
+        else
+            ssBlocks << block;
+    }
+
+    switch (rf) {
+    case RF_BINARY: {
+        string binaryBlocks = ssBlocks.str();
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, binaryBlocks);
+        return true;
+    }
+
+    case RF_HEX: {
+        string strHex = HexStr(ssBlocks.begin(), ssBlocks.end()) + "\n";
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, strHex);
+        return true;
+    }
+
+    case RF_JSON: {
+        string strJSON = jsonBlocks.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
+// Serialized forms of identities, currencies and address index entries, with an entity tag that lets clients ask
+// again with If-None-Match and get 304 Not Modified instead of a body they already have.
+
+// A bit of a hack - dependency on a function defined in rpc/pbaasrpc.cpp
+uint160 ValidateCurrencyName(std::string currencyStr, bool ensureCurrencyValid, CCurrencyDefinition *pCurrencyDef);
+
+// identity and currency names may themselves contain dots, so only a known format after the last one is taken as the extension
+static enum RetFormat ParseNameDataFormat(string& name, const string& strReq)
+{
+    size_t pos = strReq.rfind('.');
+    if (pos != string::npos) {
+        string ext = strReq.substr(pos + 1);
+        for (unsigned int i = 0; i < ARRAYLEN(rf_names); i++)
+            if (strlen(rf_names[i].name) > 0 && ext == rf_names[i].name) {
+                name = strReq.substr(0, pos);
+                return rf_names[i].rf;
+            }
+    }
+    name = strReq;
+    return rf_names[0].rf;
+}
+
+static bool ParseIndexAddress(const string& strAddress, uint160& hashBytes, int& type)
+{
+    CBitcoinAddress address(strAddress);
+    return address.GetIndexKey(hashBytes, type);
+}
+
+static string ETagHeader(const uint256& etag)
+{
+    return "\"" + etag.GetHex() + "\"";
+}
+
+// returns true, having replied, if the client's copy already carries the entity tag; only successful replies carry it
+static bool RESTNotModified(HTTPRequest* req, const uint256& etag)
+{
+    string strETag = ETagHeader(etag);
+    std::pair<bool, std::string> ifNoneMatch = req->GetHeader("If-None-Match");
+    if (ifNoneMatch.first && (ifNoneMatch.second == "*" || ifNoneMatch.second.find(strETag) != string::npos)) {
+        req->WriteHeader("ETag", strETag);
+        req->WriteReply(HTTP_NOT_MODIFIED);
+        return true;
+    }
+    return false;
+}
+
+// the tag of a reply that is only known once it is made, which changes exactly when its serialized form does
+static uint256 ContentETag(enum RetFormat rf, const CDataStream& ss)
+{
+    CHashWriter hw(SER_GETHASH, PROTOCOL_VERSION);
+    hw << (int32_t)rf;
+    hw.write(&ss[0], ss.size());
+    return hw.GetHash();
+}
+
+// the tag of a reply that depends only on the request and the block it is read at, so it can be checked before any lookup
+static uint256 BlockETag(enum RetFormat rf, const string& strURIPart, const uint256& hashBlock)
+{
+    CHashWriter hw(SER_GETHASH, PROTOCOL_VERSION);
+    hw << (int32_t)rf << strURIPart << hashBlock;
+    return hw.GetHash();
+}
+
+static bool RESTWriteData(HTTPRequest* req, enum RetFormat rf, const CDataStream& ss, const UniValue& json, const uint256& etag)
+{
+    switch (rf) {
+    case RF_BINARY: {
+        req->WriteHeader("ETag", ETagHeader(etag));
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, ss.str());
+        return true;
+    }
+
+    case RF_HEX: {
+        string strHex = HexStr(ss.begin(), ss.end()) + "\n";
+        req->WriteHeader("ETag", ETagHeader(etag));
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, strHex);
+        return true;
+    }
+
+    case RF_JSON: {
+        string strJSON;
+        json.write(strJSON);
+        strJSON += "\n";
+        req->WriteHeader("ETag", ETagHeader(etag));
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
+// binary form: the identity, the height of the block that confirmed it and the output that holds it
+static bool rest_identity(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    string strName;
+    const RetFormat rf = ParseNameDataFormat(strName, strURIPart);
+    if (rf == RF_UNDEF)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+
+    CTxDestination idDest = DecodeDestination(strName);
+    if (idDest.which() != COptCCParams::ADDRTYPE_ID)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid identity: " + strName);
+
+    CIdentity identity;
+    uint32_t nHeight = 0;
+    CTxIn idTxIn;
+    {
+        LOCK(cs_main);
+        if (!chainActive.LastTip() ||
+            CConstVerusSolutionVector::activationHeight.ActiveVersion(chainActive.LastTip()->GetHeight()) < CActivationHeight::ACTIVATE_IDENTITY)
+            return RESTERR(req, HTTP_NOT_FOUND, "Identity APIs not activated on blockchain");
+        identity = CIdentity::LookupIdentity(CIdentityID(GetDestinationID(idDest)), 0, &nHeight, &idTxIn);
+    }
+    if (!identity.IsValid())
+        return RESTERR(req, HTTP_NOT_FOUND, strName + " not found");
+
+    CDataStream ssIdentity(SER_NETWORK, PROTOCOL_VERSION);
+    ssIdentity << identity << nHeight << idTxIn.prevout;
+    uint256 etag = ContentETag(rf, ssIdentity);
+    if (RESTNotModified(req, etag))
+        return true;
+
+    UniValue objIdentity(UniValue::VOBJ);
+    if (rf == RF_JSON) {
+        objIdentity.push_back(Pair("identity", identity.ToUniValue()));
+        objIdentity.push_back(Pair("status", identity.IsRevoked() ? "revoked" : "active"));
+        objIdentity.push_back(Pair("blockheight", (int64_t)nHeight));
+        objIdentity.push_back(Pair("txid", idTxIn.prevout.hash.GetHex()));
+        objIdentity.push_back(Pair("vout", (int32_t)idTxIn.prevout.n));
+    }
+    return RESTWriteData(req, rf, ssIdentity, objIdentity, etag);
+}
+
+// binary form: the currency definition, the height it was defined at and the output that holds it
+static bool rest_currency(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    string strName;
+    const RetFormat rf = ParseNameDataFormat(strName, strURIPart);
+    if (rf == RF_UNDEF)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+
+    CCurrencyDefinition currencyDef;
+    int32_t nDefHeight = 0;
+    CUTXORef defUTXO;
+    {
+        LOCK2(cs_main, mempool.cs);
+        uint160 currencyID = ValidateCurrencyName(strName, true, &currencyDef);
+        if (currencyID.IsNull())
+            return RESTERR(req, HTTP_NOT_FOUND, strName + " not found");
+        if (!GetCurrencyDefinition(currencyID, currencyDef, &nDefHeight, false, &defUTXO))
+            return RESTERR(req, HTTP_NOT_FOUND, strName + " not found");
+    }
+
+    CDataStream ssCurrency(SER_NETWORK, PROTOCOL_VERSION);
+    ssCurrency << currencyDef << nDefHeight << defUTXO;
+    uint256 etag = ContentETag(rf, ssCurrency);
+    if (RESTNotModified(req, etag))
+        return true;
+
+    UniValue objCurrency;
+    if (rf == RF_JSON) {
+        objCurrency = currencyDef.ToUniValue();
+        objCurrency.push_back(Pair("definitionheight", nDefHeight));
+        if (defUTXO.IsValid()) {
+            objCurrency.push_back(Pair("definitiontxid", defUTXO.hash.GetHex()));
+            objCurrency.push_back(Pair("definitiontxout", (int)defUTXO.n));
+        }
+    }
+    return RESTWriteData(req, rf, ssCurrency, objCurrency, etag);
+}
+
+// /rest/currencystate/<currency> for the state after the tip, or /rest/currencystate/<height>/<currency> for the state
+// at a past height; binary form: the height and the currency state
+static bool rest_currencystate(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    string strName;
+    const RetFormat rf = ParseNameDataFormat(strName, strURIPart);
+    if (rf == RF_UNDEF)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+
+    int32_t nHeight = -1;
+    size_t pos = strName.find('/');
+    if (pos != string::npos) {
+        if (!ParseInt32(strName.substr(0, pos), &nHeight) || nHeight < 0)
+            return RESTERR(req, HTTP_BAD_REQUEST, "Invalid height: " + strName.substr(0, pos));
+        strName = strName.substr(pos + 1);
+    }
+
+    CCoinbaseCurrencyState currencyState;
+    {
+        LOCK2(cs_main, mempool.cs);
+        if (nHeight > chainActive.Height())
+            return RESTERR(req, HTTP_NOT_FOUND, strprintf("Height %d is beyond the tip", nHeight));
+        if (nHeight < 0)
+            nHeight = chainActive.Height() + 1;
+
+        CCurrencyDefinition currencyDef;
+        int32_t nDefHeight = 0;
+        uint160 currencyID = ValidateCurrencyName(strName, true, &currencyDef);
+        if (currencyID.IsNull() || !GetCurrencyDefinition(currencyID, currencyDef, &nDefHeight))
+            return RESTERR(req, HTTP_NOT_FOUND, strName + " not found");
+        currencyState = ConnectedChains.GetCurrencyState(currencyDef, nHeight, nDefHeight);
+    }
+    if (!currencyState.IsValid())
+        return RESTERR(req, HTTP_NOT_FOUND, strprintf("No state of %s at height %d", strName, nHeight));
+
+    CDataStream ssState(SER_NETWORK, PROTOCOL_VERSION);
+    ssState << nHeight << currencyState;
+    uint256 etag = ContentETag(rf, ssState);
+    if (RESTNotModified(req, etag))
+        return true;
+
+    UniValue objState(UniValue::VOBJ);
+    if (rf == RF_JSON) {
+        objState.push_back(Pair("height", nHeight));
+        objState.push_back(Pair("currencystate", currencyState.ToUniValue()));
+    }
+    return RESTWriteData(req, rf, ssState, objState, etag);
+}
+
+// Cut entries sorted by height to at most MAX_REST_ADDRESS_ENTRIES, keeping whole heights. Returns the height to continue
+// from, 0 if nothing was cut, or -1 if the first height alone has too many entries.
+template <typename Entry, typename GetHeight>
+static int TruncateAddressEntries(std::vector<Entry>& entries, GetHeight getHeight)
+{
+    if (entries.size() <= MAX_REST_ADDRESS_ENTRIES)
+        return 0;
+    int nNextHeight = getHeight(entries[MAX_REST_ADDRESS_ENTRIES]);
+    size_t nEntries = MAX_REST_ADDRESS_ENTRIES;
+    while (nEntries > 0 && getHeight(entries[nEntries - 1]) == nNextHeight)
+        nEntries--;
+    if (nEntries == 0)
+        return -1;
+    entries.resize(nEntries);
+    return nNextHeight;
+}
+
+// address index replies are read from the index snapshot of one block, and their binary forms start with its height and
+// hash as getutxos does. Utxos and deltas follow with the height to continue from, 0 if the reply is complete, and the
+// entries as the address index stores them, the balance with itself and the total received, so their tag is known before
+// the index is read. Utxos and deltas may be limited to /<start>/<end>/ heights, as getaddressdeltas takes them.
+static bool rest_address(HTTPRequest* req, const std::string& strURIPart, bool fUnspent, bool fBalance)
+{
+    if (!CheckWarmup(req))
+        return false;
+    string strAddress;
+    const RetFormat rf = ParseNameDataFormat(strAddress, strURIPart);
+    if (rf == RF_UNDEF)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+
+    int32_t nStart = 0, nEnd = 0;
+    vector<string> path;
+    boost::split(path, strAddress, boost::is_any_of("/"));
+    if (path.size() == 3 && !fBalance) {
+        if (!ParseInt32(path[0], &nStart) || !ParseInt32(path[1], &nEnd) || nStart <= 0 || nEnd < nStart)
+            return RESTERR(req, HTTP_BAD_REQUEST, "Invalid height range: " + path[0] + "/" + path[1]);
+        strAddress = path[2];
+    } else if (path.size() != 1) {
+        return RESTERR(req, HTTP_BAD_REQUEST, fBalance ? "Use /rest/address/balance/<address>.<ext>" :
+                       "Use /rest/address/<utxos|deltas>/[<start>/<end>/]<address>.<ext>");
+    }
+
+    uint160 hashBytes;
+    int type = 0;
+    if (!ParseIndexAddress(strAddress, hashBytes, type))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid address: " + strAddress);
+
+    std::shared_ptr<const CBlockTreeSnapshot> pindexSnapshot = GetBlockTreeSnapshot();
+    if (!pindexSnapshot)
+        return RESTERR(req, HTTP_SERVICE_UNAVAILABLE, "Address index not available");
+    uint256 etag = BlockETag(rf, strURIPart, pindexSnapshot->hashBlock);
+    if (RESTNotModified(req, etag))
+        return true;
+
+    CDataStream ssAddress(SER_NETWORK, PROTOCOL_VERSION);
+    ssAddress << pindexSnapshot->nHeight << pindexSnapshot->hashBlock;
+    UniValue objAddress(UniValue::VOBJ);
+
+    if (fUnspent) {
+        // the unspent index is not ordered by height, so all of it is read
+        std::vector<CAddressUnspentDbEntry> unspentOutputs;
+        if (!GetAddressUnspent(hashBytes, type, unspentOutputs, &pindexSnapshot->snapshot))
+            return RESTERR(req, HTTP_NOT_FOUND, "No information available for " + strAddress);
+        if (nEnd > 0) {
+            unspentOutputs.erase(std::remove_if(unspentOutputs.begin(), unspentOutputs.end(),
+                                                [nStart, nEnd](const CAddressUnspentDbEntry& entry) {
+                                                    return entry.second.blockHeight < nStart || entry.second.blockHeight > nEnd;
+                                                }),
+                                 unspentOutputs.end());
+        }
+        std::sort(unspentOutputs.begin(), unspentOutputs.end(),
+                  [](const CAddressUnspentDbEntry& a, const CAddressUnspentDbEntry& b) { return a.second.blockHeight < b.second.blockHeight; });
+        int nNextHeight = TruncateAddressEntries(unspentOutputs, [](const CAddressUnspentDbEntry& entry) { return entry.second.blockHeight; });
+        if (nNextHeight < 0)
+            return RESTERR(req, HTTP_REQUEST_ENTITY_TOO_LARGE, strprintf("More than %u utxos at one height", MAX_REST_ADDRESS_ENTRIES));
+        ssAddress << nNextHeight << unspentOutputs;
+
+        if (rf == RF_JSON) {
+            UniValue utxos(UniValue::VARR);
+            utxos.reserve(unspentOutputs.size());
+            BOOST_FOREACH(const CAddressUnspentDbEntry& entry, unspentOutputs) {
+                UniValue utxo(UniValue::VOBJ);
+                utxo.push_back(Pair("txid", entry.first.txhash.GetHex()));
+                utxo.push_back(Pair("outputIndex", (int)entry.first.index));
+                utxo.push_back(Pair("script", HexStr(entry.second.script.begin(), entry.second.script.end())));
+                utxo.push_back(Pair("satoshis", entry.second.satoshis));
+                utxo.push_back(Pair("height", entry.second.blockHeight));
+                utxos.push_back(std::move(utxo));
+            }
+            objAddress.push_back(Pair("utxos", std::move(utxos)));
+            objAddress.push_back(Pair("next", nNextHeight));
+        }
+    } else {
+        // the balance needs every entry, but only deltas are returned
+        std::vector<CAddressIndexDbEntry> addressIndex;
+        if (!GetAddressIndex(hashBytes, type, addressIndex, nStart, nEnd, &pindexSnapshot->snapshot, fBalance ? 0 : MAX_REST_ADDRESS_ENTRIES))
+            return RESTERR(req, HTTP_NOT_FOUND, "No information available for " + strAddress);
+
+        if (fBalance) {
+            CAmount balance = 0, received = 0;
+            BOOST_FOREACH(const CAddressIndexDbEntry& entry, addressIndex) {
+                if (entry.second > 0)
+                    received += entry.second;
+                balance += entry.second;
+            }
+            ssAddress << balance << received;
+            if (rf == RF_JSON) {
+                objAddress.push_back(Pair("balance", balance));
+                objAddress.push_back(Pair("received", received));
+            }
+        } else {
+            int nNextHeight = TruncateAddressEntries(addressIndex, [](const CAddressIndexDbEntry& entry) { return entry.first.blockHeight; });
+            if (nNextHeight < 0)
+                return RESTERR(req, HTTP_REQUEST_ENTITY_TOO_LARGE, strprintf("More than %u deltas at one height", MAX_REST_ADDRESS_ENTRIES));
+            ssAddress << nNextHeight << addressIndex;
+            if (rf == RF_JSON) {
+                UniValue deltas(UniValue::VARR);
+                deltas.reserve(addressIndex.size());
+                BOOST_FOREACH(const CAddressIndexDbEntry& entry, addressIndex) {
+                    UniValue delta(UniValue::VOBJ);
+                    delta.push_back(Pair("satoshis", entry.second));
+                    delta.push_back(Pair("txid", entry.first.txhash.GetHex()));
+                    delta.push_back(Pair("index", (int)entry.first.index));
+                    delta.push_back(Pair("blockindex", (int)entry.first.txindex));
+                    delta.push_back(Pair("height", entry.first.blockHeight));
+                    deltas.push_back(std::move(delta));
+                }
+                objAddress.push_back(Pair("deltas", std::move(deltas)));
+                objAddress.push_back(Pair("next", nNextHeight));
+            }
+        }
+    }
+
+    if (rf == RF_JSON) {
+        objAddress.push_back(Pair("address", strAddress));
+        objAddress.push_back(Pair("height", pindexSnapshot->nHeight));
+        objAddress.push_back(Pair("hash", pindexSnapshot->hashBlock.GetHex()));
+    }
+    return RESTWriteData(req, rf, ssAddress, objAddress, etag);
+}
+
+static bool rest_address_utxos(HTTPRequest* req, const std::string& strURIPart)
+{
+    return rest_address(req, strURIPart, true, false);
+}
+
+static bool rest_address_deltas(HTTPRequest* req, const std::string& strURIPart)
+{
+    return rest_address(req, strURIPart, false, false);
+}
+
+static bool rest_address_balance(HTTPRequest* req, const std::string& strURIPart)
+{
+    return rest_address(req, strURIPart, false, true);
+}
+
+// latency histograms in the Prometheus text format, which needs no warmup as they only count what has run
+static bool rest_metrics(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!strURIPart.empty())
+        return RESTERR(req, HTTP_NOT_FOUND, "not found");
+    req->WriteHeader("Content-Type", "text/plain; version=0.0.4");
+    req->WriteReply(HTTP_OK, GetPerfStatsPrometheus());
+    return true;
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(HTTPRequest* req, const std::string& strReq);
@@ -602,7 +1091,15 @@ static const struct {
       {"/rest/mempool/info", rest_mempool_info},
       {"/rest/mempool/contents", rest_mempool_contents},
       {"/rest/headers/", rest_headers},
+      {"/rest/compactsapling/", rest_compactsapling},
       {"/rest/getutxos", rest_getutxos},
+      {"/rest/identity/", rest_identity},
+      {"/rest/currency/", rest_currency},
+      {"/rest/currencystate/", rest_currencystate},
+      {"/rest/address/utxos/", rest_address_utxos},
+      {"/rest/address/deltas/", rest_address_deltas},
+      {"/rest/address/balance/", rest_address_balance},
+      {"/rest/metrics", rest_metrics},
 };
 
 bool StartREST()
@@ -6,7 +6,9 @@
 #include "amount.h"
 #include "chain.h"
 #include "chainparams.h"
+#include "chainsnapshot.h"
 #include "checkpoints.h"
+#include "compactsapling.h"
 #include "crosschain.h"
 #include "base58.h"
 #include "consensus/validation.h"
@@ -14,6 +16,7 @@
 #include "key_io.h"
 #include "main.h"
 #include "primitives/transaction.h"
+#include "rpc/jsonstream.h"
 #include "rpc/server.h"
 #include "streams.h"
 #include "sync.h"
@@ -321,18 +324,19 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     result.push_back(Pair("segid", (int64_t)blockindex->segid));
     result.push_back(Pair("finalsaplingroot", block.hashFinalSaplingRoot.GetHex()));
     UniValue txs(UniValue::VARR);
+    txs.reserve(block.vtx.size());
     BOOST_FOREACH(const CTransaction&tx, block.vtx)
     {
         if(txDetails)
         {
             UniValue objTx(UniValue::VOBJ);
             TxToJSON(tx, uint256(), objTx);
-            txs.push_back(objTx);
+            txs.push_back(std::move(objTx));
         }
         else
             txs.push_back(tx.GetHash().GetHex());
     }
-    result.push_back(Pair("tx", txs));
+    result.push_back(Pair("tx", std::move(txs)));
     result.push_back(Pair("time", block.GetBlockTime()));
     result.push_back(Pair("nonce", block.nNonce.GetHex()));
     result.push_back(Pair("solution", HexStr(block.nSolution)));
@@ -426,38 +430,72 @@ bool myIsutxo_spentinmempool(uint256 txid,int32_t vout)
     return(false);
 }
 
+/** What getrawmempool reports about a transaction, copied out so it can be formatted without mempool.cs */
+struct CMempoolEntryInfo
+{
+    uint256 hash;
+    unsigned int nSize;
+    CAmount nFee;
+    int64_t nTime;
+    unsigned int nHeight;
+    double dStartingPriority;
+    double dCurrentPriority;
+    std::set<std::string> setDepends;
+};
+
+static std::vector<CMempoolEntryInfo> GetMempoolEntryInfos()
+{
+    LOCK(mempool.cs);
+    std::vector<CMempoolEntryInfo> vInfo;
+    vInfo.reserve(mempool.mapTx.size());
+    BOOST_FOREACH(const CTxMemPoolEntry& e, mempool.mapTx)
+    {
+        CMempoolEntryInfo info;
+        info.hash = e.GetTx().GetHash();
+        info.nSize = e.GetTxSize();
+        info.nFee = e.GetFee();
+        info.nTime = e.GetTime();
+        info.nHeight = e.GetHeight();
+        info.dStartingPriority = e.GetPriority(e.GetHeight());
+        info.dCurrentPriority = e.GetPriority(chainActive.Height());
+        BOOST_FOREACH(const CTxIn& txin, e.GetTx().vin)
+        {
+            if (mempool.exists(txin.prevout.hash))
+                info.setDepends.insert(txin.prevout.hash.ToString());
+        }
+        vInfo.push_back(info);
+    }
+    return vInfo;
+}
+
+static UniValue MempoolEntryInfoToJSON(const CMempoolEntryInfo& e)
+{
+    UniValue info(UniValue::VOBJ);
+    info.push_back(Pair("size", (int)e.nSize));
+    info.push_back(Pair("fee", ValueFromAmount(e.nFee)));
+    info.push_back(Pair("time", e.nTime));
+    info.push_back(Pair("height", (int)e.nHeight));
+    info.push_back(Pair("startingpriority", e.dStartingPriority));
+    info.push_back(Pair("currentpriority", e.dCurrentPriority));
+
+    UniValue depends(UniValue::VARR);
+    BOOST_FOREACH(const string& dep, e.setDepends)
+    {
+        depends.push_back(dep);
+    }
+
+    info.push_back(Pair("depends", depends));
+    return info;
+}
+
 UniValue mempoolToJSON(bool fVerbose = false)
 {
     if (fVerbose)
     {
-        LOCK(mempool.cs);
         UniValue o(UniValue::VOBJ);
-        BOOST_FOREACH(const CTxMemPoolEntry& e, mempool.mapTx)
+        BOOST_FOREACH(const CMempoolEntryInfo& e, GetMempoolEntryInfos())
         {
-            const uint256& hash = e.GetTx().GetHash();
-            UniValue info(UniValue::VOBJ);
-            info.push_back(Pair("size", (int)e.GetTxSize()));
-            info.push_back(Pair("fee", ValueFromAmount(e.GetFee())));
-            info.push_back(Pair("time", e.GetTime()));
-            info.push_back(Pair("height", (int)e.GetHeight()));
-            info.push_back(Pair("startingpriority", e.GetPriority(e.GetHeight())));
-            info.push_back(Pair("currentpriority", e.GetPriority(chainActive.Height())));
-            const CTransaction& tx = e.GetTx();
-            set<string> setDepends;
-            BOOST_FOREACH(const CTxIn& txin, tx.vin)
-            {
-                if (mempool.exists(txin.prevout.hash))
-                    setDepends.insert(txin.prevout.hash.ToString());
-            }
-
-            UniValue depends(UniValue::VARR);
-            BOOST_FOREACH(const string& dep, setDepends)
-            {
-                depends.push_back(dep);
-            }
-
-            info.push_back(Pair("depends", depends));
-            o.push_back(Pair(hash.ToString(), info));
+            o.push_back(Pair(e.hash.ToString(), MempoolEntryInfoToJSON(e)));
         }
         return o;
     }
@@ -506,12 +544,30 @@ UniValue getrawmempool(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getrawmempool", "true")
         );
 
-    LOCK(cs_main);
-
     bool fVerbose = false;
     if (params.size() > 0)
         fVerbose = params[0].get_bool();
 
+    CJSONStreamWriter* pwriter = fVerbose ? ClaimRPCResultStream("getrawmempool") : NULL;
+    if (pwriter)
+    {
+        // a verbose mempool can be far larger than the entries it is made from, so only those
+        // are copied under the locks and each is formatted as it is sent
+        std::vector<CMempoolEntryInfo> vInfo;
+        {
+            LOCK(cs_main);
+            vInfo = GetMempoolEntryInfos();
+        }
+        pwriter->BeginObject();
+        for (size_t i = 0; i < vInfo.size() && pwriter->IsGood(); i++)
+        {
+            pwriter->Pair(vInfo[i].hash.ToString(), MempoolEntryInfoToJSON(vInfo[i]));
+        }
+        pwriter->EndObject();
+        return NullUniValue;
+    }
+
+    LOCK(cs_main);
     return mempoolToJSON(fVerbose);
 }
 
@@ -700,6 +756,84 @@ int parseHeightArg(const std::string& strHeight, int currentHeight)
     return interpretHeightArg(nHeight, currentHeight);
 }
 
+UniValue z_getcompactsaplingblocks(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 3)
+        throw runtime_error(
+            "z_getcompactsaplingblocks height ( count verbose )\n"
+            "\nReturns the Sapling nullifiers and outputs of consecutive blocks in the compact form used by light\n"
+            "wallets, with only the first " + std::to_string(COMPACT_SAPLING_CIPHERTEXT_SIZE) + " bytes of each note ciphertext. Blocks are served\n"
+            "from the compact Sapling cache when -compactsaplingcache is set.\n"
+            "\nArguments:\n"
+            "1. height       (numeric, required) The height of the first block\n"
+            "2. count        (numeric, optional, default=1) The number of blocks, at most " + std::to_string(MAX_COMPACT_SAPLING_BLOCKS) + "\n"
+            "3. verbose      (boolean, optional, default=true) true for json objects, false for hex encoded serialized blocks\n"
+            "\nResult (for verbose = true):\n"
+            "[\n"
+            "  {\n"
+            "    \"height\": n,                   (numeric) block height\n"
+            "    \"hash\": \"hash\",                (string) block hash\n"
+            "    \"previousblockhash\": \"hash\",   (string) hash of the previous block\n"
+            "    \"time\": n,                     (numeric) block time\n"
+            "    \"tx\": [                        (array) transactions with Sapling spends or outputs\n"
+            "      {\n"
+            "        \"index\": n,                (numeric) position of the transaction in the block\n"
+            "        \"txid\": \"hash\",            (string) transaction id\n"
+            "        \"nullifiers\": [\"hex\", ...], (array) nullifiers of the Sapling spends\n"
+            "        \"outputs\": [\n"
+            "          {\n"
+            "            \"cmu\": \"hex\",           (string) note commitment\n"
+            "            \"epk\": \"hex\",           (string) ephemeral public key\n"
+            "            \"ciphertext\": \"hex\"     (string) start of the note ciphertext\n"
+            "          }, ...\n"
+            "        ]\n"
+            "      }, ...\n"
+            "    ]\n"
+            "  }, ...\n"
+            "]\n"
+            "\nResult (for verbose = false):\n"
+            "[\"hex\", ...]                       (array) serialized compact blocks\n"
+            "\nExamples:\n"
+            + HelpExampleCli("z_getcompactsaplingblocks", "12800 100")
+            + HelpExampleRpc("z_getcompactsaplingblocks", "12800, 100")
+        );
+
+    int nStart = params[0].get_int();
+    int nCount = params.size() > 1 ? params[1].get_int() : 1;
+    bool fVerbose = params.size() > 2 ? params[2].get_bool() : true;
+
+    if (nCount < 1 || nCount > MAX_COMPACT_SAPLING_BLOCKS)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("count must be between 1 and %d", MAX_COMPACT_SAPLING_BLOCKS));
+
+    std::vector<const CBlockIndex*> vIndex;
+    {
+        LOCK(cs_main);
+        if (nStart < 0 || nStart > chainActive.Height())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+        for (int i = nStart; i <= chainActive.Height() && (int)vIndex.size() < nCount; i++)
+            vIndex.push_back(chainActive[i]);
+    }
+
+    UniValue ret(UniValue::VARR);
+    for (const CBlockIndex *pindex : vIndex)
+    {
+        CCompactSaplingBlock block;
+        if (!GetCompactSaplingBlock(pindex, block))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Block " + pindex->GetBlockHash().GetHex() + " not available");
+        if (fVerbose)
+        {
+            ret.push_back(block.ToUniValue());
+        }
+        else
+        {
+            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+            ss << block;
+            ret.push_back(HexStr(ss.begin(), ss.end()));
+        }
+    }
+    return ret;
+}
+
 UniValue z_gettreestate(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -1035,72 +1169,125 @@ UniValue getblock(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblock", "12800")
         );
 
-    LOCK(cs_main);
+    CBlock block;
+    CBlockIndex* pblockindex;
+    int verbosity = 1;
+    UniValue blockUni;
+    {
+        LOCK(cs_main);
 
-    std::string strHash = params[0].get_str();
+        std::string strHash = params[0].get_str();
 
-    // If height is supplied, find the hash
-    if (strHash.size() < (2 * sizeof(uint256))) {
-        // std::stoi allows characters, whereas we want to be strict
-        regex r("[[:digit:]]+");
-        if (!regex_match(strHash, r)) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
-        }
+        // If height is supplied, find the hash
+        if (strHash.size() < (2 * sizeof(uint256))) {
+            // std::stoi allows characters, whereas we want to be strict
+            regex r("[[:digit:]]+");
+            if (!regex_match(strHash, r)) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
+            }
 
-        int nHeight = -1;
-        try {
-            nHeight = std::stoi(strHash);
-        }
-        catch (const std::exception &e) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
-        }
+            int nHeight = -1;
+            try {
+                nHeight = std::stoi(strHash);
+            }
+            catch (const std::exception &e) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
+            }
 
-        if (nHeight < 0 || nHeight > chainActive.Height()) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+            if (nHeight < 0 || nHeight > chainActive.Height()) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+            }
+            strHash = chainActive[nHeight]->GetBlockHash().GetHex();
         }
-        strHash = chainActive[nHeight]->GetBlockHash().GetHex();
-    }
 
-    uint256 hash(uint256S(strHash));
+        uint256 hash(uint256S(strHash));
 
-    int verbosity = 1;
-    if (params.size() > 1) {
-        if(params[1].isNum()) {
-            verbosity = params[1].get_int();
-        } else {
-            verbosity = params[1].get_bool() ? 1 : 0;
+        if (params.size() > 1) {
+            if(params[1].isNum()) {
+                verbosity = params[1].get_int();
+            } else {
+                verbosity = params[1].get_bool() ? 1 : 0;
+            }
         }
-    }
 
-    if (verbosity < 0 || verbosity > 2) {
-        throw JSONRPCError(RPC_INVALID_PARAMETER, "Verbosity must be in range from 0 to 2");
-    }
+        if (verbosity < 0 || verbosity > 2) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Verbosity must be in range from 0 to 2");
+        }
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        if (mapBlockIndex.count(hash) == 0)
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-    CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
+        pblockindex = mapBlockIndex[hash];
 
-    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
+        if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
 
-    if(!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus(), 1))
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+        if(!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus(), 1))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+
+        if (verbosity == 0)
+        {
+            CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+            ssBlock << block;
+            std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
+            return strHex;
+        }
+        // the transactions are formatted below, so a large block does not hold cs_main throughout
+        blockUni = blockToJSON(block, pblockindex, false);
+        blockUni.pushKV("proofroot", CProofRoot::GetProofRoot(pblockindex->GetHeight()).ToUniValue());
+    }
+    if (verbosity < 2)
+        return blockUni;
 
-    if (verbosity == 0)
+    // the transaction ids are replaced by the transactions, each taking cs_main only while it is
+    // formatted and, when the reply is streamed, written out before the next one is formatted
+    CJSONStreamWriter* pwriter = ClaimRPCResultStream("getblock");
+    UniValue result(UniValue::VOBJ);
+    const std::vector<std::string>& keys = blockUni.getKeys();
+    const std::vector<UniValue>& values = blockUni.getValues();
+    if (pwriter)
+        pwriter->BeginObject();
+    for (size_t i = 0; i < keys.size(); i++)
     {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-        ssBlock << block;
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
-        return strHex;
+        if (keys[i] != "tx")
+        {
+            if (pwriter)
+                pwriter->Pair(keys[i], values[i]);
+            else
+                result.push_back(Pair(keys[i], values[i]));
+            continue;
+        }
+        UniValue txs(UniValue::VARR);
+        if (pwriter)
+        {
+            pwriter->Key("tx");
+            pwriter->BeginArray();
+        }
+        else
+            txs.reserve(block.vtx.size());
+        for (size_t j = 0; j < block.vtx.size() && (!pwriter || pwriter->IsGood()); j++)
+        {
+            UniValue objTx(UniValue::VOBJ);
+            {
+                LOCK(cs_main);
+                TxToJSON(block.vtx[j], uint256(), objTx);
+            }
+            if (pwriter)
+                pwriter->Value(objTx);
+            else
+                txs.push_back(std::move(objTx));
+        }
+        if (pwriter)
+            pwriter->EndArray();
+        else
+            result.push_back(Pair("tx", std::move(txs)));
     }
-    UniValue blockUni = blockToJSON(block, pblockindex, verbosity >= 2);
-    if (pblockindex)
+    if (pwriter)
     {
-        blockUni.pushKV("proofroot", CProofRoot::GetProofRoot(pblockindex->GetHeight()).ToUniValue());
+        pwriter->EndObject();
+        return NullUniValue;
     }
-    return blockUni;
+    return result;
 }
 
 UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
@@ -1141,6 +1328,47 @@ UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
     return ret;
 }
 
+UniValue dumpchainstate(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "dumpchainstate \"filename\"\n"
+            "\nWrites the chainstate at the current tip to a snapshot file, which a new node can start from with -loadsnapshot.\n"
+            "The file is written without holding up block processing, and a relative filename is in the data directory.\n"
+            "Note this call may take some time.\n"
+            "\nArguments:\n"
+            "1. \"filename\"    (string, required) The snapshot file, which must not already exist\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"filename\": \"path\",   (string) The full path of the snapshot file\n"
+            "  \"height\": n,            (numeric) The height of the block the chainstate is at\n"
+            "  \"bestblock\": \"hex\",   (string) The hash of that block\n"
+            "  \"records\": n,           (numeric) The number of database entries written\n"
+            "  \"checksum\": \"hash\"    (string) The checksum at the end of the file\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("dumpchainstate", "\"chainstate.snapshot\"")
+            + HelpExampleRpc("dumpchainstate", "\"chainstate.snapshot\"")
+        );
+
+    boost::filesystem::path path(params[0].get_str());
+    if (!path.is_complete())
+        path = GetDataDir() / path;
+
+    CChainstateSnapshotInfo info;
+    std::string strError;
+    if (!DumpChainstateSnapshot(path, info, strError))
+        throw JSONRPCError(RPC_MISC_ERROR, strError);
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("filename", path.string()));
+    ret.push_back(Pair("height", info.nHeight));
+    ret.push_back(Pair("bestblock", info.hashBlock.GetHex()));
+    ret.push_back(Pair("records", (int64_t)info.nRecords));
+    ret.push_back(Pair("checksum", info.hashChecksum.GetHex()));
+    return ret;
+}
+
 #include "komodo_defs.h"
 #include "komodo_structs.h"
 
@@ -1948,27 +2176,29 @@ UniValue reconsiderblock(const UniValue& params, bool fHelp)
 }
 
 static const CRPCCommand commands[] =
-{ //  category              name                      actor (function)         okSafeMode
-  //  --------------------- ------------------------  -----------------------  ----------
+{ //  category              name                      actor (function)         okSafeMode  okParallel
+  //  --------------------- ------------------------  -----------------------  ----------  ----------
     { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true  },
-    { "blockchain",         "getbestblockhash",       &getbestblockhash,       true  },
-    { "blockchain",         "getblockcount",          &getblockcount,          true  },
-    { "blockchain",         "getblock",               &getblock,               true  },
-    { "blockchain",         "getblockhash",           &getblockhash,           true  },
-    { "blockchain",         "getblockheader",         &getblockheader,         true  },
+    { "blockchain",         "getbestblockhash",       &getbestblockhash,       true,  true  },
+    { "blockchain",         "getblockcount",          &getblockcount,          true,  true  },
+    { "blockchain",         "getblock",               &getblock,               true,  true  },
+    { "blockchain",         "getblockhash",           &getblockhash,           true,  true  },
+    { "blockchain",         "getblockheader",         &getblockheader,         true,  true  },
     { "blockchain",         "getchaintips",           &getchaintips,           true  },
     { "blockchain",         "z_gettreestate",         &z_gettreestate,         true  },
+    { "blockchain",         "z_getcompactsaplingblocks", &z_getcompactsaplingblocks, true  },
     { "blockchain",         "getchaintxstats",        &getchaintxstats,        true  },
-    { "blockchain",         "getdifficulty",          &getdifficulty,          true  },
-    { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true  },
-    { "blockchain",         "getrawmempool",          &getrawmempool,          true  },
-    { "blockchain",         "gettxout",               &gettxout,               true  },
+    { "blockchain",         "getdifficulty",          &getdifficulty,          true,  true  },
+    { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true,  true  },
+    { "blockchain",         "getrawmempool",          &getrawmempool,          true,  true  },
+    { "blockchain",         "gettxout",               &gettxout,               true,  true  },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
+    { "blockchain",         "dumpchainstate",         &dumpchainstate,         true  },
     { "blockchain",         "verifychain",            &verifychain,            true  },
 
     // insightexplorer
-    { "blockchain",         "getblockdeltas",         &getblockdeltas,         false },    
-    { "blockchain",         "getblockhashes",         &getblockhashes,         true  },
+    { "blockchain",         "getblockdeltas",         &getblockdeltas,         false, true  },    
+    { "blockchain",         "getblockhashes",         &getblockhashes,         true,  true  },
 
     /* Not shown in help */
     { "hidden",             "invalidateblock",        &invalidateblock,        true  },
@@ -0,0 +1,109 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "rpc/jsonstream.h"
+
+#include <assert.h>
+
+CJSONStreamWriter::CJSONStreamWriter(const Sink& sinkIn, size_t nFlushSizeIn) :
+    sink(sinkIn), nFlushSize(nFlushSizeIn), fAfterKey(false), fGood(true)
+{
+}
+
+void CJSONStreamWriter::BeginValue()
+{
+    if (fAfterKey) {
+        fAfterKey = false;
+    } else if (!vHasElement.empty()) {
+        if (vHasElement.back())
+            buffer += ',';
+        vHasElement.back() = true;
+    }
+}
+
+void CJSONStreamWriter::MaybeFlush()
+{
+    if (!fGood)
+        buffer.clear();
+    else if (buffer.size() >= nFlushSize)
+        Flush();
+}
+
+void CJSONStreamWriter::BeginObject()
+{
+    BeginValue();
+    buffer += '{';
+    vHasElement.push_back(false);
+}
+
+void CJSONStreamWriter::EndObject()
+{
+    assert(!vHasElement.empty() && !fAfterKey);
+    buffer += '}';
+    vHasElement.pop_back();
+    MaybeFlush();
+}
+
+void CJSONStreamWriter::BeginArray()
+{
+    BeginValue();
+    buffer += '[';
+    vHasElement.push_back(false);
+}
+
+void CJSONStreamWriter::EndArray()
+{
+    assert(!vHasElement.empty() && !fAfterKey);
+    buffer += ']';
+    vHasElement.pop_back();
+    MaybeFlush();
+}
+
+void CJSONStreamWriter::Key(const std::string& key)
+{
+    assert(!vHasElement.empty() && !fAfterKey);
+    BeginValue();
+    // a string value writes itself quoted and escaped
+    UniValue(UniValue::VSTR, key).write(buffer);
+    buffer += ':';
+    fAfterKey = true;
+}
+
+void CJSONStreamWriter::Value(const UniValue& value)
+{
+    if (value.isObject()) {
+        const std::vector<std::string>& keys = value.getKeys();
+        const std::vector<UniValue>& values = value.getValues();
+        BeginObject();
+        for (size_t i = 0; i < keys.size(); i++) {
+            Key(keys[i]);
+            Value(values[i]);
+        }
+        EndObject();
+    } else if (value.isArray()) {
+        BeginArray();
+        for (const UniValue& element : value.getValues())
+            Value(element);
+        EndArray();
+    } else {
+        BeginValue();
+        value.write(buffer);
+        MaybeFlush();
+    }
+}
+
+bool CJSONStreamWriter::Flush()
+{
+    if (fGood && !buffer.empty())
+        fGood = sink(buffer);
+    buffer.clear();
+    return fGood;
+}
+
+std::string CJSONStreamWriter::TakeBuffer()
+{
+    std::string result;
+    result.swap(buffer);
+    return result;
+}
@@ -0,0 +1,64 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef VERUS_RPC_JSONSTREAM_H
+#define VERUS_RPC_JSONSTREAM_H
+
+#include <univalue.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+
+//! Bytes a CJSONStreamWriter collects before handing them to its sink
+static const size_t DEFAULT_JSON_STREAM_FLUSH = 1024 * 1024;
+
+/**
+ * Writes JSON text in pieces instead of serializing one complete UniValue into a string.
+ *
+ * Containers are opened and closed explicitly and values are appended as they are produced, with
+ * separators placed as UniValue::write() places them for compact output. Whenever at least
+ * nFlushSize bytes are buffered they are handed to the sink. Once the sink returns false, because
+ * the reader went away, further output is dropped and IsGood() returns false.
+ */
+class CJSONStreamWriter
+{
+public:
+    typedef boost::function<bool(const std::string&)> Sink;
+
+    explicit CJSONStreamWriter(const Sink& sinkIn, size_t nFlushSizeIn = DEFAULT_JSON_STREAM_FLUSH);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    //! key of the next value in the enclosing object
+    void Key(const std::string& key);
+    //! appends a complete value, arrays and objects are written element by element
+    void Value(const UniValue& value);
+    void Pair(const std::string& key, const UniValue& value) { Key(key); Value(value); }
+
+    //! true if a key has been written but its value has not
+    bool AwaitingValue() const { return fAfterKey; }
+    bool IsGood() const { return fGood; }
+    //! hands everything buffered to the sink
+    bool Flush();
+    //! returns the buffered text without sending it, for output that never grew large enough to flush
+    std::string TakeBuffer();
+
+private:
+    Sink sink;
+    size_t nFlushSize;
+    std::string buffer;
+    //! one entry per open container, true once it holds an element
+    std::vector<bool> vHasElement;
+    bool fAfterKey;
+    bool fGood;
+
+    void BeginValue();
+    void MaybeFlush();
+};
+
+#endif // VERUS_RPC_JSONSTREAM_H
@@ -10,6 +10,8 @@
 #include "main.h"
 #include "net.h"
 #include "netbase.h"
+#include "perfstats.h"
+#include "rpc/jsonstream.h"
 #include "rpc/server.h"
 #include "timedata.h"
 #include "txmempool.h"
@@ -1400,9 +1402,12 @@ UniValue getaddressmempool(const UniValue& params, bool fHelp)
     std::sort(indexes.begin(), indexes.end(), timestampSort);
 
     UniValue result(UniValue::VARR);
+    CJSONStreamWriter* pwriter = ClaimRPCResultStream("getaddressmempool");
+    if (pwriter)
+        pwriter->BeginArray();
 
     for (std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> >::iterator it = indexes.begin();
-         it != indexes.end(); it++) {
+         it != indexes.end() && (!pwriter || pwriter->IsGood()); it++) {
 
         std::string address;
         if (!getAddressFromIndex(it->first.type, it->first.addressBytes, address)) {
@@ -1419,9 +1424,16 @@ UniValue getaddressmempool(const UniValue& params, bool fHelp)
             delta.push_back(Pair("prevtxid", it->second.prevhash.GetHex()));
             delta.push_back(Pair("prevout", (int)it->second.prevout));
         }
-        result.push_back(delta);
+        if (pwriter)
+            pwriter->Value(delta);
+        else
+            result.push_back(delta);
     }
 
+    if (pwriter) {
+        pwriter->EndArray();
+        return NullUniValue;
+    }
     return result;
 }
 
@@ -1472,8 +1484,12 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
 
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
 
+    // read all addresses from the same tip without holding cs_main
+    std::shared_ptr<const CBlockTreeSnapshot> pindexSnapshot = GetBlockTreeSnapshot();
+    const CDBSnapshot *psnapshot = pindexSnapshot ? &pindexSnapshot->snapshot : NULL;
+
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs)) {
+        if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs, psnapshot)) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
     }
@@ -1481,8 +1497,17 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
     std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
 
     UniValue utxos(UniValue::VARR);
+    CJSONStreamWriter* pwriter = ClaimRPCResultStream("getaddressutxos");
+    if (pwriter) {
+        if (includeChainInfo) {
+            pwriter->BeginObject();
+            pwriter->Key("utxos");
+        }
+        pwriter->BeginArray();
+    }
 
-    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++) {
+    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin();
+         it!=unspentOutputs.end() && (!pwriter || pwriter->IsGood()); it++) {
         UniValue output(UniValue::VOBJ);
         
         std::string address = "";
@@ -1520,20 +1545,35 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
         output.push_back(Pair("script", HexStr(it->second.script.begin(), it->second.script.end())));
         output.push_back(Pair("satoshis", it->second.satoshis));
         output.push_back(Pair("height", it->second.blockHeight));
-        utxos.push_back(output);
+        if (pwriter)
+            pwriter->Value(output);
+        else
+            utxos.push_back(output);
     }
 
+    if (pwriter)
+        pwriter->EndArray();
+
     if (includeChainInfo) {
         UniValue result(UniValue::VOBJ);
-        result.push_back(Pair("utxos", utxos));
+        if (!pwriter)
+            result.push_back(Pair("utxos", utxos));
 
-        LOCK(cs_main);
-        result.push_back(Pair("hash", chainActive.LastTip()->GetBlockHash().GetHex()));
-        result.push_back(Pair("height", (int)chainActive.Height()));
-        return result;
-    } else {
-        return utxos;
+        if (pindexSnapshot) {
+            result.push_back(Pair("hash", pindexSnapshot->hashBlock.GetHex()));
+            result.push_back(Pair("height", pindexSnapshot->nHeight));
+        } else {
+            LOCK(cs_main);
+            result.push_back(Pair("hash", chainActive.LastTip()->GetBlockHash().GetHex()));
+            result.push_back(Pair("height", (int)chainActive.Height()));
+        }
+        if (!pwriter)
+            return result;
+        pwriter->Pair("hash", result["hash"]);
+        pwriter->Pair("height", result["height"]);
+        pwriter->EndObject();
     }
+    return pwriter ? NullUniValue : utxos;
 }
 
 UniValue getaddressdeltas(const UniValue& params, bool fHelp)
@@ -1600,21 +1640,57 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
 
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
+    // read all addresses from the same tip without holding cs_main
+    std::shared_ptr<const CBlockTreeSnapshot> pindexSnapshot = GetBlockTreeSnapshot();
+    const CDBSnapshot *psnapshot = pindexSnapshot ? &pindexSnapshot->snapshot : NULL;
+
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
         if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
+            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end, psnapshot)) {
                 throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
         } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, 0, 0, psnapshot)) {
                 throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
         }
     }
 
+    // the range is checked before any delta is written, as a streamed reply cannot fail after that
+    bool fChainInfo = includeChainInfo && start > 0 && end > 0;
+    UniValue startInfo(UniValue::VOBJ);
+    UniValue endInfo(UniValue::VOBJ);
+
+    if (fChainInfo) {
+        LOCK(cs_main);
+
+        int nIndexHeight = pindexSnapshot ? pindexSnapshot->nHeight : chainActive.Height();
+        if (start > nIndexHeight || end > nIndexHeight || end > chainActive.Height()) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Start or end is outside chain range");
+        }
+
+        CBlockIndex* startIndex = chainActive[start];
+        CBlockIndex* endIndex = chainActive[end];
+
+        startInfo.push_back(Pair("hash", startIndex->GetBlockHash().GetHex()));
+        startInfo.push_back(Pair("height", start));
+
+        endInfo.push_back(Pair("hash", endIndex->GetBlockHash().GetHex()));
+        endInfo.push_back(Pair("height", end));
+    }
+
     UniValue deltas(UniValue::VARR);
+    CJSONStreamWriter* pwriter = ClaimRPCResultStream("getaddressdeltas");
+    if (pwriter) {
+        if (fChainInfo) {
+            pwriter->BeginObject();
+            pwriter->Key("deltas");
+        }
+        pwriter->BeginArray();
+    }
 
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin();
+         it!=addressIndex.end() && (!pwriter || pwriter->IsGood()); it++) {
         std::string address;
         if (!getAddressFromIndex(it->first.type, it->first.hashBytes, address)) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
@@ -1627,30 +1703,24 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
         delta.push_back(Pair("blockindex", (int)it->first.txindex));
         delta.push_back(Pair("height", it->first.blockHeight));
         delta.push_back(Pair("address", address));
-        deltas.push_back(delta);
+        if (pwriter)
+            pwriter->Value(delta);
+        else
+            deltas.push_back(delta);
     }
 
-    UniValue result(UniValue::VOBJ);
-
-    if (includeChainInfo && start > 0 && end > 0) {
-        LOCK(cs_main);
-
-        if (start > chainActive.Height() || end > chainActive.Height()) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Start or end is outside chain range");
+    if (pwriter) {
+        pwriter->EndArray();
+        if (fChainInfo) {
+            pwriter->Pair("start", startInfo);
+            pwriter->Pair("end", endInfo);
+            pwriter->EndObject();
         }
+        return NullUniValue;
+    }
 
-        CBlockIndex* startIndex = chainActive[start];
-        CBlockIndex* endIndex = chainActive[end];
-
-        UniValue startInfo(UniValue::VOBJ);
-        UniValue endInfo(UniValue::VOBJ);
-
-        startInfo.push_back(Pair("hash", startIndex->GetBlockHash().GetHex()));
-        startInfo.push_back(Pair("height", start));
-
-        endInfo.push_back(Pair("hash", endIndex->GetBlockHash().GetHex()));
-        endInfo.push_back(Pair("height", end));
-
+    if (fChainInfo) {
+        UniValue result(UniValue::VOBJ);
         result.push_back(Pair("deltas", deltas));
         result.push_back(Pair("start", startInfo));
         result.push_back(Pair("end", endInfo));
@@ -1693,8 +1763,12 @@ UniValue getaddressbalance(const UniValue& params, bool fHelp)
 
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
+    // read all addresses from the same tip without holding cs_main
+    std::shared_ptr<const CBlockTreeSnapshot> pindexSnapshot = GetBlockTreeSnapshot();
+    const CDBSnapshot *psnapshot = pindexSnapshot ? &pindexSnapshot->snapshot : NULL;
+
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+        if (!GetAddressIndex((*it).first, (*it).second, addressIndex, 0, 0, psnapshot)) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
     }
@@ -1815,13 +1889,17 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
 
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
+    // read all addresses from the same tip without holding cs_main
+    std::shared_ptr<const CBlockTreeSnapshot> pindexSnapshot = GetBlockTreeSnapshot();
+    const CDBSnapshot *psnapshot = pindexSnapshot ? &pindexSnapshot->snapshot : NULL;
+
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
         if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
+            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end, psnapshot)) {
                 throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
         } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, 0, 0, psnapshot)) {
                 throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
         }
@@ -1829,8 +1907,12 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
 
     std::set<std::pair<int, std::string> > txids;
     UniValue result(UniValue::VARR);
+    CJSONStreamWriter* pwriter = ClaimRPCResultStream("getaddresstxids");
+    if (pwriter)
+        pwriter->BeginArray();
 
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin();
+         it!=addressIndex.end() && (!pwriter || pwriter->IsGood()); it++) {
         int height = it->first.blockHeight;
         std::string txid = it->first.txhash.GetHex();
 
@@ -1838,17 +1920,28 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
             txids.insert(std::make_pair(height, txid));
         } else {
             if (txids.insert(std::make_pair(height, txid)).second) {
-                result.push_back(txid);
+                if (pwriter)
+                    pwriter->Value(txid);
+                else
+                    result.push_back(txid);
             }
         }
     }
 
     if (addresses.size() > 1) {
-        for (std::set<std::pair<int, std::string> >::const_iterator it=txids.begin(); it!=txids.end(); it++) {
-            result.push_back(it->second);
+        for (std::set<std::pair<int, std::string> >::const_iterator it=txids.begin();
+             it!=txids.end() && (!pwriter || pwriter->IsGood()); it++) {
+            if (pwriter)
+                pwriter->Value(it->second);
+            else
+                result.push_back(it->second);
         }
     }
 
+    if (pwriter) {
+        pwriter->EndArray();
+        return NullUniValue;
+    }
     return result;
 
 }
@@ -1889,7 +1982,15 @@ UniValue getspentinfo(const UniValue& params, bool fHelp)
     CSpentIndexKey key(txid, outputIndex);
     CSpentIndexValue value;
 
-    if (!GetSpentIndex(key, value)) {
+    std::shared_ptr<const CBlockTreeSnapshot> pindexSnapshot = GetBlockTreeSnapshot();
+    bool fFound;
+    if (pindexSnapshot) {
+        fFound = GetSpentIndex(key, value, &pindexSnapshot->snapshot);
+    } else {
+        LOCK(cs_main);
+        fFound = GetSpentIndex(key, value);
+    }
+    if (!fFound) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unable to get spent info");
     }
     UniValue obj(UniValue::VOBJ);
@@ -1900,10 +2001,97 @@ UniValue getspentinfo(const UniValue& params, bool fHelp)
     return obj;
 }
 
+static UniValue LatencyHistogramToJSON(const CLatencyHistogram &histogram)
+{
+    std::vector<uint64_t> buckets = histogram.GetBuckets();
+    uint64_t nCount = 0;
+    for (auto oneBucket : buckets)
+        nCount += oneBucket;
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("count", (uint64_t)nCount));
+    ret.push_back(Pair("total_ms", histogram.TotalMicros() * 0.001));
+    if (nCount)
+    {
+        ret.push_back(Pair("mean_ms", histogram.TotalMicros() * 0.001 / nCount));
+        ret.push_back(Pair("p50_ms", CLatencyHistogram::Percentile(buckets, nCount, 0.5) * 0.001));
+        ret.push_back(Pair("p90_ms", CLatencyHistogram::Percentile(buckets, nCount, 0.9) * 0.001));
+        ret.push_back(Pair("p99_ms", CLatencyHistogram::Percentile(buckets, nCount, 0.99) * 0.001));
+    }
+    UniValue bucketsUni(UniValue::VARR);
+    for (int i = 0; i < buckets.size(); i++)
+    {
+        if (!buckets[i])
+            continue;
+        UniValue oneBucket(UniValue::VOBJ);
+        if (i < buckets.size() - 1)
+            oneBucket.push_back(Pair("under_ms", CLatencyHistogram::BucketLimit(i) * 0.001));
+        else
+            oneBucket.push_back(Pair("over_ms", CLatencyHistogram::BucketLimit(i - 1) * 0.001));
+        oneBucket.push_back(Pair("count", buckets[i]));
+        bucketsUni.push_back(oneBucket);
+    }
+    ret.push_back(Pair("buckets", bucketsUni));
+    return ret;
+}
+
+UniValue getperfstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getperfstats\n"
+            "\nReturns latency histograms of block connection phases, mempool acceptance, block template creation,\n"
+            "identity lookups, database access and P2P message processing since the node started.\n"
+            "Percentiles are the upper bounds of the power of two buckets they fall in.\n"
+            "The same histograms are served in Prometheus format at /rest/metrics when -rest is enabled.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"operations\": {\n"
+            "    \"name\": {                (object) One of connectblock, connectblock_proofs, connectblock_inputs,\n"
+            "                               connectblock_scripts, connectblock_undo, connecttip_flush, accepttomemorypool,\n"
+            "                               createnewblock, lookupidentity, leveldb_read and leveldb_write\n"
+            "      \"count\": n,            (numeric) Times the operation was timed\n"
+            "      \"total_ms\": x.xxx,     (numeric) Total time taken\n"
+            "      \"mean_ms\": x.xxx,      (numeric) Mean time taken\n"
+            "      \"p50_ms\": x.xxx,       (numeric) Median\n"
+            "      \"p90_ms\": x.xxx,       (numeric) 90th percentile\n"
+            "      \"p99_ms\": x.xxx,       (numeric) 99th percentile\n"
+            "      \"buckets\": [           (array) The buckets that are not empty\n"
+            "        { \"under_ms\": x.xxx, \"count\": n }\n"
+            "      ]\n"
+            "    }, ...\n"
+            "  },\n"
+            "  \"messages\": {            (object) The same for each P2P message command received, with \"other\" for unknown ones\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getperfstats", "")
+            + HelpExampleRpc("getperfstats", "")
+        );
+
+    UniValue operations(UniValue::VOBJ);
+    for (int i = 0; i < PERF_STAT_COUNT; i++)
+        operations.push_back(Pair(GetPerfStatName((PerfStat)i), LatencyHistogramToJSON(GetPerfHistogram((PerfStat)i))));
+
+    UniValue messages(UniValue::VOBJ);
+    for (auto &oneType : GetPerfMessageTypes())
+    {
+        CLatencyHistogram &histogram = GetMessagePerfHistogram(oneType);
+        if (histogram.Count())
+            messages.push_back(Pair(oneType, LatencyHistogramToJSON(histogram)));
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("operations", operations));
+    ret.push_back(Pair("messages", messages));
+    return ret;
+}
+
 static const CRPCCommand commands[] =
-{ //  category              name                      actor (function)         okSafeMode
-  //  --------------------- ------------------------  -----------------------  ----------
+{ //  category              name                      actor (function)         okSafeMode  okParallel
+  //  --------------------- ------------------------  -----------------------  ----------  ----------
     { "control",            "getinfo",                &getinfo,                true  }, /* uses wallet if enabled */
+    { "control",            "getperfstats",           &getperfstats,           true,  true  },
     { "util",               "validateaddress",        &validateaddress,        true  }, /* uses wallet if enabled */
     { "util",               "z_validateaddress",      &z_validateaddress,      true  }, /* uses wallet if enabled */
     { "util",               "createmultisig",         &createmultisig,         true  },
@@ -1914,12 +2102,12 @@ static const CRPCCommand commands[] =
 
     // START insightexplorer
     /* Address index */
-    { "addressindex",       "getaddresstxids",        &getaddresstxids,        false }, /* insight explorer */
-    { "addressindex",       "getaddressbalance",      &getaddressbalance,      false }, /* insight explorer */
-    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       false }, /* insight explorer */
-    { "addressindex",       "getaddressutxos",        &getaddressutxos,        false }, /* insight explorer */
-    { "addressindex",       "getaddressmempool",      &getaddressmempool,      true  }, /* insight explorer */
-    { "blockchain",         "getspentinfo",           &getspentinfo,           false }, /* insight explorer */
+    { "addressindex",       "getaddresstxids",        &getaddresstxids,        false, true  }, /* insight explorer */
+    { "addressindex",       "getaddressbalance",      &getaddressbalance,      false, true  }, /* insight explorer */
+    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       false, true  }, /* insight explorer */
+    { "addressindex",       "getaddressutxos",        &getaddressutxos,        false, true  }, /* insight explorer */
+    { "addressindex",       "getaddressmempool",      &getaddressmempool,      true,  true  }, /* insight explorer */
+    { "blockchain",         "getspentinfo",           &getspentinfo,           false, true  }, /* insight explorer */
     // END insightexplorer
 
     /* Not shown in help */
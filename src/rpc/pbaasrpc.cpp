@@ -6827,6 +6827,8 @@ UniValue submitmergedblock(const UniValue& params, bool fHelp)
     //printf("submitblock, height=%d, coinbase sequence: %d, scriptSig: %s\n", chainActive.LastTip()->GetHeight()+1, block.vtx[0].vin[0].nSequence, block.vtx[0].vin[0].scriptSig.ToString().c_str());
     bool fAccepted = ProcessNewBlock(1, chainActive.LastTip()->GetHeight()+1, state, Params(), NULL, &block, true, NULL);
     UnregisterValidationInterface(&sc);
+    // a queued notification may still be calling into sc
+    SyncWithValidationInterfaceQueue();
     if (fBlockPresent)
     {
         if (fAccepted && !sc.found)
@@ -7170,8 +7172,8 @@ UniValue getmergedblocktemplate(const UniValue& params, bool fHelp)
 }
 
 static const CRPCCommand commands[] =
-{ //  category              name                      actor (function)         okSafeMode
-  //  --------------------- ------------------------  -----------------------  ----------
+{ //  category              name                      actor (function)         okSafeMode  okParallel
+  //  --------------------- ------------------------  -----------------------  ----------  ----------
     { "identity",     "registernamecommitment",       &registernamecommitment, true  },
     { "identity",     "registeridentity",             &registeridentity,       true  },
     { "identity",     "updateidentity",               &updateidentity,         true  },
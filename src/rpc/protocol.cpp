@@ -50,7 +50,10 @@ UniValue JSONRPCReplyObj(const UniValue& result, const UniValue& error, const Un
 string JSONRPCReply(const UniValue& result, const UniValue& error, const UniValue& id)
 {
     UniValue reply = JSONRPCReplyObj(result, error, id);
-    return reply.write() + "\n";
+    string strReply;
+    reply.write(strReply);
+    strReply += "\n";
+    return strReply;
 }
 
 UniValue JSONRPCError(int code, const string& message)
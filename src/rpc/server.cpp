@@ -5,6 +5,7 @@
 
 #include "rpc/server.h"
 
+#include "checkqueue.h"
 #include "init.h"
 #include "key_io.h"
 #include "random.h"
@@ -250,8 +251,8 @@ UniValue stop(const UniValue& params, bool fHelp)
  * Call Table
  */
 static const CRPCCommand vRPCCommands[] =
-{ //  category              name                      actor (function)         okSafeMode
-  //  --------------------- ------------------------  -----------------------  ----------
+{ //  category              name                      actor (function)         okSafeMode  okParallel
+  //  --------------------- ------------------------  -----------------------  ----------  ----------
     /* Overall control/query calls */
     { "control",            "help",                   &help,                   true  },
     { "control",            "stop",                   &stop,                   true  },
@@ -273,23 +274,23 @@ static const CRPCCommand vRPCCommands[] =
     /* Block chain and UTXO */
     { "blockchain",         "coinsupply",             &coinsupply,             true  },
     { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true  },
-    { "blockchain",         "getbestblockhash",       &getbestblockhash,       true  },
-    { "blockchain",         "getblockcount",          &getblockcount,          true  },
-    { "blockchain",         "getblock",               &getblock,               true  },
-    { "blockchain",         "getblockdeltas",         &getblockdeltas,         false },
-    { "blockchain",         "getblockhashes",         &getblockhashes,         true  },
-    { "blockchain",         "getblockhash",           &getblockhash,           true  },
-    { "blockchain",         "getblockheader",         &getblockheader,         true  },
+    { "blockchain",         "getbestblockhash",       &getbestblockhash,       true,  true  },
+    { "blockchain",         "getblockcount",          &getblockcount,          true,  true  },
+    { "blockchain",         "getblock",               &getblock,               true,  true  },
+    { "blockchain",         "getblockdeltas",         &getblockdeltas,         false, true  },
+    { "blockchain",         "getblockhashes",         &getblockhashes,         true,  true  },
+    { "blockchain",         "getblockhash",           &getblockhash,           true,  true  },
+    { "blockchain",         "getblockheader",         &getblockheader,         true,  true  },
     { "blockchain",         "getchaintips",           &getchaintips,           true  },
-    { "blockchain",         "getdifficulty",          &getdifficulty,          true  },
-    { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true  },
-    { "blockchain",         "getrawmempool",          &getrawmempool,          true  },
-    { "blockchain",         "gettxout",               &gettxout,               true  },
+    { "blockchain",         "getdifficulty",          &getdifficulty,          true,  true  },
+    { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true,  true  },
+    { "blockchain",         "getrawmempool",          &getrawmempool,          true,  true  },
+    { "blockchain",         "gettxout",               &gettxout,               true,  true  },
     { "blockchain",         "gettxoutproof",          &gettxoutproof,          true  },
     { "blockchain",         "verifytxoutproof",       &verifytxoutproof,       true  },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
     { "blockchain",         "verifychain",            &verifychain,            true  },
-    { "blockchain",         "getspentinfo",           &getspentinfo,           false },
+    { "blockchain",         "getspentinfo",           &getspentinfo,           false, true  },
     //{ "blockchain",         "paxprice",               &paxprice,               true  },
     //{ "blockchain",         "paxpending",             &paxpending,             true  },
     //{ "blockchain",         "paxprices",              &paxprices,              true  },
@@ -331,9 +332,9 @@ static const CRPCCommand vRPCCommands[] =
 
     /* Raw transactions */
     { "rawtransactions",    "createrawtransaction",   &createrawtransaction,   true  },
-    { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true  },
-    { "rawtransactions",    "decodescript",           &decodescript,           true  },
-    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true  },
+    { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true,  true  },
+    { "rawtransactions",    "decodescript",           &decodescript,           true,  true  },
+    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true,  true  },
     { "rawtransactions",    "sendrawtransaction",     &sendrawtransaction,     false },
     { "rawtransactions",    "signrawtransaction",     &signrawtransaction,     false }, /* uses wallet if enabled */
 #ifdef ENABLE_WALLET
@@ -440,11 +441,11 @@ static const CRPCCommand vRPCCommands[] =
     //{ "tokens",       "tokenfillswap",    &tokenfillswap,     true },
 */
     /* Address index */
-    { "addressindex",       "getaddressmempool",      &getaddressmempool,      true  },
-    { "addressindex",       "getaddressutxos",        &getaddressutxos,        false },
-    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       false },
-    { "addressindex",       "getaddresstxids",        &getaddresstxids,        false },
-    { "addressindex",       "getaddressbalance",      &getaddressbalance,      false },
+    { "addressindex",       "getaddressmempool",      &getaddressmempool,      true,  true  },
+    { "addressindex",       "getaddressutxos",        &getaddressutxos,        false, true  },
+    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       false, true  },
+    { "addressindex",       "getaddresstxids",        &getaddresstxids,        false, true  },
+    { "addressindex",       "getaddressbalance",      &getaddressbalance,      false, true  },
     { "addressindex",       "getsnapshot",            &getsnapshot,            false },
 
     /* Utility functions */
@@ -487,6 +488,7 @@ static const CRPCCommand vRPCCommands[] =
     { "wallet",             "importprivkey",          &importprivkey,          true  },
     { "wallet",             "importwallet",           &importwallet,           true  },
     { "wallet",             "importaddress",          &importaddress,          true  },
+    { "wallet",             "abortrescan",            &abortrescan,            true  },
     { "wallet",             "keypoolrefill",          &keypoolrefill,          true  },
     { "wallet",             "listaccounts",           &listaccounts,           false },
     { "wallet",             "listaddressgroupings",   &listaddressgroupings,   false },
@@ -570,12 +572,73 @@ bool CRPCTable::appendCommand(const std::string& name, const CRPCCommand* pcmd)
     return true;
 }
 
+int nRPCBatchThreads = 0;
+
+namespace {
+
+/** Executes one entry of a JSON-RPC batch, see JSONRPCExecBatch */
+class CRPCBatchCheck
+{
+private:
+    const UniValue *preq;
+    UniValue *presult;
+
+public:
+    CRPCBatchCheck() : preq(NULL), presult(NULL) {}
+    CRPCBatchCheck(const UniValue *preqIn, UniValue *presultIn) : preq(preqIn), presult(presultIn) {}
+
+    bool operator()();
+
+    void swap(CRPCBatchCheck &check)
+    {
+        std::swap(preq, check.preq);
+        std::swap(presult, check.presult);
+    }
+};
+
+// every call is heavy enough to be handed out on its own
+CCheckQueue<CRPCBatchCheck> rpcbatchqueue(1);
+
+// CCheckQueue takes one master at a time, batches arriving while it is busy run on their own HTTP worker
+boost::mutex csRPCBatchMaster;
+
+boost::thread_group rpcBatchThreads;
+
+}
+
+static void ThreadRPCBatch()
+{
+    RenameThread("zcash-rpcbatch");
+    rpcbatchqueue.Thread();
+}
+
+void StartRPCBatchThreads(int nThreads)
+{
+    nRPCBatchThreads = std::max(1, std::min(nThreads, MAX_RPC_BATCH_THREADS));
+    LogPrint("rpc", "Using %d threads for JSON-RPC batches\n", nRPCBatchThreads);
+    for (int i = 0; i < nRPCBatchThreads - 1; i++)
+        rpcBatchThreads.create_thread(&ThreadRPCBatch);
+}
+
+void StopRPCBatchThreads()
+{
+    // batches still running finish their remaining entries on their own thread
+    rpcBatchThreads.interrupt_all();
+    rpcBatchThreads.join_all();
+    nRPCBatchThreads = 0;
+}
+
 bool StartRPC()
 {
     LogPrint("rpc", "Starting RPC\n");
     fRPCRunning = true;
     g_rpcSignals.Started();
 
+    int nBatchThreads = GetArg("-rpcbatchthreads", DEFAULT_RPC_BATCH_THREADS);
+    if (nBatchThreads <= 0)
+        nBatchThreads += GetNumCores();
+    StartRPCBatchThreads(nBatchThreads);
+
     // Launch one async rpc worker.  The ability to launch multiple workers is not recommended at present and thus the option is disabled.
     getAsyncRPCQueue()->addWorker();
 /*
@@ -606,6 +669,8 @@ void StopRPC()
     deadlineTimers.clear();
     g_rpcSignals.Stopped();
 
+    StopRPCBatchThreads();
+
     // Tells async queue to cancel all operations and shutdown.
     LogPrintf("%s: waiting for async rpc workers to stop\n", __func__);
     getAsyncRPCQueue()->closeAndWait();
@@ -691,13 +756,92 @@ static UniValue JSONRPCExecOne(const UniValue& req)
     return rpc_result;
 }
 
+bool CRPCBatchCheck::operator()()
+{
+    *presult = JSONRPCExecOne(*preq);
+    return true;
+}
+
+/** True if the batch entry calls a command that may run alongside others */
+static bool IsParallelRPCRequest(const UniValue& req)
+{
+    if (!req.isObject())
+        return false;
+    const UniValue& method = find_value(req.get_obj(), "method");
+    if (!method.isStr())
+        return false;
+    const CRPCCommand *pcmd = tableRPC[method.get_str()];
+    return pcmd && pcmd->okParallel;
+}
+
 std::string JSONRPCExecBatch(const UniValue& vReq)
 {
+    std::vector<UniValue> vResults(vReq.size());
+
+    boost::unique_lock<boost::mutex> lockMaster(csRPCBatchMaster, boost::defer_lock);
+    bool fParallel = nRPCBatchThreads > 1 && vReq.size() > 1 && lockMaster.try_lock();
+
+    // Runs of consecutive okParallel entries are spread over the batch threads. Any other entry
+    // runs by itself once everything before it has finished, so it sees their effects as it would
+    // if the batch ran in order.
+    size_t reqIdx = 0;
+    while (reqIdx < vReq.size())
+    {
+        size_t runEnd = reqIdx;
+        while (fParallel && runEnd < vReq.size() && IsParallelRPCRequest(vReq[runEnd]))
+            runEnd++;
+
+        if (runEnd - reqIdx > 1)
+        {
+            std::vector<CRPCBatchCheck> vChecks;
+            vChecks.reserve(runEnd - reqIdx);
+            for (; reqIdx < runEnd; reqIdx++)
+                vChecks.push_back(CRPCBatchCheck(&vReq[reqIdx], &vResults[reqIdx]));
+
+            CCheckQueueControl<CRPCBatchCheck> control(&rpcbatchqueue);
+            control.Add(vChecks);
+            control.Wait();
+        }
+        else
+        {
+            vResults[reqIdx] = JSONRPCExecOne(vReq[reqIdx]);
+            reqIdx++;
+        }
+    }
+
     UniValue ret(UniValue::VARR);
-    for (size_t reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+    ret.reserve(vResults.size());
+    for (size_t i = 0; i < vResults.size(); i++)
+        ret.push_back(std::move(vResults[i]));
+
+    std::string strReply;
+    ret.write(strReply);
+    strReply += "\n";
+    return strReply;
+}
+
+static thread_local const std::string* pstrStreamMethod = NULL;
+static thread_local CJSONStreamWriter* pResultStream = NULL;
+
+CRPCResultStreamScope::CRPCResultStreamScope(const std::string& strMethodIn, CJSONStreamWriter* pwriter) : strMethod(strMethodIn)
+{
+    pstrStreamMethod = &strMethod;
+    pResultStream = pwriter;
+}
 
-    return ret.write() + "\n";
+CRPCResultStreamScope::~CRPCResultStreamScope()
+{
+    pstrStreamMethod = NULL;
+    pResultStream = NULL;
+}
+
+CJSONStreamWriter* ClaimRPCResultStream(const std::string& strMethod)
+{
+    if (!pResultStream || *pstrStreamMethod != strMethod)
+        return NULL;
+    CJSONStreamWriter* pwriter = pResultStream;
+    pResultStream = NULL;
+    return pwriter;
 }
 
 UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params) const
@@ -119,6 +119,11 @@ void RPCRunLater(const std::string& name, boost::function<void(void)> func, int6
 
 typedef UniValue(*rpcfn_type)(const UniValue& params, bool fHelp);
 
+static const int DEFAULT_RPC_BATCH_THREADS = 0;
+static const int MAX_RPC_BATCH_THREADS = 16;
+
+extern int nRPCBatchThreads;
+
 class CRPCCommand
 {
 public:
@@ -126,6 +131,9 @@ public:
     std::string name;
     rpcfn_type actor;
     bool okSafeMode;
+    //! only reads state and takes the locks it needs itself, so batch entries calling it may run concurrently.
+    //! Command tables leave it out, and so false, for every command that has not opted in.
+    bool okParallel;
 };
 
 /**
@@ -160,6 +168,29 @@ public:
 
 extern CRPCTable tableRPC;
 
+class CJSONStreamWriter;
+
+/**
+ * Offers pwriter to the handler of strMethod while in scope, for the duration of one call on
+ * behalf of a client that accepts a streamed reply.
+ */
+class CRPCResultStreamScope
+{
+public:
+    CRPCResultStreamScope(const std::string& strMethodIn, CJSONStreamWriter* pwriter);
+    ~CRPCResultStreamScope();
+
+private:
+    std::string strMethod;
+};
+
+/**
+ * The writer a handler running as strMethod may write its result to instead of returning it,
+ * NULL if there is none. The first call claims the writer, so a handler that calls other RPCs
+ * never has them write into its reply. A handler that wrote its result returns NullUniValue.
+ */
+CJSONStreamWriter* ClaimRPCResultStream(const std::string& strMethod);
+
 /**
  * Utilities: convert hex-encoded Values
  * (throws error if not hex).
@@ -184,6 +215,9 @@ bool StartRPC();
 void InterruptRPC();
 void StopRPC();
 std::string JSONRPCExecBatch(const UniValue& vReq);
+/** Starts the workers for JSON-RPC batches, nThreads counting the HTTP worker that runs the batch */
+void StartRPCBatchThreads(int nThreads);
+void StopRPCBatchThreads();
 
 extern std::string experimentalDisabledHelpMsg(const std::string& rpc, const std::string& enableArg);
 
@@ -208,6 +242,7 @@ extern UniValue dumpprivkey(const UniValue& params, bool fHelp); // in rpcdump.c
 extern UniValue convertpassphrase(const UniValue& params, bool fHelp);
 extern UniValue importprivkey(const UniValue& params, bool fHelp);
 extern UniValue importaddress(const UniValue& params, bool fHelp);
+extern UniValue abortrescan(const UniValue& params, bool fHelp);
 extern UniValue dumpwallet(const UniValue& params, bool fHelp);
 extern UniValue importwallet(const UniValue& params, bool fHelp);
 
@@ -377,6 +412,7 @@ extern UniValue gettxout(const UniValue& params, bool fHelp);
 extern UniValue verifychain(const UniValue& params, bool fHelp);
 extern UniValue getchaintips(const UniValue& params, bool fHelp);
 extern UniValue z_gettreestate(const UniValue& params, bool fHelp);
+extern UniValue z_getcompactsaplingblocks(const UniValue& params, bool fHelp);
 extern UniValue getchaintxstats(const UniValue& params, bool fHelp);
 extern UniValue invalidateblock(const UniValue& params, bool fHelp);
 extern UniValue reconsiderblock(const UniValue& params, bool fHelp);
@@ -0,0 +1,119 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "blockmmrcache.h"
+
+#include "chain.h"
+#include "hash.h"
+#include "random.h"
+#include "streams.h"
+
+#include <gtest/gtest.h>
+
+static CBlock TestBlock(int nTx)
+{
+    CBlock block;
+    block.nTime = GetRand(1 << 30);
+    for (int i = 0; i < nTx; i++)
+    {
+        CMutableTransaction mtx;
+        mtx.vin.push_back(CTxIn(GetRandHash(), i));
+        mtx.vout.push_back(CTxOut(i + 1, CScript() << OP_TRUE));
+        block.vtx.push_back(CTransaction(mtx));
+    }
+    return block;
+}
+
+// the cached range has the root and proofs of the tree built from the block itself
+static void CheckSameMMR(const CBlock &block, const CBlockIndex *pindex, const BlockTxRootMMRangeRef &mmRange)
+{
+    BlockMMRange blockRange = block.GetBlockMMRTree();
+    BlockMMView blockView(blockRange);
+    BlockTxRootMMView cachedView(*mmRange);
+    EXPECT_EQ(mmRange->size(), block.vtx.size());
+    EXPECT_TRUE(cachedView.GetRoot() == blockView.GetRoot());
+
+    for (size_t i = 0; i < block.vtx.size(); i++)
+    {
+        CMMRProof blockProof, cachedProof;
+        int txIndex = -1;
+        EXPECT_TRUE(blockView.GetProof(blockProof, i));
+        EXPECT_TRUE(GetBlockTxRootProof(pindex, block.GetMMRNode(i).hash, cachedProof, txIndex));
+        EXPECT_EQ(txIndex, (int)i);
+        EXPECT_TRUE(GetHash(cachedProof) == GetHash(blockProof));
+    }
+}
+
+TEST(TestBlockMMRCache, testMatchesBlock)
+{
+    CBlockMMRDB *psaveDB = pblockmmrdb;
+    pblockmmrdb = new CBlockMMRDB(1 << 20, 100, true);
+
+    for (int nTx : {1, 2, 7, 64})
+    {
+        // built from the block, then added to both caches
+        CBlock block = TestBlock(nTx);
+        uint256 hash = block.GetHash();
+        CBlockIndex index(block);
+        index.phashBlock = &hash;
+
+        BlockTxRootMMRangeRef mmRange;
+        EXPECT_TRUE(GetBlockTxRootMMR(&index, mmRange, &block));
+        CheckSameMMR(block, &index, mmRange);
+
+        std::vector<uint256> vTxRoots;
+        EXPECT_TRUE(pblockmmrdb->ReadTxRoots(hash, vTxRoots));
+        EXPECT_EQ(vTxRoots.size(), block.vtx.size());
+
+        // a block only the disk cache knows is rebuilt from its leaves, without the block, which
+        // this index has no data for
+        CBlock diskBlock = TestBlock(nTx);
+        uint256 diskHash = diskBlock.GetHash();
+        CBlockIndex diskIndex(diskBlock);
+        diskIndex.phashBlock = &diskHash;
+        EXPECT_FALSE(diskIndex.nStatus & BLOCK_HAVE_DATA);
+
+        vTxRoots.clear();
+        for (size_t i = 0; i < diskBlock.vtx.size(); i++)
+        {
+            vTxRoots.push_back(diskBlock.GetMMRNode(i).hash);
+        }
+        EXPECT_TRUE(pblockmmrdb->WriteTxRoots(diskHash, vTxRoots));
+
+        BlockTxRootMMRangeRef diskRange;
+        EXPECT_TRUE(GetBlockTxRootMMR(&diskIndex, diskRange));
+        CheckSameMMR(diskBlock, &diskIndex, diskRange);
+    }
+
+    // the oldest entries are dropped once more than the limit are held
+    delete pblockmmrdb;
+    pblockmmrdb = new CBlockMMRDB(1 << 20, 2, true);
+    std::vector<uint256> vTxRoots(1, GetRandHash()), vRead;
+    uint256 hashes[3] = {GetRandHash(), GetRandHash(), GetRandHash()};
+    for (const uint256 &hash : hashes)
+    {
+        EXPECT_TRUE(pblockmmrdb->WriteTxRoots(hash, vTxRoots));
+    }
+    EXPECT_FALSE(pblockmmrdb->ReadTxRoots(hashes[0], vRead));
+    EXPECT_TRUE(pblockmmrdb->ReadTxRoots(hashes[2], vRead));
+
+    delete pblockmmrdb;
+    pblockmmrdb = psaveDB;
+}
+
+TEST(TestBlockMMRCache, testMemoCleared)
+{
+    CBlock block = TestBlock(5);
+    CBlock other = TestBlock(5);
+    uint256 otherRoot = BlockMMView(other.GetBlockMMRTree()).GetRoot();
+
+    // reading a block with as many transactions into the same object must not reuse its roots
+    block.GetBlockMMRTree();
+    EXPECT_EQ(block.vMMRNodes.size(), block.vtx.size());
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    ss << other;
+    ss >> block;
+    EXPECT_TRUE(block.vMMRNodes.empty());
+    EXPECT_TRUE(BlockMMView(block.GetBlockMMRTree()).GetRoot() == otherRoot);
+}
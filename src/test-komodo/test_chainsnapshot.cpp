@@ -0,0 +1,136 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "chainsnapshot.h"
+
+#include "chain.h"
+#include "main.h"
+#include "random.h"
+#include "script/script.h"
+#include "txdb.h"
+#include "util.h"
+
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+
+#include "testutils.h"
+
+// the snapshot is written from the global chainstate database, which setupChain creates
+class TestChainSnapshot : public ::testing::Test {
+public:
+    uint256 txid;
+
+    static void SetUpTestCase() { setupChain(); }
+
+    virtual void SetUp()
+    {
+        // a coin to find in the loaded chainstate
+        LOCK(cs_main);
+        txid = GetRandHash();
+        CCoinsModifier coins = pcoinsTip->ModifyCoins(txid);
+        coins->fCoinBase = false;
+        coins->nVersion = 1;
+        coins->nHeight = 1;
+        coins->vout.resize(1);
+        coins->vout[0] = CTxOut(COIN, CScript() << OP_TRUE);
+    }
+
+    bool DumpSnapshot(boost::filesystem::path &path, CChainstateSnapshotInfo &info)
+    {
+        path = GetDataDir() / "chainstate.snapshot";
+        std::string strError;
+        bool fDumped = DumpChainstateSnapshot(path, info, strError);
+        EXPECT_TRUE(fDumped) << strError;
+        return fDumped;
+    }
+};
+
+TEST_F(TestChainSnapshot, testRoundTrip)
+{
+    CChainstateSnapshotInfo info;
+    boost::filesystem::path path;
+    ASSERT_TRUE(DumpSnapshot(path, info));
+    EXPECT_TRUE(info.hashBlock == chainActive.Tip()->GetBlockHash());
+    EXPECT_EQ(info.nHeight, chainActive.Height());
+
+    CCoinsViewDB coinsdb(1 << 20, true);
+    CBlockTreeDB blocktree(1 << 20, true);
+    CChainstateSnapshotInfo loadInfo;
+    std::string strError;
+    EXPECT_TRUE(LoadChainstateSnapshot(path, coinsdb, blocktree, loadInfo, strError)) << strError;
+    EXPECT_TRUE(loadInfo.hashBlock == info.hashBlock);
+    EXPECT_EQ(loadInfo.nRecords, info.nRecords);
+    EXPECT_TRUE(loadInfo.hashChecksum == info.hashChecksum);
+
+    EXPECT_TRUE(coinsdb.GetBestBlock() == info.hashBlock);
+    CCoins coins;
+    EXPECT_TRUE(coinsdb.GetCoins(txid, coins));
+    EXPECT_TRUE(coins.IsAvailable(0) && coins.vout[0].nValue == COIN);
+
+    CDiskBlockIndex diskindex;
+    EXPECT_TRUE(blocktree.Read(std::make_pair('b', info.hashBlock), diskindex));
+    EXPECT_FALSE(diskindex.nStatus & (BLOCK_HAVE_DATA | BLOCK_HAVE_UNDO));
+
+    // the loading node has no transaction index, whatever the node that wrote the snapshot had
+    bool fTxIndex = true;
+    EXPECT_TRUE(blocktree.ReadFlag("txindex", fTxIndex) && !fTxIndex);
+
+    // the load is not finished until it is checked
+    EXPECT_TRUE(IsChainstateSnapshotLoadInterrupted(blocktree));
+    EXPECT_TRUE(FinishChainstateSnapshotLoad(blocktree));
+    EXPECT_FALSE(IsChainstateSnapshotLoadInterrupted(blocktree));
+}
+
+TEST_F(TestChainSnapshot, testChecksumFailure)
+{
+    CChainstateSnapshotInfo info;
+    boost::filesystem::path path;
+    ASSERT_TRUE(DumpSnapshot(path, info));
+
+    // change the last byte of the checksum
+    FILE *file = fopen(path.string().c_str(), "r+b");
+    ASSERT_TRUE(file);
+    ASSERT_EQ(0, fseek(file, -1, SEEK_END));
+    int ch = fgetc(file);
+    ASSERT_TRUE(ch != EOF && fseek(file, -1, SEEK_END) == 0);
+    fputc(ch ^ 0xff, file);
+    fclose(file);
+
+    // nothing is written when the file does not check
+    CCoinsViewDB coinsdb(1 << 20, true);
+    CBlockTreeDB blocktree(1 << 20, true);
+    CChainstateSnapshotInfo loadInfo;
+    std::string strError;
+    EXPECT_FALSE(LoadChainstateSnapshot(path, coinsdb, blocktree, loadInfo, strError));
+    EXPECT_EQ("chainstate snapshot checksum does not match", strError);
+    EXPECT_TRUE(coinsdb.GetDB().IsEmpty());
+    EXPECT_TRUE(blocktree.IsEmpty());
+}
+
+TEST_F(TestChainSnapshot, testInterruptedLoad)
+{
+    CChainstateSnapshotInfo info;
+    boost::filesystem::path path;
+    ASSERT_TRUE(DumpSnapshot(path, info));
+
+    // as a load leaves the databases when it stops part way through
+    CCoinsViewDB coinsdb(1 << 20, true);
+    CBlockTreeDB blocktree(1 << 20, true);
+    uint256 staleTxid = GetRandHash();
+    CCoins staleCoins;
+    staleCoins.vout.push_back(CTxOut(COIN, CScript() << OP_TRUE));
+    EXPECT_TRUE(blocktree.WriteFlag("snapshotloading", true));
+    EXPECT_TRUE(coinsdb.GetDB().Write(std::make_pair('c', staleTxid), staleCoins));
+    EXPECT_TRUE(IsChainstateSnapshotLoadInterrupted(blocktree));
+
+    CChainstateSnapshotInfo loadInfo;
+    std::string strError;
+    EXPECT_TRUE(LoadChainstateSnapshot(path, coinsdb, blocktree, loadInfo, strError)) << strError;
+    CCoins coins;
+    EXPECT_FALSE(coinsdb.GetCoins(staleTxid, coins));
+    EXPECT_TRUE(coinsdb.GetCoins(txid, coins));
+    EXPECT_TRUE(coinsdb.GetBestBlock() == info.hashBlock);
+    EXPECT_TRUE(FinishChainstateSnapshotLoad(blocktree));
+    EXPECT_FALSE(IsChainstateSnapshotLoadInterrupted(blocktree));
+}
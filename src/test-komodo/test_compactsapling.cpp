@@ -0,0 +1,170 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "compactsapling.h"
+
+#include "chain.h"
+#include "main.h"
+#include "primitives/block.h"
+#include "primitives/transaction.h"
+#include "random.h"
+#include "streams.h"
+#include "version.h"
+
+#include <boost/scoped_ptr.hpp>
+#include <gtest/gtest.h>
+
+#include "testutils.h"
+
+class TestCompactSapling : public ::testing::Test {
+public:
+    // the cache is opened under the data directory, which setupChain makes a temporary one
+    static void SetUpTestCase() { setupChain(); }
+
+    static CTransaction SaplingTx(int nSpends, int nOutputs)
+    {
+        CMutableTransaction mtx;
+        mtx.fOverwintered = true;
+        mtx.nVersion = SAPLING_TX_VERSION;
+        mtx.nVersionGroupId = SAPLING_VERSION_GROUP_ID;
+        mtx.vShieldedSpend.resize(nSpends);
+        for (SpendDescription &spend : mtx.vShieldedSpend)
+            spend.nullifier = GetRandHash();
+        mtx.vShieldedOutput.resize(nOutputs);
+        for (OutputDescription &output : mtx.vShieldedOutput)
+        {
+            output.cm = GetRandHash();
+            output.ephemeralKey = GetRandHash();
+            GetRandBytes(output.encCiphertext.begin(), output.encCiphertext.size());
+        }
+        return CTransaction(mtx);
+    }
+
+    static CCompactSaplingBlock CompactBlock()
+    {
+        CBlock block;
+        block.hashPrevBlock = GetRandHash();
+        block.nTime = 1234567;
+        block.vtx.push_back(CTransaction());
+        block.vtx.push_back(SaplingTx(1, 2));
+        return CCompactSaplingBlock(block, 42);
+    }
+};
+
+TEST_F(TestCompactSapling, testCiphertextSize)
+{
+    // ZIP 307 keeps the lead byte, diversifier, value and rcm of the note plaintext
+    EXPECT_EQ(52, COMPACT_SAPLING_CIPHERTEXT_SIZE);
+
+    CTransaction tx = SaplingTx(0, 1);
+    CCompactSaplingTx ctx(tx, 0);
+    ASSERT_EQ(1, ctx.vOutputs.size());
+    const CCompactSaplingOutput &output = ctx.vOutputs[0];
+    EXPECT_TRUE(output.cmu == tx.vShieldedOutput[0].cm);
+    EXPECT_TRUE(output.epk == tx.vShieldedOutput[0].ephemeralKey);
+    EXPECT_TRUE(std::equal(output.ciphertext.begin(), output.ciphertext.end(), tx.vShieldedOutput[0].encCiphertext.begin()));
+
+    // cmu, epk and the ciphertext with no length prefix
+    EXPECT_EQ(32 + 32 + 52, GetSerializeSize(output, SER_NETWORK, PROTOCOL_VERSION));
+    EXPECT_EQ(104, ctx.ToUniValue()["outputs"][0]["ciphertext"].get_str().size());
+}
+
+TEST_F(TestCompactSapling, testRoundTrip)
+{
+    CCompactSaplingBlock block = CompactBlock();
+
+    // only the transaction with Sapling spends or outputs is kept, at its place in the block
+    ASSERT_EQ(1, block.vtx.size());
+    EXPECT_EQ(1, block.vtx[0].nIndex);
+    EXPECT_EQ(1, block.vtx[0].vNullifiers.size());
+    EXPECT_EQ(2, block.vtx[0].vOutputs.size());
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << block;
+    std::string strSerialized = ss.str();
+    CCompactSaplingBlock read;
+    ss >> read;
+    EXPECT_TRUE(ss.empty());
+
+    EXPECT_EQ(block.nHeight, read.nHeight);
+    EXPECT_TRUE(block.hash == read.hash);
+    EXPECT_TRUE(block.hashPrevBlock == read.hashPrevBlock);
+    EXPECT_EQ(block.nTime, read.nTime);
+    ASSERT_EQ(1, read.vtx.size());
+    EXPECT_EQ(block.vtx[0].nIndex, read.vtx[0].nIndex);
+    EXPECT_TRUE(block.vtx[0].txid == read.vtx[0].txid);
+    EXPECT_TRUE(block.vtx[0].vNullifiers == read.vtx[0].vNullifiers);
+    ASSERT_EQ(2, read.vtx[0].vOutputs.size());
+    for (int i = 0; i < 2; i++)
+    {
+        EXPECT_TRUE(block.vtx[0].vOutputs[i].cmu == read.vtx[0].vOutputs[i].cmu);
+        EXPECT_TRUE(block.vtx[0].vOutputs[i].epk == read.vtx[0].vOutputs[i].epk);
+        EXPECT_TRUE(block.vtx[0].vOutputs[i].ciphertext == read.vtx[0].vOutputs[i].ciphertext);
+    }
+    EXPECT_EQ(block.ToUniValue().write(), read.ToUniValue().write());
+
+    CDataStream ssRead(SER_NETWORK, PROTOCOL_VERSION);
+    ssRead << read;
+    EXPECT_EQ(strSerialized, ssRead.str());
+}
+
+TEST_F(TestCompactSapling, testCacheEviction)
+{
+    std::vector<CCompactSaplingBlock> vBlocks;
+    for (int i = 0; i < 4; i++)
+        vBlocks.push_back(CompactBlock());
+
+    {
+        CCompactSaplingDB db(1 << 20, false, true, 2);
+        CCompactSaplingBlock read;
+        EXPECT_TRUE(db.WriteBlock(vBlocks[0]));
+        EXPECT_TRUE(db.WriteBlock(vBlocks[1]));
+        // writing a cached block again does not queue it twice
+        EXPECT_TRUE(db.WriteBlock(vBlocks[0]));
+        EXPECT_EQ(2, db.GetBlockCount());
+
+        EXPECT_TRUE(db.WriteBlock(vBlocks[2]));
+        EXPECT_EQ(2, db.GetBlockCount());
+        EXPECT_FALSE(db.ReadBlock(vBlocks[0].hash, read));
+        EXPECT_TRUE(db.ReadBlock(vBlocks[1].hash, read));
+        EXPECT_TRUE(db.ReadBlock(vBlocks[2].hash, read));
+        EXPECT_TRUE(read.hash == vBlocks[2].hash);
+    }
+
+    // the queue is kept across restarts
+    CCompactSaplingDB db(1 << 20, false, false, 2);
+    CCompactSaplingBlock read;
+    EXPECT_EQ(2, db.GetBlockCount());
+    EXPECT_TRUE(db.WriteBlock(vBlocks[3]));
+    EXPECT_EQ(2, db.GetBlockCount());
+    EXPECT_FALSE(db.ReadBlock(vBlocks[1].hash, read));
+    EXPECT_TRUE(db.ReadBlock(vBlocks[2].hash, read));
+    EXPECT_TRUE(db.ReadBlock(vBlocks[3].hash, read));
+}
+
+TEST_F(TestCompactSapling, testGetFromCache)
+{
+    const CBlockIndex *pindex;
+    {
+        LOCK(cs_main);
+        pindex = chainActive.Tip();
+    }
+    ASSERT_TRUE(pindex != NULL);
+
+    pcompactsapling = new CCompactSaplingDB(1 << 20, true, true);
+    CCompactSaplingBlock block, cached;
+    EXPECT_FALSE(pcompactsapling->ReadBlock(pindex->GetBlockHash(), cached));
+    EXPECT_TRUE(GetCompactSaplingBlock(pindex, block));
+    EXPECT_TRUE(block.hash == pindex->GetBlockHash());
+    EXPECT_EQ(pindex->GetHeight(), block.nHeight);
+
+    // the first request fills the cache, which later ones are served from
+    EXPECT_TRUE(pcompactsapling->ReadBlock(pindex->GetBlockHash(), cached));
+    EXPECT_EQ(1, pcompactsapling->GetBlockCount());
+    EXPECT_TRUE(GetCompactSaplingBlock(pindex, cached));
+    EXPECT_EQ(block.ToUniValue().write(), cached.ToUniValue().write());
+
+    delete pcompactsapling;
+    pcompactsapling = NULL;
+}
@@ -0,0 +1,80 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "dbwrapper.h"
+#include "random.h"
+#include "uint256.h"
+#include "util.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <gtest/gtest.h>
+
+using namespace boost::filesystem;
+
+// Test per-database options, including a database without a bloom filter
+TEST(TestDBWrapper, testOptions)
+{
+    {
+        CDBOptions dbOptions;
+        dbOptions.nBloomBits = 0;
+        dbOptions.nBlockSize = 1024;
+        dbOptions.nBlockCachePercent = 70;
+        dbOptions.nWriteBufferPercent = 10;
+
+        path ph = temp_directory_path() / unique_path();
+        CDBWrapper dbw(ph, (1 << 20), dbOptions, true, false);
+        char key = 'o';
+        uint256 in = GetRandHash();
+        uint256 res;
+
+        EXPECT_TRUE(dbw.Write(key, in));
+        EXPECT_TRUE(dbw.Read(key, res));
+        EXPECT_EQ(res.ToString(), in.ToString());
+        EXPECT_FALSE(dbw.Exists('p'));
+    }
+    {
+        mapArgs["-testdbbloombits"] = "100";
+        mapArgs["-testdbcacheshare"] = "80";
+        mapArgs["-testdbwritebuffer"] = "50";
+        CDBOptions dbOptions;
+        dbOptions.ApplyArgs("testdb");
+        EXPECT_EQ(dbOptions.nBloomBits, 64);
+        EXPECT_EQ(dbOptions.nBlockCachePercent, 80);
+        EXPECT_EQ(dbOptions.nWriteBufferPercent, 10);
+        mapArgs.erase("-testdbbloombits");
+        mapArgs.erase("-testdbcacheshare");
+        mapArgs.erase("-testdbwritebuffer");
+    }
+}
+
+// Test that reads through a snapshot ignore later writes
+TEST(TestDBWrapper, testSnapshot)
+{
+    path ph = temp_directory_path() / unique_path();
+    CDBWrapper dbw(ph, (1 << 20), true, false);
+
+    char key = 's';
+    char key2 = 't';
+    uint256 in = GetRandHash();
+    uint256 in2 = GetRandHash();
+    uint256 res;
+
+    EXPECT_TRUE(dbw.Write(key, in));
+    CDBSnapshot snapshot(dbw);
+    EXPECT_TRUE(dbw.Write(key, in2));
+    EXPECT_TRUE(dbw.Write(key2, in2));
+
+    EXPECT_TRUE(dbw.Read(key, res, &snapshot));
+    EXPECT_EQ(res.ToString(), in.ToString());
+    EXPECT_FALSE(dbw.Read(key2, res, &snapshot));
+    EXPECT_TRUE(dbw.Read(key, res));
+    EXPECT_EQ(res.ToString(), in2.ToString());
+
+    boost::scoped_ptr<CDBIterator> it(dbw.NewIterator(&snapshot));
+    int count = 0;
+    for (it->SeekToFirst(); it->Valid(); it->Next())
+        count++;
+    EXPECT_EQ(count, 1);
+}
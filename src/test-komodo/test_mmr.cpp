@@ -0,0 +1,159 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "mmr.h"
+
+#include "hash.h"
+#include "primitives/transaction.h"
+
+#include <gtest/gtest.h>
+
+typedef CMerkleMountainRange<CDefaultMMRNode> TestMMRange;
+typedef CMerkleMountainView<CDefaultMMRNode> TestMMView;
+typedef CMerkleMountainRange<CDefaultMMRPowerNode> TestPowerMMRange;
+typedef CMerkleMountainView<CDefaultMMRPowerNode> TestPowerMMView;
+
+static uint256 TestHash(uint32_t n)
+{
+    return Hash(BEGIN(n), END(n));
+}
+
+// the hash each element is proven with, which for power nodes is the hash before power is added
+static uint256 TestPreHash(uint32_t n)
+{
+    return TestHash(n + 1000000);
+}
+
+static CDefaultMMRPowerNode TestPowerLeaf(uint32_t n)
+{
+    uint256 power = ArithToUint256((arith_uint256(n % 7) << 128) | arith_uint256(n + 1));
+    return CDefaultMMRPowerNode(CDefaultMMRPowerNode::HashObj(TestPreHash(n), power), power);
+}
+
+TEST(TestMMR, testBatchedProofs)
+{
+    TestMMRange mmr;
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        mmr.Add(CDefaultMMRNode(TestHash(i)));
+    }
+
+    for (uint64_t viewSize : {1, 2, 3, 7, 64, 513, 1000})
+    {
+        TestMMView view(mmr, viewSize);
+        std::vector<uint64_t> positions({0, viewSize - 1, viewSize / 2, viewSize / 3});
+        std::vector<CMMRProof> proofs;
+        EXPECT_TRUE(view.GetProofs(proofs, positions));
+        EXPECT_EQ(proofs.size(), positions.size());
+        for (int i = 0; i < positions.size(); i++)
+        {
+            CMMRProof oneProof;
+            EXPECT_TRUE(view.GetProof(oneProof, positions[i]));
+            EXPECT_TRUE(GetHash(oneProof) == GetHash(proofs[i]));
+        }
+    }
+}
+
+TEST(TestMMR, testMultiproof)
+{
+    TestMMRange mmr;
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        mmr.Add(CDefaultMMRNode(TestHash(i)));
+    }
+
+    for (uint64_t viewSize : {1, 2, 3, 5, 64, 100, 777, 1000})
+    {
+        TestMMView view(mmr, viewSize);
+        std::vector<uint64_t> positions;
+        for (uint64_t pos = 0; pos < viewSize; pos += 1 + (pos % 13))
+        {
+            positions.push_back(pos);
+        }
+
+        CMMRProof multiProof;
+        EXPECT_TRUE(view.GetMultiProof(multiProof, positions));
+
+        std::vector<uint256> hashes;
+        for (auto pos : positions)
+        {
+            hashes.push_back(TestHash(pos));
+        }
+        EXPECT_TRUE(multiProof.CheckProof(hashes) == view.GetRoot());
+
+        // survives serialization
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << multiProof;
+        CMMRProof readProof;
+        ss >> readProof;
+        EXPECT_TRUE(readProof.CheckProof(hashes) == view.GetRoot());
+
+        // never larger than the proofs of more than one element it replaces
+        size_t separateSize = 0;
+        for (auto pos : positions)
+        {
+            CMMRProof oneProof;
+            EXPECT_TRUE(view.GetProof(oneProof, pos));
+            separateSize += GetSerializeSize(oneProof, SER_NETWORK, PROTOCOL_VERSION);
+        }
+        EXPECT_TRUE(positions.size() == 1 || GetSerializeSize(multiProof, SER_NETWORK, PROTOCOL_VERSION) <= separateSize);
+
+        if (positions.size() > 1)
+        {
+            std::vector<uint256> badHashes(hashes);
+            std::swap(badHashes[0], badHashes[1]);
+            EXPECT_TRUE(multiProof.CheckProof(badHashes) != view.GetRoot());
+            badHashes.pop_back();
+            EXPECT_TRUE(multiProof.CheckProof(badHashes).IsNull());
+        }
+    }
+
+    // one element checks through the multi element check, while the single hash check that
+    // consensus uses, and partial transaction proofs, reject any multi branch
+    TestMMView view(mmr, 600);
+    CMMRProof multiProof;
+    EXPECT_TRUE(view.GetMultiProof(multiProof, std::vector<uint64_t>({123})));
+    EXPECT_TRUE(multiProof.HasMultiBranch());
+    EXPECT_TRUE(multiProof.CheckProof(std::vector<uint256>({TestHash(123)})) == view.GetRoot());
+    EXPECT_TRUE(multiProof.CheckProof(TestHash(123)).IsNull());
+    EXPECT_FALSE(CPartialTransactionProof(multiProof, std::vector<CTransactionComponentProof>()).IsValid());
+
+    CMMRProof singleProof;
+    EXPECT_TRUE(view.GetProof(singleProof, 123));
+    EXPECT_FALSE(singleProof.HasMultiBranch());
+    EXPECT_TRUE(CPartialTransactionProof(singleProof, std::vector<CTransactionComponentProof>()).IsValid());
+
+    EXPECT_FALSE(view.GetMultiProof(multiProof, std::vector<uint64_t>({600})));
+}
+
+TEST(TestMMR, testPowerMultiproof)
+{
+    TestPowerMMRange mmr;
+    for (uint32_t i = 0; i < 300; i++)
+    {
+        mmr.Add(TestPowerLeaf(i));
+    }
+
+    TestPowerMMView view(mmr, 299);
+    std::vector<uint64_t> positions({3, 4, 100, 150, 298});
+    std::vector<uint256> hashes;
+    for (auto pos : positions)
+    {
+        hashes.push_back(TestPreHash(pos));
+
+        CMMRProof oneProof;
+        EXPECT_TRUE(view.GetProof(oneProof, pos));
+        EXPECT_TRUE(oneProof.CheckProof(TestPreHash(pos)) == view.GetRoot());
+    }
+
+    CMMRProof multiProof;
+    EXPECT_TRUE(view.GetMultiProof(multiProof, positions));
+    EXPECT_TRUE(multiProof.CheckProof(hashes) == view.GetRoot());
+
+    // power out of range for a parent fails instead of asserting
+    CMMRPowerNodeMultiBranch &branch = *(CMMRPowerNodeMultiBranch *)multiProof.proofSequence[0];
+    EXPECT_TRUE(branch.nodes.size() > 1);
+    branch.nodes[1] = ArithToUint256(~arith_uint256(0));
+    EXPECT_TRUE(multiProof.CheckProof(hashes).IsNull());
+}
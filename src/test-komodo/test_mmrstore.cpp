@@ -0,0 +1,93 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "mmrstore.h"
+
+#include "hash.h"
+#include "random.h"
+#include "util.h"
+
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+
+typedef CMerkleMountainRange<CDefaultMMRNode, CMMRStoreLayer<CDefaultMMRNode>, CMMRStoreLayer<CDefaultMMRNode>> StoreMMRange;
+typedef CMerkleMountainView<CDefaultMMRNode, CMMRStoreLayer<CDefaultMMRNode>, CMMRStoreLayer<CDefaultMMRNode>> StoreMMView;
+typedef CMerkleMountainRange<CDefaultMMRNode> MemoryMMRange;
+typedef CMerkleMountainView<CDefaultMMRNode> MemoryMMView;
+
+static CDefaultMMRNode TestLeaf(uint32_t n)
+{
+    return CDefaultMMRNode(Hash(BEGIN(n), END(n)));
+}
+
+TEST(TestMMRStore, testPostOrder)
+{
+    // leaves 0 1 | parent | leaves 3 4 | parent | grandparent | leaf 7 ...
+    EXPECT_EQ(CMMRNodeStore::NodePos(0, 0), 0);
+    EXPECT_EQ(CMMRNodeStore::NodePos(0, 1), 1);
+    EXPECT_EQ(CMMRNodeStore::NodePos(1, 0), 2);
+    EXPECT_EQ(CMMRNodeStore::NodePos(0, 2), 3);
+    EXPECT_EQ(CMMRNodeStore::NodePos(1, 1), 5);
+    EXPECT_EQ(CMMRNodeStore::NodePos(2, 0), 6);
+    EXPECT_EQ(CMMRNodeStore::NodePos(0, 4), 7);
+    EXPECT_EQ(CMMRNodeStore::NodePos(3, 0), 14);
+    EXPECT_EQ(CMMRNodeStore::NodeCount(4), 7);
+    EXPECT_EQ(CMMRNodeStore::NodeCount(5), 8);
+}
+
+TEST(TestMMRStore, testFileRoundtrip)
+{
+    boost::filesystem::path path = GetTempPath() / strprintf("test_mmrstore_%d", GetRand(1 << 30));
+    MemoryMMRange memoryRange;
+    uint256 rootAtTruncation;
+
+    {
+        CMMRNodeStore store(sizeof(CDefaultMMRNode));
+        EXPECT_TRUE(store.Open(path));
+        StoreMMRange storeRange(CMMRStoreLayer<CDefaultMMRNode>(&store, 0));
+
+        // enough nodes for the file to grow past its first mapping
+        for (uint32_t i = 0; i < 100000; i++)
+        {
+            storeRange.Add(TestLeaf(i));
+            memoryRange.Add(TestLeaf(i));
+        }
+        EXPECT_TRUE(StoreMMView(storeRange).GetRoot() == MemoryMMView(memoryRange).GetRoot());
+
+        CMMRProof storeProof, memoryProof;
+        StoreMMView storeView(storeRange, 5000);
+        MemoryMMView memoryView(memoryRange, 5000);
+        EXPECT_TRUE(storeView.GetProof(storeProof, 1234));
+        EXPECT_TRUE(memoryView.GetProof(memoryProof, 1234));
+        EXPECT_TRUE(GetHash(storeProof) == GetHash(memoryProof));
+
+        EXPECT_TRUE(store.Flush(storeRange.size()));
+
+        // a reorg drops the saved leaves above it before their nodes are replaced
+        storeRange.Truncate(60000);
+        memoryRange.Truncate(60000);
+        EXPECT_TRUE(store.Truncate(60000));
+        rootAtTruncation = MemoryMMView(memoryRange).GetRoot();
+        for (uint32_t i = 0; i < 10; i++)
+        {
+            storeRange.Add(TestLeaf(i + 1000000));
+        }
+    }
+
+    CMMRNodeStore store(sizeof(CDefaultMMRNode));
+    EXPECT_TRUE(store.Open(path));
+    EXPECT_EQ(store.SavedLeaves(), 60000);
+
+    StoreMMRange storeRange(CMMRStoreLayer<CDefaultMMRNode>(&store, 0));
+    storeRange.layer0.resize(store.SavedLeaves());
+    for (uint64_t layerSize = store.SavedLeaves() >> 1, height = 1; layerSize; layerSize >>= 1, height++)
+    {
+        storeRange.upperNodes.push_back(CMMRStoreLayer<CDefaultMMRNode>(&store, height));
+        storeRange.upperNodes.back().resize(layerSize);
+    }
+    EXPECT_TRUE(StoreMMView(storeRange).GetRoot() == rootAtTruncation);
+
+    store.Close();
+    boost::filesystem::remove(path);
+}
@@ -0,0 +1,48 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "pbaas/notarizedsync.h"
+
+#include "chain.h"
+#include "random.h"
+
+#include <gtest/gtest.h>
+
+TEST(TestNotarizedSync, testHeaderMMRRootMatchesChain)
+{
+    const int nHeaders = 300;
+    std::vector<uint256> vHashes(nHeaders);
+    std::vector<CBlockIndex> vIndex(nHeaders);
+    for (int i = 0; i < nHeaders; i++)
+    {
+        vHashes[i] = GetRandHash();
+        vIndex[i].SetHeight(i);
+        vIndex[i].pprev = i ? &vIndex[i - 1] : NULL;
+        vIndex[i].phashBlock = &vHashes[i];
+        vIndex[i].hashMerkleRoot = GetRandHash();
+        vIndex[i].nBits = 0x200f0f0f;
+        vIndex[i].nNonce = GetRandHash();
+        vIndex[i].BuildSkip();
+    }
+
+    // headers are added to one range as the chain grows, as they are between checks of newer roots
+    CChain chain;
+    CHeaderMMRPeaks peaks;
+    EXPECT_TRUE(peaks.GetRoot().IsNull());
+    for (int i = 0; i < nHeaders; i++)
+    {
+        chain.SetTip(&vIndex[i]);
+        peaks.Add(vIndex[i].GetBlockMMRNode());
+        EXPECT_EQ(peaks.size(), (uint64_t)(i + 1));
+        EXPECT_TRUE(peaks.GetRoot() == chain.GetMMV().GetRoot());
+    }
+
+    // and the same root is reached when they are added all at once
+    CHeaderMMRPeaks allPeaks;
+    for (int i = 0; i < nHeaders; i++)
+    {
+        allPeaks.Add(vIndex[i].GetBlockMMRNode());
+    }
+    EXPECT_TRUE(allPeaks.GetRoot() == peaks.GetRoot());
+}
@@ -0,0 +1,49 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "perfstats.h"
+
+#include <gtest/gtest.h>
+
+TEST(TestPerfStats, testHistogram)
+{
+    CLatencyHistogram histogram;
+    histogram.Add(0);
+    histogram.Add(1);
+    histogram.Add(3);
+    histogram.Add(1000);
+    histogram.Add(-5);
+    histogram.Add((int64_t)1 << 40);
+
+    std::vector<uint64_t> buckets = histogram.GetBuckets();
+    EXPECT_EQ(buckets.size(), CLatencyHistogram::BUCKETS);
+    EXPECT_EQ(buckets[0], 2);   // nothing is under zero
+    EXPECT_EQ(buckets[1], 1);
+    EXPECT_EQ(buckets[2], 1);
+    EXPECT_EQ(buckets[10], 1);  // 1000 is under 1024
+    EXPECT_EQ(buckets.back(), 1);
+    EXPECT_EQ(histogram.Count(), 6);
+    EXPECT_EQ(histogram.TotalMicros(), 1004 + ((uint64_t)1 << 40));
+
+    EXPECT_EQ(CLatencyHistogram::Percentile(buckets, 6, 0.5), 2);
+    EXPECT_EQ(CLatencyHistogram::Percentile(buckets, 6, 0.8), 1024);
+    EXPECT_EQ(CLatencyHistogram::Percentile(buckets, 6, 1.0), CLatencyHistogram::BucketLimit(CLatencyHistogram::BUCKETS - 1));
+}
+
+TEST(TestPerfStats, testPrometheus)
+{
+    GetMessagePerfHistogram("inv").Add(5);
+    GetMessagePerfHistogram("madeup").Add(5);
+    EXPECT_TRUE(&GetMessagePerfHistogram("madeup") == &GetMessagePerfHistogram("other"));
+    {
+        CPerfTimer timer(PERF_LOOKUPIDENTITY);
+    }
+
+    std::string text = GetPerfStatsPrometheus();
+    EXPECT_TRUE(text.find("# TYPE verus_latency_seconds histogram\n") != std::string::npos);
+    EXPECT_TRUE(text.find("verus_latency_seconds_count{operation=\"lookupidentity\"} ") != std::string::npos);
+    EXPECT_TRUE(text.find("verus_message_latency_seconds_bucket{command=\"inv\",le=\"0.000008\"} ") != std::string::npos);
+    EXPECT_TRUE(text.find("command=\"madeup\"") == std::string::npos);
+    EXPECT_TRUE(GetMessagePerfHistogram("other").Count() >= 1);
+}
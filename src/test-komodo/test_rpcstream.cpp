@@ -0,0 +1,178 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "rpc/server.h"
+#include "rpc/client.h"
+#include "rpc/jsonstream.h"
+#include "rpc/pbaasrpc.h"
+#include "rpc/register.h"
+
+#include "key_io.h"
+#include "main.h"
+#include "utilstrencodings.h"
+
+#include <boost/algorithm/string.hpp>
+#include <gtest/gtest.h>
+
+#include <univalue.h>
+
+#include "testutils.h"
+
+struct JSONStreamCollector
+{
+    std::vector<std::string> vChunks;
+    bool fAccept;
+
+    JSONStreamCollector() : fAccept(true) {}
+    bool operator()(const std::string& strChunk)
+    {
+        vChunks.push_back(strChunk);
+        return fAccept;
+    }
+};
+
+class TestRPCStream : public ::testing::Test {
+public:
+    static void SetUpTestCase()
+    {
+        setupChain();
+        RegisterAllCoreRPCCommands(tableRPC);
+    }
+
+    UniValue CallRPC(const std::string& args)
+    {
+        std::vector<std::string> vArgs;
+        boost::split(vArgs, args, boost::is_any_of(" \t"));
+        std::string strMethod = vArgs[0];
+        vArgs.erase(vArgs.begin());
+        UniValue params = RPCConvertValues(strMethod, vArgs);
+        const CRPCCommand *pcmd = tableRPC[strMethod];
+        EXPECT_TRUE(pcmd) << strMethod;
+        if (!pcmd)
+            return NullUniValue;
+        try {
+            return pcmd->actor(params, false);
+        } catch (const UniValue& objError) {
+            ADD_FAILURE() << strMethod << ": " << find_value(objError, "message").get_str();
+        }
+        return NullUniValue;
+    }
+};
+
+TEST_F(TestRPCStream, testBatchOrder)
+{
+    if (RPCIsInWarmup(NULL))
+        SetRPCWarmupFinished();
+    StartRPCBatchThreads(4);
+
+    // decodescript runs in parallel, an unknown method splits the batch into two parallel runs
+    UniValue batch(UniValue::VARR);
+    std::vector<std::string> vExpected;
+    for (int i = 0; i < 64; i++) {
+        UniValue req(UniValue::VOBJ);
+        req.push_back(Pair("id", i));
+        if (i == 32) {
+            req.push_back(Pair("method", "nosuchmethod"));
+            req.push_back(Pair("params", UniValue(UniValue::VARR)));
+            vExpected.push_back("");
+        } else {
+            CScript script = CScript() << i << OP_DROP << OP_TRUE;
+            UniValue params(UniValue::VARR);
+            params.push_back(HexStr(script.begin(), script.end()));
+            req.push_back(Pair("method", "decodescript"));
+            req.push_back(Pair("params", params));
+            vExpected.push_back(EncodeDestination(CScriptID(script)));
+        }
+        batch.push_back(req);
+    }
+
+    UniValue reply;
+    EXPECT_TRUE(reply.read(JSONRPCExecBatch(batch)));
+    StopRPCBatchThreads();
+
+    ASSERT_TRUE(reply.isArray());
+    ASSERT_EQ(batch.size(), reply.size());
+    for (int i = 0; i < 64; i++) {
+        EXPECT_EQ(i, find_value(reply[i], "id").get_int());
+        if (vExpected[i].empty())
+            EXPECT_FALSE(find_value(reply[i], "error").isNull());
+        else
+            EXPECT_EQ(vExpected[i], find_value(find_value(reply[i], "result"), "p2sh").get_str());
+    }
+}
+
+TEST_F(TestRPCStream, testWriter)
+{
+    UniValue value;
+    ASSERT_TRUE(value.read("{\"a\":[1,2.5,\"x\\\"y\",true,null,{}],\"b\":{\"c\":[],\"d\":\"\\u0001\"},\"e\":-7}"));
+
+    // written in one piece, as a value or built up by hand, it matches UniValue::write
+    JSONStreamCollector whole;
+    CJSONStreamWriter writer(boost::ref(whole));
+    writer.Value(value);
+    EXPECT_TRUE(whole.vChunks.empty());
+    EXPECT_EQ(value.write(), writer.TakeBuffer());
+
+    writer.BeginObject();
+    writer.Key("a");
+    EXPECT_TRUE(writer.AwaitingValue());
+    writer.BeginArray();
+    for (const UniValue& element : value["a"].getValues())
+        writer.Value(element);
+    writer.EndArray();
+    EXPECT_FALSE(writer.AwaitingValue());
+    writer.Pair("b", value["b"]);
+    writer.Pair("e", value["e"]);
+    writer.EndObject();
+    EXPECT_EQ(value.write(), writer.TakeBuffer());
+
+    // with a tiny flush size the sink sees the same text in pieces
+    JSONStreamCollector pieces;
+    CJSONStreamWriter smallWriter(boost::ref(pieces), 4);
+    smallWriter.Value(value);
+    EXPECT_TRUE(smallWriter.Flush());
+    EXPECT_GT(pieces.vChunks.size(), 1);
+    EXPECT_EQ(value.write(), boost::algorithm::join(pieces.vChunks, ""));
+
+    // once the sink refuses output, the rest is dropped
+    JSONStreamCollector refusing;
+    refusing.fAccept = false;
+    CJSONStreamWriter refusedWriter(boost::ref(refusing), 4);
+    refusedWriter.Value(value);
+    EXPECT_FALSE(refusedWriter.IsGood());
+    EXPECT_EQ(1, refusing.vChunks.size());
+    EXPECT_FALSE(refusedWriter.Flush());
+}
+
+TEST_F(TestRPCStream, testResultStreamClaim)
+{
+    JSONStreamCollector sink;
+    CJSONStreamWriter writer(boost::ref(sink));
+    EXPECT_TRUE(ClaimRPCResultStream("getrawmempool") == NULL);
+    {
+        CRPCResultStreamScope scope("getrawmempool", &writer);
+        // only the method the stream is offered to can claim it, and only once
+        EXPECT_TRUE(ClaimRPCResultStream("getblock") == NULL);
+        EXPECT_TRUE(ClaimRPCResultStream("getrawmempool") == &writer);
+        EXPECT_TRUE(ClaimRPCResultStream("getrawmempool") == NULL);
+    }
+    EXPECT_TRUE(ClaimRPCResultStream("getrawmempool") == NULL);
+}
+
+TEST_F(TestRPCStream, testResultStreamGetBlock)
+{
+    // the genesis block written transaction by transaction reads the same as the returned value
+    UniValue expected = CallRPC("getblock 0 2");
+    EXPECT_GT(expected["tx"].size(), 0);
+
+    JSONStreamCollector sink;
+    CJSONStreamWriter writer(boost::ref(sink), 16);
+    {
+        CRPCResultStreamScope scope("getblock", &writer);
+        EXPECT_TRUE(CallRPC("getblock 0 2").isNull());
+    }
+    EXPECT_TRUE(writer.Flush());
+    EXPECT_GT(sink.vChunks.size(), 1);
+    EXPECT_EQ(expected.write(), boost::algorithm::join(sink.vChunks, ""));
+}
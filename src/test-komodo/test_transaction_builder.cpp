@@ -0,0 +1,161 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "transaction_builder.h"
+
+#include "chainparams.h"
+#include "key.h"
+#include "keystore.h"
+#include "util.h"
+#include "utiltime.h"
+#include "zcash/Address.hpp"
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+#include <gtest/gtest.h>
+#include <librustzcash.h>
+
+// -provingtxs is not set in the tests
+static const int PROVING_SLOTS = DEFAULT_PROVING_TXS;
+
+// takes every slot on its own thread, so a slot that was never released fails the test instead of hanging it
+static bool AllSlotsFree()
+{
+    boost::thread t([]() {
+        std::vector<std::unique_ptr<CSaplingProvingSlot>> slots;
+        for (int i = 0; i < PROVING_SLOTS; i++)
+            slots.emplace_back(new CSaplingProvingSlot());
+    });
+    if (t.timed_join(boost::posix_time::seconds(10)))
+        return true;
+    t.detach();
+    return false;
+}
+
+// proving needs the Sapling parameters, which the tests only have where zcash-fetch-params has been run
+static bool LoadSaplingParams()
+{
+    static bool fLoaded = false;
+    if (fLoaded)
+        return true;
+
+    boost::filesystem::path sapling_spend = ZC_GetParamsDir() / "sapling-spend.params";
+    boost::filesystem::path sapling_output = ZC_GetParamsDir() / "sapling-output.params";
+    boost::filesystem::path sprout_groth16 = ZC_GetParamsDir() / "sprout-groth16.params";
+    if (!boost::filesystem::exists(sapling_spend) || !boost::filesystem::exists(sapling_output) || !boost::filesystem::exists(sprout_groth16))
+        return false;
+
+    auto sapling_spend_str = sapling_spend.native();
+    auto sapling_output_str = sapling_output.native();
+    auto sprout_groth16_str = sprout_groth16.native();
+    librustzcash_init_zksnark_params(
+        reinterpret_cast<const codeunit*>(sapling_spend_str.c_str()),
+        sapling_spend_str.length(),
+        "8270785a1a0d0bc77196f000ee6d221c9c9894f55307bd9357c3f0105d31ca63991ab91324160d8f53e2bbd3c2633a6eb8bdf5205d822e7f3f73edac51b2b70c",
+        reinterpret_cast<const codeunit*>(sapling_output_str.c_str()),
+        sapling_output_str.length(),
+        "657e3d38dbb5cb5e7dd2970e8b03d69b4787dd907285b5a7f0790dcc8072f60bf593b32cc2d1c030e00ff5ae64bf84c5c3beb84ddc841d48264b4a171744d028",
+        reinterpret_cast<const codeunit*>(sprout_groth16_str.c_str()),
+        sprout_groth16_str.length(),
+        "e9b238411bd6c0ec4791e9d04245ec350c9c5744f5610dfcce4365d5ca49dfefd5054e371842b3f88fa1b9d7e8e075249b3ebabd167fa8b0f3161292d36c180a"
+    );
+    fLoaded = true;
+    return true;
+}
+
+TEST(TestSaplingProvingSlot, testLimit)
+{
+    std::atomic<int> nMaxHeld(0), nThrown(0);
+    boost::thread_group threads;
+    for (int i = 0; i < PROVING_SLOTS + 4; i++)
+    {
+        threads.create_thread([&nMaxHeld, &nThrown, i]() {
+            try {
+                CSaplingProvingSlot slot;
+                int nHeld = CSaplingProvingSlot::Held();
+                int nMax = nMaxHeld;
+                while (nHeld > nMax && !nMaxHeld.compare_exchange_weak(nMax, nHeld)) { }
+                MilliSleep(20);
+                // half of the provers fail, which must not keep their slots
+                if (i % 2)
+                    throw std::runtime_error("proof failed");
+            } catch (const std::runtime_error &e) {
+                nThrown++;
+            }
+        });
+    }
+    threads.join_all();
+
+    EXPECT_GE(nMaxHeld, 1);
+    EXPECT_LE(nMaxHeld, PROVING_SLOTS);
+    EXPECT_EQ((PROVING_SLOTS + 4) / 2, nThrown);
+    EXPECT_EQ(0, CSaplingProvingSlot::Held());
+    EXPECT_TRUE(AllSlotsFree());
+}
+
+TEST(TestSaplingProvingSlot, testBuildWaitsForSlot)
+{
+    if (!LoadSaplingParams())
+    {
+        std::cout << "Sapling parameters not found in " << ZC_GetParamsDir().string() << ", skipping" << std::endl;
+        return;
+    }
+
+    SelectParams(CBaseChainParams::REGTEST);
+    int nOverwinterHeight = Params().GetConsensus().vUpgrades[Consensus::UPGRADE_OVERWINTER].nActivationHeight;
+    int nSaplingHeight = Params().GetConsensus().vUpgrades[Consensus::UPGRADE_SAPLING].nActivationHeight;
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_OVERWINTER, Consensus::NetworkUpgrade::ALWAYS_ACTIVE);
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_SAPLING, Consensus::NetworkUpgrade::ALWAYS_ACTIVE);
+
+    CBasicKeyStore keystore;
+    CKey key;
+    key.MakeNewKey(true);
+    keystore.AddKey(key);
+    auto sk = libzcash::SaplingSpendingKey::random();
+    auto fvk = sk.full_viewing_key();
+    libzcash::diversifier_t d = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    auto pk = *fvk.in_viewing_key().address(d);
+
+    // a shielding transaction, which has one output to prove
+    TransactionBuilder builder(Params().GetConsensus(), 1, &keystore);
+    builder.AddTransparentInput(COutPoint(), GetScriptForDestination(key.GetPubKey().GetID()), 50000);
+    builder.AddSaplingOutput(fvk.ovk, pk, 40000, {});
+
+    // with every slot taken, the builder waits
+    std::vector<std::unique_ptr<CSaplingProvingSlot>> slots;
+    for (int i = 0; i < PROVING_SLOTS; i++)
+        slots.emplace_back(new CSaplingProvingSlot());
+    EXPECT_EQ(PROVING_SLOTS, CSaplingProvingSlot::Held());
+
+    std::atomic<bool> fBuilt(false);
+    boost::optional<CTransaction> tx;
+    boost::thread t([&builder, &fBuilt, &tx]() {
+        TransactionBuilderResult result = builder.Build();
+        if (result.IsTx())
+            tx = result.GetTxOrThrow();
+        fBuilt = true;
+    });
+    MilliSleep(500);
+    EXPECT_FALSE(fBuilt);
+    EXPECT_EQ(PROVING_SLOTS, CSaplingProvingSlot::Held());
+
+    // and proves once one is released, giving it back when done
+    slots.pop_back();
+    EXPECT_TRUE(t.timed_join(boost::posix_time::seconds(120)));
+    EXPECT_TRUE(fBuilt);
+    ASSERT_TRUE(tx != boost::none);
+    EXPECT_EQ(1, tx->vShieldedOutput.size());
+    EXPECT_EQ(PROVING_SLOTS - 1, CSaplingProvingSlot::Held());
+
+    slots.clear();
+    EXPECT_EQ(0, CSaplingProvingSlot::Held());
+    EXPECT_TRUE(AllSlotsFree());
+
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_SAPLING, nSaplingHeight);
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_OVERWINTER, nOverwinterHeight);
+}
@@ -0,0 +1,70 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include <limits>
+#include <sstream>
+#include <string>
+#include <univalue.h>
+
+#include <gtest/gtest.h>
+
+TEST(TestUniValue, testMove)
+{
+    UniValue inner(UniValue::VOBJ);
+    inner.pushKV("name", "martian");
+    inner.pushKV("height", 800);
+    std::string innerJson = inner.write();
+
+    UniValue arr(UniValue::VARR);
+    arr.reserve(2);
+    UniValue copied(inner);
+    arr.push_back(std::move(copied));
+    arr.push_back(inner);
+    EXPECT_EQ(2, arr.size());
+    EXPECT_EQ(innerJson, arr[0].write());
+    EXPECT_EQ(innerJson, arr[1].write());
+
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("first", std::move(arr));
+    obj.push_back(Pair("second", UniValue(inner)));
+    EXPECT_EQ("{\"first\":[" + innerJson + "," + innerJson + "],\"second\":" + innerJson + "}", obj.write());
+
+    UniValue moved(std::move(obj));
+    EXPECT_TRUE(moved.isObject());
+    EXPECT_EQ(2, moved.size());
+    EXPECT_EQ(800, moved["second"]["height"].get_int());
+}
+
+TEST(TestUniValue, testSetInt)
+{
+    EXPECT_EQ("0", UniValue((int64_t)0).getValStr());
+    EXPECT_EQ("-42", UniValue((int64_t)-42).getValStr());
+    EXPECT_EQ("-9223372036854775808", UniValue(std::numeric_limits<int64_t>::min()).getValStr());
+    EXPECT_EQ("9223372036854775807", UniValue(std::numeric_limits<int64_t>::max()).getValStr());
+    EXPECT_EQ("18446744073709551615", UniValue(std::numeric_limits<uint64_t>::max()).getValStr());
+    EXPECT_EQ(std::numeric_limits<int64_t>::min(), UniValue(std::numeric_limits<int64_t>::min()).get_int64());
+}
+
+TEST(TestUniValue, testWriteBuffer)
+{
+    UniValue v;
+    ASSERT_TRUE(v.read("[1.10000000,{\"key1\":\"str\\u0000\",\"key2\":800,\"key3\":{\"name\":\"martian http://test.com\"}}]"));
+
+    std::string out("prefix");
+    v.write(out);
+    EXPECT_EQ("prefix" + v.write(), out);
+
+    std::string pretty;
+    v.write(pretty, 4);
+    EXPECT_EQ(v.write(4), pretty);
+
+    // enough elements that the stream is written in several chunks
+    UniValue arr(UniValue::VARR);
+    for (int i = 0; i < 10000; i++)
+        arr.push_back(v);
+    std::ostringstream os;
+    arr.write(os, 2);
+    EXPECT_EQ(arr.write(2), os.str());
+    EXPECT_GT(os.str().size(), UNIVALUE_STREAM_CHUNK);
+}
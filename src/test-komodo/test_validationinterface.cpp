@@ -0,0 +1,52 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "scheduler.h"
+#include "validationinterface.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <gtest/gtest.h>
+
+static void QueuedTask(std::vector<int>& order, int& nRunning, int& nOverlaps, int n)
+{
+    // callbacks never run at the same time, so none of this needs a lock
+    if (nRunning++)
+        nOverlaps++;
+    boost::this_thread::sleep_for(boost::chrono::microseconds(n % 7));
+    order.push_back(n);
+    nRunning--;
+}
+
+TEST(TestValidationInterface, testQueue)
+{
+    CScheduler scheduler;
+    boost::thread_group threads;
+    for (int i = 0; i < 5; i++)
+        threads.create_thread(boost::bind(&CScheduler::serviceQueue, &scheduler));
+    RegisterBackgroundSignalScheduler(scheduler);
+
+    std::vector<int> order;
+    int nRunning = 0, nOverlaps = 0;
+    for (int i = 0; i < 500; i++) {
+        CallFunctionInValidationInterfaceQueue(boost::bind(&QueuedTask, boost::ref(order), boost::ref(nRunning), boost::ref(nOverlaps), i));
+        if (i % 100 == 0)
+            LimitValidationInterfaceQueue();
+    }
+    SyncWithValidationInterfaceQueue();
+    EXPECT_EQ(500, order.size());
+    EXPECT_EQ(0, GetValidationInterfaceQueueSize());
+
+    // anything still queued runs on this thread once the scheduler is unregistered
+    for (int i = 500; i < 600; i++)
+        CallFunctionInValidationInterfaceQueue(boost::bind(&QueuedTask, boost::ref(order), boost::ref(nRunning), boost::ref(nOverlaps), i));
+    UnregisterBackgroundSignalScheduler();
+    ASSERT_EQ(600, order.size());
+    for (int i = 0; i < order.size(); i++)
+        EXPECT_EQ(i, order[i]);
+    EXPECT_EQ(0, nOverlaps);
+
+    scheduler.stop(true);
+    threads.join_all();
+}
@@ -0,0 +1,171 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "main.h"
+#include "primitives/block.h"
+#include "random.h"
+#include "utiltest.h"
+#include "wallet/coinselection.h"
+#include "wallet/wallet.h"
+
+#include <algorithm>
+
+#include <gtest/gtest.h>
+
+class TestUnspentWallet : public CWallet {
+public:
+    TestUnspentWallet() : CWallet() { }
+
+    std::set<uint256> GetUnspentTxs() {
+        LOCK2(cs_main, cs_wallet);
+        return CWallet::GetUnspentTxs();
+    }
+};
+
+TEST(TestWallet, testBnBCoinSelection)
+{
+    std::vector<char> vfSelected;
+
+    // one currency: 3 + 7 is the only exact way to make 10
+    std::vector<CAmount> vAmounts = {5 * CENT, 3 * CENT, 2 * CENT, 7 * CENT, 1 * CENT};
+    EXPECT_TRUE(SelectCoinsBnB(vAmounts, {10 * CENT}, {0}, vfSelected));
+    EXPECT_TRUE(vfSelected == std::vector<char>({false, true, false, true, false}));
+
+    // 19 cents can't be made exactly, but 18 + up to 1 cent of window can
+    EXPECT_FALSE(SelectCoinsBnB(vAmounts, {19 * CENT}, {0}, vfSelected));
+    EXPECT_TRUE(SelectCoinsBnB(vAmounts, {17 * CENT + 50}, {1 * CENT}, vfSelected));
+    EXPECT_EQ(5, std::count(vfSelected.begin(), vfSelected.end(), true));
+
+    // more than we have is never selected
+    EXPECT_FALSE(SelectCoinsBnB(vAmounts, {19 * CENT}, {10 * CENT}, vfSelected));
+
+    // two currencies, one row per output
+    vAmounts = {5, 0,
+                0, 4,
+                3, 3,
+                2, 1};
+    EXPECT_TRUE(SelectCoinsBnB(vAmounts, {8, 3}, {0, 0}, vfSelected));
+    EXPECT_TRUE(vfSelected == std::vector<char>({true, false, true, false}));
+    EXPECT_TRUE(SelectCoinsBnB(vAmounts, {5, 4}, {0, 0}, vfSelected));
+    EXPECT_EQ(2, std::count(vfSelected.begin(), vfSelected.end(), true));
+
+    // an exact match in one currency isn't enough if the other overshoots its window
+    EXPECT_FALSE(SelectCoinsBnB(vAmounts, {3, 2}, {0, 0}, vfSelected));
+
+    // the same candidates always give the same selection
+    std::vector<char> vfSelected2;
+    vAmounts.clear();
+    for (int i = 0; i < 1000; i++)
+        vAmounts.push_back((i % 37 + 1) * CENT);
+    EXPECT_TRUE(SelectCoinsBnB(vAmounts, {100 * CENT}, {0}, vfSelected));
+    EXPECT_TRUE(SelectCoinsBnB(vAmounts, {100 * CENT}, {0}, vfSelected2));
+    EXPECT_TRUE(vfSelected == vfSelected2);
+
+    // malformed input is rejected
+    EXPECT_FALSE(SelectCoinsBnB({1, 2, 3}, {1, 1}, {0, 0}, vfSelected));
+    EXPECT_FALSE(SelectCoinsBnB({1, 2}, {0, 1}, {0, 0}, vfSelected));
+}
+
+TEST(TestWallet, testUnspentTxsFollowActiveChain)
+{
+    TestUnspentWallet wallet;
+    CKey tsk = AddTestCKeyToKeyStore(wallet);
+
+    // Receive a transparent output and spend it to a script we don't own
+    CMutableTransaction mtx;
+    mtx.vin.push_back(CTxIn(GetRandHash(), 0));
+    mtx.vout.push_back(CTxOut(5 * COIN, GetScriptForDestination(tsk.GetPubKey().GetID())));
+    CWalletTx wtx {&wallet, mtx};
+    auto hash = wtx.GetHash();
+
+    CMutableTransaction mtx2;
+    mtx2.vin.push_back(CTxIn(hash, 0));
+    mtx2.vout.push_back(CTxOut(4 * COIN, CScript() << OP_TRUE));
+    CWalletTx wtx2 {&wallet, mtx2};
+
+    CMutableTransaction mtx3;
+    mtx3.vin.push_back(CTxIn(GetRandHash(), 0));
+    mtx3.vout.push_back(CTxOut(COIN, CScript() << OP_TRUE));
+
+    // Fake-mine the receive at height 0, and the spend and an unrelated transaction on two forks at height 1
+    CBlock block;
+    block.vtx.push_back(wtx);
+    block.hashMerkleRoot = block.BuildMerkleTree();
+    auto blockHash = block.GetHash();
+    CBlockIndex fakeIndex {block};
+    mapBlockIndex.insert(std::make_pair(blockHash, &fakeIndex));
+
+    CBlock block2;
+    block2.vtx.push_back(wtx2);
+    block2.hashMerkleRoot = block2.BuildMerkleTree();
+    block2.hashPrevBlock = blockHash;
+    auto blockHash2 = block2.GetHash();
+    CBlockIndex fakeIndex2 {block2};
+    fakeIndex2.pprev = &fakeIndex;
+    fakeIndex2.SetHeight(1);
+    mapBlockIndex.insert(std::make_pair(blockHash2, &fakeIndex2));
+
+    CBlock block3;
+    block3.vtx.push_back(CTransaction(mtx3));
+    block3.hashMerkleRoot = block3.BuildMerkleTree();
+    block3.hashPrevBlock = blockHash;
+    auto blockHash3 = block3.GetHash();
+    CBlockIndex fakeIndex3 {block3};
+    fakeIndex3.pprev = &fakeIndex;
+    fakeIndex3.SetHeight(1);
+    mapBlockIndex.insert(std::make_pair(blockHash3, &fakeIndex3));
+
+    // other tests in this binary may have built a chain, which is put back afterwards
+    CBlockIndex *pSavedTip = chainActive.Tip();
+    chainActive.SetTip(&fakeIndex);
+    wtx.SetMerkleBranch(block);
+    wallet.AddToWallet(wtx, true, NULL);
+    wallet.AddToWallet(wtx2, true, NULL);
+    EXPECT_EQ(std::set<uint256>({hash}), wallet.GetUnspentTxs());
+
+    // Connecting the spend settles the output
+    chainActive.SetTip(&fakeIndex2);
+    wtx2.SetMerkleBranch(block2);
+    wallet.AddToWallet(wtx2, true, NULL);
+    EXPECT_EQ(0, wallet.GetUnspentTxs().size());
+
+    // Disconnecting it brings the output back, before ChainTip has run
+    chainActive.SetTip(&fakeIndex);
+    EXPECT_EQ(std::set<uint256>({hash}), wallet.GetUnspentTxs());
+
+    // A reorg to the other fork leaves the spend unconfirmed
+    chainActive.SetTip(&fakeIndex3);
+    EXPECT_EQ(std::set<uint256>({hash}), wallet.GetUnspentTxs());
+
+    // and reorganizing back settles it again
+    chainActive.SetTip(&fakeIndex2);
+    EXPECT_EQ(0, wallet.GetUnspentTxs().size());
+    chainActive.SetTip(&fakeIndex3);
+    EXPECT_EQ(std::set<uint256>({hash}), wallet.GetUnspentTxs());
+
+    // Tear down
+    chainActive.SetTip(pSavedTip);
+    mapBlockIndex.erase(blockHash);
+    mapBlockIndex.erase(blockHash2);
+    mapBlockIndex.erase(blockHash3);
+}
+
+TEST(TestWallet, testRescanReserver)
+{
+    CWallet wallet;
+    {
+        CWalletRescanReserver reserver(&wallet);
+        EXPECT_TRUE(reserver.Reserve());
+        EXPECT_TRUE(reserver.IsReserved());
+
+        // a second rescan is refused while the first holds the wallet
+        CWalletRescanReserver second(&wallet);
+        EXPECT_FALSE(second.Reserve());
+        EXPECT_FALSE(second.IsReserved());
+    }
+
+    // and allowed once it has finished
+    CWalletRescanReserver third(&wallet);
+    EXPECT_TRUE(third.Reserve());
+}
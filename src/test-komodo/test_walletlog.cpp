@@ -0,0 +1,298 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "wallet/db.h"
+#include "wallet/walletlog.h"
+
+#include "random.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include <algorithm>
+#include <functional>
+
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+
+/** Wallet log tests run in their own data directory, with a Berkeley DB environment on disk rather than a mock one */
+class TestWalletLog : public ::testing::Test {
+public:
+    boost::filesystem::path pathTemp;
+
+    virtual void SetUp()
+    {
+        ClearDatadirCache();
+        pathTemp = GetTempPath() / strprintf("test_walletlog_%lu_%i", (unsigned long)GetTime(), (int)GetRand(100000));
+        boost::filesystem::create_directories(pathTemp);
+        mapArgs["-datadir"] = pathTemp.string();
+        mapArgs["-walletstore"] = "log";
+    }
+
+    virtual void TearDown()
+    {
+        CWalletLog::CloseAll();
+        bitdb.Flush(true);
+        bitdb.Reset();
+        mapArgs.erase("-walletstore");
+        mapArgs.erase("-datadir");
+        ClearDatadirCache();
+        boost::filesystem::remove_all(pathTemp);
+    }
+};
+
+/** Exposes the CDB accessors the wallet uses, for string keys and values */
+class CTestWalletDB : public CDB
+{
+public:
+    CTestWalletDB(const std::string& strFilename, const char* pszMode = "r+") : CDB(strFilename, pszMode) {}
+
+    bool ReadString(const std::string& key, std::string& value) { return Read(key, value); }
+    bool WriteString(const std::string& key, const std::string& value) { return Write(key, value); }
+    bool EraseString(const std::string& key) { return Erase(key); }
+    bool HasString(const std::string& key) { return Exists(key); }
+
+    //! walks the whole database with a cursor, as LoadWallet does, calling fn between records
+    std::vector<std::string> Keys(std::function<void()> fn = std::function<void()>())
+    {
+        std::vector<std::string> vKeys;
+        CDBCursor* pcursor = GetCursor();
+        EXPECT_TRUE(pcursor);
+        if (!pcursor)
+            return vKeys;
+        while (true)
+        {
+            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+            CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+            if (ReadAtCursor(pcursor, ssKey, ssValue) != 0)
+                break;
+            std::string strKey;
+            ssKey >> strKey;
+            vKeys.push_back(strKey);
+            if (fn)
+                fn();
+        }
+        pcursor->close();
+        return vKeys;
+    }
+};
+
+static CWalletLog::Data LogData(const std::string& str)
+{
+    return CWalletLog::Data(str.begin(), str.end());
+}
+
+static std::string LogRead(CWalletLog* plog, const std::string& key)
+{
+    CWalletLog::Data value;
+    if (!plog->Read(LogData(key), value))
+        return "";
+    return std::string(value.begin(), value.end());
+}
+
+TEST_F(TestWalletLog, testReplay)
+{
+    CWalletLog* plog = CWalletLog::Get("test.dat");
+    ASSERT_TRUE(plog);
+
+    std::vector<CWalletLog::Record> vBatch;
+    vBatch.push_back(CWalletLog::Record(LogData("a"), LogData("1"), false));
+    vBatch.push_back(CWalletLog::Record(LogData("b"), LogData("2"), false));
+    EXPECT_TRUE(plog->Commit(vBatch));
+    EXPECT_TRUE(plog->Commit(std::vector<CWalletLog::Record>(1, CWalletLog::Record(LogData("a"), LogData("3"), false))));
+    EXPECT_TRUE(plog->Commit(std::vector<CWalletLog::Record>(1, CWalletLog::Record(LogData("b"), CWalletLog::Data(), true))));
+
+    // reopening replays every batch in order
+    CWalletLog::CloseAll();
+    plog = CWalletLog::Get("test.dat");
+    ASSERT_TRUE(plog);
+    EXPECT_EQ(LogRead(plog, "a"), "3");
+    EXPECT_FALSE(plog->Exists(LogData("b")));
+
+    // records come back in key order
+    CWalletLog::Data key, value;
+    EXPECT_TRUE(plog->Seek(CWalletLog::Data(), false, key, value));
+    EXPECT_TRUE(key == LogData("a"));
+    EXPECT_FALSE(plog->Seek(key, true, key, value));
+}
+
+TEST_F(TestWalletLog, testTornTail)
+{
+    boost::filesystem::path path = CWalletLog::GetPath("test.dat");
+    CWalletLog* plog = CWalletLog::Get("test.dat");
+    ASSERT_TRUE(plog);
+    EXPECT_TRUE(plog->Commit(std::vector<CWalletLog::Record>(1, CWalletLog::Record(LogData("a"), LogData("1"), false))));
+    CWalletLog::CloseAll();
+    uintmax_t nGoodSize = boost::filesystem::file_size(path);
+
+    plog = CWalletLog::Get("test.dat");
+    ASSERT_TRUE(plog);
+    std::vector<CWalletLog::Record> vBatch;
+    vBatch.push_back(CWalletLog::Record(LogData("b"), LogData("2"), false));
+    vBatch.push_back(CWalletLog::Record(LogData("c"), LogData("3"), false));
+    EXPECT_TRUE(plog->Commit(vBatch));
+    CWalletLog::CloseAll();
+
+    // a crash in the middle of the last record loses the whole batch and nothing before it
+    boost::filesystem::resize_file(path, boost::filesystem::file_size(path) - 3);
+    plog = CWalletLog::Get("test.dat");
+    ASSERT_TRUE(plog);
+    EXPECT_EQ(LogRead(plog, "a"), "1");
+    EXPECT_FALSE(plog->Exists(LogData("b")));
+    EXPECT_FALSE(plog->Exists(LogData("c")));
+    EXPECT_EQ(boost::filesystem::file_size(path), nGoodSize);
+
+    // the log carries on from the truncated end
+    EXPECT_TRUE(plog->Commit(std::vector<CWalletLog::Record>(1, CWalletLog::Record(LogData("d"), LogData("4"), false))));
+    CWalletLog::CloseAll();
+
+    // a record failing its checksum is dropped the same way
+    {
+        FILE* file = fopen(path.string().c_str(), "r+b");
+        ASSERT_TRUE(file);
+        EXPECT_TRUE(fseek(file, -5, SEEK_END) == 0);
+        int ch = fgetc(file);
+        EXPECT_TRUE(fseek(file, -5, SEEK_END) == 0);
+        fputc(ch ^ 0xff, file);
+        fclose(file);
+    }
+    plog = CWalletLog::Get("test.dat");
+    ASSERT_TRUE(plog);
+    EXPECT_EQ(LogRead(plog, "a"), "1");
+    EXPECT_FALSE(plog->Exists(LogData("d")));
+    EXPECT_EQ(boost::filesystem::file_size(path), nGoodSize);
+}
+
+TEST_F(TestWalletLog, testCompaction)
+{
+    boost::filesystem::path path = CWalletLog::GetPath("test.dat");
+    CWalletLog* plog = CWalletLog::Get("test.dat");
+    ASSERT_TRUE(plog);
+
+    for (int i = 0; i < 1000; i++)
+        EXPECT_TRUE(plog->Commit(std::vector<CWalletLog::Record>(1, CWalletLog::Record(LogData("key"), LogData(strprintf("%d", i)), false))));
+    EXPECT_TRUE(plog->Commit(std::vector<CWalletLog::Record>(1, CWalletLog::Record(LogData("skip1"), LogData("x"), false))));
+    EXPECT_TRUE(plog->Commit(std::vector<CWalletLog::Record>(1, CWalletLog::Record(LogData("skip2"), LogData("y"), false))));
+    uintmax_t nSize = boost::filesystem::file_size(path);
+
+    // compaction keeps only the live records, leaving out those with the skipped prefix
+    EXPECT_TRUE(plog->Compact("skip"));
+    EXPECT_TRUE(boost::filesystem::file_size(path) < nSize / 100);
+    EXPECT_EQ(LogRead(plog, "key"), "999");
+    EXPECT_FALSE(plog->Exists(LogData("skip1")));
+
+    // and appends continue after the compacted records
+    EXPECT_TRUE(plog->Commit(std::vector<CWalletLog::Record>(1, CWalletLog::Record(LogData("key"), LogData("last"), false))));
+    CWalletLog::CloseAll();
+    plog = CWalletLog::Get("test.dat");
+    ASSERT_TRUE(plog);
+    EXPECT_EQ(LogRead(plog, "key"), "last");
+    EXPECT_FALSE(plog->Exists(LogData("skip2")));
+}
+
+TEST_F(TestWalletLog, testCursor)
+{
+    CTestWalletDB db("test.dat", "cr+");
+    EXPECT_TRUE(db.WriteString("c", "3"));
+    EXPECT_TRUE(db.WriteString("a", "1"));
+    EXPECT_TRUE(db.WriteString("b", "2"));
+
+    // keys come back in order, with the version record the create mode wrote
+    std::vector<std::string> vKeys = db.Keys();
+    EXPECT_EQ(vKeys.size(), 4);
+    EXPECT_TRUE(std::is_sorted(vKeys.begin(), vKeys.end(), [](const std::string& a, const std::string& b) {
+        CDataStream ssA(SER_DISK, CLIENT_VERSION), ssB(SER_DISK, CLIENT_VERSION);
+        ssA << a;
+        ssB << b;
+        return std::vector<char>(ssA.begin(), ssA.end()) < std::vector<char>(ssB.begin(), ssB.end());
+    }));
+
+    // writing and erasing while a cursor is open neither invalidates nor repeats records
+    bool fChanged = false;
+    vKeys = db.Keys([&]() {
+        if (!fChanged)
+        {
+            fChanged = true;
+            EXPECT_TRUE(db.EraseString("b"));
+            EXPECT_TRUE(db.WriteString("d", "4"));
+        }
+    });
+    EXPECT_EQ(vKeys.size(), 4);
+    EXPECT_TRUE(std::find(vKeys.begin(), vKeys.end(), "b") == vKeys.end());
+    EXPECT_TRUE(std::find(vKeys.begin(), vKeys.end(), "d") != vKeys.end());
+}
+
+TEST_F(TestWalletLog, testTransactions)
+{
+    std::string value;
+    {
+        CTestWalletDB db("test.dat", "cr+");
+        EXPECT_TRUE(db.WriteString("a", "1"));
+
+        // an open transaction sees its own writes, and an abort drops them
+        EXPECT_TRUE(db.TxnBegin());
+        EXPECT_TRUE(db.WriteString("a", "2"));
+        EXPECT_TRUE(db.WriteString("b", "2"));
+        EXPECT_TRUE(db.EraseString("a"));
+        EXPECT_FALSE(db.HasString("a"));
+        EXPECT_TRUE(db.ReadString("b", value) && value == "2");
+        EXPECT_TRUE(db.TxnAbort());
+        EXPECT_TRUE(db.ReadString("a", value) && value == "1");
+        EXPECT_FALSE(db.HasString("b"));
+
+        // a committed transaction is one batch in the log
+        EXPECT_TRUE(db.TxnBegin());
+        EXPECT_TRUE(db.WriteString("b", "3"));
+        EXPECT_TRUE(db.WriteString("c", "3"));
+        EXPECT_TRUE(db.TxnCommit());
+        EXPECT_FALSE(db.TxnCommit());
+    }
+    CWalletLog::CloseAll();
+
+    CTestWalletDB db("test.dat");
+    EXPECT_TRUE(db.ReadString("a", value) && value == "1");
+    EXPECT_TRUE(db.ReadString("b", value) && value == "3");
+    EXPECT_TRUE(db.ReadString("c", value) && value == "3");
+}
+
+TEST_F(TestWalletLog, testMigration)
+{
+    std::string value;
+    boost::filesystem::path pathWallet = GetDataDir() / "test.dat";
+    boost::filesystem::path pathLog = CWalletLog::GetPath("test.dat");
+
+    // start with a Berkeley DB wallet
+    mapArgs["-walletstore"] = "bdb";
+    {
+        CTestWalletDB db("test.dat", "cr+");
+        EXPECT_TRUE(db.WriteString("a", "1"));
+        EXPECT_TRUE(db.WriteString("b", "2"));
+    }
+    bitdb.Flush(false);
+
+    // copying it to the log moves the Berkeley DB file out of the way
+    EXPECT_TRUE(CDB::MigrateToLog("test.dat"));
+    EXPECT_TRUE(boost::filesystem::exists(pathLog));
+    EXPECT_FALSE(boost::filesystem::exists(pathWallet));
+
+    mapArgs["-walletstore"] = "log";
+    {
+        CTestWalletDB db("test.dat");
+        EXPECT_TRUE(db.ReadString("a", value) && value == "1");
+        EXPECT_TRUE(db.ReadString("b", value) && value == "2");
+        EXPECT_TRUE(db.WriteString("c", "3"));
+        EXPECT_TRUE(db.EraseString("a"));
+    }
+
+    // and copying back recreates it with the log's records, keeping the log as a backup
+    mapArgs["-walletstore"] = "bdb";
+    EXPECT_TRUE(CDB::MigrateFromLog("test.dat"));
+    EXPECT_FALSE(boost::filesystem::exists(pathLog));
+    EXPECT_TRUE(boost::filesystem::exists(pathWallet));
+    {
+        CTestWalletDB db("test.dat");
+        EXPECT_FALSE(db.HasString("a"));
+        EXPECT_TRUE(db.ReadString("b", value) && value == "2");
+        EXPECT_TRUE(db.ReadString("c", value) && value == "3");
+    }
+}
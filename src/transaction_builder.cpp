@@ -12,6 +12,8 @@
 #include "cc/CCinclude.h"
 #include "pbaas/reserves.h"
 
+#include <atomic>
+
 #include <boost/variant.hpp>
 #include <librustzcash.h>
 
@@ -24,6 +26,37 @@ SpendDescriptionInfo::SpendDescriptionInfo(
     librustzcash_sapling_generate_r(alpha.begin());
 }
 
+// Every Sapling proof already fans out over all cores inside the prover, so the proofs of several
+// asynchronous operations running side by side only contend with each other. Builders with Sapling
+// spends or outputs hold one of the -provingtxs slots while proving and prepare everything else
+// outside of it.
+static CSemaphore& SaplingProvingSlots()
+{
+    static CSemaphore semProving(std::max(1, (int)GetArg("-provingtxs", DEFAULT_PROVING_TXS)));
+    return semProving;
+}
+
+static std::atomic<int> nSaplingProvingSlotsHeld(0);
+
+CSaplingProvingSlot::CSaplingProvingSlot()
+{
+    AssertLockNotHeld(cs_main);
+    CSemaphoreGrant slot(SaplingProvingSlots());
+    slot.MoveTo(grant);
+    nSaplingProvingSlotsHeld++;
+}
+
+CSaplingProvingSlot::~CSaplingProvingSlot()
+{
+    // counted out before the grant is released, so the count never exceeds the slots
+    nSaplingProvingSlotsHeld--;
+}
+
+int CSaplingProvingSlot::Held()
+{
+    return nSaplingProvingSlotsHeld;
+}
+
 TransactionBuilderResult::TransactionBuilderResult(const CTransaction& tx) : maybeTx(tx) {}
 
 TransactionBuilderResult::TransactionBuilderResult(const std::string& error) : maybeError(error) {}
@@ -398,21 +431,51 @@ TransactionBuilderResult TransactionBuilder::Build(bool throwTxWithPartialSig)
     // Sapling spends and outputs
     //
 
-    auto ctx = librustzcash_sapling_proving_ctx_init();
-
-    // Create Sapling SpendDescriptions
-    for (auto spend : spends) {
+    // Note commitments, nullifiers, witness paths and note encryption don't need the proving
+    // context, so they are done before waiting for a proving slot
+    std::vector<std::pair<uint256, std::vector<unsigned char>>> spendData;
+    spendData.reserve(spends.size());
+    for (auto& spend : spends) {
         auto cm = spend.note.cm();
         auto nf = spend.note.nullifier(
             spend.expsk.full_viewing_key(), spend.witness.position());
         if (!cm || !nf) {
-            librustzcash_sapling_proving_ctx_free(ctx);
             return TransactionBuilderResult("Spend is invalid");
         }
 
         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
         ss << spend.witness.path();
-        std::vector<unsigned char> witness(ss.begin(), ss.end());
+        spendData.push_back(std::make_pair(*nf, std::vector<unsigned char>(ss.begin(), ss.end())));
+    }
+
+    std::vector<std::pair<uint256, libzcash::SaplingNotePlaintextEncryptionResult>> outputData;
+    outputData.reserve(outputs.size());
+    for (auto& output : outputs) {
+        auto cm = output.note.cm();
+        if (!cm) {
+            return TransactionBuilderResult("Output is invalid");
+        }
+
+        libzcash::SaplingNotePlaintext notePlaintext(output.note, output.memo);
+
+        auto res = notePlaintext.encrypt(output.note.pk_d);
+        if (!res) {
+            return TransactionBuilderResult("Failed to encrypt note");
+        }
+        outputData.push_back(std::make_pair(*cm, res.get()));
+    }
+
+    // transparent and smart transactions, which the miner and notarizations build under cs_main, have
+    // nothing to prove and must not wait behind wallet operations for a slot
+    boost::optional<CSaplingProvingSlot> provingSlot;
+    if (!spends.empty() || !outputs.empty()) {
+        provingSlot.emplace();
+    }
+    auto ctx = librustzcash_sapling_proving_ctx_init();
+
+    // Create Sapling SpendDescriptions
+    for (size_t i = 0; i < spends.size(); i++) {
+        auto& spend = spends[i];
 
         SpendDescription sdesc;
         if (!librustzcash_sapling_spend_proof(
@@ -424,7 +487,7 @@ TransactionBuilderResult TransactionBuilder::Build(bool throwTxWithPartialSig)
                 spend.alpha.begin(),
                 spend.note.value(),
                 spend.anchor.begin(),
-                witness.data(),
+                spendData[i].second.data(),
                 sdesc.cv.begin(),
                 sdesc.rk.begin(),
                 sdesc.zkproof.data())) {
@@ -433,27 +496,14 @@ TransactionBuilderResult TransactionBuilder::Build(bool throwTxWithPartialSig)
         }
 
         sdesc.anchor = spend.anchor;
-        sdesc.nullifier = *nf;
+        sdesc.nullifier = spendData[i].first;
         mtx.vShieldedSpend.push_back(sdesc);
     }
 
     // Create Sapling OutputDescriptions
-    for (auto output : outputs) {
-        auto cm = output.note.cm();
-        if (!cm) {
-            librustzcash_sapling_proving_ctx_free(ctx);
-            return TransactionBuilderResult("Output is invalid");
-        }
-
-        libzcash::SaplingNotePlaintext notePlaintext(output.note, output.memo);
-
-        auto res = notePlaintext.encrypt(output.note.pk_d);
-        if (!res) {
-            librustzcash_sapling_proving_ctx_free(ctx);
-            return TransactionBuilderResult("Failed to encrypt note");
-        }
-        auto enc = res.get();
-        auto encryptor = enc.second;
+    for (size_t i = 0; i < outputs.size(); i++) {
+        auto& output = outputs[i];
+        auto& encryptor = outputData[i].second.second;
 
         OutputDescription odesc;
         if (!librustzcash_sapling_output_proof(
@@ -469,9 +519,9 @@ TransactionBuilderResult TransactionBuilder::Build(bool throwTxWithPartialSig)
             return TransactionBuilderResult("Output proof failed");
         }
 
-        odesc.cm = *cm;
+        odesc.cm = outputData[i].first;
         odesc.ephemeralKey = encryptor.get_epk();
-        odesc.encCiphertext = enc.first;
+        odesc.encCiphertext = outputData[i].second.first;
 
         libzcash::SaplingOutgoingPlaintext outPlaintext(output.note.pk_d, encryptor.get_esk());
         odesc.outCiphertext = outPlaintext.encrypt(
@@ -536,6 +586,7 @@ TransactionBuilderResult TransactionBuilder::Build(bool throwTxWithPartialSig)
         mtx.bindingSig.data());
 
     librustzcash_sapling_proving_ctx_free(ctx);
+    provingSlot = boost::none;
 
     // Create Sprout joinSplitSig
     if (crypto_sign_detached(
@@ -11,6 +11,7 @@
 #include "primitives/transaction.h"
 #include "script/script.h"
 #include "script/standard.h"
+#include "sync.h"
 #include "uint256.h"
 #include "zcash/Address.hpp"
 #include "zcash/IncrementalMerkleTree.hpp"
@@ -20,6 +21,26 @@
 
 #include <boost/optional.hpp>
 
+//! Default for -provingtxs, the number of transactions whose Sapling proofs are generated at once
+static const int DEFAULT_PROVING_TXS = 2;
+
+/**
+ * One of the -provingtxs slots, which a builder with Sapling spends or outputs holds while it proves, waiting for
+ * one to be free. Must not be taken with cs_main held.
+ */
+class CSaplingProvingSlot
+{
+private:
+    CSemaphoreGrant grant;
+
+public:
+    CSaplingProvingSlot();
+    ~CSaplingProvingSlot();
+
+    //! the number of slots held now
+    static int Held();
+};
+
 struct SpendDescriptionInfo {
     libzcash::SaplingExpandedSpendingKey expsk;
     libzcash::SaplingNote note;
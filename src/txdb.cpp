@@ -49,10 +49,19 @@ static const char DB_LAST_BLOCK = 'l';
 CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / dbName, nCacheSize, fMemory, fWipe) {
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe) 
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, DefaultOptions(), fMemory, fWipe)
 {
 }
 
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, const CDBOptions &dbOptions, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, dbOptions, fMemory, fWipe)
+{
+}
+
+CDBOptions CCoinsViewDB::DefaultOptions()
+{
+    return CDBOptions();
+}
+
 
 bool CCoinsViewDB::GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const {
     if (rt == SproutMerkleTree::empty_root()) {
@@ -203,7 +212,24 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
     return db.WriteBatch(batch);
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, compression, maxOpenFiles) {
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, DefaultOptions(false, compression, maxOpenFiles), fMemory, fWipe) {
+}
+
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, const CDBOptions &dbOptions, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, dbOptions, fMemory, fWipe) {
+}
+
+CDBOptions CBlockTreeDB::DefaultOptions(bool fPointLookupIndexes, bool compression, int maxOpenFiles)
+{
+    CDBOptions dbOptions;
+    dbOptions.fCompression = compression;
+    dbOptions.nMaxOpenFiles = maxOpenFiles;
+    if (fPointLookupIndexes) {
+        // spent index, txindex and timestamp lookups miss far more often than they hit
+        dbOptions.nBloomBits = 16;
+        dbOptions.nBlockCachePercent = 60;
+        dbOptions.nWriteBufferPercent = 20;
+    }
+    return dbOptions;
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
@@ -303,8 +329,8 @@ bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos>
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) {
-    return Read(make_pair(DB_SPENTINDEX, key), value);
+bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value, const CDBSnapshot *psnapshot) {
+    return Read(make_pair(DB_SPENTINDEX, key), value, psnapshot);
 }
 
 bool CBlockTreeDB::UpdateSpentIndex(const std::vector<CSpentIndexDbEntry> &vect) {
@@ -331,9 +357,9 @@ bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<CAddressUnspentDb
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type, std::vector<CAddressUnspentDbEntry> &unspentOutputs)
+bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type, std::vector<CAddressUnspentDbEntry> &unspentOutputs, const CDBSnapshot *psnapshot)
 {
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator(psnapshot));
 
     pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
 
@@ -382,9 +408,9 @@ bool CBlockTreeDB::EraseAddressIndex(const std::vector<CAddressIndexDbEntry> &ve
 bool CBlockTreeDB::ReadAddressIndex(
         uint160 addressHash, int type,
         std::vector<CAddressIndexDbEntry> &addressIndex,
-        int start, int end)
+        int start, int end, const CDBSnapshot *psnapshot, size_t nMaxEntries)
 {
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator(psnapshot));
 
     if (start > 0 && end > 0) {
         pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
@@ -404,6 +430,10 @@ bool CBlockTreeDB::ReadAddressIndex(
                 if (end > 0 && indexKey.blockHeight > end) {
                     break;
                 }
+                // one entry more than the limit lets the caller see that there are more
+                if (nMaxEntries > 0 && addressIndex.size() > nMaxEntries) {
+                    break;
+                }
                 try {
                     CAmount nValue;
                     pcursor->GetValue(nValue);
@@ -566,9 +596,9 @@ bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex)
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes)
+bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes, const CDBSnapshot *psnapshot)
 {
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator(psnapshot));
 
     pcursor->Seek(make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
 
@@ -78,6 +78,10 @@ protected:
     CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 public:
     CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    CCoinsViewDB(size_t nCacheSize, const CDBOptions &dbOptions, bool fMemory = false, bool fWipe = false);
+
+    //! chainstate lookups are mostly point reads of txids, many of them for coins that do not exist
+    static CDBOptions DefaultOptions();
 
     bool GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const;
     bool GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const;
@@ -95,6 +99,9 @@ public:
                     CNullifiersMap &mapSproutNullifiers,
                     CNullifiersMap &mapSaplingNullifiers);
     bool GetStats(CCoinsStats &stats) const;
+
+    //! the underlying database, for copying the chainstate as a whole into and out of snapshots
+    CDBWrapper &GetDB() { return db; }
 };
 
 /** Access to the block database (blocks/index/) */
@@ -102,6 +109,14 @@ class CBlockTreeDB : public CDBWrapper
 {
 public:
     CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool compression = true, int maxOpenFiles = 1000);
+    CBlockTreeDB(size_t nCacheSize, const CDBOptions &dbOptions, bool fMemory = false, bool fWipe = false);
+
+    /**
+     * The block index also holds the tx, address, spent and timestamp indexes. When the
+     * point lookup indexes are enabled, most reads are negative probes, so favor a larger
+     * bloom filter and block cache.
+     */
+    static CDBOptions DefaultOptions(bool fPointLookupIndexes, bool compression = true, int maxOpenFiles = 1000);
 private:
     CBlockTreeDB(const CBlockTreeDB&);
     void operator=(const CBlockTreeDB&);
@@ -114,15 +129,15 @@ public:
     bool ReadReindexing(bool &fReindex);
     bool ReadTxIndex(const uint256 &txid, CDiskTxPos &pos);
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &list);
-    bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
+    bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value, const CDBSnapshot *psnapshot = NULL);
     bool UpdateSpentIndex(const std::vector<CSpentIndexDbEntry> &vect);
     bool UpdateAddressUnspentIndex(const std::vector<CAddressUnspentDbEntry> &vect);
-    bool ReadAddressUnspentIndex(uint160 addressHash, int type, std::vector<CAddressUnspentDbEntry> &vect);
+    bool ReadAddressUnspentIndex(uint160 addressHash, int type, std::vector<CAddressUnspentDbEntry> &vect, const CDBSnapshot *psnapshot = NULL);
     bool WriteAddressIndex(const std::vector<CAddressIndexDbEntry> &vect);
     bool EraseAddressIndex(const std::vector<CAddressIndexDbEntry> &vect);
-    bool ReadAddressIndex(uint160 addressHash, int type, std::vector<CAddressIndexDbEntry> &addressIndex, int start = 0, int end = 0);
+    bool ReadAddressIndex(uint160 addressHash, int type, std::vector<CAddressIndexDbEntry> &addressIndex, int start = 0, int end = 0, const CDBSnapshot *psnapshot = NULL, size_t nMaxEntries = 0);
     bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
-    bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &vect);
+    bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &vect, const CDBSnapshot *psnapshot = NULL);
     bool WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts);
     bool ReadTimestampBlockIndex(const uint256 &hash, unsigned int &logicalTS);
     bool WriteFlag(const std::string &name, bool fValue);
@@ -132,4 +147,23 @@ public:
     UniValue Snapshot(int top);
 };
 
+/**
+ * Read-only view of the block tree database pinned at a chain tip, so index queries see
+ * the state after a whole block was connected or disconnected, never a partial write.
+ */
+class CBlockTreeSnapshot
+{
+private:
+    CBlockTreeSnapshot(const CBlockTreeSnapshot&);
+    void operator=(const CBlockTreeSnapshot&);
+
+public:
+    CDBSnapshot snapshot;
+    uint256 hashBlock;
+    int nHeight;
+
+    CBlockTreeSnapshot(const CBlockTreeDB &db, const uint256 &hashBlockIn, int nHeightIn) :
+        snapshot(db), hashBlock(hashBlockIn), nHeight(nHeightIn) {}
+};
+
 #endif // BITCOIN_TXDB_H
@@ -13,6 +13,7 @@
 #include <map>
 #include <cassert>
 
+#include <ostream>
 #include <sstream>        // .get_int64()
 #include <utility>        // std::pair
 
@@ -47,7 +48,12 @@ public:
         std::string s(val_);
         setStr(s);
     }
-    ~UniValue() {}
+    // values are moved rather than copied wherever the compiler can, so large replies can be
+    // assembled from their parts and returned without duplicating every nested value
+    UniValue(const UniValue&) = default;
+    UniValue(UniValue&&) = default;
+    UniValue& operator=(const UniValue&) = default;
+    UniValue& operator=(UniValue&&) = default;
 
     void clear();
 
@@ -67,6 +73,8 @@ public:
     bool empty() const { return (values.size() == 0); }
 
     size_t size() const { return values.size(); }
+    //! make room for n elements of an array or object before they are added
+    void reserve(size_t n);
 
     bool getBool() const { return isTrue(); }
     bool checkObject(const std::map<std::string,UniValue::VType>& memberTypes);
@@ -84,57 +92,56 @@ public:
     bool isObject() const { return (typ == VOBJ); }
 
     bool push_back(const UniValue& val);
+    bool push_back(UniValue&& val);
     bool push_back(const std::string& val_) {
-        UniValue tmpVal(VSTR, val_);
-        return push_back(tmpVal);
+        return push_back(UniValue(VSTR, val_));
     }
     bool push_back(const char *val_) {
         std::string s(val_);
         return push_back(s);
     }
     bool push_back(uint64_t val_) {
-        UniValue tmpVal(val_);
-        return push_back(tmpVal);
+        return push_back(UniValue(val_));
     }
     bool push_back(int64_t val_) {
-        UniValue tmpVal(val_);
-        return push_back(tmpVal);
+        return push_back(UniValue(val_));
     }
     bool push_back(int val_) {
-        UniValue tmpVal(val_);
-        return push_back(tmpVal);
+        return push_back(UniValue(val_));
     }
     bool push_backV(const std::vector<UniValue>& vec);
 
     bool pushKV(const std::string& key, const UniValue& val);
+    bool pushKV(const std::string& key, UniValue&& val);
     bool pushKV(const std::string& key, const std::string& val_) {
-        UniValue tmpVal(VSTR, val_);
-        return pushKV(key, tmpVal);
+        return pushKV(key, UniValue(VSTR, val_));
     }
     bool pushKV(const std::string& key, const char *val_) {
         std::string _val(val_);
         return pushKV(key, _val);
     }
     bool pushKV(const std::string& key, int64_t val_) {
-        UniValue tmpVal(val_);
-        return pushKV(key, tmpVal);
+        return pushKV(key, UniValue(val_));
     }
     bool pushKV(const std::string& key, uint64_t val_) {
-        UniValue tmpVal(val_);
-        return pushKV(key, tmpVal);
+        return pushKV(key, UniValue(val_));
     }
     bool pushKV(const std::string& key, int val_) {
-        UniValue tmpVal((int64_t)val_);
-        return pushKV(key, tmpVal);
+        return pushKV(key, UniValue((int64_t)val_));
     }
     bool pushKV(const std::string& key, double val_) {
-        UniValue tmpVal(val_);
-        return pushKV(key, tmpVal);
+        return pushKV(key, UniValue(val_));
     }
     bool pushKVs(const UniValue& obj);
 
     std::string write(unsigned int prettyIndent = 0,
                       unsigned int indentLevel = 0) const;
+    // append to out, without building the text of nested values separately
+    void write(std::string& out, unsigned int prettyIndent = 0,
+               unsigned int indentLevel = 0) const;
+    // write to os, in pieces of about UNIVALUE_STREAM_CHUNK bytes
+    void write(std::ostream& os, unsigned int prettyIndent = 0,
+               unsigned int indentLevel = 0) const;
 
     bool read(const char *raw, size_t len);
     bool read(const char *raw);
@@ -149,8 +156,9 @@ private:
     std::vector<UniValue> values;
 
     bool findKey(const std::string& key, size_t& ret) const;
-    void writeArray(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
-    void writeObject(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
+    void writeValue(unsigned int prettyIndent, unsigned int indentLevel, std::string& s, std::ostream *os) const;
+    void writeArray(unsigned int prettyIndent, unsigned int indentLevel, std::string& s, std::ostream *os) const;
+    void writeObject(unsigned int prettyIndent, unsigned int indentLevel, std::string& s, std::ostream *os) const;
 
 public:
     // Strict type-specific getters, these throw std::runtime_error if the
@@ -167,7 +175,7 @@ public:
 
     enum VType type() const { return getType(); }
     bool push_back(std::pair<std::string,UniValue> pear) {
-        return pushKV(pear.first, pear.second);
+        return pushKV(pear.first, std::move(pear.second));
     }
     friend const UniValue& find_value( const UniValue& obj, const std::string& name);
 };
@@ -231,11 +239,21 @@ static inline std::pair<std::string,UniValue> Pair(const char *cKey, const UniVa
     return std::make_pair(key, uVal);
 }
 
+static inline std::pair<std::string,UniValue> Pair(const char *cKey, UniValue&& uVal)
+{
+    return std::make_pair(std::string(cKey), std::move(uVal));
+}
+
 static inline std::pair<std::string,UniValue> Pair(std::string key, const UniValue& uVal)
 {
     return std::make_pair(key, uVal);
 }
 
+static inline std::pair<std::string,UniValue> Pair(std::string key, UniValue&& uVal)
+{
+    return std::make_pair(std::move(key), std::move(uVal));
+}
+
 enum jtokentype {
     JTOK_ERR        = -1,
     JTOK_NONE       = 0,                           // eof
@@ -291,6 +309,9 @@ static inline bool json_isspace(int ch)
 
 extern const UniValue NullUniValue;
 
+//! bytes UniValue::write(std::ostream&) collects before writing them to the stream
+static const size_t UNIVALUE_STREAM_CHUNK = 64 * 1024;
+
 const UniValue& find_value( const UniValue& obj, const std::string& name);
 
 #endif // UNIVALUE_H__
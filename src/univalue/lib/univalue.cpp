@@ -121,22 +121,44 @@ bool UniValue::setNumStr(const string& val_)
     return true;
 }
 
-bool UniValue::setInt(uint64_t val_)
+// integers are formatted directly, since they are always valid numbers and are most of what
+// RPC replies hold
+static char *formatUnsigned(uint64_t val_, char *end)
 {
-    ostringstream oss;
+    char *p = end;
+    do {
+        *--p = '0' + (val_ % 10);
+        val_ /= 10;
+    } while (val_);
+    return p;
+}
 
-    oss << val_;
+bool UniValue::setInt(uint64_t val_)
+{
+    char buf[24];
+    char *end = buf + sizeof(buf);
+    char *begin = formatUnsigned(val_, end);
 
-    return setNumStr(oss.str());
+    clear();
+    typ = VNUM;
+    val.assign(begin, end);
+    return true;
 }
 
 bool UniValue::setInt(int64_t val_)
 {
-    ostringstream oss;
-
-    oss << val_;
+    char buf[24];
+    char *end = buf + sizeof(buf);
+    // the magnitude of the most negative value only fits unsigned
+    uint64_t magnitude = val_ < 0 ? ~(uint64_t)val_ + 1 : (uint64_t)val_;
+    char *begin = formatUnsigned(magnitude, end);
+    if (val_ < 0)
+        *--begin = '-';
 
-    return setNumStr(oss.str());
+    clear();
+    typ = VNUM;
+    val.assign(begin, end);
+    return true;
 }
 
 bool UniValue::setFloat(double val_)
@@ -172,6 +194,13 @@ bool UniValue::setObject()
     return true;
 }
 
+void UniValue::reserve(size_t n)
+{
+    if (typ == VOBJ)
+        keys.reserve(n);
+    values.reserve(n);
+}
+
 bool UniValue::push_back(const UniValue& val_)
 {
     if (typ != VARR)
@@ -181,6 +210,15 @@ bool UniValue::push_back(const UniValue& val_)
     return true;
 }
 
+bool UniValue::push_back(UniValue&& val_)
+{
+    if (typ != VARR)
+        return false;
+
+    values.push_back(std::move(val_));
+    return true;
+}
+
 bool UniValue::push_backV(const std::vector<UniValue>& vec)
 {
     if (typ != VARR)
@@ -201,6 +239,16 @@ bool UniValue::pushKV(const std::string& key, const UniValue& val_)
     return true;
 }
 
+bool UniValue::pushKV(const std::string& key, UniValue&& val_)
+{
+    if (typ != VOBJ)
+        return false;
+
+    keys.push_back(key);
+    values.push_back(std::move(val_));
+    return true;
+}
+
 bool UniValue::pushKVs(const UniValue& obj)
 {
     if (typ != VOBJ || obj.typ != VOBJ)
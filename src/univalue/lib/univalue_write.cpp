@@ -10,22 +10,22 @@
 
 using namespace std;
 
-static string json_escape(const string& inS)
+// append inS to outS as the contents of a JSON string, copying the runs between escapes whole
+static void json_escape(const string& inS, string& outS)
 {
-    string outS;
-    outS.reserve(inS.size() * 2);
-
-    for (unsigned int i = 0; i < inS.size(); i++) {
-        unsigned char ch = inS[i];
-        const char *escStr = escapes[ch];
-
-        if (escStr)
+    const char *p = inS.data();
+    const char *end = p + inS.size();
+    const char *run = p;
+
+    for (; p < end; p++) {
+        const char *escStr = escapes[(unsigned char)*p];
+        if (escStr) {
+            outS.append(run, p - run);
             outS += escStr;
-        else
-            outS += ch;
+            run = p + 1;
+        }
     }
-
-    return outS;
+    outS.append(run, end - run);
 }
 
 string UniValue::write(unsigned int prettyIndent,
@@ -33,7 +33,37 @@ string UniValue::write(unsigned int prettyIndent,
 {
     string s;
     s.reserve(1024);
+    write(s, prettyIndent, indentLevel);
+    return s;
+}
 
+void UniValue::write(string& s, unsigned int prettyIndent,
+                     unsigned int indentLevel) const
+{
+    writeValue(prettyIndent, indentLevel, s, NULL);
+}
+
+void UniValue::write(ostream& os, unsigned int prettyIndent,
+                     unsigned int indentLevel) const
+{
+    string s;
+    s.reserve(UNIVALUE_STREAM_CHUNK * 2);
+    writeValue(prettyIndent, indentLevel, s, &os);
+    os.write(s.data(), s.size());
+}
+
+// hands what has been written so far to the stream once there is enough of it
+static inline void flushChunk(string& s, ostream *os)
+{
+    if (os && s.size() >= UNIVALUE_STREAM_CHUNK) {
+        os->write(s.data(), s.size());
+        s.clear();
+    }
+}
+
+void UniValue::writeValue(unsigned int prettyIndent, unsigned int indentLevel,
+                          string& s, ostream *os) const
+{
     unsigned int modIndent = indentLevel;
     if (modIndent == 0)
         modIndent = 1;
@@ -43,13 +73,15 @@ string UniValue::write(unsigned int prettyIndent,
         s += "null";
         break;
     case VOBJ:
-        writeObject(prettyIndent, modIndent, s);
+        writeObject(prettyIndent, modIndent, s, os);
         break;
     case VARR:
-        writeArray(prettyIndent, modIndent, s);
+        writeArray(prettyIndent, modIndent, s, os);
         break;
     case VSTR:
-        s += "\"" + json_escape(val) + "\"";
+        s += '"';
+        json_escape(val, s);
+        s += '"';
         break;
     case VNUM:
         s += val;
@@ -58,8 +90,6 @@ string UniValue::write(unsigned int prettyIndent,
         s += (val == "1" ? "true" : "false");
         break;
     }
-
-    return s;
 }
 
 static void indentStr(unsigned int prettyIndent, unsigned int indentLevel, string& s)
@@ -67,7 +97,8 @@ static void indentStr(unsigned int prettyIndent, unsigned int indentLevel, strin
     s.append(prettyIndent * indentLevel, ' ');
 }
 
-void UniValue::writeArray(unsigned int prettyIndent, unsigned int indentLevel, string& s) const
+void UniValue::writeArray(unsigned int prettyIndent, unsigned int indentLevel,
+                          string& s, ostream *os) const
 {
     s += "[";
     if (prettyIndent)
@@ -76,12 +107,13 @@ void UniValue::writeArray(unsigned int prettyIndent, unsigned int indentLevel, s
     for (unsigned int i = 0; i < values.size(); i++) {
         if (prettyIndent)
             indentStr(prettyIndent, indentLevel, s);
-        s += values[i].write(prettyIndent, indentLevel + 1);
+        values[i].writeValue(prettyIndent, indentLevel + 1, s, os);
         if (i != (values.size() - 1)) {
             s += ",";
         }
         if (prettyIndent)
             s += "\n";
+        flushChunk(s, os);
     }
 
     if (prettyIndent)
@@ -89,7 +121,8 @@ void UniValue::writeArray(unsigned int prettyIndent, unsigned int indentLevel, s
     s += "]";
 }
 
-void UniValue::writeObject(unsigned int prettyIndent, unsigned int indentLevel, string& s) const
+void UniValue::writeObject(unsigned int prettyIndent, unsigned int indentLevel,
+                           string& s, ostream *os) const
 {
     s += "{";
     if (prettyIndent)
@@ -98,18 +131,20 @@ void UniValue::writeObject(unsigned int prettyIndent, unsigned int indentLevel,
     for (unsigned int i = 0; i < keys.size(); i++) {
         if (prettyIndent)
             indentStr(prettyIndent, indentLevel, s);
-        s += "\"" + json_escape(keys[i]) + "\":";
+        s += '"';
+        json_escape(keys[i], s);
+        s += "\":";
         if (prettyIndent)
             s += " ";
-        s += values.at(i).write(prettyIndent, indentLevel + 1);
+        values.at(i).writeValue(prettyIndent, indentLevel + 1, s, os);
         if (i != (values.size() - 1))
             s += ",";
         if (prettyIndent)
             s += "\n";
+        flushChunk(s, os);
     }
 
     if (prettyIndent)
         indentStr(prettyIndent, indentLevel - 1, s);
     s += "}";
 }
-
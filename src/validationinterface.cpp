@@ -5,8 +5,178 @@
 
 #include "validationinterface.h"
 
+#include "primitives/block.h"
+#include "scheduler.h"
+#include "sync.h"
+#include "util.h"
+
+#include <deque>
+#include <memory>
+
+#include <boost/thread.hpp>
+
+// the queued callbacks take it, see SyncWithValidationInterfaceQueue
+extern CCriticalSection cs_main;
+
 static CMainSignals g_signals;
 
+namespace {
+
+/**
+ * Runs queued callbacks in order on a scheduler, keeping at most one task for them scheduled at a time so
+ * that only one runs at once however many threads service the scheduler.
+ */
+class CValidationCallbackQueue
+{
+private:
+    boost::mutex cs;
+    boost::condition_variable cond;
+    std::deque<boost::function<void ()>> callbacks;
+    CScheduler *pscheduler;
+    bool fScheduled;                // a task to run the callbacks is on the scheduler
+    boost::thread::id idRunning;    // the thread running a callback, if any
+    uint64_t nQueued;
+    uint64_t nDone;
+
+    void ProcessQueue()
+    {
+        boost::function<void ()> fn;
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            if (!pscheduler || callbacks.empty())
+            {
+                fScheduled = false;
+                return;
+            }
+            fn = callbacks.front();
+            callbacks.pop_front();
+            idRunning = boost::this_thread::get_id();
+        }
+
+        try
+        {
+            fn();
+        }
+        catch (const std::exception &e)
+        {
+            PrintExceptionContinue(&e, "ProcessValidationCallback()");
+        }
+        catch (const boost::thread_interrupted&)
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            fScheduled = false;
+            idRunning = boost::thread::id();
+            cond.notify_all();
+            throw;
+        }
+
+        boost::unique_lock<boost::mutex> lock(cs);
+        nDone++;
+        idRunning = boost::thread::id();
+        cond.notify_all();
+        if (!pscheduler || callbacks.empty())
+        {
+            fScheduled = false;
+            return;
+        }
+        // one task per callback lets other scheduled tasks run between them
+        pscheduler->scheduleFromNow(boost::bind(&CValidationCallbackQueue::ProcessQueue, this), 0);
+    }
+
+public:
+    CValidationCallbackQueue() : pscheduler(NULL), fScheduled(false), nQueued(0), nDone(0) {}
+
+    void Register(CScheduler &scheduler)
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        pscheduler = &scheduler;
+    }
+
+    void Unregister()
+    {
+        std::deque<boost::function<void ()>> remaining;
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            pscheduler = NULL;
+            while (idRunning != boost::thread::id())
+            {
+                cond.wait(lock);
+            }
+            fScheduled = false;
+            remaining.swap(callbacks);
+        }
+        for (auto &fn : remaining)
+        {
+            fn();
+            boost::unique_lock<boost::mutex> lock(cs);
+            nDone++;
+            cond.notify_all();
+        }
+    }
+
+    void Add(const boost::function<void ()> &fn)
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            nQueued++;
+            if (pscheduler)
+            {
+                callbacks.push_back(fn);
+                if (!fScheduled)
+                {
+                    fScheduled = true;
+                    pscheduler->scheduleFromNow(boost::bind(&CValidationCallbackQueue::ProcessQueue, this), 0);
+                }
+                return;
+            }
+        }
+
+        // without a scheduler, callbacks run on the thread that queues them
+        fn();
+        boost::unique_lock<boost::mutex> lock(cs);
+        nDone++;
+        cond.notify_all();
+    }
+
+    void Sync()
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        // a callback waiting for itself would never return
+        if (idRunning == boost::this_thread::get_id())
+        {
+            return;
+        }
+        uint64_t nTarget = nQueued;
+        while (nDone < nTarget && pscheduler)
+        {
+            cond.wait(lock);
+        }
+    }
+
+    void Limit(size_t nMaxPending)
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        if (idRunning == boost::this_thread::get_id())
+        {
+            return;
+        }
+        while (callbacks.size() > nMaxPending && pscheduler)
+        {
+            cond.wait(lock);
+        }
+    }
+
+    size_t Size()
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        return callbacks.size();
+    }
+};
+
+}
+
+static CValidationCallbackQueue validationCallbacks;
+
 CMainSignals& GetMainSignals()
 {
     return g_signals;
@@ -58,13 +228,41 @@ void UnregisterAllValidationInterfaces() {
 }
 
 void SyncWithWallets(const CTransaction &tx, const CBlock *pblock) {
-    g_signals.SyncTransaction(tx, pblock);
+    // the queued callback may run after the caller's block is gone
+    std::shared_ptr<const CBlock> pblockCopy(pblock ? new CBlock(*pblock) : NULL);
+    validationCallbacks.Add([tx, pblockCopy]() { g_signals.SyncTransaction(tx, pblockCopy.get()); });
 }
 
 void EraseFromWallets(const uint256 &hash) {
-    g_signals.EraseTransaction(hash);
+    validationCallbacks.Add([hash]() { g_signals.EraseTransaction(hash); });
 }
 
 void RescanWallets() {
     g_signals.RescanWallet();
-}
\ No newline at end of file
+}
+void RegisterBackgroundSignalScheduler(CScheduler& scheduler) {
+    validationCallbacks.Register(scheduler);
+}
+
+void UnregisterBackgroundSignalScheduler() {
+    validationCallbacks.Unregister();
+}
+
+void CallFunctionInValidationInterfaceQueue(const boost::function<void ()>& fn) {
+    validationCallbacks.Add(fn);
+}
+
+void SyncWithValidationInterfaceQueue() {
+    // the queued callbacks take cs_main, so waiting for them while holding it would deadlock
+    AssertLockNotHeld(cs_main);
+    validationCallbacks.Sync();
+}
+
+void LimitValidationInterfaceQueue() {
+    AssertLockNotHeld(cs_main);
+    validationCallbacks.Limit(MAX_PENDING_VALIDATION_CALLBACKS);
+}
+
+size_t GetValidationInterfaceQueueSize() {
+    return validationCallbacks.Size();
+}
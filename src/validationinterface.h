@@ -6,6 +6,7 @@
 #ifndef BITCOIN_VALIDATIONINTERFACE_H
 #define BITCOIN_VALIDATIONINTERFACE_H
 
+#include <boost/function.hpp>
 #include <boost/signals2/signal.hpp>
 #include <boost/shared_ptr.hpp>
 
@@ -15,11 +16,15 @@ class CBlock;
 class CBlockIndex;
 struct CBlockLocator;
 class CReserveScript;
+class CScheduler;
 class CTransaction;
 class CValidationInterface;
 class CValidationState;
 class uint256;
 
+//! Callbacks that may wait in the validation interface queue before blocks are connected more slowly
+static const size_t MAX_PENDING_VALIDATION_CALLBACKS = 10;
+
 // These functions dispatch to one or all registered wallets
 
 /** Register a wallet to receive updates from core */
@@ -35,6 +40,25 @@ void EraseFromWallets(const uint256 &hash);
 /** Rescan all registered wallets */
 void RescanWallets();
 
+/**
+ * Run the queued validation interface callbacks in order, one at a time, on the threads of scheduler,
+ * instead of on the thread that queues them. Until this is called, they run as they are queued.
+ */
+void RegisterBackgroundSignalScheduler(CScheduler& scheduler);
+/** Stop using the scheduler and run any queued callbacks on this thread, for shutdown */
+void UnregisterBackgroundSignalScheduler();
+/** Queue fn to run after the callbacks queued before it */
+void CallFunctionInValidationInterfaceQueue(const boost::function<void ()>& fn);
+/**
+ * Wait until the callbacks queued before this call have run, so that an RPC sees their effects.
+ * Callbacks may take cs_main and cs_wallet, so neither may be held by the caller.
+ */
+void SyncWithValidationInterfaceQueue();
+/** Wait until no more than MAX_PENDING_VALIDATION_CALLBACKS are queued. The caller may not hold cs_main or cs_wallet. */
+void LimitValidationInterfaceQueue();
+/** Number of callbacks waiting in the queue */
+size_t GetValidationInterfaceQueueSize();
+
 class CValidationInterface {
 protected:
     virtual void UpdatedBlockTip(const CBlockIndex *pindex) {}
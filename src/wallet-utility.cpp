@@ -232,7 +232,7 @@ bool WalletUtilityDB::parseKeys(bool dumppriv, std::string masterPass)
     bool first = true;
 
     try {
-        Dbc* pcursor = GetCursor();
+        CDBCursor* pcursor = GetCursor();
         if (!pcursor)
         {
             LogPrintf("Error getting wallet database cursor\n");
@@ -0,0 +1,177 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "wallet/coinselection.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+static CAmount SaturatingAdd(CAmount a, CAmount b)
+{
+    return (a > std::numeric_limits<CAmount>::max() - b) ? std::numeric_limits<CAmount>::max() : a + b;
+}
+
+bool SelectCoinsBnB(const std::vector<CAmount>& vAmounts,
+                    const std::vector<CAmount>& vTarget,
+                    const std::vector<CAmount>& vWindow,
+                    std::vector<char>& vfSelected,
+                    size_t nMaxTries)
+{
+    const size_t nCurrencies = vTarget.size();
+    vfSelected.clear();
+    if (!nCurrencies || vWindow.size() != nCurrencies || vAmounts.size() % nCurrencies)
+    {
+        return false;
+    }
+    const size_t nCandidates = vAmounts.size() / nCurrencies;
+    vfSelected.assign(nCandidates, false);
+
+    std::vector<CAmount> vUpper(nCurrencies);
+    for (size_t j = 0; j < nCurrencies; j++)
+    {
+        if (vTarget[j] <= 0 || vWindow[j] < 0)
+        {
+            return false;
+        }
+        vUpper[j] = SaturatingAdd(vTarget[j], vWindow[j]);
+    }
+
+    // order candidates largest first relative to the targets, dropping any that alone overshoot
+    // a currency, since they can never be part of a solution
+    std::vector<std::pair<double, size_t>> vOrder;
+    vOrder.reserve(nCandidates);
+    for (size_t i = 0; i < nCandidates; i++)
+    {
+        const CAmount *pRow = &vAmounts[i * nCurrencies];
+        double weight = 0;
+        bool fUseful = false, fFits = true;
+        for (size_t j = 0; j < nCurrencies && fFits; j++)
+        {
+            fFits = pRow[j] >= 0 && pRow[j] <= vUpper[j];
+            fUseful = fUseful || pRow[j] > 0;
+            weight += (double)pRow[j] / vTarget[j];
+        }
+        if (fFits && fUseful)
+        {
+            vOrder.push_back(std::make_pair(weight, i));
+        }
+    }
+    std::sort(vOrder.begin(), vOrder.end(), [](const std::pair<double, size_t>& a, const std::pair<double, size_t>& b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    });
+
+    // sorted copy of the amounts and the totals still available from each position on
+    const size_t n = vOrder.size();
+    std::vector<CAmount> vSorted(n * nCurrencies);
+    std::vector<CAmount> vRemaining((n + 1) * nCurrencies, 0);
+    for (size_t p = 0; p < n; p++)
+    {
+        std::copy(&vAmounts[vOrder[p].second * nCurrencies], &vAmounts[vOrder[p].second * nCurrencies] + nCurrencies, &vSorted[p * nCurrencies]);
+    }
+    for (size_t p = n; p-- > 0;)
+    {
+        for (size_t j = 0; j < nCurrencies; j++)
+        {
+            vRemaining[p * nCurrencies + j] = SaturatingAdd(vRemaining[(p + 1) * nCurrencies + j], vSorted[p * nCurrencies + j]);
+        }
+    }
+    for (size_t j = 0; j < nCurrencies; j++)
+    {
+        if (vRemaining[j] < vTarget[j])
+        {
+            return false;
+        }
+    }
+
+    std::vector<CAmount> vCurrent(nCurrencies, 0);
+    std::vector<char> vfIncluded(n, false);
+    std::vector<size_t> vIncluded, vBest;
+    double bestWaste = std::numeric_limits<double>::max();
+    size_t pos = 0;
+
+    for (size_t nTries = 0; nTries < nMaxTries; nTries++)
+    {
+        bool fBacktrack = false, fReached = true;
+        for (size_t j = 0; j < nCurrencies && !fBacktrack; j++)
+        {
+            if (vCurrent[j] > vUpper[j])
+            {
+                fBacktrack = true;
+            }
+            else if (vCurrent[j] < vTarget[j])
+            {
+                fReached = false;
+                fBacktrack = SaturatingAdd(vCurrent[j], vRemaining[pos * nCurrencies + j]) < vTarget[j];
+            }
+        }
+
+        if (!fBacktrack && fReached)
+        {
+            double waste = 0;
+            for (size_t j = 0; j < nCurrencies; j++)
+            {
+                waste += (double)(vCurrent[j] - vTarget[j]) / vTarget[j];
+            }
+            if (waste < bestWaste || (waste == bestWaste && vIncluded.size() < vBest.size()))
+            {
+                bestWaste = waste;
+                vBest = vIncluded;
+            }
+            if (waste == 0)
+            {
+                break;
+            }
+            fBacktrack = true;
+        }
+        else if (!fBacktrack && pos == n)
+        {
+            fBacktrack = true;
+        }
+
+        if (fBacktrack)
+        {
+            if (vIncluded.empty())
+            {
+                break;
+            }
+            // switch the most recently included candidate to its exclusion branch
+            size_t last = vIncluded.back();
+            vIncluded.pop_back();
+            vfIncluded[last] = false;
+            for (size_t j = 0; j < nCurrencies; j++)
+            {
+                vCurrent[j] -= vSorted[last * nCurrencies + j];
+            }
+            pos = last + 1;
+        }
+        else
+        {
+            // including a candidate equal to an excluded predecessor repeats a branch already searched
+            if (pos > 0 && !vfIncluded[pos - 1] &&
+                std::equal(&vSorted[pos * nCurrencies], &vSorted[pos * nCurrencies] + nCurrencies, &vSorted[(pos - 1) * nCurrencies]))
+            {
+                pos++;
+                continue;
+            }
+            vfIncluded[pos] = true;
+            vIncluded.push_back(pos);
+            for (size_t j = 0; j < nCurrencies; j++)
+            {
+                vCurrent[j] += vSorted[pos * nCurrencies + j];
+            }
+            pos++;
+        }
+    }
+
+    if (vBest.empty())
+    {
+        return false;
+    }
+    for (size_t p : vBest)
+    {
+        vfSelected[vOrder[p].second] = true;
+    }
+    return true;
+}
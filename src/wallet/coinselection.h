@@ -0,0 +1,34 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef VERUS_WALLET_COINSELECTION_H
+#define VERUS_WALLET_COINSELECTION_H
+
+#include "amount.h"
+
+#include <vector>
+
+//! Maximum number of branches the branch and bound selector visits before giving up
+static const size_t BNB_MAX_TRIES = 100000;
+
+/**
+ * Deterministic branch and bound search for a subset of candidate outputs whose totals land in
+ * [vTarget[j], vTarget[j] + vWindow[j]] for every currency j, so that spending them needs no
+ * change output.
+ *
+ * vAmounts is the flat candidate list, nCurrencies = vTarget.size() amounts per candidate, one
+ * candidate after another. Every target must be positive and every amount non-negative.
+ * Candidates are searched largest first by their amounts relative to the targets. Among the
+ * solutions found the one with the least excess, then the fewest inputs, wins.
+ *
+ * Returns false if no solution is found within nMaxTries branches. On success vfSelected has one
+ * entry per candidate, set for those selected.
+ */
+bool SelectCoinsBnB(const std::vector<CAmount>& vAmounts,
+                    const std::vector<CAmount>& vTarget,
+                    const std::vector<CAmount>& vWindow,
+                    std::vector<char>& vfSelected,
+                    size_t nMaxTries = BNB_MAX_TRIES);
+
+#endif // VERUS_WALLET_COINSELECTION_H
@@ -8,6 +8,7 @@
 #include "addrman.h"
 #include "hash.h"
 #include "protocol.h"
+#include "support/cleanse.h"
 #include "util.h"
 #include "utilstrencodings.h"
 
@@ -225,7 +226,7 @@ void CDBEnv::CheckpointLSN(const std::string& strFile)
 }
 
 
-CDB::CDB(const std::string& strFilename, const char* pszMode, bool fFlushOnCloseIn) : pdb(NULL), activeTxn(NULL)
+CDB::CDB(const std::string& strFilename, const char* pszMode, bool fFlushOnCloseIn) : pdb(NULL), activeTxn(NULL), plog(NULL), fLogTxn(false)
 {
     int ret;
     fReadOnly = (!strchr(pszMode, '+') && !strchr(pszMode, 'w'));
@@ -234,6 +235,20 @@ CDB::CDB(const std::string& strFilename, const char* pszMode, bool fFlushOnClose
         return;
 
     bool fCreate = strchr(pszMode, 'c') != NULL;
+
+    if (CWalletLog::IsEnabled()) {
+        strFile = strFilename;
+        plog = CWalletLog::Get(strFile);
+        if (plog == NULL)
+            throw runtime_error(strprintf("CDB: can't open wallet log for %s", strFile));
+        if (fCreate && !Exists(string("version"))) {
+            bool fTmp = fReadOnly;
+            fReadOnly = false;
+            WriteVersion(CLIENT_VERSION);
+            fReadOnly = fTmp;
+        }
+        return;
+    }
     unsigned int nFlags = DB_THREAD;
     if (fCreate)
         nFlags |= DB_CREATE;
@@ -286,7 +301,8 @@ CDB::CDB(const std::string& strFilename, const char* pszMode, bool fFlushOnClose
 
 void CDB::Flush()
 {
-    if (activeTxn)
+    // log writes are on disk once they return
+    if (activeTxn || plog)
         return;
 
     // Flush database activity from memory pool to disk log
@@ -299,6 +315,11 @@ void CDB::Flush()
 
 void CDB::Close()
 {
+    if (plog) {
+        ClearLogTxn();
+        plog = NULL;
+        return;
+    }
     if (!pdb)
         return;
     if (activeTxn)
@@ -315,6 +336,101 @@ void CDB::Close()
     }
 }
 
+void CDB::ClearLogTxn()
+{
+    for (CWalletLog::Record& record : vLogTxn)
+        memory_cleanse(record.value.data(), record.value.size());
+    vLogTxn.clear();
+    fLogTxn = false;
+}
+
+bool CDB::LogRead(const CDataStream& ssKey, CDataStream& ssValue)
+{
+    CWalletLog::Data key(ssKey.begin(), ssKey.end()), value;
+
+    // an open transaction sees its own writes, as it would in Berkeley DB
+    bool fPending = false, fFound = false;
+    for (std::vector<CWalletLog::Record>::reverse_iterator it = vLogTxn.rbegin(); it != vLogTxn.rend() && !fPending; ++it) {
+        if (it->key == key) {
+            fPending = true;
+            fFound = !it->fErase;
+            if (fFound)
+                value = it->value;
+        }
+    }
+    if (!fPending)
+        fFound = plog->Read(key, value);
+    if (!fFound)
+        return false;
+
+    ssValue.write((const char*)value.data(), value.size());
+    memory_cleanse(value.data(), value.size());
+    return true;
+}
+
+bool CDB::LogWrite(const CDataStream& ssKey, const CDataStream& ssValue, bool fOverwrite)
+{
+    if (!fOverwrite && LogExists(ssKey))
+        return false;
+
+    CWalletLog::Record record(CWalletLog::Data(ssKey.begin(), ssKey.end()), CWalletLog::Data(ssValue.begin(), ssValue.end()), false);
+    if (fLogTxn) {
+        vLogTxn.push_back(record);
+        memory_cleanse(record.value.data(), record.value.size());
+        return true;
+    }
+    bool fSuccess = plog->Commit(std::vector<CWalletLog::Record>(1, record));
+    memory_cleanse(record.value.data(), record.value.size());
+    return fSuccess;
+}
+
+bool CDB::LogErase(const CDataStream& ssKey)
+{
+    CWalletLog::Record record(CWalletLog::Data(ssKey.begin(), ssKey.end()), CWalletLog::Data(), true);
+    if (fLogTxn) {
+        vLogTxn.push_back(record);
+        return true;
+    }
+    return plog->Commit(std::vector<CWalletLog::Record>(1, record));
+}
+
+bool CDB::LogExists(const CDataStream& ssKey)
+{
+    CWalletLog::Data key(ssKey.begin(), ssKey.end());
+    for (std::vector<CWalletLog::Record>::reverse_iterator it = vLogTxn.rbegin(); it != vLogTxn.rend(); ++it) {
+        if (it->key == key)
+            return !it->fErase;
+    }
+    return plog->Exists(key);
+}
+
+int CDB::ReadAtLogCursor(CDBCursor* pcursor, CDataStream& ssKey, CDataStream& ssValue, unsigned int fFlags)
+{
+    CWalletLog::Data key, value;
+    bool fFound;
+    if (fFlags == DB_SET_RANGE)
+        fFound = pcursor->plog->Seek(CWalletLog::Data(ssKey.begin(), ssKey.end()), false, key, value);
+    else if (fFlags == DB_NEXT)
+        fFound = pcursor->plog->Seek(pcursor->vchLastKey, pcursor->fStarted, key, value);
+    else
+        return EINVAL;
+    if (!fFound)
+        return DB_NOTFOUND;
+
+    // the cursor only remembers its position by key, so writes while it is open don't invalidate it
+    pcursor->vchLastKey = key;
+    pcursor->fStarted = true;
+
+    ssKey.SetType(SER_DISK);
+    ssKey.clear();
+    ssKey.write((const char*)key.data(), key.size());
+    ssValue.SetType(SER_DISK);
+    ssValue.clear();
+    ssValue.write((const char*)value.data(), value.size());
+    memory_cleanse(value.data(), value.size());
+    return 0;
+}
+
 void CDBEnv::CloseDb(const string& strFile)
 {
     {
@@ -340,6 +456,18 @@ bool CDBEnv::RemoveDb(const string& strFile)
 
 bool CDB::Rewrite(const string& strFile, const char* pszSkip)
 {
+    if (CWalletLog::IsEnabled()) {
+        CWalletLog* plog = CWalletLog::Get(strFile);
+        if (!plog)
+            return false;
+        {
+            CDB db(strFile, "r+");
+            db.WriteVersion(CLIENT_VERSION);
+        }
+        LogPrintf("CDB::Rewrite: Compacting %s...\n", CWalletLog::GetPath(strFile).string());
+        return plog->Compact(pszSkip);
+    }
+
     while (true) {
         {
             LOCK(bitdb.cs_db);
@@ -367,7 +495,7 @@ bool CDB::Rewrite(const string& strFile, const char* pszSkip)
                         fSuccess = false;
                     }
 
-                    Dbc* pcursor = db.GetCursor();
+                    CDBCursor* pcursor = db.GetCursor();
                     if (pcursor)
                         while (fSuccess) {
                             CDataStream ssKey(SER_DISK, CLIENT_VERSION);
@@ -421,10 +549,128 @@ bool CDB::Rewrite(const string& strFile, const char* pszSkip)
     return false;
 }
 
+bool CDB::MigrateToLog(const string& strFile)
+{
+    int64_t nStart = GetTimeMillis();
+    CWalletLog::DataMap mapRecords;
+    {
+        LOCK(bitdb.cs_db);
+        Db db(bitdb.dbenv, 0);
+        int ret = db.open(NULL, strFile.c_str(), "main", DB_BTREE, DB_RDONLY, 0);
+        if (ret != 0)
+            return error("CDB::MigrateToLog: Error %d, can't open database %s", ret, strFile);
+
+        Dbc* pcursor = NULL;
+        ret = db.cursor(NULL, &pcursor, 0);
+        if (ret == 0 && pcursor) {
+            Dbt datKey, datValue;
+            datKey.set_flags(DB_DBT_REALLOC);
+            datValue.set_flags(DB_DBT_REALLOC);
+            while ((ret = pcursor->get(&datKey, &datValue, DB_NEXT)) == 0) {
+                const unsigned char* pkey = (const unsigned char*)datKey.get_data();
+                const unsigned char* pvalue = (const unsigned char*)datValue.get_data();
+                mapRecords[CWalletLog::Data(pkey, pkey + datKey.get_size())] = CWalletLog::Data(pvalue, pvalue + datValue.get_size());
+            }
+            pcursor->close();
+            if (datValue.get_data()) {
+                memset(datValue.get_data(), 0, datValue.get_size());
+                free(datValue.get_data());
+            }
+            free(datKey.get_data());
+        }
+        db.close(0);
+        if (ret != DB_NOTFOUND)
+            return error("CDB::MigrateToLog: Error %d reading database %s", ret, strFile);
+    }
+
+    boost::filesystem::path pathLog = CWalletLog::GetPath(strFile);
+    boost::filesystem::path pathNew = pathLog.string() + ".new";
+    bool fSuccess = CWalletLog::WriteFile(pathNew, mapRecords) && RenameOver(pathNew, pathLog);
+    for (CWalletLog::DataMap::iterator it = mapRecords.begin(); it != mapRecords.end(); ++it)
+        memory_cleanse(it->second.data(), it->second.size());
+    if (!fSuccess)
+        return error("CDB::MigrateToLog: can't write %s", pathLog.string());
+
+    // the log is now the wallet, so don't leave a stale copy under the wallet's name for backups
+    // and tools to read; the renamed file stays as a backup, like the one MigrateFromLog keeps
+    bitdb.CloseDb(strFile);
+    std::string strBackup = strprintf("%s.%d.bak", strFile, GetTime());
+    {
+        LOCK(bitdb.cs_db);
+        if (bitdb.dbenv->dbrename(NULL, strFile.c_str(), NULL, strBackup.c_str(), DB_AUTO_COMMIT) != 0)
+            return error("CDB::MigrateToLog: failed to rename %s to %s", strFile, strBackup);
+    }
+
+    LogPrintf("CDB::MigrateToLog: copied %u records from %s to %s in %dms, %s kept as %s\n",
+              mapRecords.size(), strFile, pathLog.string(), GetTimeMillis() - nStart, strFile, strBackup);
+    return true;
+}
+
+bool CDB::MigrateFromLog(const string& strFile)
+{
+    int64_t nStart = GetTimeMillis();
+    boost::filesystem::path pathLog = CWalletLog::GetPath(strFile);
+    CWalletLog* plog = CWalletLog::Get(strFile);
+    if (!plog)
+        return false;
+
+    std::vector<CDBEnv::KeyValPair> vRecords;
+    CWalletLog::Data keyLast, key, value;
+    while (plog->Seek(keyLast, !vRecords.empty(), key, value)) {
+        vRecords.push_back(make_pair(key, value));
+        keyLast = key;
+    }
+    memory_cleanse(value.data(), value.size());
+    CWalletLog::CloseAll();
+
+    LOCK(bitdb.cs_db);
+    int64_t now = GetTime();
+    if (boost::filesystem::exists(GetDataDir() / strFile)) {
+        std::string strBackup = strprintf("%s.%d.bak", strFile, now);
+        if (bitdb.dbenv->dbrename(NULL, strFile.c_str(), NULL, strBackup.c_str(), DB_AUTO_COMMIT) != 0)
+            return error("CDB::MigrateFromLog: failed to rename %s to %s", strFile, strBackup);
+        LogPrintf("CDB::MigrateFromLog: renamed %s to %s\n", strFile, strBackup);
+    }
+
+    bool fSuccess = true;
+    {
+        Db db(bitdb.dbenv, 0);
+        int ret = db.open(NULL, strFile.c_str(), "main", DB_BTREE, DB_CREATE, 0);
+        if (ret != 0)
+            return error("CDB::MigrateFromLog: Error %d, can't create database %s", ret, strFile);
+
+        DbTxn* ptxn = bitdb.TxnBegin();
+        fSuccess = ptxn != NULL;
+        for (CDBEnv::KeyValPair& row : vRecords) {
+            if (!fSuccess)
+                break;
+            Dbt datKey(row.first.data(), row.first.size());
+            Dbt datValue(row.second.data(), row.second.size());
+            fSuccess = db.put(ptxn, &datKey, &datValue, DB_NOOVERWRITE) == 0;
+            memory_cleanse(row.second.data(), row.second.size());
+        }
+        if (ptxn)
+            fSuccess = fSuccess ? ptxn->commit(0) == 0 : (ptxn->abort(), false);
+        db.close(0);
+    }
+    if (!fSuccess)
+        return error("CDB::MigrateFromLog: failed to write %s", strFile);
+
+    boost::filesystem::path pathBackup = pathLog.string() + strprintf(".%d.bak", now);
+    if (!RenameOver(pathLog, pathBackup))
+        return error("CDB::MigrateFromLog: failed to rename %s to %s", pathLog.string(), pathBackup.string());
+
+    LogPrintf("CDB::MigrateFromLog: copied %u records from %s to %s in %dms, log kept as %s\n",
+              vRecords.size(), pathLog.string(), strFile, GetTimeMillis() - nStart, pathBackup.string());
+    return true;
+}
+
 
 void CDBEnv::Flush(bool fShutdown)
 {
     int64_t nStart = GetTimeMillis();
+    if (fShutdown)
+        CWalletLog::CloseAll();
     // Flush log data to the actual data file on all files that are not in use
     LogPrint("db", "CDBEnv::Flush: Flush(%s)%s\n", fShutdown ? "true" : "false", fDbEnvInit ? "" : " database not started");
     if (!fDbEnvInit)
@@ -11,6 +11,7 @@
 #include "streams.h"
 #include "sync.h"
 #include "version.h"
+#include "wallet/walletlog.h"
 
 #include <map>
 #include <string>
@@ -87,6 +88,26 @@ public:
 extern CDBEnv bitdb;
 
 
+/** Cursor over a Berkeley database or a wallet log, freed by close() like the Dbc it wraps */
+class CDBCursor
+{
+public:
+    Dbc* pdbc;
+    CWalletLog* plog;
+    CWalletLog::Data vchLastKey;
+    bool fStarted;
+
+    CDBCursor(Dbc* pdbcIn, CWalletLog* plogIn) : pdbc(pdbcIn), plog(plogIn), fStarted(false) {}
+
+    void close()
+    {
+        if (pdbc)
+            pdbc->close();
+        delete this;
+    }
+};
+
+
 /** RAII class that provides access to a Berkeley database */
 class CDB
 {
@@ -96,6 +117,10 @@ protected:
     DbTxn* activeTxn;
     bool fReadOnly;
     bool fFlushOnClose;
+    //! with -walletstore=log every access goes to this log instead of pdb
+    CWalletLog* plog;
+    std::vector<CWalletLog::Record> vLogTxn;
+    bool fLogTxn;
 
     explicit CDB(const std::string& strFilename, const char* pszMode = "r+", bool fFlushOnCloseIn=true);
     ~CDB() { Close(); }
@@ -108,17 +133,37 @@ private:
     CDB(const CDB&);
     void operator=(const CDB&);
 
+    bool LogRead(const CDataStream& ssKey, CDataStream& ssValue);
+    bool LogWrite(const CDataStream& ssKey, const CDataStream& ssValue, bool fOverwrite);
+    bool LogErase(const CDataStream& ssKey);
+    bool LogExists(const CDataStream& ssKey);
+    int ReadAtLogCursor(CDBCursor* pcursor, CDataStream& ssKey, CDataStream& ssValue, unsigned int fFlags);
+    void ClearLogTxn();
+
 protected:
     template <typename K, typename T>
     bool Read(const K& key, T& value)
     {
-        if (!pdb)
+        if (!pdb && !plog)
             return false;
 
         // Key
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(1000);
         ssKey << key;
+
+        if (plog)
+        {
+            CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+            if (!LogRead(ssKey, ssValue))
+                return false;
+            try {
+                ssValue >> value;
+            } catch (const std::exception&) {
+                return false;
+            }
+            return true;
+        }
         Dbt datKey(&ssKey[0], ssKey.size());
 
         // Read
@@ -146,7 +191,7 @@ protected:
     template <typename K, typename T>
     bool Write(const K& key, const T& value, bool fOverwrite = true)
     {
-        if (!pdb)
+        if (!pdb && !plog)
             return false;
         if (fReadOnly)
             assert(!"Write called on database in read-only mode");
@@ -155,12 +200,14 @@ protected:
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(1000);
         ssKey << key;
-        Dbt datKey(&ssKey[0], ssKey.size());
 
         // Value
         CDataStream ssValue(SER_DISK, CLIENT_VERSION);
         ssValue.reserve(10000);
         ssValue << value;
+        if (plog)
+            return LogWrite(ssKey, ssValue, fOverwrite);
+        Dbt datKey(&ssKey[0], ssKey.size());
         Dbt datValue(&ssValue[0], ssValue.size());
 
         // Write
@@ -175,7 +222,7 @@ protected:
     template <typename K>
     bool Erase(const K& key)
     {
-        if (!pdb)
+        if (!pdb && !plog)
             return false;
         if (fReadOnly)
             assert(!"Erase called on database in read-only mode");
@@ -184,6 +231,8 @@ protected:
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(1000);
         ssKey << key;
+        if (plog)
+            return LogErase(ssKey);
         Dbt datKey(&ssKey[0], ssKey.size());
 
         // Erase
@@ -197,13 +246,15 @@ protected:
     template <typename K>
     bool Exists(const K& key)
     {
-        if (!pdb)
+        if (!pdb && !plog)
             return false;
 
         // Key
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(1000);
         ssKey << key;
+        if (plog)
+            return LogExists(ssKey);
         Dbt datKey(&ssKey[0], ssKey.size());
 
         // Exists
@@ -214,19 +265,25 @@ protected:
         return (ret == 0);
     }
 
-    Dbc* GetCursor()
+    CDBCursor* GetCursor()
     {
+        if (plog)
+            return new CDBCursor(NULL, plog);
         if (!pdb)
             return NULL;
         Dbc* pcursor = NULL;
         int ret = pdb->cursor(NULL, &pcursor, 0);
         if (ret != 0)
             return NULL;
-        return pcursor;
+        return new CDBCursor(pcursor, NULL);
     }
 
-    int ReadAtCursor(Dbc* pcursor, CDataStream& ssKey, CDataStream& ssValue, unsigned int fFlags = DB_NEXT)
+    int ReadAtCursor(CDBCursor* pcursorIn, CDataStream& ssKey, CDataStream& ssValue, unsigned int fFlags = DB_NEXT)
     {
+        if (pcursorIn->plog)
+            return ReadAtLogCursor(pcursorIn, ssKey, ssValue, fFlags);
+        Dbc* pcursor = pcursorIn->pdbc;
+
         // Read at cursor
         Dbt datKey;
         if (fFlags == DB_SET || fFlags == DB_SET_RANGE || fFlags == DB_GET_BOTH || fFlags == DB_GET_BOTH_RANGE) {
@@ -265,6 +322,13 @@ protected:
 public:
     bool TxnBegin()
     {
+        if (plog)
+        {
+            if (fLogTxn)
+                return false;
+            fLogTxn = true;
+            return true;
+        }
         if (!pdb || activeTxn)
             return false;
         DbTxn* ptxn = bitdb.TxnBegin();
@@ -276,6 +340,14 @@ public:
 
     bool TxnCommit()
     {
+        if (plog)
+        {
+            if (!fLogTxn)
+                return false;
+            bool fSuccess = plog->Commit(vLogTxn);
+            ClearLogTxn();
+            return fSuccess;
+        }
         if (!pdb || !activeTxn)
             return false;
         int ret = activeTxn->commit(0);
@@ -285,6 +357,13 @@ public:
 
     bool TxnAbort()
     {
+        if (plog)
+        {
+            if (!fLogTxn)
+                return false;
+            ClearLogTxn();
+            return true;
+        }
         if (!pdb || !activeTxn)
             return false;
         int ret = activeTxn->abort();
@@ -304,6 +383,10 @@ public:
     }
 
     bool static Rewrite(const std::string& strFile, const char* pszSkip = NULL);
+    //! copies the Berkeley DB strFile into a new wallet log, leaving the original in place
+    bool static MigrateToLog(const std::string& strFile);
+    //! recreates the Berkeley DB strFile from its wallet log, keeping the old file and log as backups
+    bool static MigrateFromLog(const std::string& strFile);
 };
 
 #endif // BITCOIN_WALLET_DB_H
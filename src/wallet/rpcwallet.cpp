@@ -12,6 +12,7 @@
 #include "pbaas/pbaas.h"
 #include "net.h"
 #include "netbase.h"
+#include "rpc/jsonstream.h"
 #include "rpc/server.h"
 #include "timedata.h"
 #include "transaction_builder.h"
@@ -81,6 +82,9 @@ bool EnsureWalletIsAvailable(bool avoidException)
         else
             return false;
     }
+    // let the wallet catch up with the blocks and transactions validated before this call
+    if (!avoidException)
+        SyncWithValidationInterfaceQueue();
     return true;
 }
 
@@ -2357,65 +2361,78 @@ UniValue listtransactions(const UniValue& params, bool fHelp)
             + HelpExampleRpc("listtransactions", "\"*\", 20, 100")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    vector<UniValue> arrTmp;
+    {
+        LOCK2(cs_main, pwalletMain->cs_wallet);
 
-    string strAccount = "*";
-    if (params.size() > 0)
-        strAccount = params[0].get_str();
-    int nCount = 10;
-    if (params.size() > 1)
-        nCount = params[1].get_int();
-    int nFrom = 0;
-    if (params.size() > 2)
-        nFrom = params[2].get_int();
-    isminefilter filter = ISMINE_SPENDABLE;
-    if(params.size() > 3)
-        if(params[3].get_bool())
-            filter = ISMINE_ALL;
+        string strAccount = "*";
+        if (params.size() > 0)
+            strAccount = params[0].get_str();
+        int nCount = 10;
+        if (params.size() > 1)
+            nCount = params[1].get_int();
+        int nFrom = 0;
+        if (params.size() > 2)
+            nFrom = params[2].get_int();
+        isminefilter filter = ISMINE_SPENDABLE;
+        if(params.size() > 3)
+            if(params[3].get_bool())
+                filter = ISMINE_ALL;
 
-    if (nCount < 0)
-        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative count");
-    if (nFrom < 0)
-        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative from");
+        if (nCount < 0)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative count");
+        if (nFrom < 0)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative from");
 
-    UniValue ret(UniValue::VARR);
+        UniValue ret(UniValue::VARR);
 
-    std::list<CAccountingEntry> acentries;
-    CWallet::TxItems txOrdered = pwalletMain->OrderedTxItems(acentries, strAccount);
+        std::list<CAccountingEntry> acentries;
+        CWallet::TxItems txOrdered = pwalletMain->OrderedTxItems(acentries, strAccount);
 
-    // iterate backwards until we have nCount items to return:
-    for (CWallet::TxItems::reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it)
-    {
-        CWalletTx *const pwtx = (*it).second.first;
-        if (pwtx != 0)
-            ListTransactions(*pwtx, strAccount, 0, true, ret, filter);
-        CAccountingEntry *const pacentry = (*it).second.second;
-        if (pacentry != 0)
-            AcentryToJSON(*pacentry, strAccount, ret);
+        // iterate backwards until we have nCount items to return:
+        for (CWallet::TxItems::reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it)
+        {
+            CWalletTx *const pwtx = (*it).second.first;
+            if (pwtx != 0)
+                ListTransactions(*pwtx, strAccount, 0, true, ret, filter);
+            CAccountingEntry *const pacentry = (*it).second.second;
+            if (pacentry != 0)
+                AcentryToJSON(*pacentry, strAccount, ret);
 
-        if ((int)ret.size() >= (nCount+nFrom)) break;
-    }
-    // ret is newest to oldest
+            if ((int)ret.size() >= (nCount+nFrom)) break;
+        }
+        // ret is newest to oldest
 
-    if (nFrom > (int)ret.size())
-        nFrom = ret.size();
-    if ((nFrom + nCount) > (int)ret.size())
-        nCount = ret.size() - nFrom;
+        if (nFrom > (int)ret.size())
+            nFrom = ret.size();
+        if ((nFrom + nCount) > (int)ret.size())
+            nCount = ret.size() - nFrom;
 
-    vector<UniValue> arrTmp = ret.getValues();
+        arrTmp = ret.getValues();
 
-    vector<UniValue>::iterator first = arrTmp.begin();
-    std::advance(first, nFrom);
-    vector<UniValue>::iterator last = arrTmp.begin();
-    std::advance(last, nFrom+nCount);
+        vector<UniValue>::iterator first = arrTmp.begin();
+        std::advance(first, nFrom);
+        vector<UniValue>::iterator last = arrTmp.begin();
+        std::advance(last, nFrom+nCount);
 
-    if (last != arrTmp.end()) arrTmp.erase(last, arrTmp.end());
-    if (first != arrTmp.begin()) arrTmp.erase(arrTmp.begin(), first);
+        if (last != arrTmp.end()) arrTmp.erase(last, arrTmp.end());
+        if (first != arrTmp.begin()) arrTmp.erase(arrTmp.begin(), first);
+    }
 
     std::reverse(arrTmp.begin(), arrTmp.end()); // Return oldest to newest
 
-    ret.clear();
-    ret.setArray();
+    // the entries are complete, so a streamed reply is written without holding the locks
+    CJSONStreamWriter* pwriter = ClaimRPCResultStream("listtransactions");
+    if (pwriter)
+    {
+        pwriter->BeginArray();
+        for (size_t i = 0; i < arrTmp.size() && pwriter->IsGood(); i++)
+            pwriter->Value(arrTmp[i]);
+        pwriter->EndArray();
+        return NullUniValue;
+    }
+
+    UniValue ret(UniValue::VARR);
     ret.push_backV(arrTmp);
 
     return ret;
@@ -3726,9 +3743,17 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
             "Runs a benchmark of the selected type samplecount times,\n"
             "returning the running times of each sample.\n"
             "\n"
+            "trydecryptsaplingnotes takes the number of wallet keys and an optional\n"
+            "number of transactions to check, and also reports the trial decryptions\n"
+            "per second for each sample.\n"
+            "\n"
+            "selectcoinsbnb takes the number of synthetic wallet outputs and an optional\n"
+            "number of currencies per output (default 2).\n"
+            "\n"
             "Output: [\n"
             "  {\n"
             "    \"runningtime\": runningtime\n"
+            "    (\"trialdecryptionspersecond\": n)\n"
             "  },\n"
             "  {\n"
             "    \"runningtime\": runningtime\n"
@@ -3748,6 +3773,7 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
     }
 
     std::vector<double> sample_times;
+    std::vector<double> sample_throughput;
 
     JSDescription samplejoinsplit;
 
@@ -3797,7 +3823,13 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
             sample_times.push_back(benchmark_try_decrypt_sprout_notes(nKeys));
         } else if (benchmarktype == "trydecryptsaplingnotes") {
             int nKeys = params[2].get_int();
-            sample_times.push_back(benchmark_try_decrypt_sapling_notes(nKeys));
+            int nTxs = 1;
+            if (params.size() >= 4) {
+                nTxs = params[3].get_int();
+            }
+            double time = benchmark_try_decrypt_sapling_notes(nKeys, nTxs);
+            sample_times.push_back(time);
+            sample_throughput.push_back(time > 0 ? (double)nKeys * nTxs / time : 0);
         } else if (benchmarktype == "incnotewitnesses") {
             int nTxs = params[2].get_int();
             sample_times.push_back(benchmark_increment_sprout_note_witnesses(nTxs));
@@ -3822,6 +3854,16 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
             sample_times.push_back(benchmark_loadwallet());
         } else if (benchmarktype == "listunspent") {
             sample_times.push_back(benchmark_listunspent());
+        } else if (benchmarktype == "selectcoinsbnb") {
+            int nCoins = params[2].get_int();
+            int nCurrencies = 2;
+            if (params.size() >= 4) {
+                nCurrencies = params[3].get_int();
+            }
+            if (nCoins <= 0 || nCurrencies <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid number of outputs or currencies");
+            }
+            sample_times.push_back(benchmark_select_coins_bnb(nCoins, nCurrencies));
         } else if (benchmarktype == "createsaplingspend") {
             sample_times.push_back(benchmark_create_sapling_spend());
         } else if (benchmarktype == "createsaplingoutput") {
@@ -3836,9 +3878,12 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
     }
 
     UniValue results(UniValue::VARR);
-    for (auto time : sample_times) {
+    for (size_t i = 0; i < sample_times.size(); i++) {
         UniValue result(UniValue::VOBJ);
-        result.push_back(Pair("runningtime", time));
+        result.push_back(Pair("runningtime", sample_times[i]));
+        if (i < sample_throughput.size()) {
+            result.push_back(Pair("trialdecryptionspersecond", sample_throughput[i]));
+        }
         results.push_back(result);
     }
 
@@ -8071,8 +8116,8 @@ extern UniValue z_getpaymentdisclosure(const UniValue& params, bool fHelp); // i
 extern UniValue z_validatepaymentdisclosure(const UniValue &params, bool fHelp);
 
 static const CRPCCommand commands[] =
-{ //  category              name                        actor (function)           okSafeMode
-    //  --------------------- ------------------------    -----------------------    ----------
+{ //  category              name                        actor (function)           okSafeMode  okParallel
+    //  --------------------- ------------------------    -----------------------    ----------  ----------
     { "rawtransactions",    "fundrawtransaction",       &fundrawtransaction,       false },
     { "hidden",             "resendwallettransactions", &resendwallettransactions, true  },
     { "wallet",             "addmultisigaddress",       &addmultisigaddress,       true  },
@@ -8096,6 +8141,7 @@ static const CRPCCommand commands[] =
     { "wallet",             "importprivkey",            &importprivkey,            true  },
     { "wallet",             "importwallet",             &importwallet,             true  },
     { "wallet",             "importaddress",            &importaddress,            true  },
+    { "wallet",             "abortrescan",              &abortrescan,              true  },
     { "wallet",             "keypoolrefill",            &keypoolrefill,            true  },
     { "wallet",             "listaccounts",             &listaccounts,             false },
     { "wallet",             "listaddressgroupings",     &listaddressgroupings,     false },
@@ -0,0 +1,123 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "wallet/saplingdecrypt.h"
+
+#include "checkqueue.h"
+#include "util.h"
+#include "zcash/Note.hpp"
+
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+using namespace libzcash;
+
+int nSaplingDecryptThreads = 0;
+
+namespace {
+
+/** Tries a range of viewing keys against one output, see TrialDecryptSaplingOutputBatch */
+class CSaplingTrialDecryptCheck
+{
+private:
+    const OutputDescription *poutput;
+    const std::vector<SaplingIncomingViewingKey> *pvIvks;
+    size_t nBegin;
+    size_t nEnd;
+    boost::optional<CSaplingTrialDecryptResult> *presult;
+
+public:
+    CSaplingTrialDecryptCheck() : poutput(NULL), pvIvks(NULL), nBegin(0), nEnd(0), presult(NULL) {}
+    CSaplingTrialDecryptCheck(const OutputDescription *poutputIn, const std::vector<SaplingIncomingViewingKey> *pvIvksIn,
+                              size_t nBeginIn, size_t nEndIn, boost::optional<CSaplingTrialDecryptResult> *presultIn) :
+        poutput(poutputIn), pvIvks(pvIvksIn), nBegin(nBeginIn), nEnd(nEndIn), presult(presultIn) {}
+
+    bool operator()()
+    {
+        for (size_t i = nBegin; i < nEnd; i++)
+        {
+            auto result = SaplingNotePlaintext::decrypt(poutput->encCiphertext, (*pvIvks)[i], poutput->ephemeralKey, poutput->cm);
+            if (result)
+            {
+                *presult = CSaplingTrialDecryptResult(i, result.get().d);
+                break;
+            }
+        }
+        return true;
+    }
+
+    void swap(CSaplingTrialDecryptCheck &check)
+    {
+        std::swap(poutput, check.poutput);
+        std::swap(pvIvks, check.pvIvks);
+        std::swap(nBegin, check.nBegin);
+        std::swap(nEnd, check.nEnd);
+        std::swap(presult, check.presult);
+    }
+};
+
+CCheckQueue<CSaplingTrialDecryptCheck> saplingdecryptqueue(16);
+
+// CCheckQueue takes one master at a time, batches started while it is busy run on their own thread
+boost::mutex csSaplingDecryptMaster;
+
+}
+
+void ThreadSaplingTrialDecrypt()
+{
+    RenameThread("zcash-saplingdec");
+    saplingdecryptqueue.Thread();
+}
+
+std::vector<boost::optional<CSaplingTrialDecryptResult> > TrialDecryptSaplingOutputBatch(
+    const std::vector<const OutputDescription*> &vOutputs,
+    const std::vector<SaplingIncomingViewingKey> &vIvks)
+{
+    std::vector<boost::optional<CSaplingTrialDecryptResult> > vResults(vOutputs.size());
+    if (vOutputs.empty() || vIvks.empty())
+        return vResults;
+
+    boost::unique_lock<boost::mutex> lockMaster(csSaplingDecryptMaster, boost::defer_lock);
+    if (nSaplingDecryptThreads <= 1 || vOutputs.size() * vIvks.size() < MIN_SAPLING_DECRYPT_BATCH || !lockMaster.try_lock())
+    {
+        for (size_t i = 0; i < vOutputs.size(); i++)
+            CSaplingTrialDecryptCheck(vOutputs[i], &vIvks, 0, vIvks.size(), &vResults[i])();
+        return vResults;
+    }
+
+    // Every output gets a result slot per key range, the first range that decrypts it wins so the
+    // key chosen is the same as when trying all keys in order on one thread.
+    size_t nRanges = (vIvks.size() + SAPLING_DECRYPT_KEYS_PER_CHECK - 1) / SAPLING_DECRYPT_KEYS_PER_CHECK;
+    std::vector<boost::optional<CSaplingTrialDecryptResult> > vRangeResults(vOutputs.size() * nRanges);
+    std::vector<CSaplingTrialDecryptCheck> vChecks;
+    vChecks.reserve(vRangeResults.size());
+    for (size_t i = 0; i < vOutputs.size(); i++)
+    {
+        for (size_t j = 0; j < nRanges; j++)
+        {
+            size_t nBegin = j * SAPLING_DECRYPT_KEYS_PER_CHECK;
+            size_t nEnd = std::min(vIvks.size(), nBegin + SAPLING_DECRYPT_KEYS_PER_CHECK);
+            vChecks.push_back(CSaplingTrialDecryptCheck(vOutputs[i], &vIvks, nBegin, nEnd, &vRangeResults[i * nRanges + j]));
+        }
+    }
+
+    {
+        CCheckQueueControl<CSaplingTrialDecryptCheck> control(&saplingdecryptqueue);
+        control.Add(vChecks);
+        control.Wait();
+    }
+
+    for (size_t i = 0; i < vOutputs.size(); i++)
+    {
+        for (size_t j = 0; j < nRanges; j++)
+        {
+            if (vRangeResults[i * nRanges + j])
+            {
+                vResults[i] = vRangeResults[i * nRanges + j];
+                break;
+            }
+        }
+    }
+    return vResults;
+}
@@ -0,0 +1,47 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef VERUS_WALLET_SAPLINGDECRYPT_H
+#define VERUS_WALLET_SAPLINGDECRYPT_H
+
+#include "primitives/transaction.h"
+#include "zcash/Address.hpp"
+
+#include <vector>
+
+#include <boost/optional.hpp>
+
+//! -saplingdecryptthreads default, 0 uses one thread per core
+static const int DEFAULT_SAPLING_DECRYPT_THREADS = 0;
+//! Maximum number of threads trial decrypting Sapling outputs
+static const int MAX_SAPLING_DECRYPT_THREADS = 16;
+//! Batches with fewer output and key pairs than this are decrypted on the calling thread
+static const size_t MIN_SAPLING_DECRYPT_BATCH = 64;
+//! Number of viewing keys one queued check tries against its output
+static const size_t SAPLING_DECRYPT_KEYS_PER_CHECK = 32;
+
+extern int nSaplingDecryptThreads;
+
+/** The viewing key, as an index into the batch's keys, and diversifier an output decrypted with */
+struct CSaplingTrialDecryptResult
+{
+    size_t nIvk;
+    libzcash::diversifier_t d;
+
+    CSaplingTrialDecryptResult(size_t nIvkIn, const libzcash::diversifier_t &dIn) : nIvk(nIvkIn), d(dIn) {}
+};
+
+/**
+ * Trial decrypts each output against the viewing keys in order, stopping at the first key that
+ * decrypts it. Output and key range pairs are spread over the Sapling decryption threads when the
+ * batch is large enough and no other batch is using them, otherwise the calling thread does the work.
+ */
+std::vector<boost::optional<CSaplingTrialDecryptResult> > TrialDecryptSaplingOutputBatch(
+    const std::vector<const OutputDescription*> &vOutputs,
+    const std::vector<libzcash::SaplingIncomingViewingKey> &vIvks);
+
+/** Run by each of the -saplingdecryptthreads - 1 worker threads */
+void ThreadSaplingTrialDecrypt();
+
+#endif // VERUS_WALLET_SAPLINGDECRYPT_H
@@ -6,6 +6,7 @@
 #include "wallet/wallet.h"
 
 #include "asyncrpcqueue.h"
+#include "blockmmrcache.h"
 #include "checkpoints.h"
 #include "coincontrol.h"
 #include "core_io.h"
@@ -27,6 +28,8 @@
 #include "crypter.h"
 #include "coins.h"
 #include "wallet/asyncrpcoperation_saplingmigration.h"
+#include "wallet/coinselection.h"
+#include "wallet/saplingdecrypt.h"
 #include "zcash/zip32.h"
 #include "cc/StakeGuard.h"
 #include "pbaas/identity.h"
@@ -527,6 +530,7 @@ bool CWallet::AddCScript(const CScript& redeemScript)
     // hash of the script, we store it under the name ID
     if (!CCryptoKeyStore::AddCScript(redeemScript))
         return false;
+    MarkUnspentTxsStale();
     if (!fFileBacked)
         return true;
     return CWalletDB(strWalletFile).WriteCScript(ScriptOrIdentityID(redeemScript), redeemScript);
@@ -555,6 +559,7 @@ bool CWallet::AddIdentity(const CIdentityMapKey &mapKey, const CIdentityMapValue
     // hash of the script, we store it under the name ID
     if (!CCryptoKeyStore::AddIdentity(mapKey, identity))
         return false;
+    MarkUnspentTxsStale();
     if (!fFileBacked)
         return true;
     return CWalletDB(strWalletFile).WriteIdentity(mapKey, identity);
@@ -567,6 +572,7 @@ bool CWallet::UpdateIdentity(const CIdentityMapKey &mapKey, const CIdentityMapVa
     // hash of the script, we store it under the name ID
     if (!CCryptoKeyStore::UpdateIdentity(mapKey, identity))
         return false;
+    MarkUnspentTxsStale();
     if (!fFileBacked)
         return true;
     return CWalletDB(strWalletFile).WriteIdentity(mapKey, identity);
@@ -579,6 +585,7 @@ bool CWallet::AddUpdateIdentity(const CIdentityMapKey &mapKey, const CIdentityMa
     // hash of the script, we store it under the name ID
     if (!CCryptoKeyStore::AddUpdateIdentity(mapKey, identity))
         return false;
+    MarkUnspentTxsStale();
     if (!fFileBacked)
         return true;
     return CWalletDB(strWalletFile).WriteIdentity(mapKey, identity);
@@ -595,6 +602,7 @@ void CWallet::ClearIdentities()
     }
 
     CCryptoKeyStore::ClearIdentities();
+    MarkUnspentTxsStale();
 }
 
 bool CWallet::RemoveIdentity(const CIdentityMapKey &mapKey, const uint256 &txid)
@@ -627,6 +635,7 @@ bool CWallet::RemoveIdentity(const CIdentityMapKey &mapKey, const uint256 &txid)
     }
     if (!CCryptoKeyStore::RemoveIdentity(mapKey, txid))
         return false;
+    MarkUnspentTxsStale();
     if (!fFileBacked)
         return true;
 
@@ -683,6 +692,7 @@ bool CWallet::AddWatchOnly(const CScript &dest)
 {
     if (!CCryptoKeyStore::AddWatchOnly(dest))
         return false;
+    MarkUnspentTxsStale();
     nTimeFirstKey = 1; // No birthday information for watch-only keys.
     NotifyWatchonlyChanged(true);
     if (!fFileBacked)
@@ -695,6 +705,7 @@ bool CWallet::RemoveWatchOnly(const CScript &dest)
     AssertLockHeld(cs_wallet);
     if (!CCryptoKeyStore::RemoveWatchOnly(dest))
         return false;
+    MarkUnspentTxsStale();
     if (!HaveWatchOnly())
         NotifyWatchonlyChanged(false);
     if (fFileBacked)
@@ -796,8 +807,16 @@ void CWallet::ChainTip(const CBlockIndex *pindex,
                        SaplingMerkleTree saplingTree, 
                        bool added)
 {
+    // called from the validation interface queue, which does not hold cs_main
+    LOCK2(cs_main, cs_wallet);
     if (added) {
-        ChainTipAdded(pindex, pblock, sproutTree, saplingTree);
+        // a running rescan adds the blocks above the ones it scanned itself, and the queue may still
+        // hold blocks a finished rescan already added
+        if (!fScanningWallet &&
+            !(pindexRescanned && pindexRescanned->GetAncestor(pindex->GetHeight()) == pindex))
+        {
+            ChainTipAdded(pindex, pblock, sproutTree, saplingTree);
+        }
         // Prevent migration transactions from being created when node is syncing after launch,
         // and also when node wakes up from suspension/hibernation and incoming blocks are old.
         if (!IsInitialBlockDownload(Params()) &&
@@ -806,8 +825,19 @@ void CWallet::ChainTip(const CBlockIndex *pindex,
             RunSaplingMigration(pindex->GetHeight());
         }
     } else {
+        if (pindex == pindexRescanned)
+        {
+            pindexRescanned = pindex->pprev;
+        }
+        else if (fScanningWallet)
+        {
+            // not yet reached by the rescan
+            return;
+        }
         DecrementNoteWitnesses(pindex);
         UpdateSaplingNullifierNoteMapForBlock(pblock);
+        // spends confirmed in the disconnected block are no longer settled
+        MarkUnspentTxsStale();
     }
 }
 
@@ -1062,6 +1092,27 @@ bool CWallet::Verify(const string& walletFile, string& warningString, string& er
         }
     }
 
+    boost::filesystem::path pathLog = CWalletLog::GetPath(walletFile);
+    if (CWalletLog::IsEnabled())
+    {
+        // the log checks its own records as it replays them, wallet.dat is only read to migrate it
+        if (boost::filesystem::exists(pathLog))
+        {
+            // salvage works on the Berkeley DB file, which the log has replaced
+            if (GetBoolArg("-salvagewallet", false))
+                errorString += strprintf(_("-salvagewallet cannot be used with -walletstore=log, start once with -walletstore=bdb to copy %s back to %s first"),
+                                         pathLog.string(), walletFile);
+            return true;
+        }
+    }
+    else if (boost::filesystem::exists(pathLog))
+    {
+        // last run used -walletstore=log, bring its records back into wallet.dat
+        if (!CDB::MigrateFromLog(walletFile))
+            errorString += strprintf(_("Error copying %s back to %s"), pathLog.string(), walletFile);
+        return true;
+    }
+
     if (GetBoolArg("-salvagewallet", false))
     {
         // Recover readable keypairs:
@@ -1081,6 +1132,8 @@ bool CWallet::Verify(const string& walletFile, string& warningString, string& er
         }
         if (r == CDBEnv::RECOVER_FAIL)
             errorString += _("wallet.dat corrupt, salvage failed");
+        else if (CWalletLog::IsEnabled() && !CDB::MigrateToLog(walletFile))
+            errorString += strprintf(_("Error copying %s to %s"), walletFile, pathLog.string());
     }
 
     return true;
@@ -1204,6 +1257,71 @@ void CWallet::AddToSaplingSpends(const uint256& nullifier, const uint256& wtxid)
     SyncMetaData<uint256>(range);
 }
 
+/**
+ * True if some output of wtx that we own or watch is not yet spent by a wallet transaction
+ * confirmed in the main chain. Only a disconnected block can bring such a spend back to
+ * unconfirmed, and GetUnspentTxs rebuilds the index when that happens.
+ */
+bool CWallet::HasUnsettledOutputs(const uint256& wtxid, const CWalletTx& wtx) const
+{
+    for (int i = 0; i < wtx.vout.size(); i++)
+    {
+        if (IsMine(wtx.vout[i]) == ISMINE_NO)
+            continue;
+
+        bool fSettled = false;
+        pair<TxSpends::const_iterator, TxSpends::const_iterator> range;
+        range = mapTxSpends.equal_range(COutPoint(wtxid, i));
+        for (TxSpends::const_iterator it = range.first; it != range.second && !fSettled; ++it)
+        {
+            std::map<uint256, CWalletTx>::const_iterator mit = mapWallet.find(it->second);
+            fSettled = mit != mapWallet.end() && mit->second.GetDepthInMainChain() > 0;
+        }
+        if (!fSettled)
+            return true;
+    }
+    return false;
+}
+
+const std::set<uint256>& CWallet::GetUnspentTxs() const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    // ChainTip may not have marked a disconnected block yet, as it runs from the validation queue
+    if (pindexUnspentTxs && !chainActive.Contains(pindexUnspentTxs))
+        fUnspentTxsStale = true;
+    pindexUnspentTxs = chainActive.Tip();
+
+    if (fUnspentTxsStale)
+    {
+        int64_t nStart = GetTimeMillis();
+        setUnspentTxs.clear();
+        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        {
+            if (HasUnsettledOutputs(it->first, it->second))
+                setUnspentTxs.insert(setUnspentTxs.end(), it->first);
+        }
+        fUnspentTxsStale = false;
+        setUnspentTxsToCheck.clear();
+        LogPrint("wallet", "%s: indexed %u of %u wallet transactions with unspent outputs in %dms\n",
+                 __func__, setUnspentTxs.size(), mapWallet.size(), GetTimeMillis() - nStart);
+    }
+    else
+    {
+        for (const uint256& wtxid : setUnspentTxsToCheck)
+        {
+            std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(wtxid);
+            if (it != mapWallet.end() && HasUnsettledOutputs(it->first, it->second))
+                setUnspentTxs.insert(wtxid);
+            else
+                setUnspentTxs.erase(wtxid);
+        }
+        setUnspentTxsToCheck.clear();
+    }
+    return setUnspentTxs;
+}
+
 void CWallet::AddToSpends(const uint256& wtxid)
 {
     assert(mapWallet.count(wtxid));
@@ -1227,7 +1345,10 @@ void CWallet::AddToSpends(const uint256& wtxid)
 void CWallet::ClearNoteWitnessCache()
 {
     LOCK(cs_wallet);
+    // every note gets witnessed again, including those of transactions dropped from setNoteTxs
+    setNoteTxs.clear();
     for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
+        AddToNoteTxs(wtxItem.first, wtxItem.second);
         for (mapSproutNoteData_t::value_type& item : wtxItem.second.mapSproutNoteData) {
             item.second.witnesses.clear();
             item.second.witnessHeight = -1;
@@ -1241,8 +1362,48 @@ void CWallet::ClearNoteWitnessCache()
     //fprintf(stderr,"Clear witness cache\n");
 }
 
+int CWallet::GetSpendDepth(const TxNullifiers& mapTxNullifiers, const uint256& nullifier) const
+{
+    int nDepth = -1;
+    pair<TxNullifiers::const_iterator, TxNullifiers::const_iterator> range;
+    range = mapTxNullifiers.equal_range(nullifier);
+
+    for (TxNullifiers::const_iterator it = range.first; it != range.second; ++it) {
+        std::map<uint256, CWalletTx>::const_iterator mit = mapWallet.find(it->second);
+        if (mit != mapWallet.end()) {
+            nDepth = std::max(nDepth, mit->second.GetDepthInMainChain());
+        }
+    }
+    return nDepth;
+}
+
 template<typename NoteDataMap>
-void CopyPreviousWitnesses(NoteDataMap& noteDataMap, int indexHeight, int64_t nWitnessCacheSize)
+bool CWallet::PruneSpentNoteWitnesses(NoteDataMap& noteDataMap, const TxNullifiers& mapTxNullifiers)
+{
+    bool fAllSpent = true;
+    for (auto& item : noteDataMap) {
+        auto* nd = &(item.second);
+        // A note spent deeper than the witness cache can only become unspent again through a
+        // reorg the cache could not undo anyway, so its witnesses will never be used.
+        if (nd->nullifier && GetSpendDepth(mapTxNullifiers, nd->nullifier.get()) > WITNESS_CACHE_SIZE) {
+            nd->witnesses.clear();
+        } else {
+            fAllSpent = false;
+        }
+    }
+    return fAllSpent;
+}
+
+template<typename NoteDataMap>
+void ResetWitnessHeights(NoteDataMap& noteDataMap)
+{
+    for (auto& item : noteDataMap) {
+        item.second.witnessHeight = -1;
+    }
+}
+
+template<typename NoteDataMap, typename NoteData>
+void CopyPreviousWitnesses(NoteDataMap& noteDataMap, int indexHeight, int64_t nWitnessCacheSize, std::vector<NoteData*>& vWitnessed)
 {
     for (auto& item : noteDataMap) {
         auto* nd = &(item.second);
@@ -1260,6 +1421,7 @@ void CopyPreviousWitnesses(NoteDataMap& noteDataMap, int indexHeight, int64_t nW
             // Copy the witness for the previous block if we have one
             if (nd->witnesses.size() > 0) {
                 nd->witnesses.push_front(nd->witnesses.front());
+                vWitnessed.push_back(nd);
             }
             if (nd->witnesses.size() > WITNESS_CACHE_SIZE) {
                 nd->witnesses.pop_back();
@@ -1268,26 +1430,28 @@ void CopyPreviousWitnesses(NoteDataMap& noteDataMap, int indexHeight, int64_t nW
     }
 }
 
-template<typename NoteDataMap>
-void AppendNoteCommitment(NoteDataMap& noteDataMap, int indexHeight, int64_t nWitnessCacheSize, const uint256& note_commitment)
+template<typename NoteData>
+void AppendNoteCommitment(const std::vector<NoteData*>& vWitnessed, int64_t nWitnessCacheSize, const uint256& note_commitment)
 {
-    for (auto& item : noteDataMap) {
-        auto* nd = &(item.second);
-        if (nd->witnessHeight < indexHeight && nd->witnesses.size() > 0) {
-            // Check the validity of the cache
-            // See comment in CopyPreviousWitnesses about validity.
-            assert(nWitnessCacheSize >= nd->witnesses.size());
-            nd->witnesses.front().append(note_commitment);
-        }
+    for (NoteData* nd : vWitnessed) {
+        // Check the validity of the cache
+        // See comment in CopyPreviousWitnesses about validity.
+        assert(nWitnessCacheSize >= nd->witnesses.size());
+        nd->witnesses.front().append(note_commitment);
     }
 }
 
+/**
+ * Returns the note data when the note gets its first witness, so the caller can append the
+ * rest of the block's note commitments to it.
+ */
 template<typename OutPoint, typename NoteData, typename Witness>
-void WitnessNoteIfMine(std::map<OutPoint, NoteData>& noteDataMap, int indexHeight, int64_t nWitnessCacheSize, const OutPoint& key, const Witness& witness)
+NoteData* WitnessNoteIfMine(std::map<OutPoint, NoteData>& noteDataMap, int indexHeight, int64_t nWitnessCacheSize, const OutPoint& key, const Witness& witness)
 {
     if (noteDataMap.count(key) && noteDataMap[key].witnessHeight < indexHeight) {
         auto* nd = &(noteDataMap[key]);
-        if (nd->witnesses.size() > 0) {
+        bool fWitnessed = nd->witnesses.size() > 0;
+        if (fWitnessed) {
             // We think this can happen because we write out the
             // witness cache state after every block increment or
             // decrement, but the block index itself is written in
@@ -1309,7 +1473,10 @@ void WitnessNoteIfMine(std::map<OutPoint, NoteData>& noteDataMap, int indexHeigh
         nd->witnessHeight = indexHeight - 1;
         // Check the validity of the cache
         assert(nWitnessCacheSize >= nd->witnesses.size());
+        // a note that already had witnesses was collected by CopyPreviousWitnesses
+        return fWitnessed ? NULL : nd;
     }
+    return NULL;
 }
 
 
@@ -1333,9 +1500,26 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
                                      SaplingMerkleTree& saplingTree)
 {
     LOCK(cs_wallet);
-    for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
-       ::CopyPreviousWitnesses(wtxItem.second.mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize);
-       ::CopyPreviousWitnesses(wtxItem.second.mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize);
+    // Collect the notes whose witnesses move with this block in one pass over the transactions
+    // with notes, so each note commitment in the block only touches those.
+    std::vector<SproutNoteData*> vSproutWitnessed;
+    std::vector<SaplingNoteData*> vSaplingWitnessed;
+    for (std::set<uint256>::iterator it = setNoteTxs.begin(); it != setNoteTxs.end(); ) {
+        CWalletTx& wtx = mapWallet[*it];
+        bool fSproutSpent = PruneSpentNoteWitnesses(wtx.mapSproutNoteData, mapTxSproutNullifiers);
+        bool fSaplingSpent = PruneSpentNoteWitnesses(wtx.mapSaplingNoteData, mapTxSaplingNullifiers);
+        if (fSproutSpent && fSaplingSpent) {
+            // Nothing is left to witness. The notes are marked as never witnessed, which every
+            // witness update accepts, in case the transaction is visited again after a restart
+            // or a rescan.
+            ::ResetWitnessHeights(wtx.mapSproutNoteData);
+            ::ResetWitnessHeights(wtx.mapSaplingNoteData);
+            setNoteTxs.erase(it++);
+            continue;
+        }
+        ::CopyPreviousWitnesses(wtx.mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize, vSproutWitnessed);
+        ::CopyPreviousWitnesses(wtx.mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize, vSaplingWitnessed);
+        ++it;
     }
 
     if (nWitnessCacheSize < WITNESS_CACHE_SIZE) {
@@ -1352,6 +1536,10 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
     for (const CTransaction& tx : pblock->vtx) {
         auto hash = tx.GetHash();
         bool txIsOurs = mapWallet.count(hash);
+        if (txIsOurs) {
+            // its notes get their heights updated below
+            AddToNoteTxs(hash, mapWallet[hash]);
+        }
         // Sprout
         for (size_t i = 0; i < tx.vJoinSplit.size(); i++) {
             const JSDescription& jsdesc = tx.vJoinSplit[i];
@@ -1360,14 +1548,15 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
                 sproutTree.append(note_commitment);
 
                 // Increment existing witnesses
-                for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
-                    ::AppendNoteCommitment(wtxItem.second.mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize, note_commitment);
-                }
+                ::AppendNoteCommitment(vSproutWitnessed, nWitnessCacheSize, note_commitment);
 
                 // If this is our note, witness it
                 if (txIsOurs) {
                     JSOutPoint jsoutpt {hash, i, j};
-                    ::WitnessNoteIfMine(mapWallet[hash].mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize, jsoutpt, sproutTree.witness());
+                    SproutNoteData* nd = ::WitnessNoteIfMine(mapWallet[hash].mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize, jsoutpt, sproutTree.witness());
+                    if (nd) {
+                        vSproutWitnessed.push_back(nd);
+                    }
                 }
             }
         }
@@ -1377,22 +1566,24 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
             saplingTree.append(note_commitment);
 
             // Increment existing witnesses
-            for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
-                ::AppendNoteCommitment(wtxItem.second.mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize, note_commitment);
-            }
+            ::AppendNoteCommitment(vSaplingWitnessed, nWitnessCacheSize, note_commitment);
 
             // If this is our note, witness it
             if (txIsOurs) {
                 SaplingOutPoint outPoint {hash, i};
-                ::WitnessNoteIfMine(mapWallet[hash].mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize, outPoint, saplingTree.witness());
+                SaplingNoteData* nd = ::WitnessNoteIfMine(mapWallet[hash].mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize, outPoint, saplingTree.witness());
+                if (nd) {
+                    vSaplingWitnessed.push_back(nd);
+                }
             }
         }
     }
 
     // Update witness heights
-    for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
-        ::UpdateWitnessHeights(wtxItem.second.mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize);
-        ::UpdateWitnessHeights(wtxItem.second.mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize);
+    for (const uint256& hash : setNoteTxs) {
+        CWalletTx& wtx = mapWallet[hash];
+        ::UpdateWitnessHeights(wtx.mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize);
+        ::UpdateWitnessHeights(wtx.mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize);
     }
 
     // For performance reasons, we write out the witness cache in
@@ -1451,10 +1642,11 @@ bool DecrementNoteWitnesses(NoteDataMap& noteDataMap, int indexHeight, int64_t n
 void CWallet::DecrementNoteWitnesses(const CBlockIndex* pindex)
 {
     LOCK(cs_wallet);
-    for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
-        if (!::DecrementNoteWitnesses(wtxItem.second.mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize))
+    for (const uint256& hash : setNoteTxs) {
+        CWalletTx& wtx = mapWallet[hash];
+        if (!::DecrementNoteWitnesses(wtx.mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize))
             needsRescan = true;
-        if (!::DecrementNoteWitnesses(wtxItem.second.mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize))
+        if (!::DecrementNoteWitnesses(wtx.mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize))
             needsRescan = true;
     }
     if (nWitnessCacheSize != 0)
@@ -1809,38 +2001,10 @@ bool CWallet::VerusSelectStakeOutput(CBlock *pBlock, arith_uint256 &hashResult,
                 txProofVec.push_back(CTransactionComponentProof(txView, txMap, stakeSource, CTransactionHeader::TX_OUTPUT, pwinner->i));
 
                 // now, both the header and stake output are dependent on the transaction MMR root being provable up
-                // through the block MMR, and since we don't cache the new MMR proof for transactions yet, we need the block to create the proof.
-                // when we switch to the new MMR in place of a merkle tree, we can keep that in the wallet as well
-                CBlock block;
-                if (!ReadBlockFromDisk(block, chainActive[srcIndex], Params().GetConsensus(), false))
-                {
-                    LogPrintf("%s: ERROR: could not read block number  %u from disk\n", __func__, srcIndex);
-                    return false;
-                }
-
-                BlockMMRange blockMMR(block.GetBlockMMRTree());
-                BlockMMView blockView(blockMMR);
-
-                int txIndexPos;
-                for (txIndexPos = 0; txIndexPos < blockMMR.size(); txIndexPos++)
-                {
-                    uint256 txRootHashFromMMR = blockMMR[txIndexPos].hash;
-                    if (txRootHashFromMMR == txRoot)
-                    {
-                        //printf("tx with root %s found in block\n", txRootHashFromMMR.GetHex().c_str());
-                        break;
-                    }
-                }
-
-                if (txIndexPos == blockMMR.size())
-                {
-                    LogPrintf("%s: ERROR: could not find source transaction root in block %u\n", __func__, srcIndex);
-                    return false;
-                }
-
-                // prove the tx up to the MMR root, which also contains the block hash
+                // through the block MMR, which comes from the block MMR cache and only needs the block on a miss
                 CMMRProof txRootProof;
-                if (!blockView.GetProof(txRootProof, txIndexPos))
+                int txIndexPos;
+                if (!GetBlockTxRootProof(chainActive[srcIndex], txRoot, txRootProof, txIndexPos))
                 {
                     LogPrintf("%s: ERROR: could not create proof of source transaction in block %u\n", __func__, srcIndex);
                     return false;
@@ -2047,6 +2211,7 @@ void CWallet::MarkDirty()
         LOCK(cs_wallet);
         BOOST_FOREACH(PAIRTYPE(const uint256, CWalletTx)& item, mapWallet)
             item.second.MarkDirty();
+        MarkUnspentTxsStale();
     }
 }
 
@@ -2179,7 +2344,9 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
         mapWallet[hash] = wtxIn;
         mapWallet[hash].BindWallet(this);
         UpdateNullifierNoteMapWithTx(mapWallet[hash]);
+        AddToNoteTxs(hash, mapWallet[hash]);
         AddToSpends(hash);
+        MarkUnspentTxsStale();
     }
     else
     {
@@ -2268,6 +2435,8 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
             }
         }
 
+        AddToNoteTxs(hash, wtx);
+
         //// debug log out
         if (fDebug)
         {
@@ -2282,6 +2451,14 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet, CWalletD
         // Break debit/credit balance caches:
         wtx.MarkDirty();
 
+        // Recheck its outputs and the outputs it spends in the unspent index
+        CheckUnspentTx(hash);
+        if (!wtx.IsCoinBase())
+        {
+            for (const CTxIn& txin : wtx.vin)
+                CheckUnspentTx(txin.prevout.hash);
+        }
+
         // Notify UI of new or updated transaction
         NotifyTransactionChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
 
@@ -2398,6 +2575,10 @@ bool CWallet::MarkIdentityDirty(const CIdentityID &idID)
             txidAndWtx.second.MarkDirty();
         }
     }
+    if (found)
+    {
+        MarkUnspentTxsStale();
+    }
     return found;
 }
 
@@ -2413,7 +2594,8 @@ bool CWallet::MarkIdentityDirty(const CIdentityID &idID)
  * updated; instead, the transaction being in the mempool or conflicted is determined on
  * the fly in CMerkleTx::GetDepthInMainChain().
  */
-bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate, bool isRescan)
+bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate, bool isRescan,
+                                       const std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> *pSaplingNotes)
 {
     {
         AssertLockHeld(cs_wallet);
@@ -2423,10 +2605,14 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pbl
         bool fExisted = mapWallet.count(txHash) != 0;
         if (fExisted && !fUpdate) return false;
         auto sproutNoteData = FindMySproutNotes(tx);
-        auto saplingNoteDataAndAddressesToAdd = FindMySaplingNotes(tx);
+        auto saplingNoteDataAndAddressesToAdd = pSaplingNotes ? *pSaplingNotes : FindMySaplingNotes(tx);
         auto saplingNoteData = saplingNoteDataAndAddressesToAdd.first;
         auto addressesToAdd = saplingNoteDataAndAddressesToAdd.second;
         for (const auto &addressToAdd : addressesToAdd) {
+            // results computed ahead of time may hold addresses added by an earlier transaction
+            if (pSaplingNotes && HaveSaplingIncomingViewingKey(addressToAdd.first)) {
+                continue;
+            }
             if (!AddSaplingIncomingViewingKey(addressToAdd.second, addressToAdd.first)) {
                 return false;
             }
@@ -3130,7 +3316,8 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pbl
 
 void CWallet::SyncTransaction(const CTransaction& tx, const CBlock* pblock)
 {
-    LOCK(cs_wallet);
+    // called from the validation interface queue, which does not hold cs_main
+    LOCK2(cs_main, cs_wallet);
     if (!AddToWalletIfInvolvingMe(tx, pblock, true, false))
         return; // Not one of ours
 
@@ -3172,7 +3359,11 @@ void CWallet::EraseFromWallet(const uint256 &hash)
     {
         LOCK(cs_wallet);
         if (mapWallet.erase(hash))
+        {
+            setNoteTxs.erase(hash);
             CWalletDB(strWalletFile).EraseTx(hash);
+            MarkUnspentTxsStale();
+        }
     }
     return;
 }
@@ -3181,9 +3372,15 @@ void CWallet::RescanWallet()
 {
     if (needsRescan)
     {
+        CWalletRescanReserver reserver(this);
+        if (!reserver.Reserve())
+        {
+            LogPrintf("%s: another rescan is running, not rescanning for the loaded keys\n", __func__);
+            return;
+        }
         CBlockIndex *start = chainActive.Height() > 0 ? chainActive[1] : NULL;
         if (start)
-            ScanForWalletTransactions(start, true);
+            ScanForWalletTransactions(start, reserver, true);
         needsRescan = false;
     }
 }
@@ -3271,6 +3468,50 @@ mapSproutNoteData_t CWallet::FindMySproutNotes(const CTransaction &tx) const
 }
 
 
+/**
+ * Trial decrypts the Sapling outputs of tx with each of vIvks. Unlike FindMySaplingNotes this
+ * does not take cs_SpendingKeyStore, and returns every address found whether or not the wallet
+ * already knows it.
+ */
+static std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> TrialDecryptSaplingOutputs(
+    const CTransaction &tx, const std::vector<SaplingIncomingViewingKey> &vIvks)
+{
+    mapSaplingNoteData_t noteData;
+    SaplingIncomingViewingKeyMap viewingKeysToAdd;
+
+    if (tx.vShieldedOutput.empty()) {
+        return std::make_pair(noteData, viewingKeysToAdd);
+    }
+    uint256 hash = tx.GetHash();
+
+    std::vector<const OutputDescription*> vOutputs;
+    vOutputs.reserve(tx.vShieldedOutput.size());
+    for (const OutputDescription &output : tx.vShieldedOutput) {
+        vOutputs.push_back(&output);
+    }
+
+    // Protocol Spec: 4.19 Block Chain Scanning (Sapling)
+    auto vResults = TrialDecryptSaplingOutputBatch(vOutputs, vIvks);
+    for (uint32_t i = 0; i < vResults.size(); ++i) {
+        if (!vResults[i]) {
+            continue;
+        }
+        const SaplingIncomingViewingKey &ivk = vIvks[vResults[i].get().nIvk];
+        auto address = ivk.address(vResults[i].get().d);
+        if (address) {
+            viewingKeysToAdd[address.get()] = ivk;
+        }
+        // We don't cache the nullifier here as computing it requires knowledge of the note position
+        // in the commitment tree, which can only be determined when the transaction has been mined.
+        SaplingOutPoint op {hash, i};
+        SaplingNoteData nd;
+        nd.ivk = ivk;
+        noteData.insert(std::make_pair(op, nd));
+    }
+
+    return std::make_pair(noteData, viewingKeysToAdd);
+}
+
 /**
  * Finds all output notes in the given transaction that have been sent to
  * SaplingPaymentAddresses in this wallet.
@@ -3281,36 +3522,27 @@ mapSproutNoteData_t CWallet::FindMySproutNotes(const CTransaction &tx) const
  */
 std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> CWallet::FindMySaplingNotes(const CTransaction &tx) const
 {
+    if (tx.vShieldedOutput.empty()) {
+        return std::make_pair(mapSaplingNoteData_t(), SaplingIncomingViewingKeyMap());
+    }
+
     LOCK(cs_SpendingKeyStore);
-    uint256 hash = tx.GetHash();
 
-    mapSaplingNoteData_t noteData;
-    SaplingIncomingViewingKeyMap viewingKeysToAdd;
+    std::vector<SaplingIncomingViewingKey> vIvks;
+    vIvks.reserve(mapSaplingFullViewingKeys.size());
+    for (auto it = mapSaplingFullViewingKeys.begin(); it != mapSaplingFullViewingKeys.end(); ++it) {
+        vIvks.push_back(it->first);
+    }
 
-    // Protocol Spec: 4.19 Block Chain Scanning (Sapling)
-    for (uint32_t i = 0; i < tx.vShieldedOutput.size(); ++i) {
-        const OutputDescription output = tx.vShieldedOutput[i];
-        for (auto it = mapSaplingFullViewingKeys.begin(); it != mapSaplingFullViewingKeys.end(); ++it) {
-            SaplingIncomingViewingKey ivk = it->first;
-            auto result = SaplingNotePlaintext::decrypt(output.encCiphertext, ivk, output.ephemeralKey, output.cm);
-            if (!result) {
-                continue;
-            }
-            auto address = ivk.address(result.get().d);
-            if (address && mapSaplingIncomingViewingKeys.count(address.get()) == 0) {
-                viewingKeysToAdd[address.get()] = ivk;
-            }
-            // We don't cache the nullifier here as computing it requires knowledge of the note position
-            // in the commitment tree, which can only be determined when the transaction has been mined.
-            SaplingOutPoint op {hash, i};
-            SaplingNoteData nd;
-            nd.ivk = ivk;
-            noteData.insert(std::make_pair(op, nd));
-            break;
+    auto result = TrialDecryptSaplingOutputs(tx, vIvks);
+    for (auto it = result.second.begin(); it != result.second.end(); ) {
+        if (mapSaplingIncomingViewingKeys.count(it->first)) {
+            result.second.erase(it++);
+        } else {
+            ++it;
         }
     }
-
-    return std::make_pair(noteData, viewingKeysToAdd);
+    return result;
 }
 
 bool CWallet::IsSproutNullifierFromMe(const uint256& nullifier) const
@@ -4277,47 +4509,236 @@ void CWallet::WitnessNoteCommitment(std::vector<uint256> commitments,
     }
 }
 
+namespace {
+
+/**
+ * Reads blocks and trial decrypts their Sapling outputs on a pool of threads, ahead of
+ * ScanForWalletTransactions, which takes the results in chain order and adds them to the wallet.
+ * Workers stay at most a window of blocks ahead of the wallet to bound memory use.
+ */
+class CWalletRescanPipeline
+{
+public:
+    struct CScannedBlock
+    {
+        CBlock block;
+        std::vector<std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> > vSaplingNotes;
+    };
+
+private:
+    const std::vector<CBlockIndex*> &vBlocks;
+    const std::vector<SaplingIncomingViewingKey> &vIvks;
+    size_t nWindow;
+
+    boost::mutex cs;
+    boost::condition_variable cond;
+    std::map<size_t, std::shared_ptr<CScannedBlock> > mapScanned;
+    size_t nNextRead;
+    size_t nNextCommit;
+    bool fStop;
+    boost::thread_group threadGroup;
+
+    void ThreadScan()
+    {
+        const Consensus::Params &consensusParams = Params().GetConsensus();
+        while (true)
+        {
+            size_t n;
+            {
+                boost::unique_lock<boost::mutex> lock(cs);
+                while (!fStop && nNextRead < vBlocks.size() && nNextRead >= nNextCommit + nWindow)
+                    cond.wait(lock);
+                if (fStop || nNextRead >= vBlocks.size())
+                    return;
+                n = nNextRead++;
+            }
+
+            std::shared_ptr<CScannedBlock> pscanned(new CScannedBlock());
+            ReadBlockFromDisk(pscanned->block, vBlocks[n], consensusParams);
+            pscanned->vSaplingNotes.reserve(pscanned->block.vtx.size());
+            for (const CTransaction &tx : pscanned->block.vtx)
+                pscanned->vSaplingNotes.push_back(TrialDecryptSaplingOutputs(tx, vIvks));
+
+            {
+                boost::unique_lock<boost::mutex> lock(cs);
+                mapScanned[n] = pscanned;
+            }
+            cond.notify_all();
+        }
+    }
+
+public:
+    CWalletRescanPipeline(const std::vector<CBlockIndex*> &vBlocksIn, const std::vector<SaplingIncomingViewingKey> &vIvksIn, int nThreads) :
+        vBlocks(vBlocksIn), vIvks(vIvksIn), nWindow(nThreads * 4), nNextRead(0), nNextCommit(0), fStop(false)
+    {
+        for (int i = 0; i < nThreads; i++)
+            threadGroup.create_thread(boost::bind(&CWalletRescanPipeline::ThreadScan, this));
+    }
+
+    ~CWalletRescanPipeline()
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            fStop = true;
+        }
+        cond.notify_all();
+        threadGroup.join_all();
+    }
+
+    //! Wait for the next block in chain order, returns NULL once all blocks were taken
+    std::shared_ptr<CScannedBlock> Next()
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        if (nNextCommit >= vBlocks.size())
+            return std::shared_ptr<CScannedBlock>();
+        std::map<size_t, std::shared_ptr<CScannedBlock> >::iterator it;
+        while ((it = mapScanned.find(nNextCommit)) == mapScanned.end())
+            cond.wait(lock);
+        std::shared_ptr<CScannedBlock> pscanned = it->second;
+        mapScanned.erase(it);
+        nNextCommit++;
+        lock.unlock();
+        cond.notify_all();
+        return pscanned;
+    }
+};
+
+/** Clears the wallet's scanning flag if the rescan leaves early */
+class CWalletScanningGuard
+{
+    std::atomic<bool> &fScanning;
+public:
+    CWalletScanningGuard(std::atomic<bool> &fScanningIn) : fScanning(fScanningIn) {}
+    ~CWalletScanningGuard() { fScanning = false; }
+};
+
+}
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
  * exist in the wallet will be updated.
  */
-int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
+int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, const CWalletRescanReserver& reserver, bool fUpdate)
 {
+    assert(reserver.IsReserved());
+
     int ret = 0;
     int64_t nNow = GetTime();
+    int64_t nStart = GetTimeMillis();
     const CChainParams& chainParams = Params();
 
-    CBlockIndex* pindex = pindexStart;
-
-    if (pindexStart->GetHeight() <= 1)
-    {
-        pwalletMain->ClearIdentities();
-    }
-
     std::vector<uint256> myTxHashes;
+    std::vector<SaplingIncomingViewingKey> vIvks;
+    double dProgressStart, dProgressTip;
+
+    int nThreads = GetArg("-rescanthreads", DEFAULT_RESCAN_THREADS);
+    if (nThreads <= 0)
+        nThreads += GetNumCores();
+    nThreads = std::max(1, std::min(nThreads, MAX_RESCAN_THREADS));
 
     {
         LOCK2(cs_main, cs_wallet);
 
+        CBlockIndex* pindex = pindexStart ? pindexStart : chainActive.Genesis();
+        if (pindex && pindex->GetHeight() <= 1)
+        {
+            ClearIdentities();
+        }
+
         // no need to read and scan block, if block was created before
         // our wallet birthday (as adjusted for block time variability)
         while (pindex && nTimeFirstKey && (pindex->GetBlockTime() < (nTimeFirstKey - 7200)))
             pindex = chainActive.Next(pindex);
 
-        ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
-        double dProgressStart = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false);
-        double dProgressTip = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), chainActive.LastTip(), false);
-        while (pindex)
+        // from here ChainTip leaves the blocks above pindexRescanned to the rescan
+        pindexRescanned = pindex ? pindex->pprev : chainActive.Tip();
+        fAbortRescan = false;
+        fScanningWallet = true;
+
         {
+            LOCK(cs_SpendingKeyStore);
+            for (auto it = mapSaplingFullViewingKeys.begin(); it != mapSaplingFullViewingKeys.end(); ++it)
+                vIvks.push_back(it->first);
+        }
+
+        LogPrintf("Rescanning %d blocks from height %d using %d threads\n",
+                  pindex ? chainActive.Height() - pindex->GetHeight() + 1 : 0, pindex ? pindex->GetHeight() : -1, nThreads);
+        dProgressStart = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false);
+        dProgressTip = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), chainActive.LastTip(), false);
+    }
+    CWalletScanningGuard scanning(fScanningWallet);
+
+    ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
+    bool fSynced = false;
+    while (true)
+    {
+        // cs_main is only held to look up the next batch and to add each block to the wallet, so
+        // validation can go on while the pipeline reads and decrypts blocks
+        std::vector<CBlockIndex*> vBlocks;
+        {
+            LOCK2(cs_main, cs_wallet);
+            if (fAbortRescan || ShutdownRequested())
+            {
+                LogPrintf("Rescan aborted at block %d\n", pindexRescanned ? pindexRescanned->GetHeight() + 1 : 0);
+                fScanningWallet = false;
+                break;
+            }
+            if (pindexRescanned && !chainActive.Contains(pindexRescanned))
+            {
+                if (fSynced)
+                {
+                    LogPrintf("Rescan stopped, block %s at height %d is no longer in the active chain\n",
+                              pindexRescanned->GetBlockHash().GetHex(), pindexRescanned->GetHeight());
+                    fScanningWallet = false;
+                    break;
+                }
+            }
+            else
+            {
+                for (CBlockIndex *pindexScan = pindexRescanned ? chainActive.Next(pindexRescanned) : chainActive.Genesis();
+                     pindexScan && vBlocks.size() < RESCAN_BATCH_BLOCKS;
+                     pindexScan = chainActive.Next(pindexScan))
+                {
+                    vBlocks.push_back(pindexScan);
+                }
+                if (vBlocks.empty())
+                {
+                    // caught up with the tip, ChainTip takes over with the next block
+                    fScanningWallet = false;
+                    break;
+                }
+            }
+        }
+
+        if (vBlocks.empty())
+        {
+            // the chain was reorganized below the scanned blocks, let ChainTip roll them back first
+            SyncWithValidationInterfaceQueue();
+            fSynced = true;
+            continue;
+        }
+        fSynced = false;
+
+        CWalletRescanPipeline pipeline(vBlocks, vIvks, nThreads);
+        std::shared_ptr<CWalletRescanPipeline::CScannedBlock> pscanned;
+        for (size_t n = 0; n < vBlocks.size() && (pscanned = pipeline.Next()); n++)
+        {
+            CBlockIndex *pindex = vBlocks[n];
+            LOCK2(cs_main, cs_wallet);
+
+            // the chain may have been reorganized since the batch was looked up
+            if (fAbortRescan || ShutdownRequested() || pindex->pprev != pindexRescanned || !chainActive.Contains(pindex))
+                break;
+
             if (pindex->GetHeight() % 100 == 0 && dProgressTip - dProgressStart > 0.0)
                 ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
 
-            CBlock block;
-            ReadBlockFromDisk(block, pindex, Params().GetConsensus());
-            BOOST_FOREACH(CTransaction& tx, block.vtx)
+            CBlock &block = pscanned->block;
+            for (size_t i = 0; i < block.vtx.size(); i++)
             {
-                if (AddToWalletIfInvolvingMe(tx, &block, fUpdate, true)) {
+                const CTransaction &tx = block.vtx[i];
+                if (AddToWalletIfInvolvingMe(tx, &block, fUpdate, true, &pscanned->vSaplingNotes[i])) {
                     myTxHashes.push_back(tx.GetHash());
                     ret++;
                 }
@@ -4335,13 +4756,17 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
             }
             // Increment note witness caches
             ChainTipAdded(pindex, &block, sproutTree, saplingTree);
+            pindexRescanned = pindex;
 
-            pindex = chainActive.Next(pindex);
             if (GetTime() >= nNow + 60) {
                 nNow = GetTime();
-                LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex ? pindex->GetHeight() : -1, Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex));
+                LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->GetHeight(), Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex));
             }
         }
+    }
+
+    {
+        LOCK(cs_wallet);
 
         // After rescanning, persist Sapling note data that might have changed, e.g. nullifiers.
         // Do not flush the wallet here for performance reasons.
@@ -4354,9 +4779,10 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
                 }
             }
         }
-
-        ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
     }
+
+    LogPrintf("Rescan done, found %d transactions in %dms\n", ret, GetTimeMillis() - nStart);
+    ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
     return ret;
 }
 
@@ -4878,9 +5304,9 @@ CAmount CWallet::GetBalance(bool includeIDLocked) const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const uint256& wtxid : GetUnspentTxs())
         {
-            const CWalletTx* pcoin = &(*it).second;
+            const CWalletTx* pcoin = &mapWallet.at(wtxid);
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAvailableCredit(includeIDLocked, includeIDLocked);
         }
@@ -4894,9 +5320,9 @@ CCurrencyValueMap CWallet::GetReserveBalance(bool includeIDLocked) const
     CCurrencyValueMap retVal;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const uint256& wtxid : GetUnspentTxs())
         {
-            const CWalletTx* pcoin = &(*it).second;
+            const CWalletTx* pcoin = &mapWallet.at(wtxid);
             if (pcoin->IsTrusted())
                 retVal += pcoin->GetAvailableReserveCredit(includeIDLocked, includeIDLocked);
         }
@@ -4910,9 +5336,9 @@ CAmount CWallet::GetUnconfirmedBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const uint256& wtxid : GetUnspentTxs())
         {
-            const CWalletTx* pcoin = &(*it).second;
+            const CWalletTx* pcoin = &mapWallet.at(wtxid);
             if (!CheckFinalTx(*pcoin) || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
                 nTotal += pcoin->GetAvailableCredit();
         }
@@ -4925,9 +5351,9 @@ CCurrencyValueMap CWallet::GetUnconfirmedReserveBalance() const
     CCurrencyValueMap retVal;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const uint256& wtxid : GetUnspentTxs())
         {
-            const CWalletTx* pcoin = &(*it).second;
+            const CWalletTx* pcoin = &mapWallet.at(wtxid);
             if (!CheckFinalTx(*pcoin) || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
                 retVal += pcoin->GetAvailableReserveCredit();
         }
@@ -4940,9 +5366,9 @@ CAmount CWallet::GetImmatureBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const uint256& wtxid : GetUnspentTxs())
         {
-            const CWalletTx* pcoin = &(*it).second;
+            const CWalletTx* pcoin = &mapWallet.at(wtxid);
             nTotal += pcoin->GetImmatureCredit();
         }
     }
@@ -4954,9 +5380,9 @@ CCurrencyValueMap CWallet::GetImmatureReserveBalance() const
     CCurrencyValueMap retVal;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const uint256& wtxid : GetUnspentTxs())
         {
-            const CWalletTx* pcoin = &(*it).second;
+            const CWalletTx* pcoin = &mapWallet.at(wtxid);
             retVal += pcoin->GetImmatureReserveCredit();
         }
     }
@@ -4968,9 +5394,9 @@ CAmount CWallet::GetWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const uint256& wtxid : GetUnspentTxs())
         {
-            const CWalletTx* pcoin = &(*it).second;
+            const CWalletTx* pcoin = &mapWallet.at(wtxid);
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAvailableWatchOnlyCredit();
         }
@@ -4984,9 +5410,9 @@ CCurrencyValueMap CWallet::GetWatchOnlyReserveBalance() const
     CCurrencyValueMap retVal;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const uint256& wtxid : GetUnspentTxs())
         {
-            const CWalletTx* pcoin = &(*it).second;
+            const CWalletTx* pcoin = &mapWallet.at(wtxid);
             if (pcoin->IsTrusted())
                 retVal += pcoin->GetAvailableWatchOnlyReserveCredit();
         }
@@ -5000,9 +5426,9 @@ CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const uint256& wtxid : GetUnspentTxs())
         {
-            const CWalletTx* pcoin = &(*it).second;
+            const CWalletTx* pcoin = &mapWallet.at(wtxid);
             if (!CheckFinalTx(*pcoin) || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
                 nTotal += pcoin->GetAvailableWatchOnlyCredit();
         }
@@ -5015,9 +5441,9 @@ CCurrencyValueMap CWallet::GetUnconfirmedWatchOnlyReserveBalance() const
     CCurrencyValueMap retVal;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const uint256& wtxid : GetUnspentTxs())
         {
-            const CWalletTx* pcoin = &(*it).second;
+            const CWalletTx* pcoin = &mapWallet.at(wtxid);
             if (!CheckFinalTx(*pcoin) || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
                 retVal += pcoin->GetAvailableWatchOnlyReserveCredit();
         }
@@ -5030,9 +5456,9 @@ CAmount CWallet::GetImmatureWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const uint256& wtxid : GetUnspentTxs())
         {
-            const CWalletTx* pcoin = &(*it).second;
+            const CWalletTx* pcoin = &mapWallet.at(wtxid);
             nTotal += pcoin->GetImmatureWatchOnlyCredit();
         }
     }
@@ -5044,9 +5470,9 @@ CCurrencyValueMap CWallet::GetImmatureWatchOnlyReserveBalance() const
     CCurrencyValueMap retVal;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const uint256& wtxid : GetUnspentTxs())
         {
-            const CWalletTx* pcoin = &(*it).second;
+            const CWalletTx* pcoin = &mapWallet.at(wtxid);
             retVal += pcoin->GetImmatureWatchOnlyReserveCredit();
         }
     }
@@ -5067,10 +5493,9 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
     {
         LOCK2(cs_main, cs_wallet);
         uint32_t nHeight = chainActive.Height() + 1;
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const uint256& wtxid : GetUnspentTxs())
         {
-            const uint256& wtxid = it->first;
-            const CWalletTx* pcoin = &(*it).second;
+            const CWalletTx* pcoin = &mapWallet.at(wtxid);
 
             if (!CheckFinalTx(*pcoin))
                 continue;
@@ -5102,8 +5527,8 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
             {
                 isminetype mine = IsMine(pcoin->vout[i]);
                 if (!(IsSpent(wtxid, i)) && mine != ISMINE_NO &&
-                    !IsLockedCoin((*it).first, i) && (pcoin->vout[i].nValue > 0 || fIncludeZeroValue) &&
-                    (!coinControl || !coinControl->HasSelected() || coinControl->IsSelected((*it).first, i)))
+                    !IsLockedCoin(wtxid, i) && (pcoin->vout[i].nValue > 0 || fIncludeZeroValue) &&
+                    (!coinControl || !coinControl->HasSelected() || coinControl->IsSelected(wtxid, i)))
                 {
                     if (!fIncludeIDLockedCoins)
                     {
@@ -5183,10 +5608,9 @@ void CWallet::AvailableReserveCoins(vector<COutput>& vCoins, bool fOnlyConfirmed
     {
         LOCK2(cs_main, cs_wallet);
         uint32_t nHeight = chainActive.Height() + 1;
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const uint256& wtxid : GetUnspentTxs())
         {
-            const uint256& wtxid = it->first;
-            const CWalletTx* pcoin = &(*it).second;
+            const CWalletTx* pcoin = &mapWallet.at(wtxid);
 
             if (!CheckFinalTx(*pcoin))
                 continue;
@@ -5209,8 +5633,8 @@ void CWallet::AvailableReserveCoins(vector<COutput>& vCoins, bool fOnlyConfirmed
                 isminetype mine = IsMine(pcoin->vout[i]);
                 if (!(IsSpent(wtxid, i)) &&
                     mine != ISMINE_NO &&
-                    !IsLockedCoin((*it).first, i) &&
-                    (!coinControl || !coinControl->HasSelected() || coinControl->IsSelected((*it).first, i)))
+                    !IsLockedCoin(wtxid, i) &&
+                    (!coinControl || !coinControl->HasSelected() || coinControl->IsSelected(wtxid, i)))
                 {
                     COptCCParams p;
                     CCurrencyValueMap rOut = pcoin->vout[i].scriptPubKey.ReserveOutValue(p, true);
@@ -5379,7 +5803,11 @@ bool CloserToTarget(const CCurrencyValueMap &target, const CCurrencyValueMap &cu
     return false;
 }
 
-static void ApproximateBestReserveSubset(vector<pair<CCurrencyValueMap, pair<const CWalletTx*,unsigned int>>> vValue, 
+//! Outputs the randomized reserve subset search visits over all of its iterations, so that on large
+//! wallets it runs fewer iterations rather than taking time in proportion to the wallet size
+static const size_t RESERVE_SUBSET_MAX_VISITS = 1000000;
+
+static void ApproximateBestReserveSubset(const vector<pair<CCurrencyValueMap, pair<const CWalletTx*,unsigned int>>> &vValue, 
                                          const CCurrencyValueMap &totalToOptimize, 
                                          const CCurrencyValueMap &targetValues,
                                          vector<char>& vfBest, 
@@ -5391,6 +5819,9 @@ static void ApproximateBestReserveSubset(vector<pair<CCurrencyValueMap, pair<con
     vfBest.assign(vValue.size(), true);
     bestTotals = totalToOptimize;
 
+    // each iteration makes up to two passes over all outputs
+    iterations = std::max(1, (int)std::min((size_t)iterations, RESERVE_SUBSET_MAX_VISITS / (2 * std::max(vValue.size(), (size_t)1))));
+
     seed_insecure_rand();
 
     for (int nRep = 0; nRep < iterations && bestTotals != targetValues; nRep++)
@@ -5697,6 +6128,101 @@ bool CWallet::SelectCoins(const CAmount& nTargetValue, set<pair<const CWalletTx*
     return retval;
 }
 
+/**
+ * Looks for inputs that match the target exactly in every reserve currency and come within dust of
+ * it in the native currency, so the transaction needs no change output. Outputs carrying any
+ * currency outside of the target would always need change and are left out.
+ */
+static bool SelectReserveCoinsWithoutChange(const CCurrencyValueMap& totalTarget,
+                                            int nConfMine,
+                                            int nConfTheirs,
+                                            const std::vector<COutput>& vCoins,
+                                            std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet,
+                                            CCurrencyValueMap& valueRet,
+                                            CAmount& nativeValueRet)
+{
+    std::map<uint160, size_t> currencyColumns;
+    std::vector<CAmount> vTarget, vWindow;
+    for (auto &oneCur : totalTarget.valueMap)
+    {
+        if (oneCur.second <= 0)
+        {
+            return false;
+        }
+        currencyColumns[oneCur.first] = vTarget.size();
+        vTarget.push_back(oneCur.second);
+        vWindow.push_back(oneCur.first == ASSETCHAINS_CHAINID ?
+                          CTxOut(0, GetScriptForDestination(CKeyID())).GetDustThreshold(::minRelayTxFee) - 1 :
+                          0);
+    }
+    if (!vTarget.size())
+    {
+        return false;
+    }
+
+    std::vector<CAmount> vAmounts;
+    std::vector<const COutput *> vCandidates;
+    std::vector<CAmount> vRow(vTarget.size());
+    for (const COutput &output : vCoins)
+    {
+        if (!output.fSpendable ||
+            output.nDepth < (output.tx->IsFromMe(ISMINE_ALL) ? nConfMine : nConfTheirs))
+        {
+            continue;
+        }
+
+        const CTxOut &txOut = output.tx->vout[output.i];
+        CCurrencyValueMap nAll(txOut.scriptPubKey.ReserveOutValue());
+        if (txOut.nValue)
+        {
+            nAll.valueMap[ASSETCHAINS_CHAINID] = txOut.nValue;
+        }
+
+        bool fOnlyTarget = nAll.valueMap.size() > 0;
+        std::fill(vRow.begin(), vRow.end(), 0);
+        for (auto &oneCur : nAll.valueMap)
+        {
+            auto colIt = currencyColumns.find(oneCur.first);
+            if (colIt == currencyColumns.end())
+            {
+                fOnlyTarget = false;
+                break;
+            }
+            vRow[colIt->second] = oneCur.second;
+        }
+        if (fOnlyTarget)
+        {
+            vAmounts.insert(vAmounts.end(), vRow.begin(), vRow.end());
+            vCandidates.push_back(&output);
+        }
+    }
+
+    std::vector<char> vfSelected;
+    if (!SelectCoinsBnB(vAmounts, vTarget, vWindow, vfSelected))
+    {
+        return false;
+    }
+
+    size_t numInputsLimit = (size_t)GetArg("-mempooltxinputlimit", MAX_NUM_INPUTS_LIMIT);
+    if ((size_t)std::count(vfSelected.begin(), vfSelected.end(), true) > numInputsLimit)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < vCandidates.size(); i++)
+    {
+        if (vfSelected[i])
+        {
+            const CTxOut &txOut = vCandidates[i]->tx->vout[vCandidates[i]->i];
+            setCoinsRet.insert(std::make_pair(vCandidates[i]->tx, (unsigned int)vCandidates[i]->i));
+            valueRet += txOut.ReserveOutValue();
+            nativeValueRet += txOut.nValue;
+        }
+    }
+    LogPrint("selectcoins", "%s: selected %lu of %lu candidates without change\n", __func__, setCoinsRet.size(), vCandidates.size());
+    return true;
+}
+
 bool CWallet::SelectReserveCoinsMinConf(const CCurrencyValueMap& targetValues, 
                                         CAmount targetNativeValue, 
                                         int nConfMine, 
@@ -5727,10 +6253,18 @@ bool CWallet::SelectReserveCoinsMinConf(const CCurrencyValueMap& targetValues,
     CCurrencyValueMap totalToOptimize;
     std::vector<std::pair<CCurrencyValueMap, std::pair<const CWalletTx*, unsigned int>>> vOutputsToOptimize;
 
-    random_shuffle(vCoins.begin(), vCoins.end(), GetRandInt);
-
     CCurrencyValueMap nTotalTarget = (targetValues + CCurrencyValueMap(std::vector<uint160>({ASSETCHAINS_CHAINID}), std::vector<CAmount>({targetNativeValue}))).CanonicalMap();
 
+    if (SelectReserveCoinsWithoutChange(nTotalTarget, nConfMine, nConfTheirs, vCoins, setCoinsRet, valueRet, nativeValueRet))
+    {
+        return true;
+    }
+    setCoinsRet.clear();
+    valueRet.valueMap.clear();
+    nativeValueRet = 0;
+
+    random_shuffle(vCoins.begin(), vCoins.end(), GetRandInt);
+
     // printf("totaltarget: %s\n", nTotalTarget.ToUniValue().write().c_str());
 
     // currencies in the target that are satisfied x4 in the lower list
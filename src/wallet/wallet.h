@@ -28,6 +28,7 @@
 #include "base58.h"
 
 #include <algorithm>
+#include <atomic>
 #include <map>
 #include <set>
 #include <stdexcept>
@@ -58,6 +59,12 @@ static const CAmount DEFAULT_TRANSACTION_MAXFEE = 0.1 * COIN;
 static const unsigned int DEFAULT_TX_CONFIRM_TARGET = 2;
 //! -maxtxfee will warn if called with a higher fee than this amount (in satoshis)
 static const CAmount nHighTransactionMaxFeeWarning = 100 * nHighTransactionFeeWarning;
+//! -rescanthreads default, 0 uses one thread per core
+static const int DEFAULT_RESCAN_THREADS = 0;
+//! Maximum number of threads reading and decrypting blocks during a rescan
+static const int MAX_RESCAN_THREADS = 16;
+//! Blocks a rescan reads ahead before it looks up the rest of the chain again
+static const unsigned int RESCAN_BATCH_BLOCKS = 1000;
 //! Largest (in bytes) free transaction we're willing to create
 static const unsigned int MAX_FREE_TRANSACTION_CREATE_SIZE = 1000;
 //! Size of witness cache
@@ -80,6 +87,7 @@ class CReserveKey;
 class CScript;
 class CTxMemPool;
 class CWalletTx;
+class CWalletRescanReserver;
 
 /** (client) version numbers for particular wallet features */
 enum WalletFeature
@@ -826,6 +834,14 @@ private:
     int64_t nLastResend;
     bool fBroadcastTransactions;
 
+    std::atomic<bool> fAbortRescan;
+    std::atomic<bool> fScanningWallet;
+    //! held by a CWalletRescanReserver, so that only one rescan runs at a time
+    std::atomic<bool> fRescanReserved;
+    friend class CWalletRescanReserver;
+    //! the last block a rescan applied to the wallet; ChainTip leaves blocks past it to the running rescan
+    const CBlockIndex *pindexRescanned;
+
     template <class T>
     using TxSpendMap = std::multimap<T, uint256>;
     /**
@@ -843,6 +859,23 @@ private:
     TxNullifiers mapTxSproutNullifiers;
     TxNullifiers mapTxSaplingNullifiers;
 
+    /**
+     * Wallet transactions with at least one unspent transparent output that is ours or watched.
+     * Balances and coin selection only visit these. The set is kept current as transactions and
+     * spends are added, and is rebuilt on next use after events that can change the spent or mine
+     * state of older outputs (conflicts, erasures, imports and identity changes).
+     *
+     * Disconnected blocks reach the wallet through ChainTip on the validation interface queue, so
+     * GetUnspentTxs also rebuilds the set when the tip it was last used with left the active chain.
+     * The set follows a reorg at once; transactions in new blocks still arrive through the queue.
+     */
+    mutable std::set<uint256> setUnspentTxs;
+    //! transactions whose outputs or spends changed since setUnspentTxs was last brought up to date
+    mutable std::set<uint256> setUnspentTxsToCheck;
+    mutable bool fUnspentTxsStale;
+    //! the chain tip setUnspentTxs was last brought up to date with
+    mutable const CBlockIndex *pindexUnspentTxs;
+
     std::vector<CTransaction> pendingSaplingMigrationTxs;
     AsyncRPCOperationId saplingMigrationOperationId;
 
@@ -851,6 +884,29 @@ private:
     void AddToSaplingSpends(const uint256& nullifier, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
 
+    bool HasUnsettledOutputs(const uint256& wtxid, const CWalletTx& wtx) const;
+    void MarkUnspentTxsStale() const { LOCK(cs_wallet); fUnspentTxsStale = true; setUnspentTxsToCheck.clear(); }
+    void CheckUnspentTx(const uint256& wtxid) const { if (!fUnspentTxsStale) setUnspentTxsToCheck.insert(wtxid); }
+
+    /**
+     * The wallet transactions whose notes IncrementNoteWitnesses and DecrementNoteWitnesses keep
+     * up to date, so that connecting a block does not walk all of mapWallet. A transaction leaves
+     * the set once all of its notes are spent deeper than WITNESS_CACHE_SIZE. Guarded by cs_wallet.
+     */
+    std::set<uint256> setNoteTxs;
+    void AddToNoteTxs(const uint256& wtxid, const CWalletTx& wtx)
+    {
+        if (!wtx.mapSproutNoteData.empty() || !wtx.mapSaplingNoteData.empty())
+            setNoteTxs.insert(wtxid);
+    }
+
+    //! depth of the deepest wallet transaction spending nullifier, -1 if it is unspent
+    int GetSpendDepth(const TxNullifiers& mapTxNullifiers, const uint256& nullifier) const;
+    //! drop the witness caches of notes spent deeper than any reorg the cache can undo, returns
+    //! true if that is all of them
+    template<typename NoteDataMap>
+    bool PruneSpentNoteWitnesses(NoteDataMap& noteDataMap, const TxNullifiers& mapTxNullifiers);
+
 public:
     /*
      * Size of the incremental witness cache for the notes in our wallet.
@@ -866,6 +922,13 @@ public:
 protected:
     /**
      * pindex is the new tip being connected.
+     *
+     * Each unspent note keeps its own cache of one witness per block, because the spend paths
+     * (GetSproutNoteWitnesses, GetSaplingNoteWitnesses) and DecrementNoteWitnesses read those
+     * witnesses directly and they are persisted with the wallet transactions. Only the
+     * transactions in setNoteTxs are visited, so the cost per block is one witness copy per
+     * unspent note plus one append per note and commitment in the block; transactions whose
+     * notes are all spent deeper than WITNESS_CACHE_SIZE are dropped from setNoteTxs.
      */
     void IncrementNoteWitnesses(const CBlockIndex* pindex,
                                 const CBlock* pblock,
@@ -875,6 +938,11 @@ protected:
      * pindex is the old tip being disconnected.
      */
     void DecrementNoteWitnesses(const CBlockIndex* pindex);
+    /**
+     * The wallet transactions with unspent outputs, brought up to date with the active chain.
+     * Requires cs_main and cs_wallet.
+     */
+    const std::set<uint256>& GetUnspentTxs() const;
 
     template <typename WalletDB>
     void SetBestChainINTERNAL(WalletDB& walletdb, const CBlockLocator& loc) {
@@ -987,6 +1055,12 @@ public:
         nLastResend = 0;
         nTimeFirstKey = 0;
         fBroadcastTransactions = false;
+        fAbortRescan = false;
+        fScanningWallet = false;
+        fRescanReserved = false;
+        pindexRescanned = NULL;
+        fUnspentTxsStale = true;
+        pindexUnspentTxs = NULL;
         nWitnessCacheSize = 0;
     }
 
@@ -1229,12 +1303,22 @@ public:
     void RescanWallet();
     std::pair<bool, bool> CheckAuthority(const CIdentity &identity);
     bool MarkIdentityDirty(const CIdentityID &idID);
-    bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate, bool isRescan);
+    /**
+     * pSaplingNotes, when given, holds the result of FindMySaplingNotes(tx) computed ahead of time,
+     * which lets ScanForWalletTransactions trial decrypt blocks on several threads.
+     */
+    bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate, bool isRescan,
+                                  const std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> *pSaplingNotes = NULL);
     void WitnessNoteCommitment(
          std::vector<uint256> commitments,
          std::vector<boost::optional<SproutWitness>>& witnesses,
          uint256 &final_anchor);
-    int ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate = false);
+    //! Scan from pindexStart, or the genesis block if NULL, to the tip, taking cs_main one block at a time.
+    //! The caller must have reserved the wallet with reserver first.
+    int ScanForWalletTransactions(CBlockIndex* pindexStart, const CWalletRescanReserver& reserver, bool fUpdate = false);
+    //! Stop a running ScanForWalletTransactions at the next block, returns false if there was none
+    bool AbortRescan() { if (!fScanningWallet) return false; fAbortRescan = true; return true; }
+    bool IsScanning() const { return fScanningWallet; }
     void ReacceptWalletTransactions();
     void ResendWalletTransactions(int64_t nBestBlockTime);
     std::vector<uint256> ResendWalletTransactionsBefore(int64_t nTime);
@@ -1455,6 +1539,35 @@ public:
     static bool GetAndValidateSaplingZAddress(const std::string &addressStr, libzcash::PaymentAddress &zaddress);
 };
 
+/**
+ * Reserves a wallet for one rescan, which is released when this goes out of scope. Two rescans
+ * would both add the same blocks to the note witness caches, so a second one must fail instead.
+ */
+class CWalletRescanReserver
+{
+    CWallet* pwallet;
+    bool fReserved;
+public:
+    explicit CWalletRescanReserver(CWallet* pwalletIn) : pwallet(pwalletIn), fReserved(false) {}
+
+    //! returns false if another rescan holds the wallet
+    bool Reserve()
+    {
+        assert(!fReserved);
+        bool fExpected = false;
+        fReserved = pwallet->fRescanReserved.compare_exchange_strong(fExpected, true);
+        return fReserved;
+    }
+
+    bool IsReserved() const { return fReserved; }
+
+    ~CWalletRescanReserver()
+    {
+        if (fReserved)
+            pwallet->fRescanReserved = false;
+    }
+};
+
 /** A key allocated from the key pool. */
 class CReserveKey : public CReserveScript
 {
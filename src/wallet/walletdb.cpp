@@ -314,7 +314,7 @@ void CWalletDB::ListAccountCreditDebit(const string& strAccount, list<CAccountin
 {
     bool fAllAccounts = (strAccount == "*");
 
-    Dbc* pcursor = GetCursor();
+    CDBCursor* pcursor = GetCursor();
     if (!pcursor)
         throw runtime_error("CWalletDB::ListAccountCreditDebit(): cannot create DB cursor");
     unsigned int fFlags = DB_SET_RANGE;
@@ -911,7 +911,7 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
         }
 
         // Get cursor
-        Dbc* pcursor = GetCursor();
+        CDBCursor* pcursor = GetCursor();
         if (!pcursor)
         {
             LogPrintf("Error getting wallet database cursor\n");
@@ -1020,7 +1020,7 @@ DBErrors CWalletDB::FindWalletTxToZap(CWallet* pwallet, vector<uint256>& vTxHash
         }
 
         // Get cursor
-        Dbc* pcursor = GetCursor();
+        CDBCursor* pcursor = GetCursor();
         if (!pcursor)
         {
             LogPrintf("Error getting wallet database cursor\n");
@@ -1106,6 +1106,9 @@ void ThreadFlushWalletDB(const string& strFile)
     fOneThread = true;
     if (!GetBoolArg("-flushwallet", true))
         return;
+    // every write to the wallet log is already durable
+    if (CWalletLog::IsEnabled())
+        return;
 
     unsigned int nLastSeen = nWalletDBUpdated;
     unsigned int nLastFlushed = nWalletDBUpdated;
@@ -1161,6 +1164,18 @@ bool BackupWallet(const CWallet& wallet, const string& strDest)
 {
     if (!wallet.fFileBacked)
         return false;
+    if (CWalletLog::IsEnabled())
+    {
+        // the copy is itself a wallet log, restored by naming it <wallet file>.log
+        CWalletLog* plog = CWalletLog::Get(wallet.strWalletFile);
+        boost::filesystem::path pathDest(strDest);
+        if (boost::filesystem::is_directory(pathDest))
+            pathDest /= CWalletLog::GetPath(wallet.strWalletFile).filename();
+        if (!plog || !plog->Backup(pathDest))
+            return false;
+        LogPrintf("copied %s to %s\n", CWalletLog::GetPath(wallet.strWalletFile).string(), pathDest.string());
+        return true;
+    }
     while (true)
     {
         {
@@ -0,0 +1,373 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#include "wallet/walletlog.h"
+
+#include "clientversion.h"
+#include "crypto/common.h"
+#include "hash.h"
+#include "streams.h"
+#include "support/cleanse.h"
+#include "util.h"
+
+#include <string.h>
+
+#include <boost/filesystem.hpp>
+
+using namespace std;
+
+static const unsigned char WALLETLOG_MAGIC[8] = {'V', 'R', 'S', 'C', 'W', 'L', 'G', '1'};
+static const uint8_t WALLETLOG_ERASE = 0x01;
+static const uint8_t WALLETLOG_BATCH_END = 0x02;
+//! bytes framing each record: its size before and its checksum after
+static const size_t WALLETLOG_RECORD_OVERHEAD = 8;
+//! a record size larger than this can only be corruption
+static const uint32_t WALLETLOG_MAX_RECORD_SIZE = 64 * 1024 * 1024;
+
+static boost::mutex csWalletLogs;
+static map<string, CWalletLog*> mapWalletLogs;
+
+static uint32_t RecordChecksum(const unsigned char* pbegin, size_t nSize)
+{
+    uint256 hash = Hash(pbegin, pbegin + nSize);
+    return ReadLE32(hash.begin());
+}
+
+// [payload size][flags, key, value][checksum of size and payload]
+static void AppendRecord(vector<unsigned char>& vch, const CWalletLog::Record& record, bool fBatchEnd)
+{
+    CDataStream ssPayload(SER_DISK, CLIENT_VERSION);
+    uint8_t flags = (record.fErase ? WALLETLOG_ERASE : 0) | (fBatchEnd ? WALLETLOG_BATCH_END : 0);
+    ssPayload << flags << record.key;
+    if (!record.fErase)
+        ssPayload << record.value;
+
+    size_t nStart = vch.size();
+    vch.resize(nStart + 4);
+    WriteLE32(&vch[nStart], ssPayload.size());
+    vch.insert(vch.end(), ssPayload.begin(), ssPayload.end());
+    uint32_t nChecksum = RecordChecksum(&vch[nStart], vch.size() - nStart);
+    vch.resize(vch.size() + 4);
+    WriteLE32(&vch[vch.size() - 4], nChecksum);
+}
+
+static uint64_t LiveSize(const CWalletLog::Data& key, const CWalletLog::Data& value)
+{
+    return key.size() + value.size() + WALLETLOG_RECORD_OVERHEAD + 11;
+}
+
+bool CWalletLog::IsEnabled()
+{
+    return GetArg("-walletstore", DEFAULT_WALLET_STORE) == "log";
+}
+
+boost::filesystem::path CWalletLog::GetPath(const std::string& strFile)
+{
+    return GetDataDir() / (strFile + ".log");
+}
+
+CWalletLog* CWalletLog::Get(const std::string& strFile)
+{
+    boost::unique_lock<boost::mutex> lock(csWalletLogs);
+    map<string, CWalletLog*>::iterator it = mapWalletLogs.find(strFile);
+    if (it != mapWalletLogs.end())
+        return it->second;
+
+    int64_t nStart = GetTimeMillis();
+    CWalletLog* plog = new CWalletLog(GetPath(strFile));
+    if (!plog->Open())
+    {
+        delete plog;
+        return NULL;
+    }
+    LogPrintf("Opened wallet log %s, %u records, %u bytes, %dms\n",
+              plog->path.string(), plog->mapRecords.size(), plog->nFileSize, GetTimeMillis() - nStart);
+    mapWalletLogs[strFile] = plog;
+    return plog;
+}
+
+void CWalletLog::CloseAll()
+{
+    boost::unique_lock<boost::mutex> lock(csWalletLogs);
+    for (map<string, CWalletLog*>::iterator it = mapWalletLogs.begin(); it != mapWalletLogs.end(); ++it)
+        delete it->second;
+    mapWalletLogs.clear();
+}
+
+bool CWalletLog::WriteFile(const boost::filesystem::path& pathOut, const DataMap& mapOut)
+{
+    vector<unsigned char> vch(WALLETLOG_MAGIC, WALLETLOG_MAGIC + sizeof(WALLETLOG_MAGIC));
+    size_t nRecord = 0;
+    for (DataMap::const_iterator it = mapOut.begin(); it != mapOut.end(); ++it)
+        AppendRecord(vch, Record(it->first, it->second, false), ++nRecord == mapOut.size());
+
+    FILE* fileOut = fopen(pathOut.string().c_str(), "wb");
+    bool fSuccess = fileOut && fwrite(&vch[0], 1, vch.size(), fileOut) == vch.size();
+    if (fileOut)
+    {
+        FileCommit(fileOut);
+        fclose(fileOut);
+    }
+    memory_cleanse(&vch[0], vch.size());
+    if (!fSuccess)
+        return error("%s: failed to write %s", __func__, pathOut.string());
+    return true;
+}
+
+CWalletLog::CWalletLog(const boost::filesystem::path& pathIn) :
+    path(pathIn), file(NULL), nFileSize(0), nLiveSize(0), nWrittenSeq(0), nSyncedSeq(0), fSyncing(false)
+{
+}
+
+CWalletLog::~CWalletLog()
+{
+    Close();
+}
+
+bool CWalletLog::Open()
+{
+    vector<unsigned char> vch;
+    if (boost::filesystem::exists(path))
+    {
+        FILE* fileIn = fopen(path.string().c_str(), "rb");
+        if (!fileIn)
+            return error("%s: failed to open %s", __func__, path.string());
+        vch.resize(boost::filesystem::file_size(path));
+        bool fRead = vch.empty() || fread(&vch[0], 1, vch.size(), fileIn) == vch.size();
+        fclose(fileIn);
+        if (!fRead)
+            return error("%s: failed to read %s", __func__, path.string());
+    }
+
+    if (vch.empty())
+    {
+        if (!WriteFile(path, DataMap()))
+            return false;
+        nFileSize = sizeof(WALLETLOG_MAGIC);
+    }
+    else
+    {
+        if (vch.size() < sizeof(WALLETLOG_MAGIC) || memcmp(&vch[0], WALLETLOG_MAGIC, sizeof(WALLETLOG_MAGIC)))
+            return error("%s: %s is not a wallet log", __func__, path.string());
+
+        // replay complete batches, stopping at the first record that is short or fails its checksum
+        size_t nPos = sizeof(WALLETLOG_MAGIC);
+        size_t nValid = nPos;
+        vector<Record> vPending;
+        while (nPos + WALLETLOG_RECORD_OVERHEAD <= vch.size())
+        {
+            uint32_t nSize = ReadLE32(&vch[nPos]);
+            if (nSize > WALLETLOG_MAX_RECORD_SIZE || nPos + WALLETLOG_RECORD_OVERHEAD + nSize > vch.size() ||
+                ReadLE32(&vch[nPos + 4 + nSize]) != RecordChecksum(&vch[nPos], 4 + nSize))
+                break;
+
+            uint8_t flags;
+            Data key, value;
+            try {
+                CDataStream ss((const char*)&vch[nPos + 4], (const char*)&vch[nPos + 4 + nSize], SER_DISK, CLIENT_VERSION);
+                ss >> flags >> key;
+                if (!(flags & WALLETLOG_ERASE))
+                    ss >> value;
+            } catch (const std::exception&) {
+                break;
+            }
+            vPending.push_back(Record(key, value, (flags & WALLETLOG_ERASE) != 0));
+            nPos += WALLETLOG_RECORD_OVERHEAD + nSize;
+
+            if (flags & WALLETLOG_BATCH_END)
+            {
+                for (const Record& record : vPending)
+                    Apply(record);
+                vPending.clear();
+                nValid = nPos;
+            }
+        }
+        memory_cleanse(&vch[0], vch.size());
+
+        if (nValid < vch.size())
+        {
+            LogPrintf("%s: dropping %u bytes of incomplete or corrupt records at the end of %s\n",
+                      __func__, vch.size() - nValid, path.string());
+            boost::filesystem::resize_file(path, nValid);
+        }
+        nFileSize = nValid;
+    }
+
+    file = fopen(path.string().c_str(), "ab");
+    if (!file)
+        return error("%s: failed to open %s for writing", __func__, path.string());
+    return true;
+}
+
+void CWalletLog::Close()
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    while (fSyncing)
+        condSynced.wait(lock);
+    if (file)
+    {
+        FileCommit(file);
+        fclose(file);
+        file = NULL;
+    }
+    for (DataMap::iterator it = mapRecords.begin(); it != mapRecords.end(); ++it)
+        memory_cleanse(it->second.data(), it->second.size());
+    mapRecords.clear();
+}
+
+void CWalletLog::Apply(const Record& record)
+{
+    DataMap::iterator it = mapRecords.find(record.key);
+    if (it != mapRecords.end())
+    {
+        nLiveSize -= LiveSize(it->first, it->second);
+        memory_cleanse(it->second.data(), it->second.size());
+        if (record.fErase)
+        {
+            mapRecords.erase(it);
+            return;
+        }
+        it->second = record.value;
+    }
+    else
+    {
+        if (record.fErase)
+            return;
+        mapRecords.insert(make_pair(record.key, record.value));
+    }
+    nLiveSize += LiveSize(record.key, record.value);
+}
+
+bool CWalletLog::Read(const Data& key, Data& value) const
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    DataMap::const_iterator it = mapRecords.find(key);
+    if (it == mapRecords.end())
+        return false;
+    value = it->second;
+    return true;
+}
+
+bool CWalletLog::Exists(const Data& key) const
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    return mapRecords.count(key) != 0;
+}
+
+bool CWalletLog::Seek(const Data& key, bool fAfter, Data& keyRet, Data& valueRet) const
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    DataMap::const_iterator it = fAfter ? mapRecords.upper_bound(key) : mapRecords.lower_bound(key);
+    if (it == mapRecords.end())
+        return false;
+    keyRet = it->first;
+    valueRet = it->second;
+    return true;
+}
+
+bool CWalletLog::Commit(const std::vector<Record>& vBatch)
+{
+    if (vBatch.empty())
+        return true;
+
+    vector<unsigned char> vch;
+    for (size_t i = 0; i < vBatch.size(); i++)
+        AppendRecord(vch, vBatch[i], i + 1 == vBatch.size());
+
+    boost::unique_lock<boost::mutex> lock(cs);
+    if (!file)
+    {
+        memory_cleanse(&vch[0], vch.size());
+        return false;
+    }
+    bool fWritten = fwrite(&vch[0], 1, vch.size(), file) == vch.size() && fflush(file) == 0;
+    memory_cleanse(&vch[0], vch.size());
+    if (!fWritten)
+    {
+        // a partial record would hide everything appended after it, so refuse further writes
+        fclose(file);
+        file = NULL;
+        return error("%s: failed to append to %s", __func__, path.string());
+    }
+    for (const Record& record : vBatch)
+        Apply(record);
+    nFileSize += vch.size();
+    uint64_t nSeq = ++nWrittenSeq;
+
+    // group commit: one writer syncs everything appended so far, those arriving meanwhile share the next sync
+    while (nSyncedSeq < nSeq)
+    {
+        if (fSyncing)
+        {
+            condSynced.wait(lock);
+            continue;
+        }
+        fSyncing = true;
+        uint64_t nTargetSeq = nWrittenSeq;
+        FILE* fileSync = file;
+        lock.unlock();
+        FileCommit(fileSync);
+        lock.lock();
+        fSyncing = false;
+        nSyncedSeq = std::max(nSyncedSeq, nTargetSeq);
+        condSynced.notify_all();
+    }
+
+    if (nFileSize > 2 * nLiveSize + WALLETLOG_COMPACT_SLACK)
+        CompactLocked(lock, NULL);
+    return true;
+}
+
+bool CWalletLog::Compact(const char* pszSkip)
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    return CompactLocked(lock, pszSkip);
+}
+
+bool CWalletLog::CompactLocked(boost::unique_lock<boost::mutex>& lock, const char* pszSkip)
+{
+    while (fSyncing)
+        condSynced.wait(lock);
+    if (!file)
+        return false;
+
+    int64_t nStart = GetTimeMillis();
+    if (pszSkip)
+    {
+        size_t nSkip = strlen(pszSkip);
+        for (DataMap::iterator it = mapRecords.begin(); it != mapRecords.end();)
+        {
+            if (memcmp(it->first.data(), pszSkip, std::min(it->first.size(), nSkip)) == 0)
+            {
+                nLiveSize -= LiveSize(it->first, it->second);
+                memory_cleanse(it->second.data(), it->second.size());
+                mapRecords.erase(it++);
+            }
+            else
+                ++it;
+        }
+    }
+
+    boost::filesystem::path pathNew = path.string() + ".new";
+    if (!WriteFile(pathNew, mapRecords))
+        return false;
+    fclose(file);
+    file = NULL;
+    bool fRenamed = RenameOver(pathNew, path);
+    file = fopen(path.string().c_str(), "ab");
+    if (!fRenamed || !file)
+        return error("%s: failed to replace %s", __func__, path.string());
+
+    uint64_t nOldSize = nFileSize;
+    nFileSize = boost::filesystem::file_size(path);
+    nSyncedSeq = nWrittenSeq;
+    LogPrint("db", "%s: compacted %s from %u to %u bytes in %dms\n", __func__, path.string(), nOldSize, nFileSize, GetTimeMillis() - nStart);
+    return true;
+}
+
+bool CWalletLog::Backup(const boost::filesystem::path& pathOut) const
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    return WriteFile(pathOut, mapRecords);
+}
@@ -0,0 +1,91 @@
+// Copyright (c) 2020 The Verus developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+#ifndef VERUS_WALLET_WALLETLOG_H
+#define VERUS_WALLET_WALLETLOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+//! -walletstore default, "bdb" keeps wallet.dat in Berkeley DB, "log" uses CWalletLog
+static const char * const DEFAULT_WALLET_STORE = "bdb";
+//! The log is compacted once it holds this many bytes more than twice its live records
+static const uint64_t WALLETLOG_COMPACT_SLACK = 16 * 1024 * 1024;
+
+/**
+ * Append-only, checksummed key/value store that holds a wallet in place of its Berkeley DB file.
+ *
+ * All records are kept in memory in key order, as the BDB btree returns them, and every change is
+ * appended to <wallet file>.log. A batch of records only takes effect once its last record is
+ * complete, so a torn tail left by a crash is dropped on the next open. Committing writers that
+ * arrive while an fsync is running share the next one, and the file is rewritten with only the
+ * live records when the overwritten and erased ones dominate.
+ */
+class CWalletLog
+{
+public:
+    typedef std::vector<unsigned char> Data;
+    typedef std::map<Data, Data> DataMap;
+
+    struct Record
+    {
+        Data key;
+        Data value;
+        bool fErase;
+
+        Record(const Data& keyIn, const Data& valueIn, bool fEraseIn) : key(keyIn), value(valueIn), fErase(fEraseIn) {}
+    };
+
+    //! true if -walletstore=log
+    static bool IsEnabled();
+    static boost::filesystem::path GetPath(const std::string& strFile);
+    //! the open log for strFile, replaying it on first use, NULL if it cannot be opened
+    static CWalletLog* Get(const std::string& strFile);
+    static void CloseAll();
+    //! writes records as a complete log at path, replacing any file already there
+    static bool WriteFile(const boost::filesystem::path& path, const DataMap& mapRecords);
+
+    bool Read(const Data& key, Data& value) const;
+    bool Exists(const Data& key) const;
+    //! first record with a key at or after key (strictly after if fAfter), false past the end
+    bool Seek(const Data& key, bool fAfter, Data& keyRet, Data& valueRet) const;
+    //! appends vBatch as one atomic batch and returns once it is on disk
+    bool Commit(const std::vector<Record>& vBatch);
+    //! rewrites the file with only the live records, leaving out keys starting with pszSkip
+    bool Compact(const char* pszSkip = NULL);
+    //! writes a compacted copy of the log to path
+    bool Backup(const boost::filesystem::path& path) const;
+
+private:
+    boost::filesystem::path path;
+    mutable boost::mutex cs;
+    boost::condition_variable condSynced;
+    FILE* file;
+    DataMap mapRecords;
+    uint64_t nFileSize;
+    uint64_t nLiveSize;
+    uint64_t nWrittenSeq;
+    uint64_t nSyncedSeq;
+    bool fSyncing;
+
+    explicit CWalletLog(const boost::filesystem::path& pathIn);
+    ~CWalletLog();
+    CWalletLog(const CWalletLog&);
+    void operator=(const CWalletLog&);
+
+    bool Open();
+    void Close();
+    void Apply(const Record& record);
+    bool CompactLocked(boost::unique_lock<boost::mutex>& lock, const char* pszSkip);
+};
+
+#endif // VERUS_WALLET_WALLETLOG_H
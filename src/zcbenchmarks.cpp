@@ -24,6 +24,7 @@
 #include "streams.h"
 #include "txdb.h"
 #include "utiltest.h"
+#include "wallet/coinselection.h"
 #include "wallet/wallet.h"
 
 #include "zcbenchmarks.h"
@@ -295,7 +296,8 @@ double benchmark_large_tx(size_t nInputs)
 // are checking worst-case scenarios. In both we add n keys to a wallet, 
 // create a transaction using a key not in our original list of n, and then
 // check that the transaction is not associated with any of the keys in our 
-// wallet. We call assert(...) to ensure that this is true.
+// wallet. We call assert(...) to ensure that this is true. The Sapling one
+// checks nTxs transactions so throughput can be compared across key counts.
 double benchmark_try_decrypt_sprout_notes(size_t nKeys)
 {
     CWallet wallet;
@@ -315,7 +317,7 @@ double benchmark_try_decrypt_sprout_notes(size_t nKeys)
     return timer_stop(tv_start);
 }
 
-double benchmark_try_decrypt_sapling_notes(size_t nKeys)
+double benchmark_try_decrypt_sapling_notes(size_t nKeys, size_t nTxs)
 {
     // Set params
     auto consensusParams = Params().GetConsensus();
@@ -335,8 +337,10 @@ double benchmark_try_decrypt_sapling_notes(size_t nKeys)
 
     struct timeval tv_start;
     timer_start(tv_start);
-    auto noteDataMapAndAddressesToAdd = wallet.FindMySaplingNotes(tx);
-    assert(noteDataMapAndAddressesToAdd.first.empty());
+    for (size_t i = 0; i < nTxs; i++) {
+        auto noteDataMapAndAddressesToAdd = wallet.FindMySaplingNotes(tx);
+        assert(noteDataMapAndAddressesToAdd.first.empty());
+    }
     return timer_stop(tv_start);
 }
 
@@ -617,6 +621,34 @@ double benchmark_listunspent()
     return timer_stop(tv_start);
 }
 
+// Branch and bound selection over a synthetic wallet of nCoins outputs holding nCurrencies
+// currencies each, for a target that three of the outputs can pay without change
+double benchmark_select_coins_bnb(size_t nCoins, size_t nCurrencies)
+{
+    std::vector<CAmount> vAmounts(nCoins * nCurrencies);
+    seed_insecure_rand();
+    for (CAmount &amount : vAmounts) {
+        amount = (CAmount)(insecure_rand() % (100 * COIN)) + 1;
+    }
+
+    std::vector<CAmount> vTarget(nCurrencies, 0);
+    for (int i = 0; i < 3 && nCoins; i++) {
+        size_t n = insecure_rand() % nCoins;
+        for (size_t j = 0; j < nCurrencies; j++) {
+            vTarget[j] += vAmounts[n * nCurrencies + j];
+        }
+    }
+    // the last column plays the native currency, which may overshoot by dust
+    std::vector<CAmount> vWindow(nCurrencies, 0);
+    vWindow.back() = CTxOut(0, GetScriptForDestination(CKeyID())).GetDustThreshold(::minRelayTxFee) - 1;
+
+    std::vector<char> vfSelected;
+    struct timeval tv_start;
+    timer_start(tv_start);
+    SelectCoinsBnB(vAmounts, vTarget, vWindow, vfSelected);
+    return timer_stop(tv_start);
+}
+
 double benchmark_create_sapling_spend()
 {
     auto sk = libzcash::SaplingSpendingKey::random();